@@ -0,0 +1,86 @@
+/**
+ * @file AllocAudit.h
+ * @brief Audit delle allocazioni dinamiche a regime: dopo setup() l'heap non si tocca.
+ *
+ * Con ALLOC_AUDIT_ENABLED gli operatori new/delete globali sono sostituiti
+ * (AllocAudit.cpp) e memAlloc()/memFree() passano di qui. Finché l'audit non
+ * è armato non cambia nulla; da arm() in poi ogni allocazione viene contata,
+ * con i byte e l'indirizzo di chiamata dei primi ALLOC_AUDIT_MAX_CALLERS
+ * colpevoli (da risolvere con addr2line sul firmware).
+ *
+ * Sul robot arm() va in fondo a setup() e [a] stampa il rapporto, con la
+ * variazione dell'heap libero e del blocco più grande dall'armamento: copre
+ * anche le malloc() delle librerie C, che l'hook non vede. Nei test host un
+ * percorso a regime si esegue armato e deve lasciare allocations() a zero;
+ * setViolationHandler() permette di fermarsi alla prima allocazione.
+ *
+ * Il gancio è sicuro da qualunque task: contatori atomici, nessun lock,
+ * nessuna stampa (stampare dall'interno di new può allocare a sua volta).
+ *
+ * Nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "Constants.h"
+
+// Chiamato alla prima allocazione (e alle successive) con l'audit armato
+typedef void (*AllocViolationHandler)(size_t bytes, uintptr_t caller);
+
+class AllocAudit {
+public:
+    AllocAudit();
+
+    // Da qui in poi ogni allocazione è una violazione; azzera i contatori
+    void arm();
+    void disarm() { _armed.store(false, std::memory_order_release); }
+    bool isArmed() const { return _armed.load(std::memory_order_relaxed); }
+
+    void setViolationHandler(AllocViolationHandler handler) { _handler = handler; }
+
+    // Ganci (operator new/delete, memAlloc/memFree): costano un caricamento atomico se disarmato
+    void onAlloc(size_t bytes, uintptr_t caller);
+    void onFree();
+
+    uint32_t allocations() const { return _allocations.load(std::memory_order_relaxed); }
+    uint32_t frees() const { return _frees.load(std::memory_order_relaxed); }
+    uint32_t bytes() const { return _bytes.load(std::memory_order_relaxed); }
+    // Indirizzi di chiamata registrati (al massimo ALLOC_AUDIT_MAX_CALLERS)
+    uint8_t callerCount() const;
+    uintptr_t caller(uint8_t i) const { return _callers[i].load(std::memory_order_relaxed); }
+
+    void print() const;
+
+    /**
+     * @brief Sospende l'audit nello scope (comandi di debug che scrivono su
+     * flash, es. LittleFS). Sospende per tutti i task: solo fuori dai percorsi caldi.
+     */
+    class Exempt {
+    public:
+        Exempt();
+        ~Exempt();
+
+    private:
+        bool _wasArmed;
+    };
+
+private:
+    std::atomic<bool>      _armed;
+    std::atomic<uint32_t>  _allocations;
+    std::atomic<uint32_t>  _frees;
+    std::atomic<uint32_t>  _bytes;
+    std::atomic<uint32_t>  _callerSlots;  // Posti di _callers già presi (può superare il massimo)
+    std::atomic<uintptr_t> _callers[ALLOC_AUDIT_MAX_CALLERS];
+    AllocViolationHandler  _handler;
+
+    // Heap all'armamento (0 su host)
+    size_t _freeAtArm;
+    size_t _largestAtArm;
+};
+
+// Istanza globale usata dai ganci
+AllocAudit& allocAudit();
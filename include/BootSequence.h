@@ -0,0 +1,71 @@
+/**
+ * @file BootSequence.h
+ * @brief Avvio non bloccante dei sensori, con le attese sovrapposte.
+ *
+ * Ogni manager espone bootStep(): un passo breve che ritorna BOOT_PENDING
+ * mentre aspetta (reset IMU, boot firmware ToF, boot AS7262). La sequenza
+ * chiama a turno i passi di tutti i componenti, così la raccolta del bias
+ * IMU avanza mentre i ToF si avviano e l'AS7262 si configura nel mezzo.
+ * Ogni cambio di fase viene registrato in una timeline stampabile.
+ */
+
+#pragma once
+
+#include "Constants.h"
+#include "Hal.h"
+#include "SensorTypes.h"
+#include "ToFManager.h"
+#include "ImuManager.h"
+#include "ColorManager.h"
+
+class BootSequence {
+public:
+    enum Component : uint8_t { BOOT_IMU = 0, BOOT_TOF, BOOT_COLOR, BOOT_COMPONENTS };
+
+    // nullptr = componente assente (come in SensorTask)
+    BootSequence(ToFManager* tof, ImuManager* imu, ColorManager* color);
+
+    /**
+     * @brief Un giro di passi su tutti i componenti ancora in avvio. Non bloccante.
+     * @return true quando tutti i componenti sono conclusi (pronti o in errore).
+     */
+    bool step();
+
+    /**
+     * @brief Esegue step() fino alla fine (o BOOT_TIMEOUT_MS), cedendo la CPU tra un giro e l'altro.
+     * @return true se tutti i componenti presenti sono pronti.
+     */
+    bool run();
+
+    BootStatus status(Component c) const { return _status[c]; }
+    bool isReady(Component c) const { return _status[c] == BOOT_DONE; }
+    uint32_t totalUs() const { return _endUs - _startUs; }
+
+    void printTimeline() const;
+
+private:
+    struct Phase {
+        Component   component;
+        const char* name;     // Stringa statica fornita dal manager
+        uint32_t    startUs;
+        uint32_t    endUs;
+    };
+
+    ToFManager*   _tof;
+    ImuManager*   _imu;
+    ColorManager* _color;
+
+    BootStatus  _status[BOOT_COMPONENTS];
+    const char* _currentPhase[BOOT_COMPONENTS];
+    int8_t      _openPhase[BOOT_COMPONENTS]; // Indice in _phases, -1 se nessuna
+
+    Phase    _phases[BOOT_MAX_PHASES];
+    uint8_t  _phaseCount;
+    bool     _started;
+    uint32_t _startUs;
+    uint32_t _endUs;
+
+    bool isPresent(Component c) const;
+    void track(Component c, const char* phase, uint32_t nowUs);
+    static const char* componentName(Component c);
+};
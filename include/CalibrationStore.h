@@ -0,0 +1,68 @@
+/**
+ * @file CalibrationStore.h
+ * @brief Serializzazione della calibrazione spettrale in un unico blob versionato.
+ *
+ * Un profilo (es. una per illuminazione di arena) è una struttura packed con
+ * magic, versione, dimensione e CRC-32: si salva e si carica con una sola
+ * putBytes()/getBytes() invece di una chiave NVS per ogni float.
+ * Qui c'è solo la codifica, senza Preferences: testabile su host.
+ * L'I/O su NVS e la migrazione dalle vecchie chiavi sono in ColorManager.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+#include "SpectralClassifier.h"
+
+#define CALIB_BLOB_MAGIC   0x31424C43u // "CLB1" in little-endian
+#define CALIB_BLOB_VERSION 1
+
+enum CalibrationStatus : uint8_t {
+    CALIB_OK = 0,
+    CALIB_BAD_SIZE,      // Blob troncato o di un'altra struttura
+    CALIB_BAD_MAGIC,     // Non è un blob di calibrazione
+    CALIB_BAD_VERSION,   // Versione non supportata
+    CALIB_BAD_CRC,       // Dati corrotti (scrittura interrotta, flash usurata)
+    CALIB_BAD_CONTENT    // CRC valido ma tabella incoerente
+};
+
+struct __attribute__((packed)) CalibrationClassRecord {
+    char    name[SPECTRAL_CLASS_NAME_LEN];
+    uint8_t type;    // ColorType
+    uint8_t flags;   // SPECTRAL_*
+    float   channels[CH_COUNT];
+    float   sum;
+};
+
+struct __attribute__((packed)) CalibrationBlob {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;        // sizeof(CalibrationBlob) al momento della scrittura
+    char     profile[CALIB_PROFILE_NAME_LEN];
+    uint8_t  classCount;
+    uint8_t  reserved[3];
+    CalibrationClassRecord classes[COLOR_MAX_CLASSES];
+    uint32_t crc;         // CRC-32 di tutti i byte precedenti
+};
+
+/**
+ * @brief Impacchetta la tabella delle classi in un blob pronto da salvare.
+ */
+void packCalibration(const SpectralClassifier& classifier, const char* profileName, CalibrationBlob& out);
+
+/**
+ * @brief Verifica e carica un blob. Il classificatore viene toccato solo se il blob è valido.
+ * @param profileName Se non nullo, riceve il nome del profilo (CALIB_PROFILE_NAME_LEN byte).
+ */
+CalibrationStatus unpackCalibration(const void* data, size_t len, SpectralClassifier& classifier,
+                                    char* profileName = nullptr);
+
+// Classi predefinite (bianco, nero, rosso, blu) dai profili grezzi
+void loadDefaultClasses(SpectralClassifier& classifier, const SpectralData& white, const SpectralData& black,
+                        const SpectralData& red, const SpectralData& blue);
+
+const char* calibrationStatusName(CalibrationStatus status);
@@ -1,11 +1,14 @@
 #pragma once
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <Adafruit_AS726x.h>
-#include <Preferences.h>
-#include "Pins.h"
 #include "Constants.h"
+#include "DeviceHealth.h"
+#include "FloorEvents.h"
+#include "HoleReflex.h"
+#include "Hal.h"
+#include "SensorTypes.h"
+#include "SpectralClassifier.h"
+#include "CalibrationStore.h"
+#include "Telemetry.h"
 
 // Fallback in case they are not in Constants.h
 #ifndef DEFAULT_BLACK_THRESHOLD
@@ -18,37 +21,39 @@
 #define EMA_ALPHA 0.6f
 #endif
 
-// Indici dei canali spettrali
-enum AS_CH { V = 0, B, G, Y, O, R, CH_COUNT };
-
-enum ColorType {
-    COLOR_NONE = 0,
-    COLOR_BLACK,
-    COLOR_SILVER,
-    COLOR_WHITE,
-    COLOR_RED,
-    COLOR_BLUE
-};
-
-struct RGBColor {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-};
-
-struct SpectralData {
-    float channels[CH_COUNT];
-    float sum;
-};
-
 class ColorManager {
 public:
-    ColorManager();
+    // Sensore e memoria della calibrazione: HalEsp32.h sul robot, HalReplay.h su host
+    ColorManager(SpectralDevice& sensor, HalStorage& storage);
+
+    bool begin(bool ledOn = true);
 
-    bool begin(TwoWire* i2cBus = &Wire, bool ledOn = true);
+    /**
+     * @brief Un passo dell'avvio non bloccante (vedi BootSequence).
+     * Il boot del chip (~1 s di attesa nella libreria) non blocca il chiamante
+     * (vedi SpectralDevice::bootStart()).
+     */
+    BootStatus bootStep(uint32_t nowUs, bool ledOn = true);
+    const char* bootPhase() const; // nullptr a avvio concluso
 
     // Deve essere chiamato il più velocemente possibile nel loop/task
-    void update();
+    // Ritorna true quando è arrivato un nuovo campione spettrale.
+    // Senza campioni da HEALTH_COLOR_STALE_US il chip viene riavviato in
+    // background (bootStart/bootPoll) e riconfigurato; la calibrazione resta.
+    bool update();
+
+    const DeviceHealth& getHealth() const { return _health; }
+
+    /**
+     * @brief Transizioni di colore del pavimento, con debounce e isteresi
+     * (vedi FloorEvents.h). update() classifica ogni campione e pubblica qui:
+     * gli abbonati non devono confrontare getDominantColor() con il valore
+     * precedente. subscribe() va chiamato prima di avviare il task sensori.
+     */
+    FloorEventBus& floorEvents() { return _floorEvents; }
+    // Colore stabile della piastrella (ultimo evento), COLOR_NONE prima del primo
+    ColorType getFloorColor() const { return _floorDetector.stableColor(); }
+    uint32_t getFloorRejected() const { return _floorDetector.rejected(); }
 
     // Hardware Control
     void enableLed(bool state);
@@ -56,9 +61,17 @@ public:
 
     // Calibration
     void calibrate(ColorType type);
+    // Nuovo colore di piastrella dal campione attuale (o ricalibrazione se esiste già)
+    int8_t defineClass(const char* name, bool shadowOk = true);
     void exportCalibrationToSerial() const;
 
-    // Getters
+    // Profili di calibrazione: selezione a runtime, senza riavvio.
+    // Un nome nuovo crea il profilo copiando la calibrazione attuale.
+    bool selectProfile(const char* name);
+    void printProfiles();
+    const char* getProfileName() const;
+
+    // Getters: una sola classificazione per campione, poi O(1)
     bool isBlack();
     bool isSilver();
     bool isWhite();
@@ -66,31 +79,70 @@ public:
     bool isBlue();
 
     ColorType getDominantColor();
+    const SpectralMatch& getMatch();
+    const char* getClassName(int8_t classId) const;
+    uint32_t getSampleGeneration() const;
     RGBColor getVisualRGB() const;
+    static RGBColor toVisualRGB(const SpectralData& data);
 
-    float getTemperature();
+    // Temperatura del chip (°C), letta ogni COLOR_TEMP_INTERVAL_US da update(): nessun accesso al bus
+    float getTemperature() const { return _temperature; }
     const SpectralData& getCurrentData() const;
+    // Istante (micros) della lettura dell'ultimo campione
+    uint32_t getSampleTimeUs() const { return _sampleTimeUs; }
+
+    // Destinazione dei canali grezzi, prima dell'EMA (registratore di volo)
+    void attachRecorder(RecordSink* sink) { _recorder = sink; }
+    // Riflesso sul buco nero: valutato in update() appena il campione arriva,
+    // prima di ogni altro lavoro (vedi HoleReflex.h)
+    void attachReflex(HoleReflex* reflex) { _reflex = reflex; }
     float getBlackThreshold() const;
 
+    // Costo dell'acquisizione: poll, trasferimenti I2C e tempo sul bus per campione
+    void printReadStats() const;
+
 private:
-    Adafruit_AS726x _sensor;
-    Preferences _prefs;
-    TwoWire* _wire;
+    SpectralDevice& _sensor;
+    HalStorage&     _storage;
 
     SpectralData _currentData;
+    uint32_t     _sampleTimeUs;
+    RecordSink*  _recorder;
+    HoleReflex*  _reflex;
+
+    // Tabella delle classi con profili già normalizzati
+    SpectralClassifier _classifier;
+
+    // Cache del risultato: valida finché non arriva un nuovo campione
+    // o la tabella non viene ricalibrata
+    SpectralMatch _match;
+    uint32_t _sampleGeneration;
+    uint32_t _matchGeneration;
+    uint32_t _matchRevision;
 
-    // Calibrated Reference Profiles
-    SpectralData _refWhite;
-    SpectralData _refRed;
-    SpectralData _refBlue;
-    SpectralData _refBlack;
+    // Profilo attivo (slot NVS "p<n>")
+    uint8_t _activeSlot;
+    char    _profileName[CALIB_PROFILE_NAME_LEN];
 
     bool _isMeasuring;
+    bool _ledOn;  // Riapplicato dopo un re-init
     unsigned long _lastUpdate;
 
-    void loadCalibration();
-    void saveCalibration(ColorType type, const SpectralData& data);
+    DeviceHealth _health;
+
+    FloorEventDetector _floorDetector;
+    FloorEventBus      _floorEvents;
+
+    float    _temperature;
+    uint32_t _temperatureUs;  // Ultima lettura (micros)
 
-    // Algoritmo di classificazione spettrale
-    float calculateSpectralDistance(const SpectralData& sample, const SpectralData& reference);
+    // Avvio non bloccante
+    enum BootState : uint8_t { COLOR_BOOT_IDLE, COLOR_BOOT_SENSOR, COLOR_BOOT_DONE, COLOR_BOOT_FAILED };
+    BootState _bootState;
+
+    void recoveryStep(uint32_t nowUs);
+    void loadCalibration();
+    bool saveCalibration();  // false se il blob non è stato scritto
+    CalibrationStatus readSlot(uint8_t slot, SpectralClassifier& out, char* name);
+    bool migrateLegacyCalibration();
 };
\ No newline at end of file
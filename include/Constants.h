@@ -1,23 +1,35 @@
 #pragma once
 
-#include <Arduino.h>
+#include <stdint.h>
 
 /**
  System Constants & Configuration
  Single Source of Truth for Logic/Physics values.
  */
-#define ADDR_TOF_FL 0x30
-#define ADDR_TOF_FR 0x31
-#define ADDR_TOF_BL 0x32
-#define ADDR_TOF_BR 0x33
-#define ADDR_TOF_C  0x34
+// Indirizzi, pin e posizione dei ToF: nella configurazione del telaio (RobotLayout.h)
+// Indirizzo di fabbrica dei VL53L4CX: uno alla volta, poi ognuno passa al suo
+#define TOF_DEFAULT_I2C_ADDR 0x29
 #define AS7262_I2C_ADDR 0x49
+// MPU9250 con AD0 a GND
+#define MPU9250_I2C_ADDR 0x68
 
 // --- Configurazione Sensore ---
 // Tempo integrazione: valore * 2.8ms. 10 * 2.8 = 28ms (~35Hz)
 #define AS7262_INTEGRATION_VALUE 10
 // Gain: 0=1x, 1=3.7x, 2=16x, 3=64x
 #define AS7262_GAIN_VALUE 2
+// 1 = registri virtuali letti direttamente (poll solo a fine integrazione,
+// niente delay); 0 = percorso della libreria Adafruit, per confronto
+#define AS7262_FAST_READ 1
+#define AS7262_INTEGRATION_STEP_US 2800
+// Dato non ancora pronto a fine integrazione: nuovo controllo dopo
+#define AS7262_POLL_RETRY_US 4000
+// Letture di STATUS in attesa di TX/RX del registro virtuale (~25 us l'una a 400 kHz)
+#define AS7262_VREG_MAX_POLLS 40
+// Boot del chip dopo il reset software (come Adafruit_AS726x::begin())
+#define AS7262_RESET_BOOT_MS 1000
+// Temperatura del chip: letta di rado e tenuta in cache (ColorManager)
+#define COLOR_TEMP_INTERVAL_US 2000000
 
 // --- Soglie e Parametri Algoritmo ---
 // EMA Alpha: 0.0-1.0. Più basso = più filtro (più lento), Più alto = più reattivo
@@ -27,4 +39,333 @@
 #define DEFAULT_BLACK_THRESHOLD 50.0f
 
 // Rapporto moltiplicativo: (Luce Attuale) > (Bianco Calibrato * Ratio) = Argento
-#define DEFAULT_SILVER_RATIO 1.5f
\ No newline at end of file
+#define DEFAULT_SILVER_RATIO 1.5f
+
+// Classificatore spettrale: numero massimo di classi (4 predefinite + utente)
+#define COLOR_MAX_CLASSES 8
+// Somma sotto cui la lettura è solo rumore (robot sollevato)
+#define COLOR_MIN_SUM 15.0f
+// Zona d'ombra: somma < (somma nero calibrato * SCALE + OFFSET)
+#define COLOR_DARK_SCALE 1.5f
+#define COLOR_DARK_OFFSET 10.0f
+// In ombra un colore vince solo con distanza di forma sotto questa soglia
+#define COLOR_SHAPE_CONFIDENCE 0.15f
+// Confidenza piena a questo margine relativo dalla soglia di somma (argento, ombra)
+#define COLOR_SUM_MARGIN 0.25f
+
+// Profili di calibrazione in NVS (es. uno per illuminazione di arena)
+#define CALIB_MAX_PROFILES 4
+#define CALIB_PROFILE_NAME_LEN 12
+#define CALIB_NVS_NAMESPACE "calib"
+
+// --- Eventi di transizione del pavimento (FloorEventDetector, FloorEventBus) ---
+// Campioni consecutivi del nuovo colore per confermare una transizione (~28 ms l'uno)
+#define FLOOR_DEBOUNCE_SAMPLES 3
+// Un campione conta per il nuovo colore solo sopra questa confidenza;
+// il colore stabile resta finché un altro non la supera (isteresi)
+#define FLOOR_ENTER_CONFIDENCE 0.35f
+// Code SPSC, una per abbonato (potenza di 2)
+#define FLOOR_MAX_SUBSCRIBERS 4
+#define FLOOR_QUEUE_LEN 16
+
+// --- Task di Acquisizione Sensori (FreeRTOS) ---
+// Core 0: il loop() Arduino (controllo) gira su core 1
+#define SENSOR_TASK_CORE 0
+#define SENSOR_TASK_PRIORITY 5
+#define SENSOR_TASK_STACK_SIZE 8192
+// Destinazioni dei dati filtrati (telemetria, registratore di volo)
+#define SENSOR_MAX_SINKS 2
+
+// --- Telemetria binaria (TelemetryWriter) ---
+// Coda dei record tra produttori e task di scrittura (byte)
+#define TELEMETRY_RING_BYTES 8192
+// Priorità minima sopra l'idle: la telemetria non ruba tempo al controllo
+#define TELEMETRY_TASK_CORE 1
+#define TELEMETRY_TASK_PRIORITY 1
+#define TELEMETRY_TASK_STACK_SIZE 4096
+// Frame accumulati prima di una write() sulla seriale
+#define TELEMETRY_BATCH_BYTES 512
+// Con la coda vuota, i frame in attesa partono comunque dopo N ms
+#define TELEMETRY_FLUSH_MS 5
+// 1 = flusso binario attivo all'avvio (altrimenti si accende con [x])
+#define TELEMETRY_STREAM_AT_BOOT 0
+
+// --- Registratore di volo (FlightRecorder) ---
+// Slot da 41 byte: 6 MB ~ 150k record, oltre un minuto con IMU grezza a 1 kHz
+#define RECORDER_BYTES (6UL * 1024 * 1024)
+// Senza PSRAM si ripiega dimezzando fino a questa dimensione (in SRAM interna)
+#define RECORDER_MIN_BYTES (64UL * 1024)
+#define RECORDER_REGION MEM_BULK
+// Senza PSRAM (o piena) un buffer MEM_BULK ripiega sulla SRAM interna solo fino a
+// questa dimensione: oltre, memAlloc() fallisce e lo dice. Il resto della SRAM
+// serve dopo (DMA dei motori, stack dei task, traccia del profiler).
+#define MEM_BULK_SRAM_MAX_BYTES RECORDER_MIN_BYTES
+// Copia su flash (LittleFS, partizione "spiffs")
+#define RECORDER_FILE "/flight.bin"
+
+// --- Scheduler ToF (VL53L4CX) ---
+// Overhead tra fine timing budget e dato pronto (calcolo firmware del sensore)
+#define TOF_SCHED_OVERHEAD_US 2000
+// Anticipo del primo poll rispetto all'istante previsto di "dato pronto"
+#define TOF_SCHED_GUARD_US 300
+// Intervallo di ripetizione se il sensore risponde "non ancora pronto"
+#define TOF_SCHED_RETRY_US 1000
+// Con GPIO1 cablato: poll di sicurezza se l'interrupt non arriva entro N periodi
+#define TOF_SCHED_IRQ_TIMEOUT_PERIODS 3
+
+// --- Bus I2C condiviso ---
+#define I2C_BUS_MAX_CLOCK_HZ 400000
+#define I2C_BUS_MAX_DEVICES 12
+// Configurazione iniziale dei ToF (indirizzo di default 0x29): più lenta ma più stabile
+#define TOF_BOOT_CLOCK_HZ 100000
+
+// --- IMU (MPU9250) in modalità FIFO ---
+// 1 = burst-read della FIFO (accel+gyro a 1kHz), 0 = lettura singola per loop
+#define IMU_USE_FIFO 1
+#define IMU_GYRO_LSB_PER_DPS 16.4f   // Range ±2000 dps
+#define IMU_ACC_LSB_PER_G 4096.0f    // Range ±8 g
+#define IMU_FIFO_SAMPLE_DT_S 0.001f  // SampleRateDivider 0 -> 1 kHz
+// Frame per singola lettura I2C (buffer Wire ESP32 = 128 byte)
+#define IMU_FIFO_CHUNK_FRAMES 10
+// Frame mediati all'avvio per il bias (robot fermo): 500 = 0.5 s
+#define IMU_FIFO_BIAS_FRAMES 500
+#define IMU_GYRO_DEADBAND_DPS 0.25f
+
+// --- Fusione orientamento (Madgwick o Mahony, 9 assi) ---
+// 1 = yaw/pitch/roll dal filtro fuso, 0 = solo integrazione del gyro Z
+#define IMU_FUSION_ENABLED 1
+// 0 = Madgwick (gradiente discendente), 1 = Mahony (PI sull'errore, meno operazioni)
+#define ORIENTATION_FILTER_MAHONY 0
+// Madgwick: guadagno del gradiente, più alto = corregge prima, ma più rumore da accel/mag
+#define IMU_FUSION_BETA 0.05f
+// Mahony: guadagno proporzionale e integrale (l'integrale stima il bias residuo del gyro)
+#define IMU_FUSION_MAHONY_KP 0.5f
+#define IMU_FUSION_MAHONY_KI 0.1f
+// Il magnetometro (AK8963) viene usato solo se il modulo è plausibile (uT)
+#define IMU_FUSION_USE_MAG 1
+#define IMU_MAG_MIN_UT 15.0f
+#define IMU_MAG_MAX_UT 80.0f
+// AK8963 in continuo a 100 Hz: inutile leggerlo più spesso
+#define IMU_MAG_READ_INTERVAL_US 10000
+
+// --- Avvio non bloccante (BootSequence) ---
+// Attese dopo reset e risveglio dell'MPU9250 (PWR_MGMT_1)
+#define IMU_BOOT_RESET_WAIT_US 100000
+// XSHUT basso: scarica dei condensatori interni dei ToF
+#define TOF_BOOT_SHUTDOWN_US 50000
+// XSHUT alto -> firmware pronto (datasheet 1.2 ms, margine di sicurezza)
+#define TOF_BOOT_FIRMWARE_US 10000
+// Re-init a regime di un ToF (InitSensor, decine di ms): in un task di servizio
+#define TOF_INIT_TASK_STACK 4096
+// Init non concluso entro questo tempo: XSHUT basso, il task di servizio fallisce e si libera
+#define TOF_RECOVER_INIT_TIMEOUT_US 1000000
+// Avvio dell'AS7262 (reset software + boot, ~1 s nella libreria Adafruit)
+#define COLOR_BOOT_TASK_STACK 4096
+// Oltre questo tempo l'avvio si chiude comunque, con i componenti mancanti in errore
+#define BOOT_TIMEOUT_MS 5000
+// Fasi registrate nella timeline di avvio
+#define BOOT_MAX_PHASES 24
+
+// --- Replica su host delle registrazioni (HalReplay, env replay) ---
+// Passo dell'orologio virtuale tra due giri di update() (il task sensori gira a ~1 kHz)
+#define REPLAY_TICK_US 1000
+// L'avvio simulato parte prima della traccia: la FIFO IMU si apre sul primo frame
+#define REPLAY_BOOT_LEAD_US (2UL * IMU_BOOT_RESET_WAIT_US + 10000)
+
+// --- Mappa del labirinto (MazeMap, MazePlanner) ---
+// Il robot parte al centro della griglia: il campo può estendersi in ogni direzione
+#define MAZE_WIDTH 40
+#define MAZE_HEIGHT 40
+// Piani collegati da rampe
+#define MAZE_LEVELS 2
+#define MAZE_MAX_RAMPS 8
+// Oltre questa inclinazione (gradi) la piastrella è una rampa, come nella demo IMU
+#define MAZE_RAMP_PITCH_DEG 15.0f
+
+// --- Muri e allineamento dai ToF (WallEstimator) ---
+// Larghezza libera di una piastrella (tra due muri)
+#define MAZE_TILE_MM 300.0f
+// Distanza longitudinale tra il ToF anteriore e quello posteriore dello stesso lato
+#define TOF_SIDE_BASELINE_MM 100.0f
+// Dal centro del robot alla finestra dei ToF laterali e del ToF centrale
+#define TOF_SIDE_OFFSET_MM 60.0f
+#define TOF_CENTER_OFFSET_MM 80.0f
+// Muro sul lato della piastrella attuale: sensore più vicino di così
+#define WALL_DETECT_MM 200
+// Peso di ogni campione sulla confidenza, soglie di isteresi presente/assente
+#define WALL_CONFIDENCE_ALPHA 0.3f
+#define WALL_PRESENT_ON 0.6f
+#define WALL_PRESENT_OFF 0.4f
+// Oltre questo angolo la coppia non vede lo stesso muro (fine muro, varco)
+#define WALL_PAIR_MAX_HEADING_DEG 25.0f
+// Correzione della deriva dello yaw dai muri: 1 = attiva
+#define WALL_YAW_CORRECTION 1
+// Frazione della deriva corretta a ogni campione ToF (~30 Hz)
+#define WALL_YAW_GAIN 0.05f
+#define WALL_YAW_MIN_CONFIDENCE 0.8f
+// Deriva più grande di così: più probabile un errore di stima che del gyro
+#define WALL_YAW_MAX_DRIFT_DEG 10.0f
+
+// --- Storico e filtro delle misure ToF (ToFHistory) ---
+// Distanza riportata quando il sensore non vede oggetti
+#define TOF_NO_OBJECT_MM 8888
+// Campioni tenuti per sensore (potenza di 2)
+#define TOF_HISTORY_LEN 16
+// Finestra del filtro di Hampel (solo misure valide) e soglia in deviazioni robuste
+#define TOF_HAMPEL_WINDOW 7
+#define TOF_HAMPEL_K 3.0f
+// Scarto minimo per dichiarare un outlier: con MAD ~0 (muro fermo) conta il rumore del sensore
+#define TOF_HAMPEL_MIN_DEV_MM 20
+
+// --- Budget e distance mode adattivi dei ToF (ToFRangingPolicy) ---
+// 1 = ToFManager riconfigura i sensori a runtime, 0 = configurazione di avvio fissa
+#define TOF_ADAPTIVE_RANGING 1
+// Timing budget: veloce (muro vicino, rotazione), normale (marcia), preciso (fermo)
+#define TOF_BUDGET_FAST_US 10000
+#define TOF_BUDGET_DEFAULT_US 33000
+#define TOF_BUDGET_SLOW_US 50000
+// Muro nella piastrella: più rate che portata
+#define TOF_POLICY_NEAR_MM 250
+// Isteresi del distance mode: LONG oltre (o senza oggetto), SHORT sotto
+#define TOF_POLICY_LONG_ABOVE_MM 1100
+#define TOF_POLICY_SHORT_BELOW_MM 900
+// Tempo minimo tra due riconfigurazioni dello stesso sensore (ogni cambio costa una misura)
+#define TOF_POLICY_HOLD_US 250000
+// Oltre questa velocità di yaw il robot sta girando (SensorTask)
+#define TOF_POLICY_TURN_DPS 30.0f
+
+// --- Localizzazione a particelle sulla mappa (ParticleLocalizer) ---
+// Particelle allocate una volta sola; toccate solo a ogni campione ToF (~30 Hz): vanno in PSRAM
+#define LOCALIZER_PARTICLES 512
+#define LOCALIZER_REGION MEM_BULK
+// Oltre questa distanza il raggio non cerca muri (e le letture si tagliano qui)
+#define LOCALIZER_MAX_RANGE_MM 1200.0f
+// Rumore di misura dei ToF (deviazione standard) e peso minimo di una lettura incoerente
+#define LOCALIZER_RANGE_SIGMA_MM 40.0f
+#define LOCALIZER_OUTLIER_WEIGHT 0.05f
+// Senza encoder: velocità a MOTOR_SPEED_MAX (da tarare) e incertezza del comando
+#define LOCALIZER_MM_PER_S_AT_MAX 450.0f
+#define LOCALIZER_MOTION_NOISE 0.2f
+// Rumore minimo di posizione (mm) e di direzione (gradi) a ogni predizione
+#define LOCALIZER_POS_NOISE_MM 2.0f
+#define LOCALIZER_YAW_NOISE_DEG 0.5f
+// Ricampiona quando le particelle efficaci scendono sotto questa frazione
+#define LOCALIZER_RESAMPLE_NEFF 0.5f
+
+// --- Motori (MotorController, driver TB9051FTG) ---
+// PWM LEDC: 20 kHz fuori dalla banda udibile. 80 MHz / 20 kHz = 4000 passi: 10 bit entrano
+#define MOTOR_PWM_FREQ_HZ 20000
+#define MOTOR_PWM_BITS 10
+#define MOTOR_PWM_CHANNEL_M1 0
+#define MOTOR_PWM_CHANNEL_M2 1
+// Comando con segno come la libreria Pololu: -400..400, 0 = freno
+#define MOTOR_SPEED_MAX 400
+// Verso di rotazione invertito (motore montato a specchio)
+#define MOTOR_M1_FLIP 0
+#define MOTOR_M2_FLIP 0
+// Uscita CS: ~500 mV/A. Fondo scala ADC a 11 dB
+#define MOTOR_CS_MV_PER_A 500.0f
+#define MOTOR_ADC_FULL_SCALE_MV 3100.0f
+#define MOTOR_ADC_MAX_RAW 4095
+// ADC continuo in DMA: frequenza totale (divisa tra i canali) e byte per blocco.
+// 128 byte = 32 conversioni = 1.6 ms a 20 kHz: latenza di rilevamento
+#define MOTOR_ADC_SAMPLE_HZ 20000
+#define MOTOR_ADC_FRAME_BYTES 128
+#define MOTOR_ADC_BUFFER_BYTES 1024
+// Filtro esponenziale sulla media di ogni blocco
+#define MOTOR_CURRENT_ALPHA 0.3f
+// Sovracorrente: oltre la soglia per questo tempo il motore viene spento
+#define MOTOR_OVERCURRENT_MA 4500.0f
+#define MOTOR_OVERCURRENT_US 3000
+// Stallo: corrente vicina a quella a rotore bloccato per il duty attuale.
+// Corrente di stallo a piena tensione (dal datasheet del motore)
+#define MOTOR_STALL_CURRENT_MA 3000.0f
+#define MOTOR_STALL_FRACTION 0.8f
+// Sotto questa corrente non è mai stallo (duty piccoli: rumore del CS)
+#define MOTOR_STALL_MIN_MA 300.0f
+#define MOTOR_STALL_MIN_CMD 40
+#define MOTOR_STALL_US 5000
+// Allo spunto la corrente è quella di stallo: dopo una partenza (da sotto
+// MOTOR_STALL_MIN_CMD), un'inversione o un gradino si aspetta
+#define MOTOR_STALL_BLANK_US 150000
+// Gradino minimo del modulo del comando che riapre il mascheramento: le
+// correzioni del PID di direzione (500 Hz) restano sotto e non lo rinnovano
+#define MOTOR_STALL_BLANK_STEP 100
+// Task di lettura del DMA (priorità sopra il task sensori)
+#define MOTOR_TASK_STACK 3072
+#define MOTOR_TASK_PRIORITY 6
+#define MOTOR_TASK_CORE 0
+
+// --- Riflesso sul buco nero (HoleReflex) ---
+// Campioni grezzi (prima dell'EMA) neri di fila che fanno scattare il freno
+#define REFLEX_HOLE_SAMPLES 1
+// Confidenza minima del NERO (ombra o luce assente) per il riflesso
+#define REFLEX_MIN_CONFIDENCE 0.5f
+// Freno in corto prima della retromarcia
+#define REFLEX_BRAKE_US 120000
+// Retromarcia solo se il robot andava avanti: porta il sensore fuori dal bordo
+#define REFLEX_BACKOFF_SPEED 200
+#define REFLEX_BACKOFF_US 250000
+// Latenza misurata (poll che vede DATA_RDY -> freno) oltre cui il riflesso segnala
+// lo sforamento. Caso peggiore della lettura dei 6 canali a 400 kHz: ~81
+// trasferimenti, ~8 ms, a registri virtuali; ~480 trasferimenti, ~50 ms, con la
+// libreria. Più classificazione e scrittura dei motori (decine di us).
+#if AS7262_FAST_READ
+#define REFLEX_LATENCY_BUDGET_US 10000
+#else
+#define REFLEX_LATENCY_BUDGET_US 55000
+#endif
+
+// --- Task di controllo (ControlTask, HeadingController) ---
+// Periodo fisso del timer hardware: 2 ms = 500 Hz
+#define CONTROL_PERIOD_US 2000
+#define CONTROL_TIMER_ID 0
+// Core 1 (il loop Arduino resta sotto), priorità sopra ogni altro task applicativo
+#define CONTROL_TASK_CORE 1
+#define CONTROL_TASK_PRIORITY 10
+#define CONTROL_TASK_STACK 4096
+// Yaw più vecchio di così: niente anello chiuso, motori frenati
+#define CONTROL_HEADING_TIMEOUT_US 20000
+// PID di direzione: errore in gradi -> differenza di comando tra le ruote (unità MOTOR_SPEED_MAX)
+#define HEADING_KP 8.0f
+#define HEADING_KI 4.0f
+// Derivata sulla misura (velocità di yaw, °/s): niente calci al cambio di riferimento
+#define HEADING_KD 0.5f
+// Contributo massimo dell'integrale e correzione massima
+#define HEADING_I_LIMIT 100.0f
+// L'integrale corregge gli scarti di mantenimento, non le curve
+#define HEADING_I_ZONE_DEG 5.0f
+#define HEADING_OUT_LIMIT 300.0f
+
+// --- Profiler dei percorsi caldi (Profiler) ---
+// 0 = PROFILE_SCOPE() non genera codice
+#define PROFILER_ENABLED 1
+// Scope distinti (nomi). Istogramma: 2^3 intervalli per ottava (~12% di risoluzione)
+#define PROFILER_MAX_SCOPES 16
+#define PROFILER_HIST_SUB_BITS 3
+// Eventi per la timeline (Chrome trace), 16 byte ciascuno, riservati in setup() (Profiler::reserveTrace)
+#define PROFILER_TRACE_EVENTS 4096
+#define PROFILER_TRACE_REGION MEM_BULK
+
+// --- Salute dei sensori e re-init in background (DeviceHealth) ---
+// Media mobile del tasso di errore: peso di ogni accesso al bus
+#define HEALTH_ERROR_ALPHA 0.05f
+// Oltre questo tasso il dispositivo è DEGRADATO (dati ancora in uso)
+#define HEALTH_DEGRADED_RATE 0.2f
+// Errori di fila che dichiarano il guasto
+#define HEALTH_MAX_CONSECUTIVE_ERRORS 5
+// Attesa prima di un re-init, raddoppiata a ogni tentativo fallito
+#define HEALTH_RETRY_MIN_US 200000
+#define HEALTH_RETRY_MAX_US 5000000
+// Senza dati buoni per così tanto il dispositivo è guasto. ToF: 10 budget lenti
+#define HEALTH_TOF_STALE_US 500000
+// IMU: FIFO a 1 kHz letta a ogni giro del task sensori
+#define HEALTH_IMU_STALE_US 100000
+// AS7262: un campione ogni ~60 ms
+#define HEALTH_COLOR_STALE_US 1000000
+
+// --- Audit delle allocazioni a regime (AllocAudit) ---
+// 1 = new/delete sostituiti: dopo setup() ogni allocazione viene contata ([a] stampa il rapporto)
+#define ALLOC_AUDIT_ENABLED 1
+// Indirizzi di chiamata registrati per i primi colpevoli (addr2line sul firmware .elf)
+#define ALLOC_AUDIT_MAX_CALLERS 8
@@ -0,0 +1,78 @@
+/**
+ * @file ControlTask.h
+ * @brief Anello di controllo a periodo fisso (timer hardware) su core 1.
+ *
+ * Il timer hardware scatta ogni CONTROL_PERIOD_US e sveglia il task con una
+ * notifica: il periodo non dipende da quanto gira loop(). A ogni ciclo il
+ * task legge l'ultima direzione pubblicata dal task sensori, chiude il PID
+ * di HeadingController e comanda i motori (M1 sinistro, M2 destro).
+ * Con yaw più vecchio di CONTROL_HEADING_TIMEOUT_US i motori vengono frenati.
+ * Con i motori presi dal riflesso sul buco (MotorController::isPreempted())
+ * l'anello è sospeso come da spento e riparte con l'integrale azzerato.
+ *
+ * Jitter, WCET e scadenze perse (LoopStats) sono pubblicati a ogni ciclo
+ * con un TripleBuffer. Riferimenti e abilitazione si cambiano da qualunque
+ * core, lock-free.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "Constants.h"
+#include "HeadingController.h"
+#include "LoopStats.h"
+#include "MotorController.h"
+#include "SensorTask.h"
+#include "TripleBuffer.h"
+
+class ControlTask {
+public:
+    ControlTask(SensorTask& sensors, MotorController& motors);
+
+    // Timer hardware e task. Parte disabilitato (motori non comandati).
+    bool start(BaseType_t core = CONTROL_TASK_CORE, UBaseType_t priority = CONTROL_TASK_PRIORITY);
+
+    // Anello chiuso on/off. Alla disabilitazione i motori vengono frenati.
+    void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_release); }
+    bool isEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    void setHeading(float yawDeg) { _targetYaw.store(yawDeg, std::memory_order_relaxed); }
+    void setBaseSpeed(int16_t speed) { _baseSpeed.store(speed, std::memory_order_relaxed); }
+
+    // Un solo consumatore (il loop)
+    const LoopTiming& timing() { return _timing.latest(); }
+    void resetTiming() { _resetTiming.store(true, std::memory_order_relaxed); }
+    // Cicli senza yaw recente (motori frenati)
+    uint32_t staleCycles() const { return _staleCycles.load(std::memory_order_relaxed); }
+
+    void printStats();
+
+private:
+    SensorTask&        _sensors;
+    MotorController&   _motors;
+    HeadingController  _heading;
+    LoopStats          _stats;
+
+    TaskHandle_t       _handle;
+    hw_timer_t*        _timer;
+
+    std::atomic<bool>     _enabled;
+    std::atomic<float>    _targetYaw;
+    std::atomic<int16_t>  _baseSpeed;
+    std::atomic<bool>     _resetTiming;
+    std::atomic<uint32_t> _staleCycles;
+
+    TripleBuffer<LoopTiming> _timing;
+
+    // Il timer Arduino non passa argomenti alla ISR
+    static ControlTask* _instance;
+
+    static void IRAM_ATTR onTimer();
+    static void taskEntry(void* arg);
+    void run();
+    void step(uint32_t nowUs);
+};
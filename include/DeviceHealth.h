@@ -0,0 +1,99 @@
+/**
+ * @file DeviceHealth.h
+ * @brief Stato di salute di un sensore: tasso di errore, età del dato, re-init.
+ *
+ * Il manager riporta l'esito di ogni accesso al bus (onSuccess/onError) e
+ * chiama check() a ogni giro. Il dispositivo è:
+ *  - OK / DEGRADED: dati in arrivo; DEGRADED se la media mobile degli errori
+ *    supera HEALTH_DEGRADED_RATE
+ *  - FAILED: HEALTH_MAX_CONSECUTIVE_ERRORS errori di fila, oppure nessun dato
+ *    buono da più del timeout del dispositivo (brown-out, connettore)
+ *  - RECOVERING: re-init in corso (macchina a stati del manager)
+ *
+ * Dopo un re-init fallito il tentativo successivo si allontana (backoff
+ * esponenziale da HEALTH_RETRY_MIN_US a HEALTH_RETRY_MAX_US). Il tempo di
+ * recupero va dal guasto rilevato al dispositivo di nuovo operativo.
+ *
+ * Nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+
+enum HealthState : uint8_t {
+    HEALTH_UNKNOWN = 0, // Non ancora avviato: nessun controllo
+    HEALTH_OK,
+    HEALTH_DEGRADED,
+    HEALTH_FAILED,
+    HEALTH_RECOVERING
+};
+
+class DeviceHealth {
+public:
+    // staleUs: senza dati buoni per così tanto il dispositivo è guasto
+    explicit DeviceHealth(uint32_t staleUs = 0);
+
+    void setStaleTimeout(uint32_t staleUs) { _staleUs = staleUs; }
+
+    // Dispositivo avviato (boot o re-init riuscito): da qui si misura l'età del dato
+    void start(uint32_t nowUs);
+    // Avvio fallito: primo tentativo di recupero dopo HEALTH_RETRY_MIN_US
+    void fail(uint32_t nowUs);
+
+    void onSuccess(uint32_t nowUs);
+    void onError(uint32_t nowUs);
+
+    /**
+     * @brief Valuta errori consecutivi ed età del dato.
+     * @return true solo al passaggio a FAILED (da gestire una volta).
+     */
+    bool check(uint32_t nowUs);
+
+    // --- Recupero (chiamati dalla macchina a stati del manager) ---
+    bool needsRecovery() const { return _state == HEALTH_FAILED || _state == HEALTH_RECOVERING; }
+    // Guasto e backoff scaduto: si può tentare un re-init
+    bool retryDue(uint32_t nowUs) const;
+    void beginRecovery(uint32_t nowUs);
+    void endRecovery(bool ok, uint32_t nowUs);
+
+    HealthState state() const { return _state; }
+    bool isOnline() const { return _state == HEALTH_OK || _state == HEALTH_DEGRADED; }
+    float errorRate() const { return _errorRate; }
+    uint32_t errors() const { return _errors; }
+    uint32_t successes() const { return _successes; }
+    uint32_t failures() const { return _failures; }        // Passaggi a FAILED
+    uint32_t reinits() const { return _reinits; }          // Re-init riusciti
+    uint32_t failedReinits() const { return _failedReinits; }
+    uint32_t lastRecoveryUs() const { return _lastRecoveryUs; }
+    uint32_t maxRecoveryUs() const { return _maxRecoveryUs; }
+    uint32_t ageUs(uint32_t nowUs) const { return nowUs - _lastOkUs; }
+
+    static const char* stateName(HealthState state);
+
+    // Una riga per dispositivo, via halLog
+    static void printHeader();
+    void print(const char* name, uint32_t nowUs) const;
+
+private:
+    uint32_t    _staleUs;
+    HealthState _state;
+    float       _errorRate;      // Media mobile (0..1) dell'esito degli accessi
+    uint8_t     _consecutive;    // Errori di fila
+    uint32_t    _lastOkUs;
+    uint32_t    _failedAtUs;     // Guasto rilevato: inizio del tempo di recupero
+    uint32_t    _nextRetryUs;
+    uint32_t    _retryDelayUs;
+
+    uint32_t _errors;
+    uint32_t _successes;
+    uint32_t _failures;
+    uint32_t _reinits;
+    uint32_t _failedReinits;
+    uint32_t _lastRecoveryUs;
+    uint32_t _maxRecoveryUs;
+
+    void enterFailed(uint32_t nowUs);
+};
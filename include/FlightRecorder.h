@@ -0,0 +1,81 @@
+/**
+ * @file FlightRecorder.h
+ * @brief Registratore di volo: tutti i campioni di una prova in un anello in PSRAM.
+ *
+ * I manager vi scrivono i campioni grezzi (frame FIFO IMU, singole misure
+ * ToF, canali AS7262 prima dell'EMA) e il task sensori quelli filtrati,
+ * ciascuno con il timestamp del proprio sensore. Ogni record occupa uno slot
+ * fisso: header di telemetria + payload, quindi un dump è un normale flusso
+ * di telemetria leggibile da telemetry_decode.
+ *
+ * Un solo produttore (il task sensori: tutti gli update() girano lì) e
+ * lettori in qualunque momento. A buffer pieno si sovrascrivono i record più
+ * vecchi; il lettore rileva gli slot riscritti durante la copia e li salta.
+ * Nessuna dipendenza Arduino.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "Constants.h"
+#include "MemoryPolicy.h"
+#include "Telemetry.h"
+
+// Payload massimo di un record registrato (TelemetrySpectral = 28 byte)
+#define FLIGHT_RECORD_PAYLOAD 32
+
+struct FlightRecord {
+    TelemetryHeader header;
+    uint8_t         length;  // Byte validi in payload
+    uint8_t         payload[FLIGHT_RECORD_PAYLOAD];
+};
+
+class FlightRecorder : public RecordSink {
+public:
+    FlightRecorder();
+    ~FlightRecorder();
+
+    /**
+     * @brief Alloca l'anello. Se la regione non ha spazio si dimezza fino a
+     * RECORDER_MIN_BYTES (es. scheda senza PSRAM).
+     * @return false se nemmeno la dimensione minima è disponibile.
+     */
+    bool begin(size_t bytes = RECORDER_BYTES, MemoryRegion region = RECORDER_REGION);
+
+    void start();   // Svuota e riparte
+    void stop();
+    bool isRecording() const { return _recording.load(std::memory_order_relaxed); }
+
+    // Percorso caldo: una copia di ~45 byte, nessun lock. Solo dal produttore.
+    bool log(TelemetryType type, uint32_t timestampUs, const void* payload, size_t len) override;
+
+    uint32_t capacity() const { return _capacity; }
+    uint32_t written() const { return _written.load(std::memory_order_acquire); }
+    uint32_t size() const;                // Record ancora leggibili
+    uint32_t overwritten() const;         // Record persi per sovrascrittura
+    size_t   bytes() const { return (size_t)_capacity * sizeof(FlightRecord); }
+    bool     isExternal() const { return memIsExternal(_slots); }
+
+    /**
+     * @brief Visita i record dal più vecchio al più recente.
+     * Il visitatore ritorna false per interrompere. Sicuro durante la registrazione:
+     * i record sovrascritti durante la lettura vengono saltati.
+     * @return Record visitati.
+     */
+    typedef bool (*Visitor)(const FlightRecord& record, void* ctx);
+    uint32_t forEach(Visitor visit, void* ctx) const;
+
+private:
+    FlightRecord* _slots;
+    uint32_t      _capacity;
+
+    // Contatori monotoni dall'ultimo start(), slot = indice % _capacity.
+    // _started avanza prima della copia, _written dopo (come un seqlock).
+    std::atomic<uint32_t> _started;
+    std::atomic<uint32_t> _written;
+    std::atomic<bool>     _recording;
+    uint32_t              _next;      // Slot del prossimo record (solo produttore)
+};
@@ -0,0 +1,23 @@
+/**
+ * @file FlightRecorderIO.h
+ * @brief Scarico del registratore di volo su seriale o su flash (LittleFS).
+ *
+ * Il formato è lo stesso della telemetria (frame COBS + CRC), quindi sia il
+ * dump seriale sia il file si decodificano con telemetry_decode.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "FlightRecorder.h"
+
+// Scrive i record su out, saltando i skipOldest più vecchi. Ritorna i record scritti.
+uint32_t flightDump(const FlightRecorder& recorder, Print& out, uint32_t skipOldest = 0);
+
+// Salva su RECORDER_FILE (sovrascrive). Se la partizione non basta tiene i record
+// più recenti. false se il filesystem non è disponibile.
+bool flightSave(const FlightRecorder& recorder, const char* path = RECORDER_FILE);
+
+// Ricopia su out un file salvato in precedenza (anche dopo un riavvio)
+bool flightDumpFile(Print& out, const char* path = RECORDER_FILE);
@@ -0,0 +1,100 @@
+/**
+ * @file FloorEvents.h
+ * @brief Transizioni di colore del pavimento: debounce, isteresi e bus di eventi.
+ *
+ * FloorEventDetector riceve un SpectralMatch per campione e tiene il colore
+ * "stabile" della piastrella. Un colore diverso diventa stabile solo dopo
+ * FLOOR_DEBOUNCE_SAMPLES campioni consecutivi con confidenza almeno
+ * FLOOR_ENTER_CONFIDENCE; un campione del colore stabile annulla la
+ * transizione in corso, uno incerto (sotto soglia), di qualunque altro
+ * colore, non la conferma né la annulla. Il colore stabile non decade da solo: è questa l'isteresi.
+ * Ogni conferma produce un FloorEvent con il timestamp del primo campione
+ * del nuovo colore, cioè del bordo della piastrella, non della conferma.
+ *
+ * FloorEventBus distribuisce gli eventi a più abbonati (telemetria, LED,
+ * pianificatore) con una SpscQueue ciascuno: il produttore non si blocca
+ * mai e un abbonato lento perde solo i propri eventi (contati).
+ *
+ * Nessuna dipendenza Arduino: testabile su host con tracce registrate.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+#include "SpectralClassifier.h"
+#include "SpscQueue.h"
+
+struct FloorEvent {
+    ColorType from;
+    ColorType to;
+    int8_t    fromClass;    // Indice di classe (-1 = argento / nessuna)
+    int8_t    toClass;
+    float     confidence;   // Media dei campioni che hanno confermato
+    uint32_t  timestampUs;  // Primo campione del nuovo colore
+    uint32_t  confirmUs;    // Campione che ha confermato la transizione
+};
+
+class FloorEventDetector {
+public:
+    FloorEventDetector();
+
+    // Colore stabile sconosciuto: il primo colore confermato genera un evento da COLOR_NONE
+    void reset();
+
+    /**
+     * @brief Un campione classificato.
+     * @return true se conferma una transizione, descritta in out.
+     */
+    bool update(const SpectralMatch& match, uint32_t sampleUs, FloorEvent& out);
+
+    ColorType stableColor() const { return _stable; }
+    int8_t    stableClass() const { return _stableClass; }
+    uint32_t  transitions() const { return _transitions; }
+    // Transizioni iniziate e poi annullate (glitch, bordi di piastrella)
+    uint32_t  rejected() const { return _rejected; }
+
+private:
+    ColorType _stable;
+    int8_t    _stableClass;
+
+    ColorType _candidate;
+    int8_t    _candidateClass;
+    uint8_t   _count;         // Campioni confidenti del candidato
+    uint32_t  _candidateUs;   // Primo campione del candidato
+    float     _confidenceSum;
+
+    uint32_t _transitions;
+    uint32_t _rejected;
+
+    void dropCandidate();
+};
+
+class FloorEventBus {
+public:
+    FloorEventBus();
+
+    /**
+     * @brief Registra un abbonato, prima di avviare il produttore.
+     * @return Id da passare a poll(), -1 se ci sono già FLOOR_MAX_SUBSCRIBERS abbonati.
+     */
+    int8_t subscribe();
+
+    // Solo il produttore (task sensori). Non blocca mai.
+    void publish(const FloorEvent& event);
+
+    // Solo il task dell'abbonato id
+    bool poll(int8_t id, FloorEvent& out);
+
+    uint32_t published() const { return _published.load(std::memory_order_relaxed); }
+    uint32_t dropped(int8_t id) const;
+
+private:
+    SpscQueue<FloorEvent, FLOOR_QUEUE_LEN> _queues[FLOOR_MAX_SUBSCRIBERS];
+    std::atomic<uint32_t> _dropped[FLOOR_MAX_SUBSCRIBERS];
+    std::atomic<uint32_t> _published;
+    uint8_t _count;
+};
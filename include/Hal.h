@@ -0,0 +1,247 @@
+/**
+ * @file Hal.h
+ * @brief Astrazione hardware minima: orologio, log, memoria persistente e sensori.
+ *
+ * I manager (ImuManager, ToFManager, ColorManager) parlano solo con queste
+ * interfacce e non includono Arduino.h. Sul robot le implementano i driver
+ * di HalEsp32.h (librerie + I2CBus); su Linux quelle di HalReplay.h, che
+ * rigiocano una registrazione del FlightRecorder con un orologio virtuale.
+ *
+ * Le interfacce sono grosse quanto serve ai manager, non di più: ogni metodo
+ * corrisponde a un'operazione che il manager fa oggi sul bus, e quelle che
+ * devono restare in un solo possesso del bus (FIFO IMU, campione AS7262)
+ * sono un solo metodo.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorTypes.h"
+
+// Le ISR (data ready dei ToF) devono stare in IRAM sull'ESP32
+#if defined(ESP_PLATFORM)
+#include <esp_attr.h>
+#define HAL_ISR_ATTR IRAM_ATTR
+#else
+#define HAL_ISR_ATTR
+#endif
+
+// ==========================================
+// OROLOGIO E LOG
+// ==========================================
+
+class HalClock {
+public:
+    virtual ~HalClock() {}
+    virtual uint32_t micros() = 0;
+    virtual uint32_t millis() = 0;
+    virtual void     delayUs(uint32_t us) = 0;
+};
+
+// Orologio in uso: quello di sistema sull'ESP32, uno virtuale nel replay
+HalClock& halClock();
+void      halSetClock(HalClock* clock);
+
+inline uint32_t halMicros() { return halClock().micros(); }
+inline uint32_t halMillis() { return halClock().millis(); }
+inline void     halDelayMs(uint32_t ms) { halClock().delayUs(ms * 1000UL); }
+
+// Messaggi diagnostici (Serial sul robot, stderr su host)
+void halLog(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// ==========================================
+// MEMORIA PERSISTENTE (NVS / Preferences)
+// ==========================================
+
+class HalStorage {
+public:
+    virtual ~HalStorage() {}
+    virtual bool    begin(const char* ns, bool readOnly) = 0;
+    virtual void    end() = 0;
+    virtual bool    isKey(const char* key) = 0;
+    virtual size_t  getBytes(const char* key, void* buf, size_t maxLen) = 0;
+    virtual size_t  putBytes(const char* key, const void* buf, size_t len) = 0;
+    virtual uint8_t getUChar(const char* key, uint8_t defaultValue) = 0;
+    virtual size_t  putUChar(const char* key, uint8_t value) = 0;
+    virtual float   getFloat(const char* key, float defaultValue) = 0;
+    virtual bool    clear() = 0;
+};
+
+// ==========================================
+// IMU (MPU9250)
+// ==========================================
+
+class ImuDevice {
+public:
+    virtual ~ImuDevice() {}
+
+    virtual void    setup() {}                 // Registrazione sul bus, una volta
+    virtual uint8_t whoAmI() = 0;
+    virtual void    reset() = 0;               // PWR_MGMT_1: reset
+    virtual void    wake() = 0;                // PWR_MGMT_1: clock interno
+    virtual bool    init() = 0;                // Inizializzazione della libreria
+    virtual void    configure() = 0;           // 1 kHz, ±8 g, ±2000 dps, DLPF 20 Hz
+    virtual bool    initMagnetometer() = 0;    // AK8963 in continuo a 100 Hz
+    virtual bool    isConnected() = 0;
+
+    // --- Modalità FIFO ---
+    virtual bool startFifo() = 0;              // Stop-when-full, accel + gyro, reset
+    virtual void resetFifo() = 0;
+
+    /**
+     * @brief Stato, contatore e tutti i frame in coda, in un solo possesso del bus.
+     * @param out Spazio per maxFrames frame da MPU_FIFO_FRAME_BYTES.
+     * @param overflow true se la FIFO era piena (campioni persi, FIFO già azzerata).
+     * @return Frame letti. In caso di errore la FIFO viene azzerata.
+     */
+    virtual uint16_t readFifo(uint8_t* out, uint16_t maxFrames, bool& overflow) = 0;
+    // Esito dell'ultima readFifo()/readGyro(): true se il bus non ha risposto (DeviceHealth)
+    virtual bool readFailed() const { return false; }
+
+    // Campo magnetico (uT) negli assi del chip AK8963. false = nessuna lettura
+    virtual bool readMagnetometer(float& x, float& y, float& z) = 0;
+
+    // --- Modalità a lettura singola (IMU_USE_FIFO 0) ---
+    virtual void autoOffsets() = 0;
+    virtual bool readGyro(float& x, float& y, float& z) = 0;  // dps
+    virtual float readPitch() = 0;                            // Gradi, dall'accelerometro
+};
+
+// ==========================================
+// TOF (VL53L4CX, uno per istanza)
+// ==========================================
+
+struct RangeSample {
+    int16_t  distance_mm;
+    uint8_t  rangeStatus;  // 0 = ok
+    uint8_t  objects;      // Oggetti trovati (0 = fuori portata)
+    uint16_t signalKcps;   // Segnale di ritorno (0 = non disponibile)
+    uint8_t  sigmaMm;      // Incertezza stimata dal sensore, saturata a 255
+};
+
+// Distance mode del VL53L4CX (stessi valori di VL53L4CX_DISTANCEMODE_*)
+enum ToFDistanceMode : uint8_t {
+    TOF_MODE_SHORT = 1,  // ~1.3 m, più robusto alla luce ambiente
+    TOF_MODE_MEDIUM = 2,
+    TOF_MODE_LONG = 3    // Default della libreria
+};
+
+class RangingDevice {
+public:
+    virtual ~RangingDevice() {}
+
+    virtual void        setup() {}           // Registrazione sul bus, una volta
+    virtual const char* name() const = 0;
+    virtual uint8_t     address() const = 0; // Indirizzo assegnato
+    virtual int8_t      xshutPin() const { return -1; } // Solo per i messaggi
+
+    // XSHUT
+    virtual void powerDown() = 0;
+    virtual void powerUp() = 0;
+
+    // Risposta all'indirizzo di fabbrica (0x29) o a quello assegnato
+    virtual bool probeDefault() = 0;
+    virtual bool probe() = 0;
+
+    // Avvio a freddo: init all'indirizzo di fabbrica, poi cambio indirizzo
+    virtual bool initAtDefault() = 0;
+
+    /**
+     * @brief Lo stesso init senza bloccare il chiamante (re-init a regime).
+     * BOOT_PENDING: esito da initPoll(), nel frattempo il dispositivo non si
+     * tocca. Predefinito: initAtDefault() sincrono (replica, test).
+     */
+    virtual BootStatus initStart() { return initAtDefault() ? BOOT_DONE : BOOT_FAILED; }
+    virtual BootStatus initPoll() { return BOOT_FAILED; }
+    // Avvio a caldo: sensore già all'indirizzo assegnato, misura da fermare
+    virtual bool attachWarm() = 0;
+    virtual void release() = 0;              // Driver liberato, sensore spento
+
+    // Avvia la misura continua. Ritorna il timing budget (us).
+    virtual uint32_t startRanging() = 0;
+
+    // GPIO1 (data ready). isr riceve arg, chiamata in contesto di interrupt.
+    virtual bool hasDataReadyPin() const { return false; }
+    virtual void attachDataReady(void (*isr)(void*), void* arg) { (void)isr; (void)arg; }
+
+    // Status del driver (0 = ok)
+    virtual int checkDataReady(bool& ready) = 0;
+    // Legge la misura e riavvia la successiva (clear interrupt)
+    virtual int readRange(RangeSample& sample) = 0;
+
+    /**
+     * @brief Cambia distance mode e timing budget a misura in corso: stop,
+     * configurazione, ripartenza. Solo transazioni brevi, nessuna attesa.
+     * @return Timing budget effettivo (us), 0 se fallito o non supportato.
+     */
+    virtual uint32_t reconfigure(ToFDistanceMode mode, uint32_t budgetUs) {
+        (void)mode;
+        (void)budgetUs;
+        return 0;
+    }
+};
+
+// ==========================================
+// SPETTROMETRO (AS7262)
+// ==========================================
+
+// Costo dell'acquisizione spettrale, per confrontare i percorsi di lettura
+struct SpectralReadStats {
+    uint32_t samples;    // Campioni letti
+    uint32_t polls;      // Controlli di DATA_RDY, anche a vuoto
+    uint32_t transfers;  // Trasferimenti I2C (START..STOP), 0 = non misurati
+    uint32_t busUs;      // Tempo sul bus: poll, lettura e ripartenza
+    uint32_t maxSampleUs;
+};
+
+class SpectralDevice {
+public:
+    virtual ~SpectralDevice() {}
+
+    virtual void setup() {}                  // Registrazione sul bus, una volta
+
+    // Avvio del chip (reset + ~1 s di boot) senza bloccare il chiamante
+    virtual void       bootStart() = 0;
+    virtual BootStatus bootPoll() = 0;
+
+    virtual void configure(uint8_t integration, uint8_t gain) = 0;
+    virtual void setLed(bool on) = 0;
+    virtual void setLedCurrent(uint8_t level) = 0; // 0=12.5mA ... 3=100mA
+    virtual void startMeasurement() = 0;
+
+    /**
+     * @brief Se un campione è pronto lo legge (canali calibrati) e riavvia
+     * l'integrazione, in un solo possesso del bus.
+     * @return false se il campione non è ancora pronto.
+     */
+    virtual bool pollSample(float channels[CH_COUNT]) = 0;
+
+    virtual float readTemperature() = 0;
+
+    virtual SpectralReadStats readStats() const {
+        SpectralReadStats s = {0, 0, 0, 0, 0};
+        return s;
+    }
+};
+
+// ==========================================
+// USCITA MOTORI (RIFLESSI)
+// ==========================================
+
+/**
+ * @brief Comando prioritario dei motori per i riflessi (HoleReflex).
+ * Finché è attivo, i comandi del controllo vengono ignorati.
+ */
+class DriveOutput {
+public:
+    virtual ~DriveOutput() {}
+
+    // Applica subito il comando e blocca quelli normali (0, 0 = freno)
+    virtual void preempt(int16_t left, int16_t right) = 0;
+    // Restituisce i motori al controllo (frenati)
+    virtual void releasePreempt() = 0;
+    // Comando attuale di un lato (0 = sinistro), con segno
+    virtual int16_t driveCommand(uint8_t side) const = 0;
+};
@@ -0,0 +1,275 @@
+/**
+ * @file HalEsp32.h
+ * @brief Implementazioni di Hal.h per il robot: librerie dei sensori + I2CBus.
+ *
+ * Qui vive tutto ciò che prima stava nei manager e tocca l'hardware:
+ * registri MPU9250, driver VL53L4CX con cambio indirizzo, task di boot
+ * dell'AS7262, Preferences. Ogni metodo apre la propria transazione
+ * sull'arbitro, quindi i manager non conoscono più I2CBus.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <MPU9250_WE.h>
+#include <vl53l4cx_class.h> // STM32duino library
+#include <Adafruit_AS726x.h>
+#include <Preferences.h>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "Constants.h"
+#include "Hal.h"
+#include "I2CBus.h"
+#include "RobotLayout.h"
+
+// ==========================================
+// NVS
+// ==========================================
+
+class NvsStorage : public HalStorage {
+public:
+    bool    begin(const char* ns, bool readOnly) override { return _prefs.begin(ns, readOnly); }
+    void    end() override { _prefs.end(); }
+    bool    isKey(const char* key) override { return _prefs.isKey(key); }
+    size_t  getBytes(const char* key, void* buf, size_t maxLen) override { return _prefs.getBytes(key, buf, maxLen); }
+    size_t  putBytes(const char* key, const void* buf, size_t len) override { return _prefs.putBytes(key, buf, len); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue) override { return _prefs.getUChar(key, defaultValue); }
+    size_t  putUChar(const char* key, uint8_t value) override { return _prefs.putUChar(key, value); }
+    float   getFloat(const char* key, float defaultValue) override { return _prefs.getFloat(key, defaultValue); }
+    bool    clear() override { return _prefs.clear(); }
+
+private:
+    Preferences _prefs;
+};
+
+// ==========================================
+// TASK DI SERVIZIO
+// ==========================================
+
+/**
+ * @brief Task per le operazioni lente dei driver (boot e init da decine di
+ * ms a ~1 s) fuori dal task sensori. Stack e TCB statici, creato alla prima
+ * richiesta e poi riusato: nessuna allocazione, nemmeno nei re-init a regime.
+ */
+template <size_t StackBytes>
+class StaticWorker {
+public:
+    typedef void (*Job)(void* arg);
+
+    explicit StaticWorker(const char* name, UBaseType_t priority = 1)
+        : _name(name), _priority(priority), _handle(nullptr), _job(nullptr), _arg(nullptr), _busy(false) {}
+
+    // Esegue job(arg) sul task. false se ne sta già eseguendo un altro.
+    bool run(Job job, void* arg) {
+        if (_busy.exchange(true)) return false;
+        _job = job;
+        _arg = arg;
+        if (!_handle) _handle = xTaskCreateStatic(entry, _name, sizeof(_stack), this, _priority, _stack, &_tcb);
+        if (!_handle) {
+            _busy.store(false);
+            return false;
+        }
+        xTaskNotifyGive(_handle);
+        return true;
+    }
+
+    bool isBusy() const { return _busy.load(); }
+
+private:
+    const char*  _name;
+    UBaseType_t  _priority;
+    StackType_t  _stack[StackBytes / sizeof(StackType_t)];
+    StaticTask_t _tcb;
+    TaskHandle_t _handle;
+    Job          _job;
+    void*        _arg;
+    std::atomic<bool> _busy;
+
+    static void entry(void* self) {
+        StaticWorker* w = static_cast<StaticWorker*>(self);
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            w->_job(w->_arg);
+            w->_busy.store(false);
+        }
+    }
+};
+
+// ==========================================
+// MPU9250
+// ==========================================
+
+class Mpu9250Device : public ImuDevice {
+public:
+    explicit Mpu9250Device(I2CBus& bus);
+
+    void    setup() override;
+    uint8_t whoAmI() override;
+    void    reset() override;
+    void    wake() override;
+    bool    init() override;
+    void    configure() override;
+    bool    initMagnetometer() override;
+    bool    isConnected() override;
+
+    bool     startFifo() override;
+    void     resetFifo() override;
+    uint16_t readFifo(uint8_t* out, uint16_t maxFrames, bool& overflow) override;
+    bool     readFailed() const override { return _readFailed; }
+    bool     readMagnetometer(float& x, float& y, float& z) override;
+
+    void  autoOffsets() override;
+    bool  readGyro(float& x, float& y, float& z) override;
+    float readPitch() override;
+
+private:
+    I2CBus& _bus;
+    I2CBus::DeviceId _dev;
+    MPU9250_WE _mpu;
+    bool _readFailed;
+};
+
+// ==========================================
+// VL53L4CX
+// ==========================================
+
+class Vl53l4cxDevice : public RangingDevice {
+public:
+    /**
+     * @param xshutPin Pin di spegnimento (obbligatorio per l'avvio a freddo).
+     * @param intPin   GPIO1 data ready, -1 se non cablato.
+     * @param address  Indirizzo assegnato dopo l'avvio (tabella del telaio, RobotLayout.h).
+     */
+    Vl53l4cxDevice(I2CBus& bus, uint8_t xshutPin, int8_t intPin, uint8_t address, const char* name);
+    ~Vl53l4cxDevice();
+    // Il driver vive in _driverSlot: una copia lo distruggerebbe due volte
+    Vl53l4cxDevice(const Vl53l4cxDevice&) = delete;
+    Vl53l4cxDevice& operator=(const Vl53l4cxDevice&) = delete;
+
+    void        setup() override;
+    const char* name() const override { return _name; }
+    uint8_t     address() const override { return _address; }
+    int8_t      xshutPin() const override { return (int8_t)_xshutPin; }
+
+    void powerDown() override;
+    void powerUp() override;
+    bool probeDefault() override;
+    bool probe() override;
+    bool initAtDefault() override;
+    // Re-init a regime: i passi di InitSensor nel task di servizio, il task sensori continua
+    BootStatus initStart() override;
+    BootStatus initPoll() override { return (BootStatus)_initStatus.load(); }
+    bool attachWarm() override;
+    void release() override;
+
+    uint32_t startRanging() override;
+
+    bool hasDataReadyPin() const override { return _intPin >= 0; }
+    void attachDataReady(void (*isr)(void*), void* arg) override;
+
+    int checkDataReady(bool& ready) override;
+    int readRange(RangeSample& sample) override;
+    uint32_t reconfigure(ToFDistanceMode mode, uint32_t budgetUs) override;
+
+private:
+    // Driver con indirizzo impostabile senza riprogrammare il sensore (reset a caldo)
+    class ToFDriver : public VL53L4CX {
+    public:
+        using VL53L4CX::VL53L4CX;
+        void adoptAddress(uint8_t addr) { MyDevice.I2cDevAddr = addr; }
+    };
+
+    I2CBus&     _bus;
+    I2CBus::DeviceId _dev;
+    // Driver costruito sul posto in uno slot fisso: nessun heap, nemmeno nei re-init a regime
+    alignas(ToFDriver) uint8_t _driverSlot[sizeof(ToFDriver)];
+    ToFDriver*  _driver;  // nullptr o _driverSlot
+    uint8_t     _xshutPin;
+    int8_t      _intPin;
+    uint8_t     _address;
+    const char* _name;
+
+    // Indirizzo di default 0x29 a clock ridotto, condiviso da tutti i sensori
+    static I2CBus::DeviceId _bootDev;
+
+    std::atomic<uint8_t> _initStatus;  // BootStatus, scritto dal task di servizio
+
+    ToFDriver* createDriver();
+    void destroyDriver();
+    bool initDriver();
+    static void initJob(void* arg);
+};
+
+/**
+ * @brief I VL53L4CX di un telaio (RobotLayout.h), costruiti dalla sua tabella.
+ * Un dispositivo per riga, niente per i sensori non montati: devices() ha
+ * un puntatore per ToFPosition (nullptr = non montato), come vuole ToFManager.
+ */
+template <class Layout>
+class Vl53l4cxArray {
+public:
+    explicit Vl53l4cxArray(I2CBus& bus) : Vl53l4cxArray(bus, std::make_index_sequence<Layout::TOF_N>()) {}
+
+    RangingDevice* const* devices() const { return _slots; }
+
+private:
+    static_assert(CheckedLayout<Layout>::value, "RobotLayout non valido");
+
+    template <size_t... I>
+    Vl53l4cxArray(I2CBus& bus, std::index_sequence<I...>)
+        : _devices{Vl53l4cxDevice(bus, Layout::TOF[I].xshutPin, Layout::TOF[I].intPin, Layout::TOF[I].address,
+                                  Layout::TOF[I].name)...},
+          _slots{} {
+        for (uint8_t i = 0; i < Layout::TOF_N; i++) _slots[Layout::TOF[i].position] = &_devices[i];
+    }
+
+    Vl53l4cxDevice _devices[Layout::TOF_N];
+    RangingDevice* _slots[TOF_COUNT];
+};
+
+// ==========================================
+// AS7262
+// ==========================================
+
+class As7262Device : public SpectralDevice {
+public:
+    explicit As7262Device(I2CBus& bus);
+
+    void       setup() override;
+    void       bootStart() override;
+    BootStatus bootPoll() override;
+
+    void configure(uint8_t integration, uint8_t gain) override;
+    void setLed(bool on) override;
+    void setLedCurrent(uint8_t level) override;
+    void startMeasurement() override;
+    bool pollSample(float channels[CH_COUNT]) override;
+    float readTemperature() override;
+    SpectralReadStats readStats() const override { return _stats; }
+
+private:
+    I2CBus& _bus;
+    I2CBus::DeviceId _dev;
+    Adafruit_AS726x _sensor;
+
+    // Percorso diretto sui registri virtuali (AS7262_FAST_READ)
+    uint8_t  _controlSetup;  // Gain come scritto da configure()
+    uint8_t  _ledControl;    // LED_CONTROL come scritto da setLed()/setLedCurrent()
+    uint32_t _integrationUs;
+    uint32_t _nextPollUs;    // Prima di questo istante il dato non può essere pronto
+    SpectralReadStats _stats;
+
+    bool readStatus(uint8_t& status);
+    bool waitStatus(uint8_t mask, bool set);
+    bool virtualRead(uint8_t reg, uint8_t* out, uint8_t len);
+    bool virtualWrite(uint8_t reg, uint8_t value);
+    bool startConversion();
+
+    std::atomic<uint8_t> _bootStatus; // BootStatus, scritto dal task di servizio
+    static void bootJob(void* arg);
+    bool bootSensor();
+};
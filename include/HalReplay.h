@@ -0,0 +1,232 @@
+/**
+ * @file HalReplay.h
+ * @brief Implementazioni di Hal.h su host: orologio virtuale e sensori che
+ * rigiocano una registrazione del FlightRecorder (dump [d] o file [o]).
+ *
+ * La traccia contiene i campioni grezzi con il loro timestamp (TLM_IMU_RAW,
+ * TLM_TOF_RAW, TLM_SPECTRAL_RAW). Ogni dispositivo restituisce solo i
+ * campioni con timestamp <= halMicros(), quindi i manager vedono gli stessi
+ * dati nello stesso ordine che hanno visto sul robot, ma l'orologio avanza
+ * quanto decide il chiamante: la replica gira molto più veloce del reale.
+ *
+ * Limiti: il magnetometro non è registrato (fusione a 6 assi) e la FIFO IMU
+ * riparte dai frame successivi all'avvio, quindi il bias si calcola sui
+ * primi IMU_FIFO_BIAS_FRAMES frame della traccia (robot fermo all'inizio).
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Constants.h"
+#include "Hal.h"
+#include "RobotLayout.h"
+#include "Telemetry.h"
+
+// ==========================================
+// OROLOGIO E MEMORIA
+// ==========================================
+
+class VirtualClock : public HalClock {
+public:
+    explicit VirtualClock(uint32_t startUs = 0) : _nowUs(startUs) {}
+
+    // Avvolto a 32 bit come micros(); millis() deriva dal contatore a 64 bit
+    uint32_t micros() override { return (uint32_t)_nowUs; }
+    uint32_t millis() override { return (uint32_t)(_nowUs / 1000); }
+    // Le attese non dormono: spostano solo il tempo virtuale
+    void     delayUs(uint32_t us) override { _nowUs += us; }
+
+    void advance(uint32_t us) { _nowUs += us; }
+
+private:
+    uint64_t _nowUs;
+};
+
+// Preferences in RAM: la calibrazione parte dai default a ogni replica
+class MemoryStorage : public HalStorage {
+public:
+    MemoryStorage() : _readOnly(true), _full(false) {}
+
+    // NVS piena: da qui ogni scrittura fallisce (ritorna 0), le letture no
+    void setFull(bool full) { _full = full; }
+
+    bool    begin(const char* ns, bool readOnly) override;
+    void    end() override;
+    bool    isKey(const char* key) override;
+    size_t  getBytes(const char* key, void* buf, size_t maxLen) override;
+    size_t  putBytes(const char* key, const void* buf, size_t len) override;
+    uint8_t getUChar(const char* key, uint8_t defaultValue) override;
+    size_t  putUChar(const char* key, uint8_t value) override;
+    float   getFloat(const char* key, float defaultValue) override;
+    bool    clear() override;
+
+private:
+    std::map<std::string, std::vector<uint8_t>> _values; // "namespace/chiave"
+    std::string _ns;
+    bool        _readOnly;
+    bool        _full;
+
+    std::string fullKey(const char* key) const { return _ns + "/" + key; }
+};
+
+// ==========================================
+// TRACCIA
+// ==========================================
+
+struct TraceImuFrame {
+    uint32_t        timestampUs;
+    TelemetryImuRaw raw;
+};
+
+struct TraceRange {
+    uint32_t        timestampUs;
+    TelemetryToFRaw raw;
+};
+
+struct TraceSpectral {
+    uint32_t timestampUs;
+    float    channels[CH_COUNT];
+};
+
+/**
+ * @brief Campioni grezzi di una registrazione, per tipo e in ordine di tempo.
+ * È un RecordSink: si riempie da un dump (load()) o direttamente con i log*().
+ * I record filtrati (TLM_IMU, TLM_TOF...) vengono ignorati.
+ */
+class SensorTrace : public RecordSink {
+public:
+    SensorTrace();
+
+    bool log(TelemetryType type, uint32_t timestampUs, const void* payload, size_t len) override;
+
+    // Byte di un dump COBS (flightDump / flightDumpFile). Chiamabile a blocchi.
+    void load(const uint8_t* data, size_t len);
+    bool loadFile(const char* path);
+
+    // Ordina i campioni: da chiamare dopo l'ultimo load()/log()
+    void finish();
+
+    const std::vector<TraceImuFrame>& imu() const { return _imu; }
+    const std::vector<TraceRange>&    ranges(uint8_t sensor) const { return _ranges[sensor]; }
+    const std::vector<TraceSpectral>& spectral() const { return _spectral; }
+
+    bool     empty() const { return _count == 0; }
+    uint32_t startUs() const { return _startUs; }
+    uint32_t endUs() const { return _endUs; }
+    uint32_t records() const { return _count; }
+    const TelemetryDecoder& decoder() const { return _decoder; }
+
+private:
+    TelemetryDecoder _decoder;
+    std::vector<TraceImuFrame> _imu;
+    std::vector<TraceRange>    _ranges[TOF_COUNT];
+    std::vector<TraceSpectral> _spectral;
+
+    uint32_t _count;
+    uint32_t _originUs; // Riferimento per ordinare timestamp avvolti a 32 bit
+    uint32_t _startUs;
+    uint32_t _endUs;
+
+    void extend(uint32_t timestampUs);
+};
+
+// ==========================================
+// DISPOSITIVI
+// ==========================================
+
+class ReplayImu : public ImuDevice {
+public:
+    explicit ReplayImu(const SensorTrace& trace) : _trace(trace), _next(0) {}
+
+    uint8_t whoAmI() override { return 0x71; } // MPU9250
+    void    reset() override {}
+    void    wake() override {}
+    bool    init() override { return true; }
+    void    configure() override {}
+    bool    initMagnetometer() override { return false; } // Non registrato
+    bool    isConnected() override { return !_trace.imu().empty(); }
+
+    bool     startFifo() override;
+    void     resetFifo() override;
+    uint16_t readFifo(uint8_t* out, uint16_t maxFrames, bool& overflow) override;
+    bool     readMagnetometer(float& x, float& y, float& z) override;
+
+    void  autoOffsets() override {}
+    bool  readGyro(float& x, float& y, float& z) override;
+    float readPitch() override;
+
+private:
+    const SensorTrace& _trace;
+    size_t _next;  // Primo frame non ancora in FIFO
+
+    const TraceImuFrame* latest() const;
+};
+
+class ReplayRanging : public RangingDevice {
+public:
+    ReplayRanging(const SensorTrace& trace, uint8_t sensor, const char* name)
+        : _trace(trace), _sensor(sensor), _name(name), _next(0), _off(false), _atDefault(false) {}
+
+    const char* name() const override { return _name; }
+    uint8_t     address() const override {
+        const ToFMountSpec* mount = layoutMount<RobotLayout>((ToFPosition)_sensor);
+        return mount ? mount->address : (uint8_t)TOF_DEFAULT_I2C_ADDR;
+    }
+
+    void powerDown() override { _off = true; }
+    // Dopo uno spegnimento il sensore torna a 0x29 (re-init di ToFManager)
+    void powerUp() override {
+        if (_off) _atDefault = !samples().empty();
+        _off = false;
+    }
+    // Sensori "già indirizzati": la replica passa dall'avvio a caldo
+    bool probeDefault() override { return _atDefault; }
+    bool probe() override { return !_off && !samples().empty(); }
+    bool initAtDefault() override {
+        _atDefault = false;
+        return true;
+    }
+    bool attachWarm() override { return true; }
+    void release() override { powerDown(); }
+
+    uint32_t startRanging() override;
+
+    int checkDataReady(bool& ready) override;
+    int readRange(RangeSample& sample) override;
+
+private:
+    const SensorTrace& _trace;
+    uint8_t     _sensor;
+    const char* _name;
+    size_t      _next;
+    bool        _off;
+    bool        _atDefault;
+
+    const std::vector<TraceRange>& samples() const { return _trace.ranges(_sensor); }
+};
+
+class ReplaySpectral : public SpectralDevice {
+public:
+    explicit ReplaySpectral(const SensorTrace& trace) : _trace(trace), _next(0), _readUs(0) {}
+
+    // Durata della lettura dei canali sul bus: l'orologio avanza di tanto a ogni campione
+    void setReadUs(uint32_t us) { _readUs = us; }
+
+    void       bootStart() override {}
+    BootStatus bootPoll() override { return _trace.spectral().empty() ? BOOT_FAILED : BOOT_DONE; }
+
+    void configure(uint8_t, uint8_t) override {}
+    void setLed(bool) override {}
+    void setLedCurrent(uint8_t) override {}
+    void startMeasurement() override;
+    bool pollSample(float channels[CH_COUNT]) override;
+    float readTemperature() override { return 25.0f; }
+
+private:
+    const SensorTrace& _trace;
+    size_t   _next;
+    uint32_t _readUs;
+};
@@ -0,0 +1,86 @@
+/**
+ * @file HeadingController.h
+ * @brief PID di direzione sullo yaw e miscelazione sui due motori.
+ *
+ * La correzione è una differenza di comando tra le ruote: sinistra =
+ * base - u, destra = base + u (yaw positivo = rotazione antioraria, come
+ * ImuManager). L'errore è avvolto in ±180°, la derivata è sulla velocità
+ * di yaw misurata. L'integrale lavora solo vicino al riferimento
+ * (HEADING_I_ZONE_DEG: nelle curve bastano P e D) e si ferma quando l'uscita
+ * è saturata nella stessa direzione (anti-windup). Se base + correzione supera
+ * MOTOR_SPEED_MAX si riduce la base, non la correzione: la direzione
+ * ha la precedenza.
+ *
+ * Nessuna dipendenza Arduino: testabile e misurabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+
+struct PidGains {
+    float kp;
+    float ki;
+    float kd;
+    float iLimit;    // Contributo massimo dell'integrale (ki * somma)
+    float iZone;     // Si integra solo con |errore| sotto questa soglia (0 = sempre)
+    float outLimit;  // Saturazione dell'uscita
+};
+
+class Pid {
+public:
+    explicit Pid(const PidGains& gains);
+
+    void reset();
+    void setGains(const PidGains& gains) { _gains = gains; }
+    const PidGains& gains() const { return _gains; }
+
+    /**
+     * @brief Un passo a periodo dt.
+     * @param error       Riferimento - misura.
+     * @param measureRate Derivata della misura (non dell'errore).
+     */
+    float update(float error, float measureRate, float dtS);
+
+    float integral() const { return _iTerm; }
+
+private:
+    PidGains _gains;
+    float    _iTerm;  // Già moltiplicato per ki: cambiare ki non fa saltare l'uscita
+};
+
+struct DriveCommand {
+    int16_t left;
+    int16_t right;
+};
+
+class HeadingController {
+public:
+    HeadingController();
+
+    // Nuovo riferimento (gradi, qualunque giro). L'integrale resta: stesso assetto
+    void setTarget(float yawDeg) { _target = yawDeg; }
+    float target() const { return _target; }
+
+    // Velocità di avanzamento comune alle due ruote (0 = rotazione sul posto)
+    void setBaseSpeed(int16_t speed);
+    int16_t baseSpeed() const { return _base; }
+
+    void reset();
+
+    DriveCommand update(float yawDeg, float yawRateDps, float dtS);
+
+    float error() const { return _error; }
+    Pid& pid() { return _pid; }
+
+    // Angolo in (-180, 180]
+    static float wrapDeg(float deg);
+
+private:
+    Pid     _pid;
+    float   _target;
+    float   _error;
+    int16_t _base;
+};
@@ -0,0 +1,107 @@
+/**
+ * @file HoleReflex.h
+ * @brief Riflesso sul buco nero: freno dal campione AS7262, senza passare dal controllo.
+ *
+ * ColorManager chiama onSample() appena un campione arriva dal bus, prima
+ * di temperatura, registratore ed EMA, con la classificazione del campione
+ * GREZZO: la stessa logica d'ombra di getDominantColor() (somma sotto la
+ * soglia dal nero, o luce assente = robot sollevato), ma senza i campioni di
+ * ritardo del filtro e del debounce degli eventi del pavimento.
+ *
+ * Allo scatto il riflesso prende i motori con DriveOutput::preempt(): freno
+ * in corto per REFLEX_BRAKE_US, poi, se il robot andava avanti, retromarcia
+ * per REFLEX_BACKOFF_US e di nuovo freno. I comandi del controllo restano
+ * ignorati finché il pianificatore (o l'utente) non chiama requestRelease().
+ * Scatta solo entrando nel nero: dopo un rilascio (o un riarmo) il robot è
+ * ancora sul buco e deve poterne uscire, quindi il campione nero conta solo
+ * se da allora se ne è visto uno non nero, o se il comando va in avanti.
+ *
+ * Senza campioni il riflesso è cieco: finché l'AS7262 non è online
+ * (DeviceHealth, anche durante boot e re-init) i motori restano frenati e
+ * tornano al controllo da soli quando il sensore si riprende.
+ *
+ * La latenza misurata va dall'inizio del poll che ha visto DATA_RDY (lettura
+ * dei canali inclusa) al comando di freno applicato; ogni scatto la registra
+ * via halLog e ne aggiorna il massimo. Non è misurato il tempo tra DATA_RDY
+ * alzato dal chip e quel poll: fino a AS7262_POLL_RETRY_US più un giro del
+ * task sensori, da sommare a mano al bilancio del riflesso.
+ *
+ * Nessuna dipendenza Arduino: testabile su host con una traccia spettrale.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "Constants.h"
+#include "Hal.h"
+#include "SpectralClassifier.h"
+
+enum ReflexState : uint8_t {
+    REFLEX_DISARMED = 0,
+    REFLEX_ARMED,
+    REFLEX_BRAKING,
+    REFLEX_BACKOFF,
+    REFLEX_HOLD,     // Fermo sul bordo, in attesa di requestRelease()
+    REFLEX_BLIND     // Fermo: AS7262 non online, nessun campione da guardare
+};
+
+class HoleReflex {
+public:
+    explicit HoleReflex(DriveOutput& drive);
+
+    // Da qualunque core, applicato dal prossimo tick(). Disarmato = nessuno
+    // scatto (calibrazione del nero, robot in mano) e motori restituiti.
+    void requestArmed(bool armed) { _armRequest.store(armed ? ARM : DISARM, std::memory_order_release); }
+
+    /**
+     * @brief Un campione grezzo appena letto (solo il task sensori).
+     * @return true se il riflesso è scattato su questo campione.
+     */
+    bool onSample(const SpectralMatch& raw, uint32_t sampleUs);
+
+    // Fasi a tempo e rilascio (solo il task sensori, a ogni giro).
+    // sensorOnline: salute dell'AS7262; se false e armato, freno fino al ritorno.
+    void tick(uint32_t nowUs, bool sensorOnline = true);
+
+    // Da qualunque core: buco gestito, motori di nuovo al controllo (non da cieco)
+    void requestRelease() { _releaseRequest.store(true, std::memory_order_release); }
+
+    ReflexState state() const { return _state.load(std::memory_order_relaxed); }
+    bool isEngaged() const { return state() >= REFLEX_BRAKING; }
+
+    // Statistiche, leggibili da qualunque core
+    uint32_t fires() const { return _fires.load(std::memory_order_relaxed); }
+    uint32_t lastLatencyUs() const { return _lastLatencyUs.load(std::memory_order_relaxed); }
+    uint32_t maxLatencyUs() const { return _maxLatencyUs.load(std::memory_order_relaxed); }
+    uint32_t overBudget() const { return _overBudget.load(std::memory_order_relaxed); }
+    uint32_t blindStops() const { return _blindStops.load(std::memory_order_relaxed); }
+
+    static const char* stateName(ReflexState state);
+    void printStats() const;
+
+private:
+    enum ArmRequest : uint8_t { ARM_NONE = 0, ARM, DISARM };
+
+    DriveOutput& _drive;
+
+    std::atomic<ReflexState> _state;
+    std::atomic<bool>        _releaseRequest;
+    std::atomic<uint8_t>     _armRequest;
+    uint8_t  _holeSamples;   // Campioni neri di fila
+    bool     _offBlack;      // Visto un campione non nero dall'ultimo rilascio/riarmo
+    bool     _wasForward;    // Direzione al momento dello scatto
+    uint32_t _phaseEndUs;
+
+    std::atomic<uint32_t> _fires;
+    std::atomic<uint32_t> _lastLatencyUs;
+    std::atomic<uint32_t> _maxLatencyUs;
+    std::atomic<uint32_t> _overBudget;
+    std::atomic<uint32_t> _blindStops;
+    std::atomic<uint32_t> _latencySumUs;  // Letta da printStats() su un altro core
+
+    void fire(const SpectralMatch& raw, uint32_t sampleUs);
+    void applyArm(bool armed);
+    void applySensorOnline(bool online);
+};
@@ -0,0 +1,146 @@
+/**
+ * @file I2CBus.h
+ * @brief Arbitro del bus I2C condiviso (GPIO 8/9): priorità, clock e statistiche.
+ *
+ * Unico proprietario di TwoWire e del clock. Ogni dispositivo si registra con
+ * una priorità e un clock massimo; i manager racchiudono le chiamate alle
+ * librerie in un I2CBus::Transaction. Tra due transazioni un dispositivo a
+ * priorità più alta in attesa passa davanti (es. IMU prima dei download ToF).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "Constants.h"
+
+// Priorità delle transazioni (più alto = passa prima)
+enum I2CPriority : uint8_t {
+    I2C_PRIO_LOW = 0,   // Download risultati ToF
+    I2C_PRIO_NORMAL,    // Spettrometro
+    I2C_PRIO_HIGH,      // IMU
+    I2C_PRIO_COUNT
+};
+
+// Codici di ritorno di TwoWire::endTransmission()
+enum I2CResult : uint8_t {
+    I2C_OK = 0,
+    I2C_ERR_DATA_TOO_LONG = 1,
+    I2C_ERR_NACK_ADDR = 2,
+    I2C_ERR_NACK_DATA = 3,
+    I2C_ERR_OTHER = 4,
+    I2C_ERR_TIMEOUT = 5
+};
+
+struct I2CDeviceStats {
+    uint8_t     address;
+    const char* name;
+    uint32_t    transactions;
+    uint32_t    nacks;
+    uint32_t    timeouts;
+    uint32_t    errors;      // Errori riportati dal driver (status != 0)
+    uint32_t    busTimeUs;   // Tempo totale di possesso del bus
+    uint32_t    maxHoldUs;
+    uint32_t    waitTimeUs;  // Tempo totale in coda
+    uint32_t    maxWaitUs;
+};
+
+class I2CBus {
+public:
+    typedef uint8_t DeviceId;
+    static const DeviceId INVALID_DEVICE = 0xFF;
+
+    explicit I2CBus(TwoWire& wire);
+
+    /**
+     * @brief Avvia il bus. È l'unico punto che chiama Wire.begin().
+     * @param maxClockHz Clock massimo del bus (limite globale).
+     */
+    bool begin(uint8_t sdaPin, uint8_t sclPin, uint32_t maxClockHz = I2C_BUS_MAX_CLOCK_HZ);
+
+    /**
+     * @brief Registra un dispositivo.
+     * @param maxClockHz Clock massimo accettato dal dispositivo.
+     * @return Id da usare nelle transazioni, INVALID_DEVICE se la tabella è piena.
+     */
+    DeviceId registerDevice(uint8_t address, const char* name, I2CPriority priority, uint32_t maxClockHz);
+
+    // Dopo un cambio indirizzo (es. ToF riassegnati)
+    void setDeviceAddress(DeviceId dev, uint8_t address);
+
+    // Per le librerie che vogliono il puntatore TwoWire nel costruttore/begin.
+    // Usarlo SOLO dentro una Transaction.
+    TwoWire* wire() { return &_wire; }
+
+    /**
+     * @brief Possesso del bus per la durata dello scope (RAII).
+     * Imposta il clock del dispositivo e misura attesa e tempo di possesso.
+     * Annidabile dallo stesso task.
+     */
+    class Transaction {
+    public:
+        Transaction(I2CBus& bus, DeviceId dev);
+        ~Transaction();
+
+        TwoWire* wire() { return _bus.wire(); }
+
+        // Esito di una chiamata di libreria (status != 0 = errore)
+        void reportDriverStatus(int status);
+        // Esito di endTransmission()
+        void reportWireResult(uint8_t result);
+
+    private:
+        I2CBus&  _bus;
+        DeviceId _dev;
+        bool     _outer;
+        uint32_t _startUs;
+        uint32_t _requestTicks;  // Per il Profiler (cicli CPU)
+
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+    };
+
+    // --- Helper di basso livello (ognuno è una transazione completa) ---
+    bool    probe(DeviceId dev);
+    uint8_t writeRegister(DeviceId dev, uint8_t reg, uint8_t value);
+    bool    readRegisters(DeviceId dev, uint8_t reg, uint8_t* buffer, uint8_t len);
+
+    // --- Statistiche ---
+    I2CDeviceStats getStats(DeviceId dev) const;
+    float utilization() const; // Frazione di tempo con bus occupato dall'ultimo reset
+    void  resetStats();
+    void  printStats() const;
+
+private:
+    struct Device {
+        I2CDeviceStats stats;
+        I2CPriority    priority;
+        uint32_t       maxClockHz;
+    };
+
+    TwoWire& _wire;
+    Device   _devices[I2C_BUS_MAX_DEVICES];
+    uint8_t  _deviceCount;
+
+    SemaphoreHandle_t _mutex;
+    TaskHandle_t      _owner;
+    uint8_t           _depth;
+    uint32_t          _maxClockHz;
+    uint32_t          _currentClockHz;
+
+    std::atomic<uint16_t> _waiting[I2C_PRIO_COUNT];
+
+    uint32_t _statsSinceUs;
+    uint32_t _busyUs;
+
+    bool higherPriorityWaiting(I2CPriority prio) const;
+    bool acquire(DeviceId dev);
+    void release(DeviceId dev, uint32_t holdUs);
+    void applyClock(uint32_t clockHz);
+    void recordWireResult(DeviceId dev, uint8_t result);
+};
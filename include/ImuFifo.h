@@ -0,0 +1,95 @@
+/**
+ * @file ImuFifo.h
+ * @brief Parser dei frame FIFO MPU9250 e integratore a passo fisso.
+ *
+ * Con ACCEL + GYRO abilitati nella FIFO ogni frame è di 12 byte big-endian
+ * (ax, ay, az, gx, gy, gz). Ogni frame viene integrato con il suo dt reale
+ * (1 ms a 1 kHz), indipendentemente da quanto spesso gira il loop.
+ * Se è collegato un OrientationFilter, ogni frame lo aggiorna alla piena frequenza.
+ * Nessuna dipendenza Arduino: testabile su host con stream FIFO registrati.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Constants.h"
+#include "OrientationFilter.h"
+
+#define MPU_FIFO_FRAME_BYTES 12
+// FIFO hardware da 512 byte: al massimo 42 frame completi in coda
+#define MPU_FIFO_BYTES 512
+#define MPU_FIFO_MAX_FRAMES (MPU_FIFO_BYTES / MPU_FIFO_FRAME_BYTES)
+
+struct ImuRawFrame {
+    int16_t ax, ay, az;
+    int16_t gx, gy, gz;
+};
+
+/**
+ * @brief Decodifica frame completi da uno stream FIFO.
+ * I byte di un eventuale frame incompleto in coda vengono ignorati.
+ * @return Numero di frame scritti in out.
+ */
+size_t parseFifoFrames(const uint8_t* bytes, size_t len, ImuRawFrame* out, size_t maxFrames);
+
+class FifoIntegrator {
+public:
+    /**
+     * @param gyroLsbPerDps Sensibilità giroscopio (16.4 a ±2000 dps).
+     * @param accLsbPerG    Sensibilità accelerometro (4096 a ±8 g).
+     * @param sampleDtS     Periodo di campionamento della FIFO.
+     */
+    FifoIntegrator(float gyroLsbPerDps, float accLsbPerG, float sampleDtS);
+
+    // Media dei prossimi N frame come bias (robot fermo e in piano). Non bloccante.
+    void startBiasCalibration(uint16_t frames);
+    bool isCalibrating() const { return _calibFramesLeft > 0; }
+
+    // Zona morta sul giroscopio Z (°/s), come nel percorso senza FIFO
+    void setDeadband(float dps) { _deadbandDps = dps; }
+
+    // Filtro aggiornato a ogni frame (nullptr = solo integrazione dello yaw)
+    void attachFilter(OrientationFilter* filter) { _filter = filter; }
+
+    // Ultimo campione del magnetometro, già negli assi dell'accelerometro
+    void setMagnetometer(float mx, float my, float mz, bool valid) {
+        _mx = mx; _my = my; _mz = mz; _magValid = valid;
+    }
+
+    void process(const ImuRawFrame* frames, size_t count);
+
+    // FIFO in overflow: campioni persi. Si integra l'ultima velocità nota per
+    // la durata mancante invece di perdere la rotazione (anche nel filtro collegato).
+    void bridgeGap(float seconds);
+
+    float yaw() const { return _yaw; }      // Gradi, non avvolto
+    float pitch() const { return _pitch; }  // Gradi
+    float gyroZDps() const { return _lastGyroZ; }
+    uint32_t samples() const { return _samples; }
+    void resetYaw() { _yaw = 0.0f; }
+    void adjustYaw(float deltaDeg) { _yaw += deltaDeg; }
+
+private:
+    float _gyroScale;  // dps per LSB
+    float _accScale;   // g per LSB
+    float _dt;
+    float _deadbandDps;
+
+    OrientationFilter* _filter;
+    float _mx, _my, _mz;
+    bool  _magValid;
+
+    float _biasGx, _biasGy, _biasGz;
+    float _biasAx, _biasAy, _biasAz;
+
+    uint16_t _calibFramesLeft;
+    uint16_t _calibFramesTotal;
+    int32_t  _calibSum[6];
+
+    float    _yaw;
+    float    _pitch;
+    float    _lastGyroZ;
+    uint32_t _samples;
+};
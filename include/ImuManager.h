@@ -1,42 +1,101 @@
 #pragma once
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <MPU9250_WE.h>
+#include "DeviceHealth.h"
+#include "Hal.h"
+#include "ImuFifo.h"
+#include "SensorTypes.h"
+#include "Telemetry.h"
 
 class ImuManager {
 public:
-    // Costruttore: accetta i pin I2C
-    ImuManager(uint8_t sdaPin, uint8_t sclPin);
+    // Costruttore: registri e bus stanno nel dispositivo (HalEsp32.h / HalReplay.h)
+    explicit ImuManager(ImuDevice& device);
 
-    // Inizializzazione hardware e calibrazione
+    // Inizializzazione hardware e calibrazione (bus già avviato)
     bool begin();
 
+    /**
+     * @brief Un passo dell'avvio non bloccante (vedi BootSequence).
+     * Le attese dopo reset/risveglio e la raccolta del bias non fermano il chiamante.
+     */
+    BootStatus bootStep(uint32_t nowUs);
+    const char* bootPhase() const; // nullptr a avvio concluso
+
     // Loop di aggiornamento (da chiamare il più spesso possibile, NO DELAY)
-    void update();
+    // Ritorna true se l'orientamento è stato aggiornato.
+    // Senza campioni da HEALTH_IMU_STALE_US (brown-out, connettore) l'IMU viene
+    // re-inizializzata qui dentro con le attese dell'avvio, senza bloccare:
+    // bias e orientamento restano quelli di prima.
+    bool update();
 
     // Getter per i dati elaborati
     float getYaw() const;   // Rotazione asse Z (Gradi)
     float getPitch() const; // Inclinazione rampe (Gradi)
-    bool isConnected();
+    float getRoll() const;  // Rollio (Gradi), solo con fusione attiva
+    Quaternion getQuaternion() const; // Orientamento fuso (identità senza fusione)
+    // Dal monitor di salute: nessun accesso al bus
+    bool isConnected() const { return _health.isOnline(); }
+    const DeviceHealth& getHealth() const { return _health; }
 
     // Funzione per azzerare lo Yaw corrente (utile all'avvio del robot)
     void resetYaw();
 
-private:
-    uint8_t _sda;
-    uint8_t _scl;
+    // Somma deltaDeg allo yaw (correzione della deriva da riferimenti esterni, es. WallEstimator)
+    void correctYaw(float deltaDeg);
+
+    // Numero di overflow della FIFO (campioni persi, compensati con bridgeGap)
+    uint32_t getFifoOverflows() const;
 
-    MPU9250_WE _mpu;
+    // Istante (micros) dell'ultimo campione integrato, ricostruito dalla FIFO
+    uint32_t getSampleTimeUs() const { return _sampleTimeUs; }
+
+    // Destinazione dei frame grezzi (registratore di volo). Solo dal task che chiama update().
+    void attachRecorder(RecordSink* sink) { _recorder = sink; }
+
+private:
+    ImuDevice& _device;
 
     // Variabili per il calcolo del Delta Time (dt)
-    unsigned long _lastUpdateMicros;
+    uint32_t _lastUpdateMicros;
     float _dt; // in secondi
 
     // Dati di orientamento
     float _yaw;
     float _pitch;
+    float _roll;
+
+#if IMU_USE_FIFO
+    // Modalità FIFO: tutti i frame accodati letti in un solo possesso del bus
+    FifoIntegrator _fifo;
+    uint8_t        _fifoBytes[MPU_FIFO_MAX_FRAMES * MPU_FIFO_FRAME_BYTES];
+    ImuRawFrame    _fifoFrames[MPU_FIFO_MAX_FRAMES];
+#endif
+#if IMU_USE_FIFO && IMU_FUSION_ENABLED
+    // Filtro 9 assi aggiornato a ogni frame FIFO (1 kHz)
+    OrientationFilter _fusion;
+    uint32_t          _lastMagMicros;
+    float             _lastFusedYaw;  // Yaw del filtro (avvolto ±180)
+    float             _yawOffset;     // Per resetYaw() senza toccare il filtro
+    void readMagnetometer();
+#endif
+    uint32_t       _fifoOverflows;
+    uint32_t       _sampleTimeUs;
+    RecordSink*    _recorder;
+
+    // Avvio non bloccante
+    enum BootState : uint8_t {
+        IMU_BOOT_IDLE, IMU_BOOT_RESET, IMU_BOOT_WAKE, IMU_BOOT_BIAS, IMU_BOOT_DONE, IMU_BOOT_FAILED
+    };
+    BootState _bootState;
+    uint32_t  _bootWaitUntilUs;
+    uint8_t   _chipId;
+
+    // Errori ed età del dato; re-init attraverso gli stati dell'avvio
+    DeviceHealth _health;
+    bool         _recovering;
 
-    // Configurazione filtri per vibrazioni
-    void configureFilters();
+    bool startFifo();
+    bool updateFromFifo();
+    bool updateDirect();
+    void recoveryStep(uint32_t nowUs);
 };
\ No newline at end of file
@@ -0,0 +1,53 @@
+/**
+ * @file LoopStats.h
+ * @brief Metriche di un anello periodico: jitter del periodo, WCET, scadenze perse.
+ *
+ * begin() all'inizio di ogni ciclo, end() alla fine, con lo stesso orologio.
+ *  - jitter: scarto tra due inizi consecutivi e il periodo nominale
+ *  - tempo di esecuzione: end - begin, con il massimo osservato (WCET)
+ *  - scadenza persa: il ciclo finisce dopo l'inizio teorico del successivo,
+ *    oppure il timer ha già scattato più volte (attivazioni saltate)
+ *
+ * Nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+struct LoopTiming {
+    uint32_t periodUs;        // Nominale
+    uint32_t cycles;
+    uint32_t periodMinUs;
+    uint32_t periodMaxUs;
+    uint32_t jitterMaxUs;     // max |periodo - nominale|
+    float    jitterRmsUs;
+    uint32_t execLastUs;
+    uint32_t execMaxUs;       // WCET osservato
+    float    execMeanUs;
+    uint32_t deadlineMisses;  // Cicli finiti oltre la scadenza
+    uint32_t skippedReleases; // Attivazioni del timer perse perché il ciclo era ancora in corso
+};
+
+class LoopStats {
+public:
+    explicit LoopStats(uint32_t periodUs);
+
+    void reset();
+
+    // missedReleases: attivazioni in più accumulate dall'ultimo ciclo (0 se puntuale)
+    void begin(uint32_t nowUs, uint32_t missedReleases = 0);
+    void end(uint32_t nowUs);
+
+    const LoopTiming& timing() const { return _t; }
+
+private:
+    LoopTiming _t;
+    uint32_t   _startUs;
+    bool       _started;   // Almeno un begin(): il periodo è misurabile dal secondo
+    bool       _lastOverrun;
+    uint32_t   _periods;
+    // Somme intere: l'S3 non ha FPU in doppia precisione
+    uint64_t   _jitterSq;
+    uint64_t   _execSum;
+};
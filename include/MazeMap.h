@@ -0,0 +1,188 @@
+/**
+ * @file MazeMap.h
+ * @brief Mappa a piastrelle del labirinto RCJ e pianificatore a flood-fill incrementale.
+ *
+ * MazeMap tiene due byte per piastrella in array a dimensione fissa:
+ *  - muri: bit 0-3 = muro presente (per MazeDir), bit 4-7 = lato già osservato
+ *  - flag: visitata, buco nero, checkpoint argento, blu, rampa (da ColorType)
+ * I muri sono condivisi: impostare il lato di una piastrella aggiorna anche
+ * quello opposto della vicina. I piani sono collegati da una piccola tabella
+ * di rampe, riconosciute dall'inclinazione (ImuManager::getPitch()).
+ *
+ * MazePlanner mantiene la distanza in passi di ogni piastrella dall'obiettivo
+ * più vicino (BFS multi-sorgente). Quando si scopre un muro o un buco, o cambia
+ * un obiettivo, ricalcola solo la regione coinvolta: prima invalida le
+ * piastrelle che non hanno più un vicino a distanza d-1, poi le ripara
+ * partendo dal bordo ancora valido. I lati non osservati contano come aperti
+ * (esplorazione ottimistica), quindi durante la corsa le distanze crescono.
+ *
+ * Nessuna allocazione, nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+
+enum MazeDir : uint8_t {
+    MAZE_NORTH = 0, // y-1
+    MAZE_EAST,      // x+1
+    MAZE_SOUTH,     // y+1
+    MAZE_WEST,      // x-1
+    MAZE_DIRS
+};
+
+inline MazeDir mazeOpposite(MazeDir d) { return (MazeDir)((d + 2) & 3); }
+
+// Bit del byte muri
+#define MAZE_WALL(d) (1u << (d))
+#define MAZE_SEEN(d) (0x10u << (d))
+
+// Flag di piastrella
+#define TILE_VISITED    0x01
+#define TILE_BLACK      0x02  // Buco nero: intransitabile
+#define TILE_CHECKPOINT 0x04  // Argento
+#define TILE_BLUE       0x08  // Sosta obbligatoria
+#define TILE_RAMP       0x10  // Piede o cima di una rampa
+
+// Indice lineare della piastrella: (piano * MAZE_HEIGHT + y) * MAZE_WIDTH + x
+typedef uint16_t MazeTile;
+
+#define MAZE_TILES   (MAZE_WIDTH * MAZE_HEIGHT * MAZE_LEVELS)
+#define MAZE_NO_TILE 0xFFFF
+
+class MazeMap {
+public:
+    MazeMap();
+
+    // Tutto aperto e non osservato, nessuna rampa
+    void clear();
+
+    // MAZE_NO_TILE fuori griglia
+    static MazeTile tileAt(int x, int y, int level);
+    static int tileX(MazeTile t) { return t % MAZE_WIDTH; }
+    static int tileY(MazeTile t) { return (t / MAZE_WIDTH) % MAZE_HEIGHT; }
+    static int tileLevel(MazeTile t) { return t / (MAZE_WIDTH * MAZE_HEIGHT); }
+    // Partenza: centro del piano 0
+    static MazeTile startTile() { return tileAt(MAZE_WIDTH / 2, MAZE_HEIGHT / 2, 0); }
+
+    bool hasWall(MazeTile t, MazeDir d) const { return _walls[t] & MAZE_WALL(d); }
+    bool isSideSeen(MazeTile t, MazeDir d) const { return _walls[t] & MAZE_SEEN(d); }
+    uint8_t walls(MazeTile t) const { return _walls[t]; }
+    uint8_t flags(MazeTile t) const { return _flags[t]; }
+    bool isBlocked(MazeTile t) const { return _flags[t] & TILE_BLACK; }
+
+    /**
+     * @brief Registra l'osservazione di un lato (e del lato opposto della vicina).
+     * @return true se il passaggio è cambiato (muro nuovo o rimosso).
+     */
+    bool setWall(MazeTile t, MazeDir d, bool present);
+
+    /**
+     * @brief Segna la piastrella come visitata con il colore del pavimento.
+     * @return true se la piastrella è diventata intransitabile (buco nero).
+     */
+    bool markFloor(MazeTile t, ColorType color);
+
+    /**
+     * @brief Collega il piede di una rampa alla piastrella di arrivo sull'altro piano.
+     * Andare da bottom in direzione d porta a top; da top in direzione opposta a bottom.
+     * Cambia la connettività: dopo, MazePlanner::recompute().
+     * @return false se la tabella è piena o le piastrelle non sono valide.
+     */
+    bool addRamp(MazeTile bottom, MazeDir d, MazeTile top);
+
+    // +1 salita, -1 discesa, 0 in piano (pitch positivo = muso in su)
+    static int8_t rampFromPitch(float pitchDeg);
+
+    /**
+     * @brief Piastrella raggiunta muovendosi da t in direzione d.
+     * @return MAZE_NO_TILE se c'è un muro, si esce dalla griglia o l'arrivo è un buco.
+     */
+    MazeTile neighbor(MazeTile t, MazeDir d) const;
+
+    // Come neighbor() ma ignorando muri e buchi (geometria + rampe)
+    MazeTile adjacent(MazeTile t, MazeDir d) const;
+
+private:
+    struct Ramp {
+        MazeTile bottom;
+        MazeTile top;
+        MazeDir  dir;
+    };
+
+    uint8_t _walls[MAZE_TILES];
+    uint8_t _flags[MAZE_TILES];
+    Ramp    _ramps[MAZE_MAX_RAMPS];
+    uint8_t _rampCount;
+};
+
+class MazePlanner {
+public:
+    static const uint16_t UNREACHABLE = 0xFFFF;
+
+    explicit MazePlanner(const MazeMap& map);
+
+    // Nessun obiettivo: tutte le distanze UNREACHABLE
+    void clear();
+
+    // Cambi di obiettivo, aggiornati in modo incrementale
+    void addGoal(MazeTile t);
+    void removeGoal(MazeTile t);
+    bool isGoal(MazeTile t) const { return testBit(_goal, t); }
+
+    // Ricalcolo completo (dopo molti cambi o per verifica)
+    void recompute();
+
+    // Da chiamare dopo MazeMap::setWall() che ha ritornato true
+    void onWallChanged(MazeTile t, MazeDir d);
+    // Da chiamare dopo MazeMap::markFloor() che ha ritornato true
+    void onTileBlocked(MazeTile t);
+
+    // Passi fino all'obiettivo più vicino
+    uint16_t distance(MazeTile t) const { return _dist[t]; }
+
+    /**
+     * @brief Direzione del prossimo passo verso l'obiettivo più vicino.
+     * @return MAZE_DIRS se t è un obiettivo o non c'è percorso.
+     */
+    MazeDir nextStep(MazeTile t) const;
+
+    // Piastrelle riesaminate dall'ultimo aggiornamento (misura della regione toccata)
+    uint16_t lastTouched() const { return _touched; }
+
+private:
+    static bool testBit(const uint8_t* bits, MazeTile t) { return bits[t >> 3] & (1u << (t & 7)); }
+    static void setBit(uint8_t* bits, MazeTile t) { bits[t >> 3] |= (uint8_t)(1u << (t & 7)); }
+    static void clearBit(uint8_t* bits, MazeTile t) { bits[t >> 3] &= (uint8_t)~(1u << (t & 7)); }
+
+    // Arco del grafo: simmetrico, nessun arco da o verso un buco
+    MazeTile link(MazeTile t, MazeDir d) const { return _map.isBlocked(t) ? MAZE_NO_TILE : _map.neighbor(t, d); }
+    // Ha ancora un vicino valido a distanza d-1 (o è un obiettivo)?
+    bool hasSupport(MazeTile t) const;
+    // Prova a migliorare t passando da un vicino: accoda se cambia
+    void relaxFrom(MazeTile from, MazeTile t);
+    void push(MazeTile t);
+    // Propaga le distanze accodate fino a convergenza
+    void propagate();
+    // Aumento di costo: invalida ciò che dipendeva dai semi e lo ripara
+    void raise(const MazeTile* seeds, uint8_t count);
+
+    const MazeMap& _map;
+
+    uint16_t _dist[MAZE_TILES];
+    uint8_t  _goal[(MAZE_TILES + 7) / 8];
+    uint8_t  _invalid[(MAZE_TILES + 7) / 8];
+    uint8_t  _queued[(MAZE_TILES + 7) / 8];
+
+    // Coda circolare (ogni piastrella al più una volta, grazie a _queued)
+    MazeTile _queue[MAZE_TILES];
+    uint16_t _head;
+    uint16_t _count;
+    // Piastrelle invalidate durante raise()
+    MazeTile _raised[MAZE_TILES];
+
+    uint16_t _touched;
+};
@@ -0,0 +1,40 @@
+/**
+ * @file MemoryPolicy.h
+ * @brief Dove vanno i buffer: SRAM interna per lo stato caldo, PSRAM per i blocchi grandi.
+ *
+ * La PSRAM (8 MB, OPI) è capiente ma più lenta e passa dalla cache: va bene
+ * per buffer scritti in sequenza e letti di rado (registratore di volo),
+ * non per lo stato che i task toccano a ogni ciclo. Ogni buffer grande
+ * dichiara la sua regione in Constants.h e si alloca con memAlloc(), in
+ * setup(): dopo, ogni chiamata conta come violazione per AllocAudit.
+ * Su host entrambe le regioni sono la heap normale.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum MemoryRegion : uint8_t {
+    MEM_HOT = 0,   // SRAM interna: accesso a ogni ciclo, ISR, DMA
+    MEM_BULK       // PSRAM; in SRAM interna solo fino a MEM_BULK_SRAM_MAX_BYTES
+};
+
+/**
+ * @brief Alloca nella regione richiesta (rispettando l'allineamento di malloc).
+ * Se la PSRAM manca o è piena, MEM_BULK ripiega sulla SRAM interna solo per
+ * blocchi fino a MEM_BULK_SRAM_MAX_BYTES (con un messaggio in entrambi i casi).
+ * @return nullptr se non c'è spazio in nessuna regione ammessa.
+ */
+void* memAlloc(size_t bytes, MemoryRegion region);
+void  memFree(void* ptr);
+
+// true se il puntatore è in PSRAM (sempre false su host)
+bool memIsExternal(const void* ptr);
+
+// Spazio libero nella regione (su host: 0, non noto)
+size_t memFreeBytes(MemoryRegion region);
+// Blocco libero più grande (frammentazione; su host: 0)
+size_t memLargestFreeBlock(MemoryRegion region);
+
+const char* memRegionName(MemoryRegion region);
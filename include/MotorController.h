@@ -1,5 +1,110 @@
-#ifndef MOTORCONTROLLER_H
-#define MOTORCONTROLLER_H
+/**
+ * @file MotorController.h
+ * @brief Driver Pololu Dual TB9051FTG: PWM LEDC, corrente in DMA, guasti.
+ *
+ * - PWM hardware LEDC a MOTOR_PWM_FREQ_HZ, comando con segno
+ *   -MOTOR_SPEED_MAX..MOTOR_SPEED_MAX (0 = freno, coast() = ruota libera)
+ * - M1CS/M2CS campionati dall'ADC in modalità continua (DMA): un task legge
+ *   i blocchi e aggiorna un MotorMonitor per motore. I canali su ADC2
+ *   (GPIO 11 su S3) non entrano nel DMA: li legge lo stesso task in one-shot
+ *   a ogni blocco. Nessuna analogRead() dal loop.
+ * - DIAG (attivo basso) su interrupt: la ISR segnala, il task spegne entrambi
+ *   i canali al blocco successivo (il TB9051FTG ha già aperto i ponti).
+ * - Stallo e sovracorrente spengono il solo motore interessato (EN basso)
+ *   fino a clearFaults().
+ *
+ * Scrive i comandi un solo task (il controllo); corrente e flag si leggono
+ * da qualunque core. Un riflesso (HoleReflex, dal task sensori) può prendere
+ * i motori con preempt(): da lì setSpeed() viene ignorato fino a
+ * releasePreempt(). Se i due si incrociano, l'ultimo a scrivere è il riflesso.
+ */
+
+#pragma once
+
 #include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "Constants.h"
+#include "Hal.h"
+#include "MotorMonitor.h"
+#include "Pins.h"
+
+class MotorController : public DriveOutput {
+public:
+    enum Motor : uint8_t { MOTOR_1 = 0, MOTOR_2, MOTOR_COUNT };
+
+    MotorController();
+
+    // Pin, LEDC, ADC continuo, interrupt DIAG e task di lettura. Motori frenati.
+    bool begin();
+
+    // Comando con segno, saturato a ±MOTOR_SPEED_MAX. Ignorato se il motore è in guasto.
+    void setSpeed(Motor motor, int16_t speed);
+    void setSpeeds(int16_t m1, int16_t m2);
+    int16_t getSpeed(Motor motor) const { return _ch[motor].command.load(std::memory_order_relaxed); }
+
+    // Freno (ponte in corto) e ruota libera (EN basso)
+    void brake() { setSpeeds(0, 0); }
+    void coast();
+
+    // DriveOutput: M1 sinistro, M2 destro (come ControlTask)
+    void preempt(int16_t left, int16_t right) override;
+    void releasePreempt() override;
+    int16_t driveCommand(uint8_t side) const override { return side < MOTOR_COUNT ? getSpeed((Motor)side) : 0; }
+    bool isPreempted() const { return _preempted.load(); }
+
+    float getCurrentMa(Motor motor) const { return _ch[motor].currentMa.load(std::memory_order_relaxed); }
+    // Eventi MOTOR_FLAG_* memorizzati fino a clearFaults()
+    uint8_t getFlags(Motor motor) const { return _ch[motor].flags.load(std::memory_order_acquire); }
+    bool hasFault() const { return getFlags(MOTOR_1) || getFlags(MOTOR_2); }
+    // Livello attuale del DIAG (il flag resta anche dopo che è tornato alto)
+    bool isDriverFault() const { return digitalRead(PIN_MOTOR_DIAG) == LOW; }
+
+    // Riabilita i motori (frenati). false se il DIAG è ancora basso.
+    bool clearFaults();
+
+    void printStatus() const;
+
+private:
+    struct Channel {
+        uint8_t pwmPin, dirPin, enPin;
+        int8_t  enbPin;
+        uint8_t csPin;
+        uint8_t ledcChannel;
+        bool    flip;
+        int8_t  adcChannel;  // Canale dell'unità (-1 = pin non analogico)
+        bool    onAdc1;      // true = nel pattern DMA, false = one-shot su ADC2
+
+        std::atomic<int16_t> command;
+        std::atomic<int16_t> preemptCommand;  // Comando del riflesso
+        std::atomic<bool>    tripped;
+        std::atomic<float>   currentMa;
+        std::atomic<uint8_t> flags;
+        std::atomic<bool>    clearRequest;
+
+        // Solo task di lettura
+        MotorMonitor monitor;
+        uint32_t     rawSum;
+        uint16_t     rawCount;
+    };
+
+    static void IRAM_ATTR onDiag(void* arg);
+    static void taskEntry(void* arg);
+    void run();
+
+    bool startAdc();
+    void applyOutput(Channel& c, int16_t speed);
+    void applyPreempt(Channel& c);
+    void trip(Channel& c, uint8_t flags);
+    void sampleAdc2(Channel& c);
+    void processFrame(const uint8_t* data, uint32_t len, uint32_t nowUs);
 
-#endif
\ No newline at end of file
+    Channel                 _ch[MOTOR_COUNT];
+    TaskHandle_t            _task;
+    std::atomic<bool>       _diagPending;
+    std::atomic<bool>       _preempted;
+    std::atomic<uint32_t>   _frames;
+    bool                    _started;
+};
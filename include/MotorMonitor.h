@@ -0,0 +1,65 @@
+/**
+ * @file MotorMonitor.h
+ * @brief Corrente filtrata e rilevamento di stallo/sovracorrente di un motore.
+ *
+ * Riceve la media di ogni blocco DMA dell'ADC (un blocco copre molti periodi
+ * del PWM a 20 kHz, quindi la media è la corrente media del motore) e il
+ * comando attuale. Eventi, tutti memorizzati fino a clear():
+ *  - sovracorrente: media dei blocchi oltre MOTOR_OVERCURRENT_MA per
+ *    MOTOR_OVERCURRENT_US (senza filtro: conta la latenza)
+ *  - stallo: con comando di almeno MOTOR_STALL_MIN_CMD, corrente filtrata
+ *    oltre MOTOR_STALL_FRACTION della corrente a rotore bloccato per quel
+ *    duty, per MOTOR_STALL_US. Per MOTOR_STALL_BLANK_US dopo una partenza,
+ *    un'inversione o un aumento del comando oltre MOTOR_STALL_BLANK_STEP lo
+ *    stallo non si valuta: allo spunto la corrente è la stessa.
+ *
+ * Nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+
+// Flag degli eventi (MotorMonitor::flags(), MotorController::getFlags())
+#define MOTOR_FLAG_STALL       0x01
+#define MOTOR_FLAG_OVERCURRENT 0x02
+#define MOTOR_FLAG_DRIVER      0x04  // DIAG del driver (impostato da MotorController)
+
+class MotorMonitor {
+public:
+    MotorMonitor();
+
+    void reset();
+
+    /**
+     * @brief Nuovo blocco di campioni.
+     * @param blockMa Corrente media del blocco.
+     * @param command Comando con segno in vigore durante il blocco.
+     * @return Flag diventati attivi con questo blocco (0 se nessuno).
+     */
+    uint8_t update(float blockMa, int16_t command, uint32_t nowUs);
+
+    float currentMa() const { return _filteredMa; }
+    uint8_t flags() const { return _flags; }
+    void setFlags(uint8_t flags) { _flags |= flags; }
+    // Azzera gli eventi; la corrente filtrata resta
+    void clear();
+
+    // Soglia di stallo per un comando (0 se il comando è troppo basso)
+    static float stallThresholdMa(int16_t command);
+    // Media dei campioni grezzi (0..MOTOR_ADC_MAX_RAW) -> mA
+    static float rawToMilliamps(float raw);
+
+private:
+    float    _filteredMa;
+    bool     _primed;
+    int16_t  _lastCommand;
+    uint32_t _blankUntilUs;
+    uint32_t _overSinceUs;
+    uint32_t _stallSinceUs;
+    bool     _over;   // Sopra la soglia di sovracorrente dal blocco _overSinceUs
+    bool     _stall;  // Sopra la soglia di stallo dal blocco _stallSinceUs
+    uint8_t  _flags;
+};
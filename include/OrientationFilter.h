@@ -0,0 +1,274 @@
+/**
+ * @file OrientationFilter.h
+ * @brief Filtri di orientamento a 9 assi (gyro + accel + magnetometro).
+ *
+ * Pensati per girare a ogni campione FIFO (1 kHz). Due varianti con la stessa
+ * interfaccia, scelte a compile time con ORIENTATION_FILTER_MAHONY:
+ *  - MadgwickFilter: gradiente discendente (riferimento).
+ *  - MahonyFilter: PI sull'errore tra direzioni misurate e stimate, circa la
+ *    metà delle operazioni nel ramo a 9 assi; l'integrale stima il bias del gyro.
+ * Nessun ciclo dipendente dai dati: il costo dipende solo dal ramo scelto (9
+ * assi con magnetometro valido, altrimenti 6 assi); gli altri controlli
+ * scartano solo vettori nulli. I tempi per update misurati finora sono solo
+ * su host (test_orientation), non sull'S3.
+ *
+ * Convenzioni: quaternione (w, x, y, z) da corpo a terra, angoli ZYX in gradi.
+ * Yaw positivo per rotazione positiva attorno a Z (come l'integrazione del gyro).
+ * Nessuna dipendenza Arduino: benchmark e test di deriva girano su host.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include "Constants.h"
+
+struct Quaternion {
+    float w, x, y, z;
+};
+
+// Stato e angoli comuni alle due varianti
+class OrientationEstimate {
+public:
+    /**
+     * @brief Rotazione attorno alla Z di terra (campioni persi, es. FIFO in
+     * overflow): cambia solo lo yaw, pitch e roll restano quelli stimati.
+     */
+    void rotateYaw(float rad) {
+        float c = cosf(0.5f * rad), s = sinf(0.5f * rad);
+        Quaternion q = _q;
+        _q = {c * q.w - s * q.z, c * q.x - s * q.y, c * q.y + s * q.x, c * q.z + s * q.w};
+    }
+
+    const Quaternion& quaternion() const { return _q; }
+
+    float yawDeg() const {
+        return atan2f(2.0f * (_q.w * _q.z + _q.x * _q.y), 1.0f - 2.0f * (_q.y * _q.y + _q.z * _q.z)) * RAD_TO_DEG_F;
+    }
+    float pitchDeg() const {
+        float s = 2.0f * (_q.w * _q.y - _q.x * _q.z);
+        if (s > 1.0f) s = 1.0f;
+        if (s < -1.0f) s = -1.0f;
+        return asinf(s) * RAD_TO_DEG_F;
+    }
+    float rollDeg() const {
+        return atan2f(2.0f * (_q.w * _q.x + _q.y * _q.z), 1.0f - 2.0f * (_q.x * _q.x + _q.y * _q.y)) * RAD_TO_DEG_F;
+    }
+
+protected:
+    static constexpr float RAD_TO_DEG_F = 57.29577951f;
+
+    Quaternion _q = {1.0f, 0.0f, 0.0f, 0.0f};
+
+    static inline float invSqrt(float x) {
+        return 1.0f / sqrtf(x);
+    }
+};
+
+// Gradiente discendente sull'errore di gravità e campo magnetico
+class MadgwickFilter : public OrientationEstimate {
+public:
+    explicit MadgwickFilter(float beta = IMU_FUSION_BETA) : _beta(beta) {}
+
+    void reset() {
+        _q = {1.0f, 0.0f, 0.0f, 0.0f};
+    }
+
+    void setBeta(float beta) { _beta = beta; }
+
+    /**
+     * @brief Un passo del filtro.
+     * @param gx,gy,gz Velocità angolare (rad/s), assi del corpo.
+     * @param ax,ay,az Accelerazione (qualsiasi unità, viene normalizzata).
+     * @param mx,my,mz Campo magnetico già riportato negli assi dell'accelerometro.
+     * @param useMag false = aggiornamento a 6 assi (magnetometro assente o disturbato).
+     */
+    void update(float gx, float gy, float gz,
+                float ax, float ay, float az,
+                float mx, float my, float mz, bool useMag, float dt) {
+        float q0 = _q.w, q1 = _q.x, q2 = _q.y, q3 = _q.z;
+
+        // Derivata del quaternione dal giroscopio
+        float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+        float qDot1 = 0.5f * ( q0 * gx + q2 * gz - q3 * gy);
+        float qDot2 = 0.5f * ( q0 * gy - q1 * gz + q3 * gx);
+        float qDot3 = 0.5f * ( q0 * gz + q1 * gy - q2 * gx);
+
+        float aNorm2 = ax * ax + ay * ay + az * az;
+        if (aNorm2 > 0.0f) {
+            float r = invSqrt(aNorm2);
+            ax *= r; ay *= r; az *= r;
+
+            float s0, s1, s2, s3;
+            float mNorm2 = mx * mx + my * my + mz * mz;
+
+            if (useMag && mNorm2 > 0.0f) {
+                r = invSqrt(mNorm2);
+                mx *= r; my *= r; mz *= r;
+
+                float _2q0mx = 2.0f * q0 * mx, _2q0my = 2.0f * q0 * my, _2q0mz = 2.0f * q0 * mz;
+                float _2q1mx = 2.0f * q1 * mx;
+                float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+                float _2q0q2 = 2.0f * q0 * q2, _2q2q3 = 2.0f * q2 * q3;
+                float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+                float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+                float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+                // Direzione di riferimento del campo terrestre
+                float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2
+                         + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+                float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1
+                         + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+                float _2bx = sqrtf(hx * hx + hy * hy);
+                float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1
+                           + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+                float _4bx = 2.0f * _2bx, _4bz = 2.0f * _2bz;
+
+                // Gradiente discendente (gravità + campo magnetico)
+                s0 = -_2q2 * (2.0f * q1q3 - _2q0q2 - ax) + _2q1 * (2.0f * q0q1 + _2q2q3 - ay)
+                   - _2bz * q2 * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx)
+                   + (-_2bx * q3 + _2bz * q1) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my)
+                   + _2bx * q2 * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz);
+                s1 = _2q3 * (2.0f * q1q3 - _2q0q2 - ax) + _2q0 * (2.0f * q0q1 + _2q2q3 - ay)
+                   - 4.0f * q1 * (1.0f - 2.0f * q1q1 - 2.0f * q2q2 - az)
+                   + _2bz * q3 * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx)
+                   + (_2bx * q2 + _2bz * q0) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my)
+                   + (_2bx * q3 - _4bz * q1) * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz);
+                s2 = -_2q0 * (2.0f * q1q3 - _2q0q2 - ax) + _2q3 * (2.0f * q0q1 + _2q2q3 - ay)
+                   - 4.0f * q2 * (1.0f - 2.0f * q1q1 - 2.0f * q2q2 - az)
+                   + (-_4bx * q2 - _2bz * q0) * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx)
+                   + (_2bx * q1 + _2bz * q3) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my)
+                   + (_2bx * q0 - _4bz * q2) * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz);
+                s3 = _2q1 * (2.0f * q1q3 - _2q0q2 - ax) + _2q2 * (2.0f * q0q1 + _2q2q3 - ay)
+                   + (-_4bx * q3 + _2bz * q1) * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx)
+                   + (-_2bx * q0 + _2bz * q2) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my)
+                   + _2bx * q1 * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz);
+            } else {
+                // Solo gravità (6 assi): lo yaw resta quello del giroscopio
+                float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+                float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+                float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+                float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+                s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+                s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+                s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+                s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+            }
+
+            float sNorm2 = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+            if (sNorm2 > 0.0f) {
+                r = invSqrt(sNorm2);
+                qDot0 -= _beta * s0 * r;
+                qDot1 -= _beta * s1 * r;
+                qDot2 -= _beta * s2 * r;
+                qDot3 -= _beta * s3 * r;
+            }
+        }
+
+        q0 += qDot0 * dt;
+        q1 += qDot1 * dt;
+        q2 += qDot2 * dt;
+        q3 += qDot3 * dt;
+
+        float r = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+        _q = {q0 * r, q1 * r, q2 * r, q3 * r};
+    }
+
+private:
+    float _beta;
+};
+
+// Correzione PI sul prodotto vettoriale tra direzioni misurate e stimate
+class MahonyFilter : public OrientationEstimate {
+public:
+    explicit MahonyFilter(float kp = IMU_FUSION_MAHONY_KP, float ki = IMU_FUSION_MAHONY_KI)
+        : _kp(kp), _ki(ki) {}
+
+    void reset() {
+        _q = {1.0f, 0.0f, 0.0f, 0.0f};
+        _ix = _iy = _iz = 0.0f;
+    }
+
+    void setGains(float kp, float ki) { _kp = kp; _ki = ki; }
+
+    // Stessi parametri di MadgwickFilter::update()
+    void update(float gx, float gy, float gz,
+                float ax, float ay, float az,
+                float mx, float my, float mz, bool useMag, float dt) {
+        float q0 = _q.w, q1 = _q.x, q2 = _q.y, q3 = _q.z;
+
+        float aNorm2 = ax * ax + ay * ay + az * az;
+        if (aNorm2 > 0.0f) {
+            float r = invSqrt(aNorm2);
+            ax *= r; ay *= r; az *= r;
+
+            float q0q1 = q0 * q1, q0q2 = q0 * q2, q1q3 = q1 * q3, q2q3 = q2 * q3;
+            float q0q0 = q0 * q0, q3q3 = q3 * q3;
+
+            // Metà della gravità stimata, negli assi del corpo
+            float vx = q1q3 - q0q2;
+            float vy = q0q1 + q2q3;
+            float vz = q0q0 - 0.5f + q3q3;
+
+            // Errore (metà): misurata x stimata
+            float ex = ay * vz - az * vy;
+            float ey = az * vx - ax * vz;
+            float ez = ax * vy - ay * vx;
+
+            float mNorm2 = mx * mx + my * my + mz * mz;
+            if (useMag && mNorm2 > 0.0f) {
+                r = invSqrt(mNorm2);
+                mx *= r; my *= r; mz *= r;
+
+                float q0q3 = q0 * q3, q1q1 = q1 * q1, q1q2 = q1 * q2, q2q2 = q2 * q2;
+
+                // Direzione di riferimento del campo terrestre
+                float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+                float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+                float bx = sqrtf(hx * hx + hy * hy);
+                float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+
+                // Metà del campo stimato, negli assi del corpo
+                float wx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+                float wy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+                float wz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+
+                ex += my * wz - mz * wy;
+                ey += mz * wx - mx * wz;
+                ez += mx * wy - my * wx;
+            }
+
+            // Integrale: bias del gyro (su Z solo con il magnetometro)
+            _ix += 2.0f * _ki * ex * dt;
+            _iy += 2.0f * _ki * ey * dt;
+            _iz += 2.0f * _ki * ez * dt;
+            gx += _ix + 2.0f * _kp * ex;
+            gy += _iy + 2.0f * _kp * ey;
+            gz += _iz + 2.0f * _kp * ez;
+        }
+
+        // Integrazione del quaternione con la velocità corretta
+        gx *= 0.5f * dt; gy *= 0.5f * dt; gz *= 0.5f * dt;
+        float p0 = q0, p1 = q1, p2 = q2;
+        q0 += -p1 * gx - p2 * gy - q3 * gz;
+        q1 +=  p0 * gx + p2 * gz - q3 * gy;
+        q2 +=  p0 * gy - p1 * gz + q3 * gx;
+        q3 +=  p0 * gz + p1 * gy - p2 * gx;
+
+        float r = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+        _q = {q0 * r, q1 * r, q2 * r, q3 * r};
+    }
+
+private:
+    float _kp, _ki;
+    float _ix = 0.0f, _iy = 0.0f, _iz = 0.0f;
+};
+
+// Variante selezionata a compile time (Constants.h)
+#if ORIENTATION_FILTER_MAHONY
+typedef MahonyFilter OrientationFilter;
+#else
+typedef MadgwickFilter OrientationFilter;
+#endif
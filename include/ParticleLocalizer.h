@@ -0,0 +1,131 @@
+/**
+ * @file ParticleLocalizer.h
+ * @brief Localizzazione a particelle sulla mappa a piastrelle: comando motori + yaw IMU + ToF.
+ *
+ * Ogni particella è una posa (x, y, direzione) con un peso. A ogni campione:
+ *  - predict(): avanzamento stimato dal comando (niente encoder) più la
+ *    variazione dello yaw IMU, con rumore; chi attraversa un muro noto muore
+ *  - update(): per ogni ToF montato (RobotLayout.h) e acceso, distanza
+ *    attesa = raggio dal sensore fino al primo muro della MazeMap
+ *    (attraversamento DDA delle piastrelle), peso moltiplicato per la
+ *    verosimiglianza della lettura
+ *  - ricampionamento sistematico O(N) quando le particelle efficaci calano
+ *
+ * Le particelle sono strutture di array (x[], y[], theta[], w[]) in un unico
+ * blocco allocato da begin(): il raycast riempie un array di distanze attese
+ * per sensore, poi il peso si aggiorna con un ciclo senza salti su array
+ * contigui, che il compilatore può vettorizzare.
+ *
+ * Coordinate in mm: x verso est, y verso sud (come gli indici delle
+ * piastrelle, MAZE_NORTH = y-1), la piastrella (tx, ty) copre
+ * [tx, tx+1) x [ty, ty+1) * MAZE_TILE_MM. Yaw in gradi, positivo in senso
+ * antiorario, 0 = nord (griglia allineata allo yaw 0, come WallEstimator).
+ * Un solo piano alla volta: quello della piastrella passata a reset().
+ *
+ * Nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+#include "MazeMap.h"
+#include "MemoryPolicy.h"
+#include "SensorTypes.h"
+
+struct LocalizerPose {
+    float    xMm;
+    float    yMm;
+    float    yawDeg;
+    float    spreadMm;  // Dispersione pesata delle particelle attorno alla media
+    MazeTile tile;      // MAZE_NO_TILE fuori griglia
+};
+
+class ParticleLocalizer {
+public:
+    explicit ParticleLocalizer(const MazeMap& map);
+    ~ParticleLocalizer();
+
+    /**
+     * @brief Alloca le particelle (una volta sola: le chiamate successive non riallocano).
+     * @return false se la regione non ha spazio.
+     */
+    bool begin(uint16_t count = LOCALIZER_PARTICLES, MemoryRegion region = LOCALIZER_REGION);
+
+    // Particelle attorno al centro della piastrella (gaussiana di spreadMm), tutte con lo yaw dato
+    void reset(MazeTile tile, float yawDeg, float spreadMm);
+    void resetPose(float xMm, float yMm, uint8_t level, float yawDeg, float spreadMm);
+
+    // Avanzamento stimato dal comando medio dei due motori tenuto per dtUs
+    static float commandToMm(int16_t left, int16_t right, uint32_t dtUs);
+
+    /**
+     * @brief Passo di moto: avanzamento lungo la direzione di ogni particella
+     * e yaw IMU assoluto (conta solo la variazione dall'ultima chiamata).
+     */
+    void predict(float forwardMm, float yawDeg);
+
+    /**
+     * @brief Correzione con un campione completo dei ToF (ToFManager::getReadings()).
+     * @return false se nessun sensore era utilizzabile (pesi invariati).
+     */
+    bool update(const ToFData& tof);
+
+    const LocalizerPose& estimate() const { return _pose; }
+
+    /**
+     * @brief Distanza dal punto al primo muro noto lungo la direzione (dx, dy) unitaria.
+     * Il bordo della griglia conta come muro; LOCALIZER_MAX_RANGE_MM se nessun muro.
+     */
+    float raycast(float xMm, float yMm, float dx, float dy) const;
+
+    // Lettura attesa del sensore dalla posa (distanza dalla finestra del ToF)
+    float expectedReading(float xMm, float yMm, float yawDeg, uint8_t sensor) const;
+
+    /**
+     * @brief Ricampionamento sistematico: n indici estratti con un solo numero
+     * casuale u0 in [0, 1). Pesi normalizzati (somma 1), una passata.
+     */
+    static void systematicResample(const float* w, uint16_t n, float u0, uint16_t* out);
+
+    uint16_t count() const { return _count; }
+    uint8_t  level() const { return _level; }
+    float    effectiveCount() const { return _neff; }
+    uint32_t resamples() const { return _resamples; }
+    uint32_t degenerate() const { return _degenerate; }  // Tutti i pesi a zero: pesi ripristinati
+    bool     isExternal() const { return memIsExternal(_block); }
+
+private:
+    const MazeMap& _map;
+
+    void*     _block;     // Un'unica allocazione per tutti gli array
+    uint16_t  _count;
+    float*    _x;
+    float*    _y;
+    float*    _theta;     // Radianti, antiorario da nord
+    float*    _w;
+    float*    _nx;        // Destinazione del ricampionamento (scambiati con x/y/theta)
+    float*    _ny;
+    float*    _ntheta;
+    float*    _expected;  // Distanza attesa del sensore in esame, per particella
+    float*    _cos;       // cos/sin della direzione, calcolati una volta per update()
+    float*    _sin;
+    uint16_t* _index;
+
+    uint8_t  _level;
+    float    _lastYawDeg;
+    bool     _hasYaw;
+    uint32_t _rng;
+
+    float    _neff;
+    uint32_t _resamples;
+    uint32_t _degenerate;
+    LocalizerPose _pose;
+
+    float uniform();   // [0, 1)
+    float gaussian();  // Media 0, varianza 1 (approssimata)
+    bool crossesWall(float x0, float y0, float x1, float y1) const;
+    void resample();
+    void computeEstimate();
+};
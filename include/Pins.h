@@ -4,12 +4,23 @@
 #define PIN_I2C_SDA 8
 #define PIN_I2C_SCL 9
 
-// XSHUT Pins per ToF VL53L4CX
-#define PIN_XSHUT_FRONT_LEFT  7
-#define PIN_XSHUT_FRONT_RIGHT 15
-#define PIN_XSHUT_BACK_LEFT   16
-#define PIN_XSHUT_BACK_RIGHT  17
-#define PIN_XSHUT_CENTER      18
+// XSHUT e GPIO1 dei ToF VL53L4CX: dipendono dal telaio, stanno in RobotLayout.h
+
+// Driver motori Pololu Dual TB9051FTG (documetation/Dual TB9051FTG Motor Driver Shield.md)
+#define PIN_M1PWM 1
+#define PIN_M1DIR 2   // HIGH = avanti
+#define PIN_M1EN  42  // HIGH = abilitato, LOW = ruota libera
+#define PIN_M2PWM 4
+#define PIN_M2DIR 5
+#define PIN_M2EN  6
+// ENB attivi bassi, collegati a GND (GPIO 7 è lo XSHUT del ToF anteriore sinistro). -1 = non cablato
+#define PIN_M1ENB -1
+#define PIN_M2ENB -1
+// DIAG comune ai due canali: attivo basso, open drain
+#define PIN_MOTOR_DIAG 14
+// Corrente (~500 mV/A). GPIO 10 = ADC1_CH9, GPIO 11 = ADC2_CH0
+#define PIN_M1CS 10
+#define PIN_M2CS 11
 
 /*
  Hardware Definition per ESP32-S3 DevKitC-1 (N16R8)
@@ -0,0 +1,196 @@
+/**
+ * @file Profiler.h
+ * @brief Misura dei percorsi caldi: timer di scope, istogrammi e timeline.
+ *
+ * PROFILE_SCOPE("ToF.update") all'inizio di una funzione misura la durata
+ * dello scope con il contatore di cicli della CPU (std::chrono su host).
+ * Per ogni nome si tengono, in memoria fissa:
+ *  - numero di chiamate, min/media/max
+ *  - istogramma log-lineare (PROFILER_HIST_SUB intervalli per ottava),
+ *    da cui il p99
+ *  - tempo bloccato sul bus I2C: I2CBus::Transaction lo somma allo scope
+ *    più interno attivo sullo stesso core (e, all'uscita, al suo genitore)
+ *
+ * Con la traccia attiva ogni scope diventa anche un evento in un anello di
+ * PROFILER_TRACE_EVENTS (PROFILER_TRACE_REGION), esportabile come JSON
+ * "trace event" di Chrome (chrome://tracing, Perfetto): un thread per core.
+ *
+ * Uno stesso nome va misurato da un solo task: le statistiche non sono
+ * protette da scritture concorrenti. Con PROFILER_ENABLED = 0 le macro non
+ * generano codice.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Constants.h"
+#include "MemoryPolicy.h"
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <hal/cpu_hal.h>
+#endif
+
+#define PROFILER_CORES 2
+#define PROFILER_NO_SCOPE 0xFF
+// Valori sotto PROFILER_HIST_SUB esatti, poi PROFILER_HIST_SUB intervalli per ottava fino a 2^32
+#define PROFILER_HIST_SUB (1u << PROFILER_HIST_SUB_BITS)
+#define PROFILER_HIST_BUCKETS (PROFILER_HIST_SUB * (33 - PROFILER_HIST_SUB_BITS))
+
+// Contatore di cicli (sul robot) o nanosecondi (su host), avvolto a 32 bit
+#if defined(ESP_PLATFORM)
+inline uint32_t profilerTicks() { return cpu_hal_get_cycle_count(); }
+inline uint8_t profilerCore() { return (uint8_t)xPortGetCoreID(); }
+#else
+uint32_t profilerTicks();
+inline uint8_t profilerCore() { return 0; }
+#endif
+
+// Statistiche di uno scope, in microsecondi
+struct ProfileSummary {
+    const char* name;
+    uint32_t    count;
+    float       minUs;
+    float       meanUs;
+    float       p99Us;
+    float       maxUs;
+    float       blockedMeanUs;  // Tempo medio sul bus I2C (attesa + possesso)
+    float       blockedMaxUs;
+};
+
+// Destinazione del testo esportato (Serial sul robot, file o stringa su host)
+typedef void (*ProfilerWriter)(const char* text, void* ctx);
+
+class ProfileTimer;
+
+class Profiler {
+public:
+    Profiler();
+    ~Profiler();
+
+    // Id del nome (lo stesso a ogni chiamata), PROFILER_NO_SCOPE se la tabella è piena
+    uint8_t registerScope(const char* name);
+
+    // Chiamati da ProfileTimer
+    void record(uint8_t scope, uint32_t ticks, uint32_t blockedTicks, uint8_t core, uint32_t startUs);
+    ProfileTimer* enter(ProfileTimer* timer, uint8_t core);
+    void leave(ProfileTimer* parent, uint8_t core) { _active[core] = parent; }
+
+    // Tempo bloccato del chiamante (I2C), attribuito allo scope attivo sul core
+    void addBlocked(uint32_t ticks);
+
+    // Azzera statistiche e traccia, i nomi restano
+    void reset();
+
+    /**
+     * @brief Alloca l'anello della timeline senza avviarla (in setup(): a regime niente heap).
+     * @return false se manca la memoria.
+     */
+    bool reserveTrace();
+
+    /**
+     * @brief Avvia la registrazione della timeline (alloca l'anello se non riservato).
+     * @return false se manca la memoria.
+     */
+    bool startTrace();
+    void stopTrace() { _tracing = false; }
+    bool isTracing() const { return _tracing; }
+    uint32_t traceEvents() const { return _traceCount < PROFILER_TRACE_EVENTS ? _traceCount : PROFILER_TRACE_EVENTS; }
+
+    uint8_t scopeCount() const { return _scopeCount; }
+    bool summary(uint8_t scope, ProfileSummary& out) const;
+    // Quantile (0..1) dall'istogramma, in tick: limite superiore dell'intervallo
+    uint32_t quantileTicks(uint8_t scope, float q) const;
+
+    void printStats() const;
+    // Eventi dal più vecchio, ts e dur in microsecondi. La traccia va fermata prima.
+    void exportChromeTrace(ProfilerWriter write, void* ctx) const;
+
+    static float ticksPerUs();
+    static uint16_t bucketOf(uint32_t ticks);
+    static uint32_t bucketUpper(uint16_t bucket);
+
+private:
+    struct Scope {
+        const char* name;
+        uint32_t    count;
+        uint32_t    minTicks;
+        uint32_t    maxTicks;
+        uint64_t    sumTicks;
+        uint64_t    blockedTicks;
+        uint32_t    blockedMaxTicks;
+        uint32_t    hist[PROFILER_HIST_BUCKETS];
+    };
+
+    struct TraceEvent {
+        uint32_t startUs;
+        uint32_t ticks;
+        uint32_t blockedTicks;
+        uint8_t  scope;
+        uint8_t  core;
+    };
+
+    Scope         _scopes[PROFILER_MAX_SCOPES];
+    uint8_t       _scopeCount;
+    ProfileTimer* _active[PROFILER_CORES];
+
+    TraceEvent*   _trace;
+    uint32_t      _traceCount;  // Eventi scritti dall'avvio (l'anello tiene gli ultimi)
+    volatile bool _tracing;
+
+    void clearScope(Scope& s);
+};
+
+// Istanza globale usata dalle macro
+Profiler& profiler();
+
+// Timer RAII di uno scope: si registra come scope attivo del core e misura all'uscita
+class ProfileTimer {
+public:
+    explicit ProfileTimer(uint8_t scope) : _scope(scope), _core(profilerCore()), _blocked(0), _startUs(0) {
+        Profiler& p = profiler();
+        _parent = p.enter(this, _core);
+        if (p.isTracing()) _startUs = traceMicros();
+        _start = profilerTicks();
+    }
+
+    ~ProfileTimer() {
+        uint32_t ticks = profilerTicks() - _start;
+        Profiler& p = profiler();
+        p.leave(_parent, _core);
+        // Il bus usato da uno scope annidato è anche del genitore
+        if (_parent) _parent->addBlocked(_blocked);
+        p.record(_scope, ticks, _blocked, _core, _startUs);
+    }
+
+    void addBlocked(uint32_t ticks) { _blocked += ticks; }
+
+    // Orologio comune ai due core per la timeline
+    static uint32_t traceMicros();
+
+private:
+    uint8_t       _scope;
+    uint8_t       _core;
+    uint32_t      _start;
+    uint32_t      _blocked;
+    uint32_t      _startUs;
+    ProfileTimer* _parent;
+
+    ProfileTimer(const ProfileTimer&) = delete;
+    ProfileTimer& operator=(const ProfileTimer&) = delete;
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_SCOPE(name)                                                                            \
+    static const uint8_t PROFILER_CONCAT(_profileId, __LINE__) = profiler().registerScope(name);      \
+    ProfileTimer PROFILER_CONCAT(_profileTimer, __LINE__)(PROFILER_CONCAT(_profileId, __LINE__))
+#define PROFILE_BLOCKED(ticks) profiler().addBlocked(ticks)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_BLOCKED(ticks) ((void)0)
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file RobotLayout.h
+ * @brief Configurazione del telaio a tempo di compilazione: ToF montati, pin, indirizzi, posizione.
+ *
+ * Ogni telaio è una struct con una tabella constexpr di ToFMountSpec, una
+ * riga per sensore montato. Chi la usa come parametro di template
+ * (Vl53l4cxArray<Layout>) o tramite RobotLayout (ParticleLocalizer) cicla solo sulle righe
+ * presenti: i sensori non montati non hanno né driver né iterazioni.
+ *
+ * CheckedLayout<Layout> verifica la tabella con static_assert: posizioni e
+ * indirizzi doppi, indirizzo di fabbrica o di un altro dispositivo del bus,
+ * pin XSHUT/GPIO1 condivisi o riservati (strapping, PSRAM ottale). Un
+ * telaio sbagliato non compila.
+ *
+ * Il telaio del firmware si sceglie con -DROBOT_LAYOUT=<struct> in
+ * platformio.ini (predefinito: ChassisFiveToF).
+ *
+ * Nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <initializer_list>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+
+struct ToFMountSpec {
+    ToFPosition position;   // Slot in ToFData e in ToFManager
+    uint8_t     xshutPin;
+    int8_t      intPin;     // GPIO1 data ready, -1 se non cablato
+    uint8_t     address;    // Assegnato dopo l'avvio a TOF_DEFAULT_I2C_ADDR
+    float       forwardMm;  // Finestra del sensore rispetto al centro del robot
+    float       leftMm;
+    float       angleDeg;   // Direzione del raggio, antiorario dal muso
+    const char* name;
+};
+
+// ==========================================
+// TELAI
+// ==========================================
+
+// Telaio attuale: due ToF per lato (coppie per WallEstimator) e uno davanti
+struct ChassisFiveToF {
+    static constexpr const char* NAME = "5 ToF";
+    static constexpr uint8_t TOF_N = 5;
+    static constexpr ToFMountSpec TOF[TOF_N] = {
+        {TOF_FRONT_LEFT,   7, -1, 0x30,  TOF_SIDE_BASELINE_MM / 2,  TOF_SIDE_OFFSET_MM,  90.0f, "Front_Left"},
+        {TOF_FRONT_RIGHT, 15, -1, 0x31,  TOF_SIDE_BASELINE_MM / 2, -TOF_SIDE_OFFSET_MM, -90.0f, "Front_Right"},
+        {TOF_BACK_LEFT,   16, -1, 0x32, -TOF_SIDE_BASELINE_MM / 2,  TOF_SIDE_OFFSET_MM,  90.0f, "Back_Left"},
+        {TOF_BACK_RIGHT,  17, -1, 0x33, -TOF_SIDE_BASELINE_MM / 2, -TOF_SIDE_OFFSET_MM, -90.0f, "Back_Right"},
+        {TOF_CENTER,      18, -1, 0x34,  TOF_CENTER_OFFSET_MM,      0.0f,                 0.0f, "Center"},
+    };
+};
+
+// ==========================================
+// VERIFICHE A TEMPO DI COMPILAZIONE
+// ==========================================
+
+namespace layout_check {
+
+template <class L>
+constexpr bool positionsUnique() {
+    for (uint8_t i = 0; i < L::TOF_N; i++) {
+        if (L::TOF[i].position >= TOF_COUNT) return false;
+        for (uint8_t j = i + 1; j < L::TOF_N; j++) {
+            if (L::TOF[i].position == L::TOF[j].position) return false;
+        }
+    }
+    return true;
+}
+
+template <class L>
+constexpr bool addressesValid() {
+    for (uint8_t i = 0; i < L::TOF_N; i++) {
+        uint8_t a = L::TOF[i].address;
+        // Indirizzi a 7 bit non riservati, diversi da quello di fabbrica e dagli altri dispositivi
+        if (a < 0x08 || a > 0x77) return false;
+        if (a == TOF_DEFAULT_I2C_ADDR || a == AS7262_I2C_ADDR || a == MPU9250_I2C_ADDR) return false;
+        for (uint8_t j = i + 1; j < L::TOF_N; j++) {
+            if (a == L::TOF[j].address) return false;
+        }
+    }
+    return true;
+}
+
+// Strapping (0, 45, 46), flash/PSRAM ottale (26-37), oltre l'ultimo GPIO dell'S3
+constexpr bool pinReserved(int pin) {
+    return pin == 0 || pin == 45 || pin == 46 || (pin >= 26 && pin <= 37) || pin > 48;
+}
+
+template <class L>
+constexpr bool usesPin(int pin) {
+    if (pin < 0) return false;  // Non cablato
+    for (uint8_t i = 0; i < L::TOF_N; i++) {
+        if (L::TOF[i].xshutPin == pin || L::TOF[i].intPin == pin) return true;
+    }
+    return false;
+}
+
+// Per le verifiche contro gli altri pin della scheda (Pins.h, solo firmware)
+template <class L>
+constexpr bool usesAnyPin(std::initializer_list<int> pins) {
+    for (int pin : pins) {
+        if (usesPin<L>(pin)) return true;
+    }
+    return false;
+}
+
+template <class L>
+constexpr bool pinsValid() {
+    for (uint8_t i = 0; i < L::TOF_N; i++) {
+        int xshut = L::TOF[i].xshutPin;
+        int irq = L::TOF[i].intPin;
+        if (pinReserved(xshut) || xshut == irq) return false;
+        if (irq >= 0 && pinReserved(irq)) return false;
+        for (uint8_t j = i + 1; j < L::TOF_N; j++) {
+            if (xshut == L::TOF[j].xshutPin || xshut == L::TOF[j].intPin) return false;
+            if (irq >= 0 && (irq == L::TOF[j].xshutPin || irq == L::TOF[j].intPin)) return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace layout_check
+
+template <class L>
+struct CheckedLayout {
+    static_assert(L::TOF_N > 0 && L::TOF_N <= TOF_COUNT, "RobotLayout: numero di ToF fuori da 1..TOF_COUNT");
+    static_assert(layout_check::positionsUnique<L>(), "RobotLayout: posizione ToF doppia o fuori da ToFPosition");
+    static_assert(layout_check::addressesValid<L>(), "RobotLayout: indirizzo I2C doppio, riservato o già in uso");
+    static_assert(layout_check::pinsValid<L>(), "RobotLayout: pin XSHUT/GPIO1 condiviso o riservato");
+    static constexpr bool value = true;
+};
+
+// Riga della tabella per una posizione, nullptr se il sensore non è montato
+template <class L>
+constexpr const ToFMountSpec* layoutMount(ToFPosition position) {
+    for (uint8_t i = 0; i < L::TOF_N; i++) {
+        if (L::TOF[i].position == position) return &L::TOF[i];
+    }
+    return nullptr;
+}
+
+#ifndef ROBOT_LAYOUT
+#define ROBOT_LAYOUT ChassisFiveToF
+#endif
+
+typedef ROBOT_LAYOUT RobotLayout;
+static_assert(CheckedLayout<RobotLayout>::value, "RobotLayout non valido");
@@ -0,0 +1,76 @@
+/**
+ * @file SensorReplay.h
+ * @brief I manager dei sensori che girano su host sopra una registrazione.
+ *
+ * Collega ImuManager, ToFManager e ColorManager ai dispositivi di HalReplay.h
+ * e a un VirtualClock, li avvia con BootSequence e poi avanza l'orologio a
+ * passi fissi chiamando update() come fa SensorTask sul robot. I dati filtrati
+ * escono su un RecordSink con lo stesso formato della telemetria, così un
+ * cambio di filtri o scheduler si confronta con la prova originale.
+ *
+ * Installa il proprio orologio con halSetClock(): una replica alla volta.
+ */
+
+#pragma once
+
+#include "BootSequence.h"
+#include "ColorManager.h"
+#include "HalReplay.h"
+#include "ImuManager.h"
+#include "ToFManager.h"
+#include "WallEstimator.h"
+
+class SensorReplay {
+public:
+    // trace deve restare valida (e già finish()) per tutta la replica
+    explicit SensorReplay(const SensorTrace& trace);
+    ~SensorReplay();
+
+    // Destinazione dei dati filtrati (nullptr = nessuna)
+    void attachSink(RecordSink* sink) { _sink = sink; }
+
+    // Avvio simulato, con le stesse attese del robot ma in tempo virtuale
+    bool boot();
+
+    /**
+     * @brief Avanza l'orologio di tickUs e aggiorna i manager pronti.
+     * @return false a traccia finita.
+     */
+    bool step(uint32_t tickUs = REPLAY_TICK_US);
+
+    // step() fino alla fine della traccia. Ritorna i passi eseguiti.
+    uint32_t run(uint32_t tickUs = REPLAY_TICK_US);
+
+    ImuManager&          imu() { return _imu; }
+    ToFManager&          tof() { return _tof; }
+    ColorManager&        color() { return _color; }
+    BootSequence&        bootSequence() { return _boot; }
+    const WallEstimator& walls() const { return _walls; }
+    VirtualClock&        clock() { return _clock; }
+    // NVS simulata: una calibrazione scritta qui prima di boot() viene caricata come sul robot
+    MemoryStorage&       storage() { return _storage; }
+    ReplaySpectral&      spectral() { return _spectralDevice; }
+
+    // Record filtrati prodotti (uno per aggiornamento di ciascun manager)
+    uint32_t outputs() const { return _outputs; }
+
+private:
+    const SensorTrace& _trace;
+    VirtualClock       _clock;
+
+    ReplayImu      _imuDevice;
+    ReplayRanging  _rangingDevices[TOF_COUNT];
+    RangingDevice* _rangingPtrs[TOF_COUNT];
+    ReplaySpectral _spectralDevice;
+    MemoryStorage  _storage;
+
+    ImuManager    _imu;
+    ToFManager    _tof;
+    ColorManager  _color;
+    BootSequence  _boot;
+    WallEstimator _walls;
+
+    RecordSink* _sink;
+    uint32_t    _outputs;
+    int8_t      _floorSub;   // Eventi del pavimento, inoltrati al sink
+};
@@ -0,0 +1,113 @@
+/**
+ * @file SensorTask.h
+ * @brief Task FreeRTOS di acquisizione sensori (core 0) con pubblicazione lock-free.
+ *
+ * Il task esegue gli update() di ToF, IMU e spettrometro e pubblica uno
+ * SensorSnapshot immutabile tramite TripleBuffer. Il controllo su core 1 legge
+ * l'ultimo snapshot con latest() senza lock né copie.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <atomic>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+#include "TripleBuffer.h"
+#include "ToFManager.h"
+#include "ImuManager.h"
+#include "ColorManager.h"
+#include "Telemetry.h"
+#include "WallEstimator.h"
+
+class SensorTask {
+public:
+    // I manager devono essere già inizializzati (begin()). nullptr = sensore assente.
+    SensorTask(ToFManager* tof, ImuManager* imu, ColorManager* color);
+
+    /**
+     * @brief Opzionale, prima di start(): ogni nuovo dato filtrato diventa anche
+     * un record (telemetria, registratore di volo).
+     * @return false se sono già collegati SENSOR_MAX_SINKS sink.
+     */
+    bool attachSink(RecordSink* sink);
+
+    /**
+     * @brief Crea il task di acquisizione.
+     * @return false se il task o la coda comandi non possono essere creati.
+     */
+    bool start(BaseType_t core = SENSOR_TASK_CORE, UBaseType_t priority = SENSOR_TASK_PRIORITY);
+
+    /**
+     * @brief Ultimo snapshot pubblicato (un solo consumatore: il loop di controllo).
+     * Il riferimento resta valido fino alla prossima chiamata di latest().
+     */
+    const SensorSnapshot& latest() { return _snapshots.latest(); }
+
+    /**
+     * @brief Ultima direzione (un solo consumatore: il task di controllo).
+     * Pubblicata a ogni campione IMU, senza attendere lo snapshot completo.
+     */
+    const HeadingSample& latestHeading() { return _heading.latest(); }
+
+    // Le operazioni che toccano lo stato dei manager vengono eseguite dal task
+    // stesso, tra due cicli di acquisizione: nessuna race con il core 0.
+    bool requestCalibration(ColorType type);
+    bool requestClassDefinition(const char* name);
+    bool requestProfile(const char* name);
+    bool requestProfileList();
+    bool requestCalibrationExport();
+
+    /**
+     * @brief Stato di moto comandato dal controllo (fermo / in marcia), per il
+     * budget dei ToF. La rotazione la rileva il task dallo yaw. Lock-free.
+     */
+    void setMotionHint(RobotMotion motion) { _motionHint.store(motion, std::memory_order_relaxed); }
+
+private:
+    enum CommandType : uint8_t {
+        CMD_CALIBRATE, CMD_DEFINE_CLASS, CMD_SELECT_PROFILE, CMD_LIST_PROFILES, CMD_EXPORT_CALIBRATION
+    };
+
+    struct Command {
+        CommandType type;
+        ColorType   color;
+        char        name[SPECTRAL_CLASS_NAME_LEN]; // Nome di classe o di profilo
+    };
+
+    ToFManager*   _tof;
+    ImuManager*   _imu;
+    ColorManager* _color;
+    RecordSink*   _sinks[SENSOR_MAX_SINKS];
+    uint8_t       _sinkCount;
+
+    TaskHandle_t  _handle;
+    QueueHandle_t _commands;
+
+    TripleBuffer<SensorSnapshot> _snapshots;
+    TripleBuffer<HeadingSample>  _heading;
+
+    // Muri e allineamento, aggiornati a ogni campione ToF
+    WallEstimator _walls;
+
+    // Moto del robot per ToFRangingPolicy
+    std::atomic<uint8_t> _motionHint;
+    float                _yawRateDps;
+
+    // Abbonamento agli eventi del pavimento: ognuno diventa un record per i sink
+    int8_t _floorSub;
+
+    // Stato "sorgente" del task: ogni snapshot viene ricostruito da qui
+    SensorSnapshot _state;
+
+    static void taskEntry(void* arg);
+    void run();
+    void handleCommands();
+    void publish();
+    void publishHeading();
+    bool sendNamed(CommandType type, const char* name);
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ Tipi dati condivisi dai manager dei sensori.
+ Nessuna dipendenza da Arduino: questo header compila anche nell'env native.
+ */
+
+// Esito di un passo di avvio non bloccante (bootStep dei manager)
+enum BootStatus : uint8_t {
+    BOOT_PENDING = 0,
+    BOOT_DONE,
+    BOOT_FAILED
+};
+
+// Stato di moto del robot, per le politiche dei sensori (es. ToFRangingPolicy)
+enum RobotMotion : uint8_t {
+    MOTION_STATIONARY = 0,
+    MOTION_DRIVING,
+    MOTION_TURNING
+};
+
+// Direzione per il controllo, pubblicata dal task sensori a ogni campione IMU
+struct HeadingSample {
+    float    yaw;          // Gradi, come SensorSnapshot::yaw
+    float    yawRateDps;   // Velocità di yaw tra gli ultimi due campioni
+    uint32_t timestampUs;  // Istante del campione IMU (0 = mai pubblicato)
+};
+
+// ==========================================
+// SPETTROMETRO (AS7262)
+// ==========================================
+
+// Indici dei canali spettrali
+enum AS_CH { V = 0, B, G, Y, O, R, CH_COUNT };
+
+enum ColorType {
+    COLOR_NONE = 0,
+    COLOR_BLACK,
+    COLOR_SILVER,
+    COLOR_WHITE,
+    COLOR_RED,
+    COLOR_BLUE
+};
+
+struct RGBColor {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+struct SpectralData {
+    float channels[CH_COUNT];
+    float sum;
+};
+
+// ==========================================
+// ARRAY ToF (VL53L4CX)
+// ==========================================
+
+// Numero di sensori
+#define TOF_COUNT 5
+
+// Enumerazione per indicizzare facilmente i sensori
+enum ToFPosition {
+    TOF_FRONT_LEFT = 0,
+    TOF_FRONT_RIGHT,
+    TOF_BACK_LEFT,
+    TOF_BACK_RIGHT,
+    TOF_CENTER
+};
+
+// Struttura dati per restituire le letture in blocco
+struct ToFData {
+    int16_t  distance_mm[TOF_COUNT]; // Filtrata se valida; -1 offline, TOF_NO_OBJECT_MM fuori portata
+    bool     valid[TOF_COUNT];       // true se l'ultima misura è affidabile (RangeStatus 0)
+    uint32_t timestampUs[TOF_COUNT]; // Istante (micros) dell'ultima misura, 0 se mai arrivata
+};
+
+// Lati della piastrella visti dall'array ToF (vedi WallEstimator.h)
+enum WallSide {
+    WALL_LEFT = 0,
+    WALL_RIGHT,
+    WALL_FRONT,
+    WALL_SIDES
+};
+
+// Muri e posa del robot nella piastrella, ricavati dalle letture ToF
+struct WallEstimate {
+    bool    present[WALL_SIDES];    // Con isteresi sulla confidenza
+    float   confidence[WALL_SIDES]; // 0..1
+    bool    lateralValid;
+    float   lateralOffsetMm;        // > 0 = robot a destra del centro piastrella
+    bool    headingValid;
+    float   headingErrorDeg;        // > 0 = muso ruotato a sinistra rispetto ai muri
+    int16_t frontDistanceMm;        // Dal centro robot al muro davanti, -1 se nessuno
+};
+
+
+// ==========================================
+// SNAPSHOT PUBBLICATO DAL TASK SENSORI
+// ==========================================
+
+// Stato completo dei sensori in un istante. Viene scritto solo dal task di
+// acquisizione (core 0) e letto in sola lettura dal controllo (core 1).
+struct SensorSnapshot {
+    uint32_t sequence;         // Numero di pubblicazione (0 = mai pubblicato)
+    uint32_t timestampUs;      // micros() al momento della pubblicazione
+
+    // ToF
+    ToFData      tof;
+    WallEstimate walls;        // Stimati dallo stesso campione ToF
+    uint32_t     tofTimestampUs; // Ultimo campione ToF arrivato
+
+    // IMU
+    float    yaw;              // Gradi
+    float    pitch;            // Gradi
+    uint32_t imuTimestampUs;
+
+    // Spettrometro
+    SpectralData spectral;
+    ColorType    color;        // Classificazione del campione in 'spectral'
+    int8_t       colorClass;   // Classe in tabella (-1 = nessuna), anche per colori utente
+    uint32_t     colorTimestampUs;
+};
@@ -0,0 +1,104 @@
+/**
+ * @file SpectralClassifier.h
+ * @brief Classificatore spettrale a N classi per l'AS7262.
+ *
+ * Le classi (bianco, nero, rosso, blu, ... più quelle definite dall'utente)
+ * sono una tabella: aggiungere un colore di piastrella non richiede codice.
+ * I profili di riferimento vengono normalizzati una sola volta, quando si
+ * calibra o si carica la tabella; classify() normalizza solo il campione
+ * (una divisione) e confronta con i profili già pronti.
+ *
+ * Regole, invariate rispetto al classificatore a 4 colori:
+ *  1. Somma > somma del bianco * DEFAULT_SILVER_RATIO  -> ARGENTO
+ *  2. Somma < COLOR_MIN_SUM                            -> NERO (rumore)
+ *  3. Zona d'ombra (somma < soglia dal nero): vince solo una classe con
+ *     SPECTRAL_SHADOW_OK e distanza < COLOR_SHAPE_CONFIDENCE, altrimenti NERO
+ *  4. Altrimenti vince la classe con distanza minore
+ *
+ * Ogni risultato ha una confidenza 0..1: per le decisioni di forma è il
+ * margine rispetto alla classe seconda di tipo diverso (1 - d1/d2); per
+ * quelle di somma (argento, ombra) la distanza relativa dalla soglia,
+ * piena a COLOR_SUM_MARGIN. Serve al debounce di FloorEventDetector.
+ *
+ * Nessuna dipendenza Arduino: testabile e misurabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+
+// Flag di classe
+#define SPECTRAL_MATCH_SHAPE 0x01  // Partecipa al confronto di forma
+#define SPECTRAL_SHADOW_OK   0x02  // Riconoscibile anche in zona d'ombra
+#define SPECTRAL_DARK_REF    0x04  // Riferimento del nero (solo somma, soglia d'ombra)
+#define SPECTRAL_BRIGHT_REF  0x08  // Riferimento del bianco (soglia argento)
+
+#define SPECTRAL_CLASS_NAME_LEN 12
+
+struct SpectralClass {
+    char         name[SPECTRAL_CLASS_NAME_LEN];
+    ColorType    type;   // Etichetta semantica (COLOR_NONE per colori utente)
+    uint8_t      flags;
+    SpectralData ref;    // Profilo grezzo (per salvataggio/export)
+};
+
+struct SpectralMatch {
+    ColorType type;
+    int8_t    classId;   // Indice in tabella, -1 se nessuna classe (argento/rumore)
+    float     distance;  // Distanza dalla classe vincente (0 se decisa dalla somma)
+    float     confidence; // 0..1, vedi sopra
+};
+
+class SpectralClassifier {
+public:
+    static const int8_t NO_CLASS = -1;
+
+    SpectralClassifier();
+
+    void clear();
+
+    /**
+     * @brief Aggiunge una classe alla tabella.
+     * @return Indice della classe, NO_CLASS se la tabella è piena.
+     */
+    int8_t addClass(const char* name, ColorType type, uint8_t flags, const SpectralData& ref);
+
+    // Aggiorna il profilo di una classe (calibrazione): rinormalizza solo quella
+    bool setReference(uint8_t id, const SpectralData& ref);
+
+    int8_t findByType(ColorType type) const;
+    int8_t findByName(const char* name) const;
+
+    uint8_t count() const { return _count; }
+    const SpectralClass& get(uint8_t id) const { return _classes[id]; }
+
+    // Incrementato a ogni modifica della tabella: invalida i risultati in cache
+    uint32_t revision() const { return _revision; }
+
+    // Soglia d'ombra derivata dal riferimento del nero
+    float darkThreshold() const { return _darkThreshold; }
+
+    SpectralMatch classify(const SpectralData& sample) const;
+
+private:
+    SpectralClass _classes[COLOR_MAX_CLASSES];
+    // Profili normalizzati (canale / somma), contigui per il ciclo di confronto
+    float   _norm[COLOR_MAX_CLASSES][CH_COUNT];
+    bool    _normValid[COLOR_MAX_CLASSES];
+    uint8_t _count;
+    uint32_t _revision;
+
+    float _silverSum;      // Somma bianco * DEFAULT_SILVER_RATIO
+    float _darkThreshold;  // Somma nero * COLOR_DARK_SCALE + COLOR_DARK_OFFSET
+    int8_t _darkId;        // Classe restituita per il NERO
+
+    void normalize(uint8_t id);
+    void refreshAnchors();
+    // Confidenza 0..1 da un margine relativo sulla somma
+    static float sumMargin(float relative);
+    // 1 - d1/d2 rispetto alla classe seconda di tipo diverso (dist < 0 = esclusa)
+    float shapeMargin(int8_t best, const float* dist) const;
+};
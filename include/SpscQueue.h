@@ -0,0 +1,58 @@
+/**
+ * @file SpscQueue.h
+ * @brief Coda circolare lock-free a un produttore e un consumatore.
+ *
+ * Il produttore scrive solo _tail, il consumatore solo _head: ognuno legge
+ * l'indice dell'altro con acquire e pubblica il proprio con release, quindi
+ * l'elemento copiato è visibile prima dell'indice. Nessun lato si blocca:
+ * a coda piena push() ritorna false e il chiamante conta la perdita.
+ * Header-only e senza dipendenze Arduino: compila anche nell'env native.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, uint16_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue: N deve essere una potenza di 2");
+
+public:
+    SpscQueue() : _head(0), _tail(0) {}
+
+    // --- Lato produttore ---
+
+    bool push(const T& value) {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        if ((uint16_t)(tail - _head.load(std::memory_order_acquire)) >= N) return false;
+        _items[tail & MASK] = value;
+        _tail.store((uint16_t)(tail + 1), std::memory_order_release);
+        return true;
+    }
+
+    // --- Lato consumatore ---
+
+    bool pop(T& out) {
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) return false;
+        out = _items[head & MASK];
+        _head.store((uint16_t)(head + 1), std::memory_order_release);
+        return true;
+    }
+
+    // Indicativa se letta dall'altro lato
+    uint16_t size() const {
+        return (uint16_t)(_tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire));
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr uint16_t capacity() { return N; }
+
+private:
+    static constexpr uint16_t MASK = N - 1;
+
+    T _items[N];
+    // Indici liberi di avvolgersi a 16 bit; su linee di cache distinte
+    alignas(64) std::atomic<uint16_t> _head;  // posseduto dal consumatore
+    alignas(64) std::atomic<uint16_t> _tail;  // posseduto dal produttore
+};
@@ -0,0 +1,180 @@
+/**
+ * @file Telemetry.h
+ * @brief Protocollo binario di telemetria: record versionati, CRC-32, framing COBS.
+ *
+ * Un frame sul filo è COBS(header + payload + CRC-32) seguito da 0x00.
+ * COBS elimina gli zeri dal contenuto, quindi 0x00 delimita sempre un frame:
+ * il decoder si risincronizza da solo dopo byte persi o testo di debug.
+ * Il CRC scarta i frame corrotti; versione e dimensione del payload vengono
+ * verificate per tipo, così un decoder vecchio ignora record che non conosce.
+ *
+ * Tutti i campi sono little-endian (ESP32 e host x86/ARM).
+ * Nessuna dipendenza Arduino: encoder e decoder compilano anche su host.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorTypes.h"
+
+#define TELEMETRY_SCHEMA_VERSION 1
+
+// Payload massimo di un record (il più grande oggi è TelemetrySpectral)
+#define TELEMETRY_MAX_PAYLOAD 64
+// Header + payload + CRC, prima della codifica COBS
+#define TELEMETRY_MAX_RAW (sizeof(TelemetryHeader) + TELEMETRY_MAX_PAYLOAD + 4)
+// COBS aggiunge 1 byte ogni 254 (+1), più il delimitatore
+#define TELEMETRY_MAX_FRAME (TELEMETRY_MAX_RAW + TELEMETRY_MAX_RAW / 254 + 2)
+
+enum TelemetryType : uint8_t {
+    TLM_TOF = 1,
+    TLM_IMU,
+    TLM_SPECTRAL,
+    TLM_COLOR,
+    TLM_IMU_RAW,       // Frame FIFO grezzo (1 kHz)
+    TLM_TOF_RAW,       // Singola misura di un sensore, con range status
+    TLM_SPECTRAL_RAW,  // Canali AS7262 prima dell'EMA
+    TLM_FLOOR_EVENT    // Transizione di colore confermata (FloorEventDetector)
+};
+
+struct __attribute__((packed)) TelemetryHeader {
+    uint8_t  version;      // TELEMETRY_SCHEMA_VERSION
+    uint8_t  type;         // TelemetryType
+    uint16_t sequence;     // Globale, assegnata dal produttore: i buchi = record persi
+    uint32_t timestampUs;  // micros() del campione
+};
+
+struct __attribute__((packed)) TelemetryToF {
+    int16_t distance_mm[TOF_COUNT];
+    uint8_t validMask;     // bit i = ToFData.valid[i]
+};
+
+struct __attribute__((packed)) TelemetryImu {
+    float yaw;
+    float pitch;
+    float roll;
+};
+
+struct __attribute__((packed)) TelemetrySpectral {
+    float channels[CH_COUNT];
+    float sum;
+};
+
+struct __attribute__((packed)) TelemetryColor {
+    uint8_t type;          // ColorType
+    int8_t  classId;       // -1 = nessuna classe
+    float   distance;
+};
+
+// Timestamp dell'header = primo campione del nuovo colore
+struct __attribute__((packed)) TelemetryFloorEvent {
+    uint8_t  from;         // ColorType
+    uint8_t  to;
+    int8_t   toClass;      // -1 = nessuna classe
+    float    confidence;
+    uint32_t confirmUs;    // Campione che ha confermato la transizione
+};
+
+struct __attribute__((packed)) TelemetryImuRaw {
+    int16_t ax, ay, az;    // LSB, come nella FIFO
+    int16_t gx, gy, gz;
+};
+
+struct __attribute__((packed)) TelemetryToFRaw {
+    uint8_t sensor;        // ToFPosition
+    uint8_t rangeStatus;   // 0 = ok, 255 = nessun oggetto
+    int16_t distance_mm;
+};
+
+// Dimensione attesa del payload per tipo (0 = tipo sconosciuto)
+size_t telemetryPayloadSize(uint8_t type);
+
+/**
+ * @brief Destinazione di record (flusso seriale, registratore di volo...).
+ * I log*() compongono il payload e lo passano a log(); ogni sink decide
+ * se accodarlo, salvarlo o scartarlo.
+ */
+class RecordSink {
+public:
+    virtual ~RecordSink() {}
+
+    // false = record non accettato (sink spento o pieno)
+    virtual bool log(TelemetryType type, uint32_t timestampUs, const void* payload, size_t len) = 0;
+
+    bool logToF(const ToFData& data, uint32_t timestampUs);
+    bool logImu(float yaw, float pitch, float roll, uint32_t timestampUs);
+    bool logSpectral(const SpectralData& data, uint32_t timestampUs);
+    bool logColor(ColorType type, int8_t classId, float distance, uint32_t timestampUs);
+    bool logImuRaw(int16_t ax, int16_t ay, int16_t az, int16_t gx, int16_t gy, int16_t gz, uint32_t timestampUs);
+    bool logToFRaw(uint8_t sensor, uint8_t rangeStatus, int16_t distance, uint32_t timestampUs);
+    bool logSpectralRaw(const float channels[CH_COUNT], uint32_t timestampUs);
+    bool logFloorEvent(ColorType from, ColorType to, int8_t toClass, float confidence, uint32_t confirmUs,
+                       uint32_t timestampUs);
+};
+
+/**
+ * @brief Codifica COBS. out deve avere almeno len + len/254 + 1 byte.
+ * @return Byte scritti (senza delimitatore).
+ */
+size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out);
+
+/**
+ * @brief Decodifica COBS di un frame senza delimitatore.
+ * @return Byte decodificati, 0 se il frame non è COBS valido.
+ */
+size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out, size_t cap);
+
+/**
+ * @brief Costruisce il frame completo (COBS + delimitatore 0x00).
+ * @return Byte scritti in out, 0 se il payload è troppo grande o out troppo piccolo.
+ */
+size_t telemetryEncodeFrame(const TelemetryHeader& header, const void* payload, size_t payloadLen,
+                            uint8_t* out, size_t cap);
+
+// Come sopra, con header e payload già contigui (record così come esce dalla coda)
+size_t telemetryEncodeRecord(const uint8_t* record, size_t len, uint8_t* out, size_t cap);
+
+/**
+ * @brief Decoder a flusso: riceve byte qualsiasi e restituisce record validati.
+ */
+class TelemetryDecoder {
+public:
+    enum Result : uint8_t {
+        NONE = 0,      // Frame non ancora completo
+        RECORD,        // Record valido: header()/payload()
+        BAD_FRAME,     // COBS o CRC errati (byte persi, testo, rumore)
+        BAD_VERSION,   // Schema diverso
+        BAD_RECORD     // Tipo sconosciuto o dimensione errata
+    };
+
+    TelemetryDecoder();
+
+    Result feed(uint8_t byte);
+
+    const TelemetryHeader& header() const { return _header; }
+    const uint8_t* payload() const { return _raw + sizeof(TelemetryHeader); }
+    size_t payloadLen() const { return _payloadLen; }
+
+    // Statistiche
+    uint32_t records() const { return _records; }
+    uint32_t badFrames() const { return _badFrames; }
+    uint32_t lostRecords() const { return _lost; }  // Dai buchi nella sequenza
+
+private:
+    uint8_t  _frame[TELEMETRY_MAX_FRAME];
+    size_t   _frameLen;
+    bool     _overflow;
+    uint8_t  _raw[TELEMETRY_MAX_RAW];
+    TelemetryHeader _header;
+    size_t   _payloadLen;
+
+    bool     _haveSequence;
+    uint16_t _lastSequence;
+    uint32_t _records;
+    uint32_t _badFrames;
+    uint32_t _lost;
+
+    Result decodeFrame();
+};
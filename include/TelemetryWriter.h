@@ -0,0 +1,62 @@
+/**
+ * @file TelemetryWriter.h
+ * @brief Coda di telemetria e task di scrittura a bassa priorità.
+ *
+ * I produttori (task sensori, controllo) chiamano log*(): copiano header e
+ * payload in un ring buffer FreeRTOS senza attese e tornano subito. Se la
+ * coda è piena il record si perde, ma la sequenza avanza comunque: il buco
+ * è visibile al decoder. Il task di scrittura preleva i record, li codifica
+ * (CRC + COBS, vedi Telemetry.h) e li spedisce a blocchi sulla seriale.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/ringbuf.h>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+#include "Telemetry.h"
+
+class TelemetryWriter : public RecordSink {
+public:
+    explicit TelemetryWriter(Print& out);
+
+    /**
+     * @brief Crea la coda e il task di scrittura.
+     * @return false se la coda o il task non possono essere creati.
+     */
+    bool start(BaseType_t core = TELEMETRY_TASK_CORE, UBaseType_t priority = TELEMETRY_TASK_PRIORITY);
+
+    // Flusso disattivato = log*() ritorna subito, la seriale resta testuale
+    void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    // Accodamento non bloccante, sicuro da più task. false = record perso.
+    bool log(TelemetryType type, uint32_t timestampUs, const void* payload, size_t len) override;
+
+    void printStats();
+
+private:
+    Print&          _out;
+    RingbufHandle_t _ring;
+    TaskHandle_t    _handle;
+
+    std::atomic<bool>     _enabled;
+    std::atomic<uint16_t> _sequence;
+    std::atomic<uint32_t> _dropped;
+
+    // Solo il task di scrittura
+    uint8_t  _batch[TELEMETRY_BATCH_BYTES];
+    size_t   _batchLen;
+    uint32_t _written;     // Record spediti
+    uint32_t _bytes;       // Byte spediti (frame + delimitatori)
+    uint32_t _encodeUs;    // Tempo totale di codifica
+
+    static void taskEntry(void* arg);
+    void run();
+    void flush();
+};
@@ -0,0 +1,87 @@
+/**
+ * @file ToFHistory.h
+ * @brief Storico a dimensione fissa delle misure di un ToF, con filtro di Hampel.
+ *
+ * Ogni sensore tiene gli ultimi TOF_HISTORY_LEN campioni con istante,
+ * RangeStatus, segnale e sigma. Le sole misure valide (oggetto trovato,
+ * RangeStatus 0) entrano in una finestra di TOF_HAMPEL_WINDOW distanze:
+ * se la nuova misura dista dalla mediana più di TOF_HAMPEL_K deviazioni
+ * robuste (1.4826 * MAD, almeno TOF_HAMPEL_MIN_DEV_MM) viene sostituita
+ * dalla mediana. Un gradino vero passa dopo metà finestra.
+ *
+ * I dati si leggono per riferimento (at(), latest()) o copiando solo la
+ * finestra richiesta (window()). Scrive un solo task: chi sta su un altro
+ * core legge lo snapshot del task sensori.
+ *
+ * Nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+#include "Hal.h"
+
+// Flag di ToFSample
+#define TOF_SAMPLE_VALID   0x01  // Oggetto trovato con RangeStatus 0
+#define TOF_SAMPLE_OUTLIER 0x02  // Scartato dal filtro (filtered_mm = mediana)
+
+struct ToFSample {
+    uint32_t timestampUs;
+    int16_t  distance_mm;  // Grezza (TOF_NO_OBJECT_MM se nessun oggetto)
+    int16_t  filtered_mm;  // Uscita del filtro dopo questo campione (-1 se ancora nessuna)
+    uint16_t signalKcps;
+    uint8_t  sigmaMm;
+    uint8_t  rangeStatus;  // 255 = nessun oggetto
+    uint8_t  flags;
+};
+
+class ToFHistory {
+public:
+    ToFHistory();
+
+    void clear();
+
+    // Registra una misura e aggiorna il filtro. Ritorna il campione memorizzato.
+    const ToFSample& push(const RangeSample& sample, uint32_t timestampUs);
+
+    uint8_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+
+    // age 0 = più recente, fino a size() - 1
+    const ToFSample& at(uint8_t age) const;
+    const ToFSample& latest() const { return at(0); }
+
+    /**
+     * @brief Copia gli ultimi campioni, dal più recente.
+     * @return Campioni copiati (al più maxSamples e size()).
+     */
+    uint8_t window(ToFSample* out, uint8_t maxSamples) const;
+
+    // Ultima distanza filtrata valida (-1 se nessuna) e suo istante
+    int16_t filtered() const { return _filtered; }
+    uint32_t filteredTimeUs() const { return _filteredUs; }
+    bool hasFiltered() const { return _filtered >= 0; }
+
+    // Età dell'ultima misura valida (UINT32_MAX se nessuna)
+    uint32_t ageUs(uint32_t nowUs) const;
+
+    uint32_t outliers() const { return _outliers; }
+
+private:
+    // Mediana e MAD della finestra
+    void windowStats(int16_t& median, int16_t& mad) const;
+
+    ToFSample _ring[TOF_HISTORY_LEN];
+    uint8_t   _head;   // Prossima posizione da scrivere
+    uint8_t   _count;
+
+    int16_t _window[TOF_HAMPEL_WINDOW];
+    uint8_t _windowHead;
+    uint8_t _windowCount;
+
+    int16_t  _filtered;
+    uint32_t _filteredUs;
+    uint32_t _outliers;
+};
@@ -6,72 +6,146 @@
 
 #pragma once
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <vl53l4cx_class.h> // STM32duino library
-
 // Inclusione rigorosa come da requisiti
-#include "Pins.h"
 #include "Constants.h"
-
-// Numero di sensori
-#define TOF_COUNT 5
-
-// Enumerazione per indicizzare facilmente i sensori
-enum ToFPosition {
-    TOF_FRONT_LEFT = 0,
-    TOF_FRONT_RIGHT,
-    TOF_BACK_LEFT,
-    TOF_BACK_RIGHT,
-    TOF_CENTER
-};
-
-// Struttura dati per restituire le letture in blocco
-struct ToFData {
-    int16_t distance_mm[TOF_COUNT]; // -1 se offline o range error
-    bool    valid[TOF_COUNT];       // true se la lettura è affidabile
-};
+#include "DeviceHealth.h"
+#include "Hal.h"
+#include "SensorTypes.h"
+#include "ToFHistory.h"
+#include "ToFRangingPolicy.h"
+#include "ToFScheduler.h"
+#include "Telemetry.h"
 
 class ToFManager {
 public:
-    ToFManager();
-    ~ToFManager();
+    /**
+     * @param devices Un sensore per ToFPosition (nullptr = non montato).
+     * Pin XSHUT/GPIO1 e indirizzi stanno nei dispositivi (HalEsp32.h).
+     */
+    explicit ToFManager(RangingDevice* const devices[TOF_COUNT]);
 
     /**
-     * @brief Inizializza il bus e configura i sensori sequenzialmente (Best Effort).
-     * @param wireBus Puntatore all'istanza TwoWire (es. &Wire).
+     * @brief Configura i sensori sequenzialmente (Best Effort).
      * @return true se almeno un sensore è stato inizializzato correttamente.
      */
-    bool begin(TwoWire* wireBus);
+    bool begin();
+
+    /**
+     * @brief Un passo dell'avvio non bloccante (vedi BootSequence).
+     * Attese di spegnimento e boot firmware senza delay(). Dopo un reset del
+     * solo ESP32, se i sensori rispondono già al loro indirizzo (RobotLayout.h) la riassegnazione
+     * degli indirizzi viene saltata.
+     */
+    BootStatus bootStep(uint32_t nowUs);
+    const char* bootPhase() const; // nullptr a avvio concluso
+    bool isWarmStart() const;
 
     /*
      * @brief Macchina a stati per la lettura asincrona.
      * Da chiamare ciclicamente (Loop o Task FreeRTOS). Non bloccante.
+     * Un sensore guasto (errori di fila o nessuna misura da HEALTH_TOF_STALE_US,
+     * o fallito all'avvio) viene spento e riavviato in background, uno alla
+     * volta: XSHUT, boot firmware, init a 0x29 e nuovo indirizzo, mentre gli
+     * altri continuano a misurare.
+     * @return true se almeno un sensore ha prodotto una nuova misura.
+     */
+    bool update();
+
+    /**
+     * @brief Ultime letture di tutti i sensori (filtrate se valide), con istante.
+     * Aggiornate da update(): il riferimento resta valido, niente copia per chiamata.
      */
-    void update();
+    const ToFData& getReadings() const { return _readings; }
+
+    // Storico del singolo sensore (finestra di campioni con metadati)
+    const ToFHistory& getHistory(ToFPosition pos) const { return _sensors[pos].history; }
 
     /**
-     * @brief Restituisce l'ultima lettura valida disponibile.
+     * @brief Ultima distanza filtrata valida di un sensore e sua età.
+     * @return false se offline o mai arrivata una misura valida.
      */
-    ToFData getReadings();
+    bool getFiltered(ToFPosition pos, int16_t& distanceMm, uint32_t& ageUs) const;
+
+    // Istante (micros) della misura più recente, tra tutti i sensori
+    uint32_t getSampleTimeUs() const { return _sampleTimeUs; }
+
+    // Destinazione delle singole misure grezze (registratore di volo). Solo dal task di update().
+    void attachRecorder(RecordSink* sink) { _recorder = sink; }
+
+    // Stato di moto per la politica di budget/distance mode (solo dal task di update())
+    void setMotion(RobotMotion motion) { _motion = motion; }
+
+    // Distance mode e timing budget attuali (richiesti) di un sensore
+    const ToFRangingConfig& getRangingConfig(ToFPosition pos) const { return _policy.current(pos); }
+
+    // Statistiche dello scheduler (Hz effettivi, poll sprecati, latenza lettura)
+    ToFSchedulerStats getSchedulerStats(ToFPosition pos) const;
+    void printSchedulerStats() const;
+
+    // Errori, età del dato, re-init e tempi di recupero di un sensore
+    const DeviceHealth& getHealth(ToFPosition pos) const { return _sensors[pos].health; }
+    void printHealth() const; // Righe di DeviceHealth::print(), sensori montati
 
 private:
-    TwoWire* _i2c;
+    RecordSink* _recorder;
+    uint32_t    _sampleTimeUs;
 
     // Struttura interna per gestire il singolo sensore
     struct SensorUnit {
-        VL53L4CX* driver;
-        uint8_t   xshutPin;
-        uint8_t   targetAddr;
-        bool      isOnline;
-        int16_t   lastDistance;
-        bool      dataValid;
-        const char* name; // Per debug
+        RangingDevice* device;   // nullptr = non montato
+        bool         isOnline;
+        ToFHistory   history;
+        DeviceHealth health;
     };
 
     SensorUnit _sensors[TOF_COUNT];
+    ToFData    _readings;
+
+    // Decide quando interrogare ogni sensore
+    ToFScheduler _scheduler;
+
+    // Budget e distance mode adattivi
+    ToFRangingPolicy _policy;
+    RobotMotion      _motion;
+
+    // Contesto per le ISR di GPIO1
+    struct IsrContext {
+        ToFScheduler* scheduler;
+        uint8_t index;
+    };
+    IsrContext _isrCtx[TOF_COUNT];
+    static void HAL_ISR_ATTR onDataReadyIsr(void* arg);
+
+    // Avvio non bloccante
+    enum BootState : uint8_t {
+        TOF_BOOT_IDLE, TOF_BOOT_SHUTDOWN, TOF_BOOT_NEXT, TOF_BOOT_FIRMWARE, TOF_BOOT_WARM,
+        TOF_BOOT_DONE, TOF_BOOT_FAILED
+    };
+    BootState _bootState;
+    uint8_t   _bootIndex;
+    uint32_t  _bootWaitUntilUs;
+    bool      _warmStart;
+
+    // Re-init in background: un sensore alla volta (uno solo può stare a 0x29).
+    // L'init vero (decine di ms) gira fuori dal loop: RangingDevice::initStart()
+    enum RecoverState : uint8_t { TOF_RECOVER_IDLE, TOF_RECOVER_SHUTDOWN, TOF_RECOVER_FIRMWARE, TOF_RECOVER_INIT };
+    RecoverState _recoverState;
+    uint8_t      _recoverIndex;
+    uint32_t     _recoverWaitUntilUs;
 
     // Helper per resettare tutti i pin XSHUT
     void shutdownAll();
+    const char* sensorName(int i) const;
+    bool detectWarmStart();
+    void initSensor(int i);
+    bool probeAtDefault(int i);
+    void finishInit(int i, bool ok);
+    void attachWarmSensor(int i);
+    void startRanging(int i);
+    bool adaptRanging(int i, const ToFSample& s);
+    BootStatus finishBoot();
+    void takeOffline(int i, uint32_t nowUs);
+    void recoveryStep(uint32_t nowUs);
+    void endRecovery();
 };
 
@@ -0,0 +1,64 @@
+/**
+ * @file ToFRangingPolicy.h
+ * @brief Scelta a runtime di timing budget e distance mode per ogni VL53L4CX.
+ *
+ * Regole, valutate dopo ogni misura del sensore:
+ *  - distance mode: LONG senza oggetto o oltre TOF_POLICY_LONG_ABOVE_MM,
+ *    SHORT sotto TOF_POLICY_SHORT_BELOW_MM (isteresi in mezzo)
+ *  - budget: LONG -> normale (preciso da fermo); SHORT -> veloce con muro
+ *    vicino o in rotazione, preciso da fermo, normale in marcia
+ * Ogni cambio ferma il sensore per una misura: tra due cambi dello stesso
+ * sensore passano almeno TOF_POLICY_HOLD_US.
+ *
+ * Logica pura: la riconfigurazione la esegue ToFManager, qui si decide solo.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+#include "Hal.h"
+#include "SensorTypes.h"
+
+struct ToFRangingConfig {
+    ToFDistanceMode mode;
+    uint32_t        budgetUs;
+};
+
+class ToFRangingPolicy {
+public:
+    ToFRangingPolicy();
+
+    // Configurazione con cui il sensore è partito (startRanging())
+    void reset(uint8_t index, const ToFRangingConfig& current, uint32_t nowUs);
+
+    /**
+     * @brief Configurazione desiderata per l'ultima misura.
+     * @param distanceMm Distanza filtrata, TOF_NO_OBJECT_MM se nessun oggetto,
+     *                   -1 se la misura non dice nulla (lettura sporca).
+     * @return true se va applicata (diversa dall'attuale e fuori dal tempo minimo).
+     */
+    bool evaluate(uint8_t index, int16_t distanceMm, RobotMotion motion, uint32_t nowUs,
+                  ToFRangingConfig& out);
+
+    // Esito della riconfigurazione. applied = configurazione richiesta: il budget
+    // effettivo (arrotondato dal sensore) serve solo allo scheduler
+    void onApplied(uint8_t index, const ToFRangingConfig& applied, uint32_t nowUs);
+    void onFailed(uint8_t index, uint32_t nowUs);
+
+    const ToFRangingConfig& current(uint8_t index) const { return _slots[index].current; }
+    uint32_t changes(uint8_t index) const { return _slots[index].changes; }
+
+    static const char* modeName(ToFDistanceMode mode);
+
+private:
+    struct Slot {
+        ToFRangingConfig current;
+        uint32_t         holdUntilUs;
+        uint32_t         changes;
+        bool             farMode;  // Stato dell'isteresi SHORT/LONG
+    };
+
+    Slot _slots[TOF_COUNT];
+};
@@ -0,0 +1,92 @@
+/**
+ * @file ToFScheduler.h
+ * @brief Scheduler predittivo dei poll "data ready" per l'array VL53L4CX.
+ *
+ * Invece di interrogare tutti i sensori ad ogni giro, lo scheduler impara il
+ * periodo reale di ogni sensore (timing budget + overhead) e l'istante
+ * dell'ultima ripartenza, e segnala un sensore solo quando la misura è attesa.
+ * Se la linea GPIO1 è cablata, l'interrupt salta del tutto il poll.
+ *
+ * Logica pura: i tempi arrivano come parametri (micros()), quindi si testa
+ * su host con un clock finto.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+
+// Statistiche per singolo sensore
+struct ToFSchedulerStats {
+    uint32_t measurements;     // Letture completate
+    uint32_t polls;            // Chiamate a GetMeasurementDataReady
+    uint32_t wastedPolls;      // Poll con risposta "non ancora pronto"
+    uint32_t periodUs;         // Ritardo appreso ripartenza -> dato pronto
+    float    achievedHz;       // Frequenza effettiva delle misure
+    float    avgReadLatencyUs; // Download risultato + clear interrupt (media)
+    uint32_t maxReadLatencyUs;
+};
+
+class ToFScheduler {
+public:
+    // Cosa fare con un sensore in questo istante
+    enum Action : uint8_t {
+        IDLE = 0, // Misura non ancora attesa: non toccare il bus
+        POLL,     // Chiedere GetMeasurementDataReady
+        READ      // GPIO1 ha segnalato il dato: leggere direttamente
+    };
+
+    ToFScheduler();
+
+    /**
+     * @brief Inizializza un sensore appena avviato.
+     * @param timingBudgetUs Timing budget del sensore (seme del periodo).
+     * @param nowUs Istante di StartMeasurement.
+     */
+    void configure(uint8_t index, uint32_t timingBudgetUs, uint32_t nowUs);
+
+    // Disattiva la schedulazione (sensore offline)
+    void disable(uint8_t index);
+
+    // Abilita la modalità a interrupt (linea GPIO1 cablata)
+    void setInterruptDriven(uint8_t index, bool enabled);
+
+    Action nextAction(uint8_t index, uint32_t nowUs) const;
+
+    // Esito di un poll GetMeasurementDataReady
+    void onPollResult(uint8_t index, uint32_t nowUs, bool ready);
+
+    // Lettura completata; endUs coincide con la ripartenza della misura
+    void onReadComplete(uint8_t index, uint32_t startUs, uint32_t endUs);
+
+    // Da chiamare dalla ISR di GPIO1 (solo una scrittura atomica)
+    void notifyDataReady(uint8_t index);
+
+    ToFSchedulerStats getStats(uint8_t index) const;
+
+private:
+    struct Slot {
+        bool     enabled;
+        bool     irqMode;
+        bool     missedSinceRestart; // Almeno un poll "non pronto" dall'ultima ripartenza
+        uint32_t restartUs;          // Ultima (ri)partenza della misura
+        uint32_t nextPollUs;         // Prossimo poll consentito
+        uint32_t lastMissUs;         // Ultimo poll "non pronto"
+        uint32_t lastCompleteUs;
+        float    periodUs;           // Stima EMA del ritardo ripartenza -> dato pronto
+        float    intervalUs;         // Stima EMA dell'intervallo tra due letture
+        float    readLatencyUs;
+        ToFSchedulerStats stats;
+        std::atomic<bool> irqPending;
+    };
+
+    Slot _slots[TOF_COUNT];
+
+    static bool reached(uint32_t nowUs, uint32_t targetUs) {
+        return (int32_t)(nowUs - targetUs) >= 0;
+    }
+    void scheduleNext(Slot& s);
+};
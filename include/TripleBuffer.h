@@ -0,0 +1,65 @@
+/**
+ * @file TripleBuffer.h
+ * @brief Triple buffer lock-free (1 produttore, 1 consumatore) per pubblicare snapshot.
+ *
+ * Il produttore scrive sempre in un buffer privato e lo pubblica con un solo
+ * scambio atomico; il consumatore riceve un riferimento costante all'ultimo
+ * buffer completo, senza lock e senza copie. Nessuno dei due lati si blocca mai.
+ * Header-only e senza dipendenze Arduino: compila anche nell'env native.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : _middle(1), _back(0), _front(2) {}
+
+    // --- Lato produttore (un solo task) ---
+
+    // Buffer privato da riempire COMPLETAMENTE prima di publish()
+    // (può contenere dati di due pubblicazioni fa).
+    T& writeBuffer() { return _buffers[_back].value; }
+
+    // Rende visibile il buffer scritto e ne prende uno libero.
+    void publish() {
+        uint8_t prev = _middle.exchange(_back | FRESH_BIT, std::memory_order_acq_rel);
+        _back = prev & INDEX_MASK;
+    }
+
+    // --- Lato consumatore (un solo task) ---
+
+    /**
+     * @brief Aggancia l'ultimo buffer pubblicato, se ce n'è uno nuovo.
+     * @return true se il buffer di lettura è cambiato.
+     */
+    bool fetch() {
+        if ((_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) return false;
+        uint8_t prev = _middle.exchange(_front, std::memory_order_acq_rel);
+        _front = prev & INDEX_MASK;
+        return true;
+    }
+
+    // Riferimento valido fino alla prossima fetch() dello stesso consumatore.
+    const T& read() const { return _buffers[_front].value; }
+
+    const T& latest() {
+        fetch();
+        return read();
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x03;
+    static constexpr uint8_t FRESH_BIT  = 0x04;
+
+    // Buffer su linee di cache distinte: produttore e consumatore non si pestano i piedi
+    struct alignas(64) Slot { T value; };
+
+    Slot _buffers[3];
+    std::atomic<uint8_t> _middle; // indice condiviso + flag "nuovo dato"
+    uint8_t _back;                // posseduto dal produttore
+    uint8_t _front;               // posseduto dal consumatore
+};
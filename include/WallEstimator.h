@@ -0,0 +1,56 @@
+/**
+ * @file WallEstimator.h
+ * @brief Muri della piastrella e allineamento del robot dalle coppie di ToF laterali.
+ *
+ * Ogni lato ha due ToF (anteriore e posteriore) che guardano di lato, a
+ * TOF_SIDE_BASELINE_MM l'uno dall'altro; il ToF centrale guarda avanti.
+ * Per ogni campione:
+ *  - presenza dei muri: media mobile dei "voti" dei sensori del lato, con isteresi
+ *  - errore di direzione: atan2(d_post - d_ant, baseline) per ogni coppia coerente
+ *  - offset laterale: distanze perpendicolari ai muri, rispetto al centro piastrella
+ * Una atan2 e una cos per lato: si può chiamare a ogni campione ToF.
+ *
+ * Convenzioni: yaw e errore di direzione positivi in senso antiorario (verso
+ * sinistra), griglia allineata allo yaw 0 (resetYaw() all'avvio).
+ *
+ * Nessuna dipendenza Arduino: testabile su host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Constants.h"
+#include "SensorTypes.h"
+
+class WallEstimator {
+public:
+    WallEstimator();
+
+    // Confidenze a zero, nessuna stima
+    void reset();
+
+    // Aggiorna la stima con un campione completo dell'array (ToFManager::getReadings())
+    void update(const ToFData& tof);
+
+    const WallEstimate& estimate() const { return _est; }
+
+    /**
+     * @brief Correzione dello yaw del gyro suggerita dai muri.
+     *
+     * Lo yaw vero è un multiplo di 90° più l'errore di direzione misurato: la
+     * differenza con yawDeg è la deriva. Ritorna una frazione (WALL_YAW_GAIN)
+     * della deriva cambiata di segno, da sommare allo yaw (ImuManager::correctYaw()).
+     * @return 0 se i muri non sono affidabili o la deriva è implausibile.
+     */
+    float yawCorrection(float yawDeg) const;
+
+private:
+    // Aggiorna confidenza e presenza di un lato con il voto del campione (-1 = nessun voto)
+    void vote(WallSide side, float v);
+    // Voto di un sensore: 1 muro vicino, 0 niente, -1 sensore spento
+    static float sensorVote(const ToFData& tof, uint8_t i);
+
+    WallEstimate _est;
+    uint8_t      _headingSides; // Bit WallSide delle coppie usate per headingErrorDeg
+};
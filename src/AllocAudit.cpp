@@ -0,0 +1,138 @@
+#include "AllocAudit.h"
+
+#include <stdlib.h>
+#include <new>
+
+#include "Hal.h"
+#include "MemoryPolicy.h"
+
+// Memoria statica azzerata prima di ogni costruttore: un new durante
+// l'inizializzazione di altri globali trova l'audit disarmato
+static AllocAudit s_audit;
+
+AllocAudit& allocAudit() {
+    return s_audit;
+}
+
+AllocAudit::AllocAudit()
+    : _armed(false), _allocations(0), _frees(0), _bytes(0), _callerSlots(0), _handler(nullptr), _freeAtArm(0),
+      _largestAtArm(0) {
+    for (uint8_t i = 0; i < ALLOC_AUDIT_MAX_CALLERS; i++) _callers[i].store(0, std::memory_order_relaxed);
+}
+
+void AllocAudit::arm() {
+    _armed.store(false, std::memory_order_relaxed);
+    _allocations.store(0, std::memory_order_relaxed);
+    _frees.store(0, std::memory_order_relaxed);
+    _bytes.store(0, std::memory_order_relaxed);
+    _callerSlots.store(0, std::memory_order_relaxed);
+    for (uint8_t i = 0; i < ALLOC_AUDIT_MAX_CALLERS; i++) _callers[i].store(0, std::memory_order_relaxed);
+    _freeAtArm = memFreeBytes(MEM_HOT);
+    _largestAtArm = memLargestFreeBlock(MEM_HOT);
+    _armed.store(true, std::memory_order_release);
+}
+
+void AllocAudit::onAlloc(size_t bytes, uintptr_t caller) {
+    if (!_armed.load(std::memory_order_relaxed)) return;
+
+    _allocations.fetch_add(1, std::memory_order_relaxed);
+    _bytes.fetch_add((uint32_t)bytes, std::memory_order_relaxed);
+    uint32_t slot = _callerSlots.fetch_add(1, std::memory_order_relaxed);
+    if (slot < ALLOC_AUDIT_MAX_CALLERS) _callers[slot].store(caller, std::memory_order_relaxed);
+
+    AllocViolationHandler handler = _handler;
+    if (handler) handler(bytes, caller);
+}
+
+void AllocAudit::onFree() {
+    if (_armed.load(std::memory_order_relaxed)) _frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint8_t AllocAudit::callerCount() const {
+    uint32_t n = _callerSlots.load(std::memory_order_relaxed);
+    return n < ALLOC_AUDIT_MAX_CALLERS ? (uint8_t)n : ALLOC_AUDIT_MAX_CALLERS;
+}
+
+void AllocAudit::print() const {
+    halLog("[ALLOC] Audit %s | Allocazioni %lu (%lu byte), rilasci %lu\n", isArmed() ? "ARMATO" : "disarmato",
+           (unsigned long)allocations(), (unsigned long)bytes(), (unsigned long)frees());
+    for (uint8_t i = 0; i < callerCount(); i++) halLog("[ALLOC]   da 0x%08lx\n", (unsigned long)caller(i));
+
+    // Anche le malloc() delle librerie C: heap libero e frammentazione dall'armamento
+    if (_freeAtArm > 0) {
+        halLog("[ALLOC] SRAM libera %lu -> %lu byte, blocco massimo %lu -> %lu byte\n", (unsigned long)_freeAtArm,
+               (unsigned long)memFreeBytes(MEM_HOT), (unsigned long)_largestAtArm,
+               (unsigned long)memLargestFreeBlock(MEM_HOT));
+    }
+}
+
+AllocAudit::Exempt::Exempt() : _wasArmed(s_audit.isArmed()) {
+    s_audit.disarm();
+}
+
+AllocAudit::Exempt::~Exempt() {
+    if (_wasArmed) s_audit._armed.store(true, std::memory_order_release);
+}
+
+// ==========================================
+// OPERATORI GLOBALI
+// ==========================================
+
+#if ALLOC_AUDIT_ENABLED
+
+static void* auditedAlloc(size_t bytes, uintptr_t caller) {
+    s_audit.onAlloc(bytes, caller);
+    return malloc(bytes ? bytes : 1);
+}
+
+#define CALLER() ((uintptr_t)__builtin_return_address(0))
+
+void* operator new(size_t bytes) {
+    void* p = auditedAlloc(bytes, CALLER());
+#if defined(__cpp_exceptions)
+    if (!p) throw std::bad_alloc();
+#else
+    if (!p) abort();
+#endif
+    return p;
+}
+
+void* operator new[](size_t bytes) {
+    void* p = auditedAlloc(bytes, CALLER());
+#if defined(__cpp_exceptions)
+    if (!p) throw std::bad_alloc();
+#else
+    if (!p) abort();
+#endif
+    return p;
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept {
+    return auditedAlloc(bytes, CALLER());
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept {
+    return auditedAlloc(bytes, CALLER());
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    s_audit.onFree();
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    if (!p) return;
+    s_audit.onFree();
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    operator delete[](p);
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "BootSequence.h"
+
+BootSequence::BootSequence(ToFManager* tof, ImuManager* imu, ColorManager* color)
+    : _tof(tof), _imu(imu), _color(color),
+      _phaseCount(0), _started(false), _startUs(0), _endUs(0) {
+    for (int c = 0; c < BOOT_COMPONENTS; c++) {
+        _currentPhase[c] = nullptr;
+        _openPhase[c] = -1;
+    }
+    // Componenti assenti: già "conclusi"
+    _status[BOOT_IMU]   = imu   ? BOOT_PENDING : BOOT_FAILED;
+    _status[BOOT_TOF]   = tof   ? BOOT_PENDING : BOOT_FAILED;
+    _status[BOOT_COLOR] = color ? BOOT_PENDING : BOOT_FAILED;
+}
+
+bool BootSequence::step() {
+    uint32_t now = halMicros();
+    if (!_started) {
+        _started = true;
+        _startUs = now;
+    }
+
+    // IMU per prima: a ogni giro drena la FIFO e avanza il bias
+    if (_status[BOOT_IMU] == BOOT_PENDING) {
+        _status[BOOT_IMU] = _imu->bootStep(now);
+        track(BOOT_IMU, _imu->bootPhase(), halMicros());
+    }
+    if (_status[BOOT_COLOR] == BOOT_PENDING) {
+        now = halMicros();
+        _status[BOOT_COLOR] = _color->bootStep(now);
+        track(BOOT_COLOR, _color->bootPhase(), halMicros());
+    }
+    if (_status[BOOT_TOF] == BOOT_PENDING) {
+        now = halMicros();
+        _status[BOOT_TOF] = _tof->bootStep(now);
+        track(BOOT_TOF, _tof->bootPhase(), halMicros());
+    }
+
+    for (int c = 0; c < BOOT_COMPONENTS; c++) {
+        if (_status[c] == BOOT_PENDING) return false;
+    }
+    _endUs = halMicros();
+    return true;
+}
+
+bool BootSequence::run() {
+    uint32_t startMs = halMillis();
+    while (!step()) {
+        if (halMillis() - startMs > BOOT_TIMEOUT_MS) {
+            // Chi non ha finito resta fuori: meglio un robot parziale che fermo
+            for (int c = 0; c < BOOT_COMPONENTS; c++) {
+                if (_status[c] != BOOT_PENDING) continue;
+                halLog("[BOOT] %s: timeout\n", componentName((Component)c));
+                _status[c] = BOOT_FAILED;
+                track((Component)c, nullptr, halMicros());
+            }
+            _endUs = halMicros();
+            break;
+        }
+        // Nessun passo pronto: cede la CPU (task di boot AS7262, idle)
+        halDelayMs(1);
+    }
+
+    for (int c = 0; c < BOOT_COMPONENTS; c++) {
+        if (isPresent((Component)c) && !isReady((Component)c)) return false;
+    }
+    return true;
+}
+
+bool BootSequence::isPresent(Component c) const {
+    switch (c) {
+        case BOOT_IMU:   return _imu != nullptr;
+        case BOOT_TOF:   return _tof != nullptr;
+        case BOOT_COLOR: return _color != nullptr;
+        default:         return false;
+    }
+}
+
+void BootSequence::track(Component c, const char* phase, uint32_t nowUs) {
+    // Le fasi sono stringhe statiche dei manager: basta confrontare i puntatori
+    if (phase == _currentPhase[c]) return;
+
+    if (_openPhase[c] >= 0) {
+        _phases[_openPhase[c]].endUs = nowUs;
+        _openPhase[c] = -1;
+    }
+    _currentPhase[c] = phase;
+
+    if (!phase || _phaseCount >= BOOT_MAX_PHASES) return;
+    _phases[_phaseCount] = {c, phase, nowUs, nowUs};
+    _openPhase[c] = (int8_t)_phaseCount++;
+}
+
+const char* BootSequence::componentName(Component c) {
+    switch (c) {
+        case BOOT_IMU:   return "IMU";
+        case BOOT_TOF:   return "ToF";
+        case BOOT_COLOR: return "AS7262";
+        default:         return "?";
+    }
+}
+
+void BootSequence::printTimeline() const {
+    static const char* STATUS_NAMES[] = {"in corso", "OK", "ERRORE"};
+
+    halLog("[BOOT] Componente | Fase            |  Inizio (ms) |  Durata (ms)\n");
+    uint32_t sequentialUs = 0;
+    for (uint8_t i = 0; i < _phaseCount; i++) {
+        const Phase& p = _phases[i];
+        uint32_t duration = p.endUs - p.startUs;
+        sequentialUs += duration;
+        halLog("[BOOT] %-10s | %-15s | %12.1f | %12.1f\n", componentName(p.component), p.name,
+               (p.startUs - _startUs) / 1000.0f, duration / 1000.0f);
+    }
+
+    for (int c = 0; c < BOOT_COMPONENTS; c++) {
+        if (!isPresent((Component)c)) continue;
+        halLog("[BOOT] %-10s -> %s\n", componentName((Component)c), STATUS_NAMES[_status[c]]);
+    }
+    if (_tof && _tof->isWarmStart()) halLog("[BOOT] ToF: riavvio a caldo, indirizzi mantenuti\n");
+
+    // Somma delle fasi = quanto sarebbe durato eseguendole una dopo l'altra
+    halLog("[BOOT] Totale: %.1f ms (fasi in sequenza: %.1f ms)\n",
+           totalUs() / 1000.0f, sequentialUs / 1000.0f);
+}
@@ -0,0 +1,82 @@
+#include "CalibrationStore.h"
+
+#include <string.h>
+
+#include "Crc32.h"
+
+void packCalibration(const SpectralClassifier& classifier, const char* profileName, CalibrationBlob& out) {
+    memset(&out, 0, sizeof(out));
+    out.magic = CALIB_BLOB_MAGIC;
+    out.version = CALIB_BLOB_VERSION;
+    out.size = sizeof(CalibrationBlob);
+    strncpy(out.profile, profileName ? profileName : "", CALIB_PROFILE_NAME_LEN - 1);
+
+    out.classCount = classifier.count();
+    for (uint8_t i = 0; i < out.classCount; i++) {
+        const SpectralClass& c = classifier.get(i);
+        CalibrationClassRecord& r = out.classes[i];
+        memcpy(r.name, c.name, SPECTRAL_CLASS_NAME_LEN);
+        r.type = (uint8_t)c.type;
+        r.flags = c.flags;
+        memcpy(r.channels, c.ref.channels, sizeof(r.channels));
+        r.sum = c.ref.sum;
+    }
+
+    out.crc = crc32(&out, offsetof(CalibrationBlob, crc));
+}
+
+CalibrationStatus unpackCalibration(const void* data, size_t len, SpectralClassifier& classifier,
+                                    char* profileName) {
+    // Header letto per primo: magic e versione decidono come interpretare il resto
+    if (len < offsetof(CalibrationBlob, profile)) return CALIB_BAD_SIZE;
+
+    CalibrationBlob blob;
+    memcpy(&blob, data, len < sizeof(blob) ? len : sizeof(blob));
+
+    if (blob.magic != CALIB_BLOB_MAGIC) return CALIB_BAD_MAGIC;
+    if (blob.version != CALIB_BLOB_VERSION) return CALIB_BAD_VERSION;
+    if (blob.size != sizeof(CalibrationBlob) || len != sizeof(CalibrationBlob)) return CALIB_BAD_SIZE;
+    if (blob.crc != crc32(&blob, offsetof(CalibrationBlob, crc))) return CALIB_BAD_CRC;
+    if (blob.classCount > COLOR_MAX_CLASSES) return CALIB_BAD_CONTENT;
+
+    classifier.clear();
+    for (uint8_t i = 0; i < blob.classCount; i++) {
+        const CalibrationClassRecord& r = blob.classes[i];
+        SpectralData ref;
+        memcpy(ref.channels, r.channels, sizeof(ref.channels));
+        ref.sum = r.sum;
+
+        char name[SPECTRAL_CLASS_NAME_LEN];
+        memcpy(name, r.name, SPECTRAL_CLASS_NAME_LEN);
+        name[SPECTRAL_CLASS_NAME_LEN - 1] = '\0';
+        classifier.addClass(name, (ColorType)r.type, r.flags, ref);
+    }
+
+    if (profileName) {
+        memcpy(profileName, blob.profile, CALIB_PROFILE_NAME_LEN);
+        profileName[CALIB_PROFILE_NAME_LEN - 1] = '\0';
+    }
+    return CALIB_OK;
+}
+
+void loadDefaultClasses(SpectralClassifier& classifier, const SpectralData& white, const SpectralData& black,
+                        const SpectralData& red, const SpectralData& blue) {
+    // Il nero conta solo come soglia d'ombra, il bianco come soglia dell'argento
+    classifier.clear();
+    classifier.addClass("WHITE", COLOR_WHITE, SPECTRAL_MATCH_SHAPE | SPECTRAL_BRIGHT_REF, white);
+    classifier.addClass("BLACK", COLOR_BLACK, SPECTRAL_DARK_REF, black);
+    classifier.addClass("RED",   COLOR_RED,   SPECTRAL_MATCH_SHAPE | SPECTRAL_SHADOW_OK, red);
+    classifier.addClass("BLUE",  COLOR_BLUE,  SPECTRAL_MATCH_SHAPE | SPECTRAL_SHADOW_OK, blue);
+}
+
+const char* calibrationStatusName(CalibrationStatus status) {
+    switch (status) {
+        case CALIB_OK:          return "OK";
+        case CALIB_BAD_SIZE:    return "dimensione errata";
+        case CALIB_BAD_MAGIC:   return "magic errato";
+        case CALIB_BAD_VERSION: return "versione non supportata";
+        case CALIB_BAD_CRC:     return "CRC errato";
+        case CALIB_BAD_CONTENT: return "contenuto incoerente";
+    }
+    return "?";
+}
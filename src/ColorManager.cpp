@@ -1,97 +1,217 @@
 #include "ColorManager.h"
 
-ColorManager::ColorManager() : _isMeasuring(false), _lastUpdate(0) {
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Profiler.h"
+
+ColorManager::ColorManager(SpectralDevice& sensor, HalStorage& storage)
+    : _sensor(sensor), _storage(storage), _sampleTimeUs(0), _recorder(nullptr), _reflex(nullptr),
+      _sampleGeneration(0), _matchGeneration(0), _matchRevision(0), _activeSlot(0),
+      _isMeasuring(false), _ledOn(true), _lastUpdate(0), _health(HEALTH_COLOR_STALE_US),
+      _temperature(NAN), _temperatureUs(0), _bootState(COLOR_BOOT_IDLE) {
     memset(&_currentData, 0, sizeof(SpectralData));
+    _match = {COLOR_NONE, SpectralClassifier::NO_CLASS, 0.0f, 0.0f};
+    strncpy(_profileName, "default", CALIB_PROFILE_NAME_LEN);
 }
 
-bool ColorManager::begin(TwoWire* i2cBus, bool ledOn) {
-    _wire = i2cBus;
+bool ColorManager::begin(bool ledOn) {
+    // Versione bloccante di bootStep()
+    BootStatus status;
+    while ((status = bootStep(halMicros(), ledOn)) == BOOT_PENDING) {
+        halDelayMs(1);
+    }
+    return status == BOOT_DONE;
+}
 
-    if (!_sensor.begin(_wire)) {
-        log_e("AS7262 non trovato!");
-        return false;
+BootStatus ColorManager::bootStep(uint32_t nowUs, bool ledOn) {
+    (void)nowUs;
+    switch (_bootState) {
+        case COLOR_BOOT_IDLE:
+            _sensor.setup();
+            _ledOn = ledOn;
+
+            // NVS, indipendente dal sensore: si fa mentre il chip si avvia
+            loadCalibration();
+
+            _sensor.bootStart();
+            _bootState = COLOR_BOOT_SENSOR;
+            return BOOT_PENDING;
+
+        case COLOR_BOOT_SENSOR: {
+            BootStatus sensor = _sensor.bootPoll();
+            if (sensor == BOOT_PENDING) return BOOT_PENDING;
+            if (sensor == BOOT_FAILED) {
+                halLog("[ERRORE] AS7262 non trovato!\n");
+                _bootState = COLOR_BOOT_FAILED;
+                return BOOT_FAILED;
+            }
+
+            // Configurazione Sensore
+            _sensor.configure(AS7262_INTEGRATION_VALUE, AS7262_GAIN_VALUE);
+
+            // LED Always On di default per garantire stabilità termica e illuminazione
+            enableLed(ledOn);
+            setLedCurrent(3); // 25mA, bilanciamento tra luminosità e calore
+
+            // Avvia la prima misurazione asincrona
+            _sensor.startMeasurement();
+            _isMeasuring = true;
+            _health.start(halMicros());
+            _bootState = COLOR_BOOT_DONE;
+            return BOOT_DONE;
+        }
+
+        case COLOR_BOOT_DONE:
+            return BOOT_DONE;
+
+        case COLOR_BOOT_FAILED:
+            return BOOT_FAILED;
     }
+    return BOOT_FAILED;
+}
 
-    // Configurazione Sensore
-    _sensor.setIntegrationTime(AS7262_INTEGRATION_VALUE);
-    _sensor.setGain(AS7262_GAIN_VALUE);
+const char* ColorManager::bootPhase() const {
+    switch (_bootState) {
+        case COLOR_BOOT_IDLE:
+        case COLOR_BOOT_SENSOR: return "boot AS7262";
+        default:                return nullptr;
+    }
+}
 
-    // LED Always On di default per garantire stabilità termica e illuminazione
-    enableLed(ledOn);
-    setLedCurrent(3); // 25mA, bilanciamento tra luminosità e calore
+bool ColorManager::update() {
+    PROFILE_SCOPE("Color.update");
+    if (_reflex) _reflex->tick(halMicros(), _health.isOnline());
+    if (_health.needsRecovery()) {
+        recoveryStep(halMicros());
+        return false;
+    }
+    if (!_isMeasuring) return false;
+
+    // Pronto + lettura RAW calibrata + riavvio dell'integrazione, senza mai bloccare.
+    // Il campione vale dall'inizio del poll (DATA_RDY visto): la lettura dei
+    // canali conta nella latenza del riflesso.
+    uint32_t pollUs = halMicros();
+    float newChannels[CH_COUNT];
+    if (!_sensor.pollSample(newChannels)) {
+        if (_health.check(halMicros())) {
+            halLog("[Color] AS7262 guasto (ultimo campione %lu ms fa), re-init in background\n",
+                   (unsigned long)(_health.ageUs(halMicros()) / 1000));
+        }
+        return false;
+    }
 
-    loadCalibration();
+    _sampleTimeUs = pollUs;
 
-    // Avvia la prima misurazione asincrona
-    _sensor.startMeasurement();
-    _isMeasuring = true;
+    // Riflesso prima di tutto: campione grezzo, nessun ritardo dell'EMA
+    if (_reflex) {
+        SpectralData raw;
+        raw.sum = 0.0f;
+        for (int i = 0; i < CH_COUNT; i++) {
+            raw.channels[i] = newChannels[i];
+            raw.sum += newChannels[i];
+        }
+        _reflex->onSample(_classifier.classify(raw), _sampleTimeUs);
+    }
+    _health.onSuccess(_sampleTimeUs);
 
-    return true;
-}
+    // Subito dopo un campione il chip sta integrando: la temperatura costa solo il suo registro
+    if (isnan(_temperature) || _sampleTimeUs - _temperatureUs >= COLOR_TEMP_INTERVAL_US) {
+        float t = _sensor.readTemperature();
+        if (!isnan(t)) _temperature = t;
+        _temperatureUs = _sampleTimeUs;
+    }
+    if (_recorder) _recorder->logSpectralRaw(newChannels, _sampleTimeUs);
 
-void ColorManager::update() {
-    // Controllo asincrono: il task non viene mai bloccato.
-    if (_isMeasuring && _sensor.dataReady()) {
+    float newSum = 0;
 
-        // Lettura RAW calibrata (compensata internamente dal chip)
-        float newChannels[CH_COUNT];
-        newChannels[V] = _sensor.readCalibratedViolet();
-        newChannels[B] = _sensor.readCalibratedBlue();
-        newChannels[G] = _sensor.readCalibratedGreen();
-        newChannels[Y] = _sensor.readCalibratedYellow();
-        newChannels[O] = _sensor.readCalibratedOrange();
-        newChannels[R] = _sensor.readCalibratedRed();
+    // Applica Filtro EMA (Exponential Moving Average) e calcola Somma
+    for(int i = 0; i < CH_COUNT; i++) {
+        _currentData.channels[i] = (newChannels[i] * EMA_ALPHA) + (_currentData.channels[i] * (1.0f - EMA_ALPHA));
+        newSum += _currentData.channels[i];
+    }
+    _currentData.sum = newSum;
+    _sampleGeneration++;
 
-        float newSum = 0;
+    // Una classificazione per campione, condivisa con getMatch()
+    FloorEvent event;
+    if (_floorDetector.update(getMatch(), _sampleTimeUs, event)) _floorEvents.publish(event);
+    return true;
+}
 
-        // Applica Filtro EMA (Exponential Moving Average) e calcola Somma
-        for(int i = 0; i < CH_COUNT; i++) {
-            _currentData.channels[i] = (newChannels[i] * EMA_ALPHA) + (_currentData.channels[i] * (1.0f - EMA_ALPHA));
-            newSum += _currentData.channels[i];
-        }
-        _currentData.sum = newSum;
+void ColorManager::recoveryStep(uint32_t nowUs) {
+    if (_bootState == COLOR_BOOT_DONE) {
+        if (!_health.retryDue(nowUs)) return;
+        _health.beginRecovery(nowUs);
+        halLog("[Color] AS7262 re-init (tentativo %lu)...\n", (unsigned long)_health.failedReinits() + 1);
+        // Reset e boot del chip (~1 s) nel task di avvio, come all'accensione
+        _isMeasuring = false;
+        _sensor.bootStart();
+        _bootState = COLOR_BOOT_SENSOR;
+        return;
+    }
 
-        // Riavvia subito l'integrazione hardware per la prossima lettura (~28ms)
-        _sensor.startMeasurement();
+    // Configurazione, LED e prima misura: il resto di bootStep()
+    BootStatus status = bootStep(nowUs, _ledOn);
+    if (status == BOOT_PENDING) return;
+    _bootState = COLOR_BOOT_DONE;
+    _health.endRecovery(status == BOOT_DONE, halMicros());
+    if (status == BOOT_DONE) {
+        halLog("[Color] AS7262 recuperato in %.0f ms (re-init %lu)\n", _health.lastRecoveryUs() / 1000.0f,
+               (unsigned long)_health.reinits());
     }
 }
 
 void ColorManager::enableLed(bool state) {
-    if (state) _sensor.drvOn();
-    else _sensor.drvOff();
+    _ledOn = state;
+    _sensor.setLed(state);
 }
 
 void ColorManager::setLedCurrent(uint8_t currentLevel) {
     // AS7262 limits: 0: 12.5mA, 1: 25mA, 2: 50mA, 3: 100mA
     if(currentLevel > 3) currentLevel = 3;
-    _sensor.setDrvCurrent(currentLevel);
+    _sensor.setLedCurrent(currentLevel);
 }
 
 void ColorManager::calibrate(ColorType type) {
-    switch(type) {
-        case COLOR_WHITE: _refWhite = _currentData; break;
-        case COLOR_RED:   _refRed = _currentData;   break;
-        case COLOR_BLUE:  _refBlue = _currentData;  break;
-        case COLOR_BLACK: _refBlack = _currentData; break; // <-- NUOVO
-        default: return;
-    }
-    saveCalibration(type, _currentData);
-}
+    int8_t id = _classifier.findByType(type);
+    if (id == SpectralClassifier::NO_CLASS) return;
 
+    // Il profilo viene normalizzato qui, una volta sola
+    _classifier.setReference(id, _currentData);
+    saveCalibration();
+}
 
+int8_t ColorManager::defineClass(const char* name, bool shadowOk) {
+    int8_t id = _classifier.findByName(name);
+    if (id != SpectralClassifier::NO_CLASS) {
+        if (_classifier.get(id).type != COLOR_NONE) return SpectralClassifier::NO_CLASS; // Predefinita: usare calibrate()
+        _classifier.setReference(id, _currentData);
+    } else {
+        uint8_t flags = SPECTRAL_MATCH_SHAPE | (shadowOk ? SPECTRAL_SHADOW_OK : 0);
+        id = _classifier.addClass(name, COLOR_NONE, flags, _currentData);
+        if (id == SpectralClassifier::NO_CLASS) {
+            halLog("[ERRORE] Tabella colori piena (%d classi)\n", COLOR_MAX_CLASSES);
+            return id;
+        }
+    }
+    saveCalibration();
+    return id;
+}
 
 void ColorManager::exportCalibrationToSerial() const {
 
     auto printData =[](const char* name, const SpectralData& d) {
-        Serial.printf("const float CALIB_%s_SUM = %.2ff;\n", name, d.sum);
-        Serial.printf("const float CALIB_%s_CH[6] = {%.2ff, %.2ff, %.2ff, %.2ff, %.2ff, %.2ff};\n\n",
+        halLog("const float CALIB_%s_SUM = %.2ff;\n", name, d.sum);
+        halLog("const float CALIB_%s_CH[6] = {%.2ff, %.2ff, %.2ff, %.2ff, %.2ff, %.2ff};\n\n",
             name, d.channels[0], d.channels[1], d.channels[2], d.channels[3], d.channels[4], d.channels[5]);
     };
 
-    printData("WHITE", _refWhite);
-    printData("BLACK", _refBlack);
-    printData("RED", _refRed);
-    printData("BLUE", _refBlue);
+    for (uint8_t i = 0; i < _classifier.count(); i++) {
+        const SpectralClass& c = _classifier.get(i);
+        printData(c.name, c.ref);
+    }
 
 }
 
@@ -100,62 +220,44 @@ void ColorManager::exportCalibrationToSerial() const {
 // ==========================================
 
 
-ColorType ColorManager::getDominantColor() {
-    // 1. ARGENTO: Basato sull'intensità estrema (Riflesso speculare)
-    if (_currentData.sum > (_refWhite.sum * DEFAULT_SILVER_RATIO)) {
-        return COLOR_SILVER;
+const SpectralMatch& ColorManager::getMatch() {
+    // Classificazione pigra: al massimo una per campione (o per ricalibrazione)
+    if (_matchGeneration != _sampleGeneration || _matchRevision != _classifier.revision()) {
+        _match = _classifier.classify(_currentData);
+        _matchGeneration = _sampleGeneration;
+        _matchRevision = _classifier.revision();
     }
+    return _match;
+}
 
-    // 2. NERO ASSOLUTO (Floor limit)
-    // Se la luce è quasi inesistente (es. il robot è sollevato in aria), è rumore.
-    // Nessun colore può essere calcolato con così poca luce.
-    const float ABSOLUTE_MIN_SUM = 15.0f;
-    if (_currentData.sum < ABSOLUTE_MIN_SUM) {
-        return COLOR_BLACK;
-    }
-
-    // 3. Calcolo Distanze Spettrali (forma del colore normalizzata)
-    float distWhite = calculateSpectralDistance(_currentData, _refWhite);
-    float distRed   = calculateSpectralDistance(_currentData, _refRed);
-    float distBlue  = calculateSpectralDistance(_currentData, _refBlue);
-
-    // 4. SMART SHADOW LOGIC (Per leggere i colori a >4cm di altezza)
-    float dynamicBlackThreshold = _refBlack.sum * 1.5f + 10.0f;
-
-    if (_currentData.sum < dynamicBlackThreshold) {
-        // ZONA D'OMBRA: C'è poca luce. Potrebbe essere nastro nero OPPURE un colore lontano.
-        // Guardiamo la "firma spettrale". Se l'errore quadratico rispetto al rosso/blu
-        // è molto basso (< 0.15), significa che la poca luce ha il colore purissimo.
-        const float SHAPE_CONFIDENCE = 0.15f;
-
-        if (distRed < SHAPE_CONFIDENCE && distRed < distBlue && distRed < distWhite) {
-            return COLOR_RED; // È buio, ma la traccia è chiaramente ROSSA
-        }
-        if (distBlue < SHAPE_CONFIDENCE && distBlue < distRed && distBlue < distWhite) {
-            return COLOR_BLUE; // È buio, ma la traccia è chiaramente BLU
-        }
+ColorType ColorManager::getDominantColor() {
+    PROFILE_SCOPE("Color.dominant");
+    return getMatch().type;
+}
 
-        // Se è buio e la luce non ha una firma netta (è "grigia" sporca), allora è vero NERO.
-        return COLOR_BLACK;
-    }
+const char* ColorManager::getClassName(int8_t classId) const {
+    if (classId < 0 || classId >= _classifier.count()) return "?";
+    return _classifier.get(classId).name;
+}
 
-    // 5. ZONA NORMALE (Pavimento vicino)
-    // Se la luce è abbondante, vince semplicemente chi ha la distanza matematica minore
-    if (distWhite < distRed && distWhite < distBlue) return COLOR_WHITE;
-    if (distRed < distWhite && distRed < distBlue) return COLOR_RED;
-    return COLOR_BLUE;
+uint32_t ColorManager::getSampleGeneration() const {
+    return _sampleGeneration;
 }
 
 RGBColor ColorManager::getVisualRGB() const {
+    return toVisualRGB(_currentData);
+}
+
+RGBColor ColorManager::toVisualRGB(const SpectralData& data) {
     RGBColor output = {0, 0, 0};
 
     // Pesi per convertire i 6 canali spettrali in R, G, B umani
-    float r_mix = _currentData.channels[R] * 1.0f + _currentData.channels[O] * 0.7f + _currentData.channels[Y] * 0.4f + _currentData.channels[V] * 0.3f;
-    float g_mix = _currentData.channels[G] * 1.0f + _currentData.channels[Y] * 0.8f + _currentData.channels[B] * 0.3f;
-    float b_mix = _currentData.channels[B] * 1.0f + _currentData.channels[V] * 0.8f + _currentData.channels[G] * 0.2f;
+    float r_mix = data.channels[R] * 1.0f + data.channels[O] * 0.7f + data.channels[Y] * 0.4f + data.channels[V] * 0.3f;
+    float g_mix = data.channels[G] * 1.0f + data.channels[Y] * 0.8f + data.channels[B] * 0.3f;
+    float b_mix = data.channels[B] * 1.0f + data.channels[V] * 0.8f + data.channels[G] * 0.2f;
 
     // Auto-Gain per visualizzare il colore puro
-    float maxVal = max(r_mix, max(g_mix, b_mix));
+    float maxVal = fmaxf(r_mix, fmaxf(g_mix, b_mix));
 
     if (maxVal > 5.0f) { // Evita rumore di fondo se è buio
         output.r = (uint8_t)((r_mix / maxVal) * 255.0f);
@@ -170,9 +272,18 @@ bool ColorManager::isSilver() { return getDominantColor() == COLOR_SILVER; }
 bool ColorManager::isWhite()  { return getDominantColor() == COLOR_WHITE; }
 bool ColorManager::isRed()    { return getDominantColor() == COLOR_RED; }
 bool ColorManager::isBlue()   { return getDominantColor() == COLOR_BLUE; }
-float ColorManager::getTemperature() {
-    // Metodo della libreria per leggere la temp sul chip (compensa derive termiche)
-    return _sensor.readTemperature();
+void ColorManager::printReadStats() const {
+    SpectralReadStats s = _sensor.readStats();
+    if (s.samples == 0) {
+        halLog("[Color] Nessun campione letto.\n");
+        return;
+    }
+    char transfers[16] = "-";
+    if (s.transfers) snprintf(transfers, sizeof(transfers), "%.1f", (float)s.transfers / s.samples);
+    halLog("[Color] Campioni %lu | Poll/campione %.2f | Trasferimenti I2C/campione %s | Bus us/campione %.0f"
+           " (max lettura %lu) | Temp %.0f C\n",
+           (unsigned long)s.samples, (float)s.polls / s.samples, transfers, (float)s.busUs / s.samples,
+           (unsigned long)s.maxSampleUs, _temperature);
 }
 
 const SpectralData& ColorManager::getCurrentData() const {
@@ -180,59 +291,170 @@ const SpectralData& ColorManager::getCurrentData() const {
 }
 
 float ColorManager::getBlackThreshold() const {
-    return _refBlack.sum * 1.5f + 10.0f;
-}
-
-// Calcola l'errore quadratico medio (distanza euclidea) su valori NORMALIZZATI.
-// Questo rende il rilevamento del colore indipendente dall'altezza/luce assoluta.
-float ColorManager::calculateSpectralDistance(const SpectralData& sample, const SpectralData& reference) {
-    if (sample.sum == 0 || reference.sum == 0) return 9999.0f;
-
-    float distance = 0.0f;
-    for(int i = 0; i < CH_COUNT; i++) {
-        float sampleNorm = sample.channels[i] / sample.sum;
-        float refNorm = reference.channels[i] / reference.sum;
-        float diff = sampleNorm - refNorm;
-        distance += (diff * diff);
-    }
-    return distance;
+    return _classifier.darkThreshold();
 }
 
 // ==========================================
 // NVM / FLASH MANAGEMENT
 // ==========================================
 
+// Un profilo = un blob (CalibrationStore): una getBytes() al boot invece di
+// ~28 chiavi costruite con String e lette una per una.
+static void slotKey(uint8_t slot, char* key) {
+    key[0] = 'p';
+    key[1] = (char)('0' + slot);
+    key[2] = '\0';
+}
+
 void ColorManager::loadCalibration() {
-    _prefs.begin("color_calib", true); // RO mode
-
-    // Lettura (con fallback predefinito, simulato a 1.0/1000.0 se non presente per evitare divisioni per zero)
-    _refWhite.sum = _prefs.getFloat("w_sum", 1000.0f);
-    _refRed.sum   = _prefs.getFloat("r_sum", 1000.0f);
-    _refBlue.sum  = _prefs.getFloat("b_sum", 1000.0f);
-    _refBlack.sum = _prefs.getFloat("bk_sum", 30.0f);
-
-    for(int i=0; i<CH_COUNT; i++) {
-        String key = "ch_" + String(i);
-        _refWhite.channels[i] = _prefs.getFloat(("w_"+key).c_str(), 1000.0f / CH_COUNT);
-        _refRed.channels[i]   = _prefs.getFloat(("r_"+key).c_str(), 1000.0f / CH_COUNT);
-        _refBlue.channels[i]  = _prefs.getFloat(("b_"+key).c_str(), 1000.0f / CH_COUNT);
-        _refBlack.channels[i] = _prefs.getFloat(("bk_"+key).c_str(), 5.0f);
-    }
-    _prefs.end();
-}
-
-void ColorManager::saveCalibration(ColorType type, const SpectralData& data) {
-    _prefs.begin("color_calib", false); // RW mode
-    String prefix;
-    if (type == COLOR_WHITE) prefix = "w_";
-    else if (type == COLOR_RED) prefix = "r_";
-    else if (type == COLOR_BLUE) prefix = "b_";
-    else if (type == COLOR_BLACK) prefix = "bk_";
-    else return;
-
-    _prefs.putFloat((prefix + "sum").c_str(), data.sum);
-    for(int i=0; i<CH_COUNT; i++) {
-        _prefs.putFloat((prefix + "ch_" + String(i)).c_str(), data.channels[i]);
-    }
-    _prefs.end();
-}
\ No newline at end of file
+    _storage.begin(CALIB_NVS_NAMESPACE, true); // RO mode
+    _activeSlot = _storage.getUChar("active", 0);
+    if (_activeSlot >= CALIB_MAX_PROFILES) _activeSlot = 0;
+    CalibrationStatus status = readSlot(_activeSlot, _classifier, _profileName);
+    _storage.end();
+
+    if (status == CALIB_OK) return;
+    if (migrateLegacyCalibration()) return;
+
+    if (status != CALIB_BAD_SIZE) {
+        // Blob presente ma non valido: meglio i default che una tabella corrotta
+        halLog("[ERRORE] Calibrazione slot %u scartata: %s\n", _activeSlot, calibrationStatusName(status));
+    }
+
+    // Nessuna calibrazione (simulata a 1000.0 per evitare divisioni per zero)
+    SpectralData bright, dark;
+    for (int i = 0; i < CH_COUNT; i++) {
+        bright.channels[i] = 1000.0f / CH_COUNT;
+        dark.channels[i] = 5.0f;
+    }
+    bright.sum = 1000.0f;
+    dark.sum = 30.0f;
+    loadDefaultClasses(_classifier, bright, dark, bright, bright);
+    _activeSlot = 0;
+    strncpy(_profileName, "default", CALIB_PROFILE_NAME_LEN);
+}
+
+bool ColorManager::saveCalibration() {
+    CalibrationBlob blob;
+    packCalibration(_classifier, _profileName, blob);
+
+    char key[4];
+    slotKey(_activeSlot, key);
+    _storage.begin(CALIB_NVS_NAMESPACE, false); // RW mode
+    // NVS piena o guasta: lo slot attivo resta quello che punta a un blob valido
+    bool ok = _storage.putBytes(key, &blob, sizeof(blob)) == sizeof(blob);
+    if (ok) _storage.putUChar("active", _activeSlot);
+    _storage.end();
+    if (!ok) halLog("[ERRORE] Calibrazione non salvata (profilo %s): NVS piena?\n", _profileName);
+    return ok;
+}
+
+CalibrationStatus ColorManager::readSlot(uint8_t slot, SpectralClassifier& out, char* name) {
+    // Storage già aperto dal chiamante
+    CalibrationBlob blob;
+    char key[4];
+    slotKey(slot, key);
+    size_t len = _storage.getBytes(key, &blob, sizeof(blob));
+    if (len == 0) return CALIB_BAD_SIZE;
+    return unpackCalibration(&blob, len, out, name);
+}
+
+bool ColorManager::selectProfile(const char* name) {
+    if (!name || !name[0]) return false;
+
+    int8_t freeSlot = -1;
+    _storage.begin(CALIB_NVS_NAMESPACE, true);
+    for (uint8_t slot = 0; slot < CALIB_MAX_PROFILES; slot++) {
+        CalibrationBlob blob;
+        char key[4];
+        slotKey(slot, key);
+        size_t len = _storage.getBytes(key, &blob, sizeof(blob));
+
+        bool valid = len == sizeof(blob) && blob.magic == CALIB_BLOB_MAGIC;
+        if (!valid) {
+            if (freeSlot < 0) freeSlot = slot;
+            continue;
+        }
+        if (strncmp(blob.profile, name, CALIB_PROFILE_NAME_LEN) != 0) continue;
+
+        // Profilo esistente: la tabella attiva cambia solo se il blob è integro
+        CalibrationStatus status = unpackCalibration(&blob, len, _classifier, _profileName);
+        _storage.end();
+        if (status != CALIB_OK) {
+            halLog("[ERRORE] Profilo %s non caricato: %s\n", name, calibrationStatusName(status));
+            return false;
+        }
+        _activeSlot = slot;
+        _storage.begin(CALIB_NVS_NAMESPACE, false);
+        _storage.putUChar("active", _activeSlot);
+        _storage.end();
+        return true;
+    }
+    _storage.end();
+
+    // Profilo nuovo: parte da una copia della calibrazione attuale
+    if (freeSlot < 0) {
+        halLog("[ERRORE] Nessuno slot libero per il profilo %s (%d max)\n", name, CALIB_MAX_PROFILES);
+        return false;
+    }
+    _activeSlot = (uint8_t)freeSlot;
+    strncpy(_profileName, name, CALIB_PROFILE_NAME_LEN - 1);
+    _profileName[CALIB_PROFILE_NAME_LEN - 1] = '\0';
+    return saveCalibration();
+}
+
+void ColorManager::printProfiles() {
+    _storage.begin(CALIB_NVS_NAMESPACE, true);
+    for (uint8_t slot = 0; slot < CALIB_MAX_PROFILES; slot++) {
+        SpectralClassifier scratch;
+        char name[CALIB_PROFILE_NAME_LEN];
+        CalibrationStatus status = readSlot(slot, scratch, name);
+        if (status == CALIB_OK) {
+            halLog("%c p%u %-12s %u classi\n", slot == _activeSlot ? '*' : ' ', slot, name, scratch.count());
+        } else if (status != CALIB_BAD_SIZE) {
+            halLog("  p%u (%s)\n", slot, calibrationStatusName(status));
+        }
+    }
+    _storage.end();
+}
+
+const char* ColorManager::getProfileName() const {
+    return _profileName;
+}
+
+bool ColorManager::migrateLegacyCalibration() {
+    // Formato precedente: una chiave NVS per ogni float nel namespace "color_calib"
+    _storage.begin("color_calib", true);
+    if (!_storage.isKey("w_sum")) {
+        _storage.end();
+        return false;
+    }
+
+    SpectralData white, red, blue, black;
+    white.sum = _storage.getFloat("w_sum", 1000.0f);
+    red.sum   = _storage.getFloat("r_sum", 1000.0f);
+    blue.sum  = _storage.getFloat("b_sum", 1000.0f);
+    black.sum = _storage.getFloat("bk_sum", 30.0f);
+
+    char key[12];
+    for (int i = 0; i < CH_COUNT; i++) {
+        snprintf(key, sizeof(key), "w_ch_%d", i);  white.channels[i] = _storage.getFloat(key, 1000.0f / CH_COUNT);
+        snprintf(key, sizeof(key), "r_ch_%d", i);  red.channels[i]   = _storage.getFloat(key, 1000.0f / CH_COUNT);
+        snprintf(key, sizeof(key), "b_ch_%d", i);  blue.channels[i]  = _storage.getFloat(key, 1000.0f / CH_COUNT);
+        snprintf(key, sizeof(key), "bk_ch_%d", i); black.channels[i] = _storage.getFloat(key, 5.0f);
+    }
+    loadDefaultClasses(_classifier, white, black, red, blue);
+    _storage.end();
+
+    _activeSlot = 0;
+    strncpy(_profileName, "default", CALIB_PROFILE_NAME_LEN);
+
+    // Le vecchie chiavi si cancellano solo dopo aver scritto il blob:
+    // se la scrittura fallisce si riprova al prossimo avvio
+    if (!saveCalibration()) return true;
+    _storage.begin("color_calib", false);
+    _storage.clear();
+    _storage.end();
+    halLog("[INFO] Calibrazione migrata nel profilo 'default'.\n");
+    return true;
+}
@@ -0,0 +1,96 @@
+#include "ControlTask.h"
+
+#include "Profiler.h"
+
+ControlTask* ControlTask::_instance = nullptr;
+
+ControlTask::ControlTask(SensorTask& sensors, MotorController& motors)
+    : _sensors(sensors), _motors(motors), _stats(CONTROL_PERIOD_US), _handle(nullptr), _timer(nullptr),
+      _enabled(false), _targetYaw(0.0f), _baseSpeed(0), _resetTiming(false), _staleCycles(0) {}
+
+bool ControlTask::start(BaseType_t core, UBaseType_t priority) {
+    if (_handle) return true;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(taskEntry, "control", CONTROL_TASK_STACK, this, priority, &_handle, core);
+    if (ok != pdPASS) return false;
+
+    // 80 MHz / 80 = 1 tick al microsecondo. Il timer parte dopo il task: nessuna notifica persa
+    _instance = this;
+    _timer = timerBegin(CONTROL_TIMER_ID, 80, true);
+    if (!_timer) {
+        vTaskDelete(_handle);
+        _handle = nullptr;
+        return false;
+    }
+    timerAttachInterrupt(_timer, onTimer, true);
+    timerAlarmWrite(_timer, CONTROL_PERIOD_US, true);
+    timerAlarmEnable(_timer);
+    return true;
+}
+
+void IRAM_ATTR ControlTask::onTimer() {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(_instance->_handle, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void ControlTask::taskEntry(void* arg) {
+    static_cast<ControlTask*>(arg)->run();
+}
+
+void ControlTask::run() {
+    bool wasEnabled = false;
+    for (;;) {
+        // Il contatore della notifica dice quante attivazioni sono arrivate
+        uint32_t releases = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (releases == 0) continue;
+
+        if (_resetTiming.exchange(false, std::memory_order_relaxed)) _stats.reset();
+        uint32_t startUs = micros();
+        _stats.begin(startUs, releases - 1);
+
+        // Motori presi dal riflesso sul buco: come spento, l'integrale non si carica da fermo
+        bool enabled = _enabled.load(std::memory_order_acquire) && !_motors.isPreempted();
+        if (enabled) {
+            // Riferimento fermo finché l'anello è spento: niente integrale accumulato
+            if (!wasEnabled) _heading.reset();
+            step(startUs);
+        } else if (wasEnabled) {
+            _motors.brake();
+        }
+        wasEnabled = enabled;
+
+        _stats.end(micros());
+        _timing.writeBuffer() = _stats.timing();
+        _timing.publish();
+    }
+}
+
+void ControlTask::step(uint32_t nowUs) {
+    PROFILE_SCOPE("Control.step");
+    const HeadingSample& h = _sensors.latestHeading();
+    if (h.timestampUs == 0 || nowUs - h.timestampUs > CONTROL_HEADING_TIMEOUT_US) {
+        _staleCycles.fetch_add(1, std::memory_order_relaxed);
+        _motors.brake();
+        return;
+    }
+
+    _heading.setTarget(_targetYaw.load(std::memory_order_relaxed));
+    _heading.setBaseSpeed(_baseSpeed.load(std::memory_order_relaxed));
+    DriveCommand cmd = _heading.update(h.yaw, h.yawRateDps, CONTROL_PERIOD_US * 1e-6f);
+    _motors.setSpeeds(cmd.left, cmd.right);
+}
+
+void ControlTask::printStats() {
+    const LoopTiming& t = timing();
+    Serial.printf("\n--- CONTROLLO %s (periodo %lu us, %lu cicli) ---\n", isEnabled() ? "ON" : "OFF",
+                  (unsigned long)t.periodUs, (unsigned long)t.cycles);
+    if (t.cycles == 0) return;
+    Serial.printf("Periodo min/max: %lu / %lu us | Jitter max %lu us, RMS %.1f us\n",
+                  (unsigned long)t.periodMinUs, (unsigned long)t.periodMaxUs, (unsigned long)t.jitterMaxUs,
+                  t.jitterRmsUs);
+    Serial.printf("Esecuzione: ultima %lu us, media %.1f us, WCET %lu us\n", (unsigned long)t.execLastUs,
+                  t.execMeanUs, (unsigned long)t.execMaxUs);
+    Serial.printf("Scadenze perse: %lu | Attivazioni saltate: %lu | Cicli senza yaw: %lu\n",
+                  (unsigned long)t.deadlineMisses, (unsigned long)t.skippedReleases, (unsigned long)staleCycles());
+}
@@ -0,0 +1,98 @@
+#include "DeviceHealth.h"
+
+#include "Hal.h"
+
+DeviceHealth::DeviceHealth(uint32_t staleUs)
+    : _staleUs(staleUs), _state(HEALTH_UNKNOWN), _errorRate(0.0f), _consecutive(0), _lastOkUs(0),
+      _failedAtUs(0), _nextRetryUs(0), _retryDelayUs(HEALTH_RETRY_MIN_US), _errors(0), _successes(0),
+      _failures(0), _reinits(0), _failedReinits(0), _lastRecoveryUs(0), _maxRecoveryUs(0) {}
+
+void DeviceHealth::start(uint32_t nowUs) {
+    _state = HEALTH_OK;
+    _errorRate = 0.0f;
+    _consecutive = 0;
+    _lastOkUs = nowUs;
+    _retryDelayUs = HEALTH_RETRY_MIN_US;
+}
+
+void DeviceHealth::fail(uint32_t nowUs) {
+    enterFailed(nowUs);
+}
+
+void DeviceHealth::enterFailed(uint32_t nowUs) {
+    _state = HEALTH_FAILED;
+    _failures++;
+    _failedAtUs = nowUs;
+    _retryDelayUs = HEALTH_RETRY_MIN_US;
+    _nextRetryUs = nowUs + _retryDelayUs;
+}
+
+void DeviceHealth::onSuccess(uint32_t nowUs) {
+    _successes++;
+    _consecutive = 0;
+    _lastOkUs = nowUs;
+    _errorRate -= _errorRate * HEALTH_ERROR_ALPHA;
+    // Isteresi: si torna OK a metà della soglia
+    if (_state == HEALTH_DEGRADED && _errorRate < HEALTH_DEGRADED_RATE * 0.5f) _state = HEALTH_OK;
+}
+
+void DeviceHealth::onError(uint32_t nowUs) {
+    (void)nowUs;
+    _errors++;
+    if (_consecutive < UINT8_MAX) _consecutive++;
+    _errorRate += (1.0f - _errorRate) * HEALTH_ERROR_ALPHA;
+    if (_state == HEALTH_OK && _errorRate > HEALTH_DEGRADED_RATE) _state = HEALTH_DEGRADED;
+}
+
+bool DeviceHealth::check(uint32_t nowUs) {
+    if (!isOnline()) return false;
+    bool stale = _staleUs > 0 && nowUs - _lastOkUs > _staleUs;
+    if (!stale && _consecutive < HEALTH_MAX_CONSECUTIVE_ERRORS) return false;
+    enterFailed(nowUs);
+    return true;
+}
+
+bool DeviceHealth::retryDue(uint32_t nowUs) const {
+    return _state == HEALTH_FAILED && (int32_t)(nowUs - _nextRetryUs) >= 0;
+}
+
+void DeviceHealth::beginRecovery(uint32_t nowUs) {
+    (void)nowUs;
+    _state = HEALTH_RECOVERING;
+}
+
+void DeviceHealth::endRecovery(bool ok, uint32_t nowUs) {
+    if (ok) {
+        _reinits++;
+        _lastRecoveryUs = nowUs - _failedAtUs;
+        if (_lastRecoveryUs > _maxRecoveryUs) _maxRecoveryUs = _lastRecoveryUs;
+        start(nowUs);
+        return;
+    }
+    // Ancora assente: il prossimo tentativo più lontano, il bus resta agli altri
+    _failedReinits++;
+    _state = HEALTH_FAILED;
+    _retryDelayUs = _retryDelayUs * 2 > HEALTH_RETRY_MAX_US ? HEALTH_RETRY_MAX_US : _retryDelayUs * 2;
+    _nextRetryUs = nowUs + _retryDelayUs;
+}
+
+const char* DeviceHealth::stateName(HealthState state) {
+    switch (state) {
+        case HEALTH_OK:         return "OK";
+        case HEALTH_DEGRADED:   return "DEGRADATO";
+        case HEALTH_FAILED:     return "GUASTO";
+        case HEALTH_RECOVERING: return "RE-INIT";
+        default:                return "-";
+    }
+}
+
+void DeviceHealth::printHeader() {
+    halLog("Dispositivo  | Stato     | Errori  | Tasso | Eta(ms) | Guasti | Re-init ok/ko | Recupero ult/max(ms)\n");
+}
+
+void DeviceHealth::print(const char* name, uint32_t nowUs) const {
+    halLog("%-12s | %-9s | %7lu | %5.2f | %7lu | %6lu | %6lu / %-4lu | %8.1f / %.1f\n", name, stateName(_state),
+           (unsigned long)_errors, _errorRate, (unsigned long)(_state == HEALTH_UNKNOWN ? 0 : ageUs(nowUs) / 1000),
+           (unsigned long)_failures, (unsigned long)_reinits, (unsigned long)_failedReinits,
+           _lastRecoveryUs / 1000.0f, _maxRecoveryUs / 1000.0f);
+}
@@ -0,0 +1,93 @@
+#include "FlightRecorder.h"
+
+#include <string.h>
+
+FlightRecorder::FlightRecorder()
+    : _slots(nullptr), _capacity(0), _started(0), _written(0), _recording(false), _next(0) {}
+
+FlightRecorder::~FlightRecorder() {
+    if (_slots) memFree(_slots);
+}
+
+bool FlightRecorder::begin(size_t bytes, MemoryRegion region) {
+    if (_slots) return true;
+
+    if (bytes < sizeof(FlightRecord)) return false;
+    _slots = (FlightRecord*)memAlloc(bytes, region);
+    while (!_slots && bytes / 2 >= RECORDER_MIN_BYTES) {
+        bytes /= 2;
+        _slots = (FlightRecord*)memAlloc(bytes, region);
+    }
+    if (!_slots) return false;
+
+    _capacity = bytes / sizeof(FlightRecord);
+    return true;
+}
+
+void FlightRecorder::start() {
+    if (!_slots) return;
+    _recording.store(false, std::memory_order_relaxed);
+    _next = 0;
+    _started.store(0, std::memory_order_relaxed);
+    _written.store(0, std::memory_order_release);
+    _recording.store(true, std::memory_order_release);
+}
+
+void FlightRecorder::stop() {
+    _recording.store(false, std::memory_order_release);
+}
+
+bool FlightRecorder::log(TelemetryType type, uint32_t timestampUs, const void* payload, size_t len) {
+    if (!_recording.load(std::memory_order_relaxed) || len > FLIGHT_RECORD_PAYLOAD) return false;
+
+    uint32_t n = _written.load(std::memory_order_relaxed);
+
+    // Annuncio PRIMA di scrivere: un lettore che sta copiando questo slot
+    // vede che è stato riciclato
+    _started.store(n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    FlightRecord& r = _slots[_next];
+    r.header.version = TELEMETRY_SCHEMA_VERSION;
+    r.header.type = type;
+    r.header.sequence = (uint16_t)n;
+    r.header.timestampUs = timestampUs;
+    r.length = (uint8_t)len;
+    memcpy(r.payload, payload, len);
+
+    if (++_next == _capacity) _next = 0;
+    _written.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+uint32_t FlightRecorder::size() const {
+    uint32_t n = written();
+    return n < _capacity ? n : _capacity;
+}
+
+uint32_t FlightRecorder::overwritten() const {
+    uint32_t n = written();
+    return n > _capacity ? n - _capacity : 0;
+}
+
+uint32_t FlightRecorder::forEach(Visitor visit, void* ctx) const {
+    if (!_slots) return 0;
+
+    uint32_t end = written();
+    uint32_t first = end > _capacity ? end - _capacity : 0;
+    uint32_t visited = 0;
+    FlightRecord copy;
+
+    for (uint32_t i = first; i < end; i++) {
+        copy = _slots[i % _capacity];
+
+        // Slot riciclato durante (o prima di) la copia: il record i + capacità
+        // ha già iniziato a scriverlo
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_started.load(std::memory_order_relaxed) - i > _capacity) continue;
+
+        visited++;
+        if (!visit(copy, ctx)) break;
+    }
+    return visited;
+}
@@ -0,0 +1,83 @@
+#include "FlightRecorderIO.h"
+
+#include <LittleFS.h>
+
+namespace {
+
+// Frame accumulati per ogni write(): meno chiamate alla USB/flash
+struct FrameWriter {
+    Print&   out;
+    uint8_t  buf[TELEMETRY_BATCH_BYTES];
+    size_t   len;
+    uint32_t records;
+    uint32_t skip;     // Record più vecchi da saltare
+
+    FrameWriter(Print& o, uint32_t skipOldest) : out(o), len(0), records(0), skip(skipOldest) {
+        buf[len++] = 0x00; // Delimitatore iniziale, come nel flusso live
+    }
+
+    void flush() {
+        if (len) out.write(buf, len);
+        len = 0;
+    }
+};
+
+bool writeRecord(const FlightRecord& record, void* ctx) {
+    FrameWriter& w = *static_cast<FrameWriter*>(ctx);
+    if (w.skip) {
+        w.skip--;
+        return true;
+    }
+    if (sizeof(w.buf) - w.len < TELEMETRY_MAX_FRAME) w.flush();
+
+    uint8_t raw[sizeof(TelemetryHeader) + FLIGHT_RECORD_PAYLOAD];
+    memcpy(raw, &record.header, sizeof(TelemetryHeader));
+    memcpy(raw + sizeof(TelemetryHeader), record.payload, record.length);
+
+    size_t n = telemetryEncodeRecord(raw, sizeof(TelemetryHeader) + record.length,
+                                     w.buf + w.len, sizeof(w.buf) - w.len);
+    w.len += n;
+    if (n) w.records++;
+    return true;
+}
+
+} // namespace
+
+uint32_t flightDump(const FlightRecorder& recorder, Print& out, uint32_t skipOldest) {
+    FrameWriter w(out, skipOldest);
+    recorder.forEach(writeRecord, &w);
+    w.flush();
+    return w.records;
+}
+
+bool flightSave(const FlightRecorder& recorder, const char* path) {
+    if (!LittleFS.begin(true)) return false;
+
+    // La partizione è più piccola della PSRAM: si tengono i record più recenti
+    if (LittleFS.exists(path)) LittleFS.remove(path);
+    size_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+    uint32_t fits = freeBytes / (TELEMETRY_MAX_FRAME + 1);
+    uint32_t skip = recorder.size() > fits ? recorder.size() - fits : 0;
+
+    File f = LittleFS.open(path, "w");
+    if (!f) return false;
+    uint32_t n = flightDump(recorder, f, skip);
+    f.close();
+    if (skip) Serial.printf("[REC] Flash piena: scartati i %lu record più vecchi\n", (unsigned long)skip);
+
+    Serial.printf("[REC] %lu record salvati in %s (%u / %u byte usati)\n", (unsigned long)n, path,
+                  (unsigned)LittleFS.usedBytes(), (unsigned)LittleFS.totalBytes());
+    return true;
+}
+
+bool flightDumpFile(Print& out, const char* path) {
+    if (!LittleFS.begin(false) || !LittleFS.exists(path)) return false;
+
+    File f = LittleFS.open(path, "r");
+    if (!f) return false;
+    uint8_t buf[TELEMETRY_BATCH_BYTES];
+    size_t n;
+    while ((n = f.read(buf, sizeof(buf))) > 0) out.write(buf, n);
+    f.close();
+    return true;
+}
@@ -0,0 +1,96 @@
+#include "FloorEvents.h"
+
+// ==========================================
+// RILEVATORE
+// ==========================================
+
+FloorEventDetector::FloorEventDetector() : _transitions(0), _rejected(0) {
+    reset();
+}
+
+void FloorEventDetector::reset() {
+    _stable = COLOR_NONE;
+    _stableClass = SpectralClassifier::NO_CLASS;
+    _candidate = COLOR_NONE;
+    _candidateClass = SpectralClassifier::NO_CLASS;
+    _count = 0;
+    _candidateUs = 0;
+    _confidenceSum = 0.0f;
+}
+
+void FloorEventDetector::dropCandidate() {
+    if (_count > 0) _rejected++;
+    _count = 0;
+    _confidenceSum = 0.0f;
+}
+
+bool FloorEventDetector::update(const SpectralMatch& match, uint32_t sampleUs, FloorEvent& out) {
+    // Di nuovo sul colore stabile: la transizione in corso era un glitch
+    if (match.type == _stable && match.classId == _stableClass) {
+        dropCandidate();
+        _candidate = _stable;
+        _candidateClass = _stableClass;
+        return false;
+    }
+
+    bool uncertain = match.confidence < FLOOR_ENTER_CONFIDENCE;
+    if (match.type != _candidate || match.classId != _candidateClass) {
+        // Una terza classe incerta (colori misti sul bordo) non butta una
+        // transizione già avviata; senza conferme in corso diventa il candidato
+        if (uncertain && _count > 0) return false;
+        dropCandidate();
+        _candidate = match.type;
+        _candidateClass = match.classId;
+        _candidateUs = sampleUs;
+    }
+
+    // Campione incerto: non conferma, ma nemmeno annulla
+    if (uncertain) return false;
+    _confidenceSum += match.confidence;
+    if (++_count < FLOOR_DEBOUNCE_SAMPLES) return false;
+
+    out.from = _stable;
+    out.to = _candidate;
+    out.fromClass = _stableClass;
+    out.toClass = _candidateClass;
+    out.confidence = _confidenceSum / _count;
+    out.timestampUs = _candidateUs;
+    out.confirmUs = sampleUs;
+
+    _stable = _candidate;
+    _stableClass = _candidateClass;
+    _count = 0;
+    _confidenceSum = 0.0f;
+    _transitions++;
+    return true;
+}
+
+// ==========================================
+// BUS
+// ==========================================
+
+FloorEventBus::FloorEventBus() : _published(0), _count(0) {
+    for (int i = 0; i < FLOOR_MAX_SUBSCRIBERS; i++) _dropped[i].store(0, std::memory_order_relaxed);
+}
+
+int8_t FloorEventBus::subscribe() {
+    if (_count >= FLOOR_MAX_SUBSCRIBERS) return -1;
+    return (int8_t)_count++;
+}
+
+void FloorEventBus::publish(const FloorEvent& event) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (!_queues[i].push(event)) _dropped[i].fetch_add(1, std::memory_order_relaxed);
+    }
+    _published.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool FloorEventBus::poll(int8_t id, FloorEvent& out) {
+    if (id < 0 || id >= _count) return false;
+    return _queues[id].pop(out);
+}
+
+uint32_t FloorEventBus::dropped(int8_t id) const {
+    if (id < 0 || id >= _count) return 0;
+    return _dropped[id].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+#include "Hal.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#if defined(ESP_PLATFORM)
+#include <Arduino.h>
+
+namespace {
+class SystemClock : public HalClock {
+public:
+    uint32_t micros() override { return ::micros(); }
+    uint32_t millis() override { return ::millis(); }
+    void delayUs(uint32_t us) override {
+        // delay() cede la CPU agli altri task, delayMicroseconds() no
+        if (us >= 1000) delay(us / 1000);
+        if (us % 1000) delayMicroseconds(us % 1000);
+    }
+};
+}
+
+void halLog(const char* fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    Serial.print(buf);
+}
+#else
+#include <chrono>
+#include <thread>
+
+namespace {
+class SystemClock : public HalClock {
+public:
+    SystemClock() : _epoch(std::chrono::steady_clock::now()) {}
+    uint32_t micros() override {
+        // Avvolto a 32 bit come micros() dell'ESP32
+        return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - _epoch).count();
+    }
+    uint32_t millis() override { return micros() / 1000; }
+    void delayUs(uint32_t us) override { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+private:
+    std::chrono::steady_clock::time_point _epoch;
+};
+}
+
+void halLog(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+#endif
+
+static SystemClock s_systemClock;
+static HalClock* s_clock = &s_systemClock;
+
+HalClock& halClock() {
+    return *s_clock;
+}
+
+void halSetClock(HalClock* clock) {
+    s_clock = clock ? clock : &s_systemClock;
+}
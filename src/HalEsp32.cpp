@@ -0,0 +1,648 @@
+#include "HalEsp32.h"
+
+#include "ImuFifo.h"
+
+// ==========================================
+// MPU9250
+// ==========================================
+
+// Registri MPU9250 usati dal percorso FIFO
+#define MPU_REG_CONFIG      0x1A
+#define MPU_REG_FIFO_EN     0x23
+#define MPU_REG_INT_STATUS  0x3A
+#define MPU_REG_USER_CTRL   0x6A
+#define MPU_REG_PWR_MGMT_1  0x6B
+#define MPU_REG_FIFO_COUNTH 0x72
+#define MPU_REG_FIFO_R_W    0x74
+#define MPU_REG_WHO_AM_I    0x75
+
+#define MPU_CONFIG_FIFO_STOP_WHEN_FULL 0x40
+#define MPU_FIFO_EN_ACCEL_GYRO 0x78 // ACCEL + XG + YG + ZG (niente TEMP)
+#define MPU_USER_CTRL_FIFO_EN  0x40
+#define MPU_USER_CTRL_FIFO_RST 0x04
+#define MPU_INT_FIFO_OVERFLOW  0x10
+#define MPU_PWR_RESET          0x80
+
+Mpu9250Device::Mpu9250Device(I2CBus& bus)
+    : _bus(bus), _dev(I2CBus::INVALID_DEVICE), _mpu(MPU9250_WE(bus.wire(), MPU9250_I2C_ADDR)), _readFailed(false) {}
+
+void Mpu9250Device::setup() {
+    // Priorità massima: le letture IMU passano davanti ai download ToF
+    _dev = _bus.registerDevice(MPU9250_I2C_ADDR, "MPU9250", I2C_PRIO_HIGH, 400000);
+}
+
+uint8_t Mpu9250Device::whoAmI() {
+    uint8_t id = 0;
+    _bus.readRegisters(_dev, MPU_REG_WHO_AM_I, &id, 1);
+    return id;
+}
+
+void Mpu9250Device::reset() {
+    _bus.writeRegister(_dev, MPU_REG_PWR_MGMT_1, MPU_PWR_RESET);
+}
+
+void Mpu9250Device::wake() {
+    _bus.writeRegister(_dev, MPU_REG_PWR_MGMT_1, 0x00); // Clock interno
+}
+
+bool Mpu9250Device::init() {
+    I2CBus::Transaction tx(_bus, _dev);
+    return _mpu.init();
+}
+
+void Mpu9250Device::configure() {
+    /*
+     * CONFIGURAZIONE PER ROBOT CINGOLATO (Vibrazioni meccaniche elevate)
+     * Riferimento Datasheet MPU-9250:
+     * DLPF_CFG | Gyro BW (Hz) | Accel BW (Hz)
+     *    4     |      20      |      21.2
+     */
+    I2CBus::Transaction tx(_bus, _dev);
+
+    // Imposta il divisore della frequenza di campionamento a 0 (1kHz interno)
+    _mpu.setSampleRateDivider(0);
+
+    // RANGE:
+    // Accel: 4G è l'ideale per i cingolati (2G è troppo sensibile ai colpi)
+    _mpu.setAccRange(MPU9250_ACC_RANGE_8G);
+
+    // Gyro: 500 gradi/secondo (sufficiente per rotazioni rapide del robot)
+    _mpu.setGyrRange(MPU6050_GYRO_RANGE_2000);
+
+    // FILTRI DLPF (Digital Low Pass Filter):
+    // Usiamo MPU9250_DLPF_4 che corrisponde a:
+    // -> Accelerometro: ~21.2 Hz Bandwidth
+    // -> Giroscopio:    ~20 Hz Bandwidth
+    // Questo taglierà drasticamente le vibrazioni dei motori e dei cingoli.
+
+    _mpu.setAccDLPF(MPU9250_DLPF_4);
+    _mpu.setGyrDLPF(MPU9250_DLPF_4);
+}
+
+bool Mpu9250Device::initMagnetometer() {
+    // AK8963 letto dal master I2C interno: va avviato prima della FIFO
+    I2CBus::Transaction tx(_bus, _dev);
+    if (!_mpu.initMagnetometer()) return false;
+    _mpu.setMagOpMode(AK8963_CONT_MODE_100HZ);
+    return true;
+}
+
+bool Mpu9250Device::isConnected() {
+    return _bus.probe(_dev); // Ritorna true se il sensore risponde (ACK)
+}
+
+bool Mpu9250Device::startFifo() {
+    I2CBus::Transaction tx(_bus, _dev);
+
+    // Stop-when-full: in overflow i frame restano allineati (niente sovrascrittura a metà)
+    uint8_t config = 0;
+    if (!_bus.readRegisters(_dev, MPU_REG_CONFIG, &config, 1)) return false;
+    _bus.writeRegister(_dev, MPU_REG_CONFIG, config | MPU_CONFIG_FIFO_STOP_WHEN_FULL);
+
+    _bus.writeRegister(_dev, MPU_REG_FIFO_EN, MPU_FIFO_EN_ACCEL_GYRO);
+    resetFifo();
+    return true;
+}
+
+void Mpu9250Device::resetFifo() {
+    // Read-modify-write: USER_CTRL contiene anche i bit del master I2C (magnetometro)
+    uint8_t userCtrl = 0;
+    _bus.readRegisters(_dev, MPU_REG_USER_CTRL, &userCtrl, 1);
+    userCtrl &= ~MPU_USER_CTRL_FIFO_EN;
+    _bus.writeRegister(_dev, MPU_REG_USER_CTRL, userCtrl | MPU_USER_CTRL_FIFO_RST);
+    _bus.writeRegister(_dev, MPU_REG_USER_CTRL, userCtrl | MPU_USER_CTRL_FIFO_EN);
+}
+
+uint16_t Mpu9250Device::readFifo(uint8_t* out, uint16_t maxFrames, bool& overflow) {
+    // Un solo possesso del bus per stato + contatore + tutti i frame
+    I2CBus::Transaction tx(_bus, _dev);
+    overflow = false;
+    _readFailed = true;
+
+    uint8_t intStatus = 0;
+    uint8_t count[2] = {0, 0};
+    if (!_bus.readRegisters(_dev, MPU_REG_INT_STATUS, &intStatus, 1)) return 0;
+    if (!_bus.readRegisters(_dev, MPU_REG_FIFO_COUNTH, count, 2)) return 0;
+    _readFailed = false;
+
+    uint16_t frames = (uint16_t)(((count[0] & 0x1F) << 8) | count[1]) / MPU_FIFO_FRAME_BYTES;
+    if (frames > maxFrames) frames = maxFrames;
+
+    // Buffer Wire da 128 byte: si legge a blocchi, sempre dentro la stessa transazione
+    uint16_t done = 0;
+    while (done < frames) {
+        uint16_t chunk = frames - done;
+        if (chunk > IMU_FIFO_CHUNK_FRAMES) chunk = IMU_FIFO_CHUNK_FRAMES;
+        if (!_bus.readRegisters(_dev, MPU_REG_FIFO_R_W, out + done * MPU_FIFO_FRAME_BYTES,
+                                chunk * MPU_FIFO_FRAME_BYTES)) {
+            // FIFO disallineata: si riparte puliti
+            _readFailed = true;
+            resetFifo();
+            return done;
+        }
+        done += chunk;
+    }
+
+    if (intStatus & MPU_INT_FIFO_OVERFLOW) {
+        overflow = true;
+        resetFifo();
+    }
+    return done;
+}
+
+bool Mpu9250Device::readMagnetometer(float& x, float& y, float& z) {
+    I2CBus::Transaction tx(_bus, _dev);
+    xyzFloat m = _mpu.getMagValues(); // uT, assi AK8963
+    x = m.x;
+    y = m.y;
+    z = m.z;
+    return !isnan(x) && !isnan(y) && !isnan(z);
+}
+
+void Mpu9250Device::autoOffsets() {
+    I2CBus::Transaction tx(_bus, _dev);
+    _mpu.autoOffsets(); // Bloccante: solo senza FIFO
+}
+
+bool Mpu9250Device::readGyro(float& x, float& y, float& z) {
+    I2CBus::Transaction tx(_bus, _dev);
+    xyzFloat g = _mpu.getGyrValues();
+    x = g.x;
+    y = g.y;
+    z = g.z;
+    // Se la libreria restituisce valori assurdi, il ciclo si salta
+    _readFailed = isnan(z);
+    return !_readFailed;
+}
+
+float Mpu9250Device::readPitch() {
+    I2CBus::Transaction tx(_bus, _dev);
+    return _mpu.getPitch();
+}
+
+// ==========================================
+// VL53L4CX
+// ==========================================
+
+I2CBus::DeviceId Vl53l4cxDevice::_bootDev = I2CBus::INVALID_DEVICE;
+
+// Un solo ToF alla volta a 0x29 (ToFManager): un task di servizio basta per tutti
+static StaticWorker<TOF_INIT_TASK_STACK> s_tofInitWorker("tof_init");
+
+Vl53l4cxDevice::Vl53l4cxDevice(I2CBus& bus, uint8_t xshutPin, int8_t intPin, uint8_t address, const char* name)
+    : _bus(bus), _dev(I2CBus::INVALID_DEVICE), _driver(nullptr),
+      _xshutPin(xshutPin), _intPin(intPin), _address(address), _name(name), _initStatus(BOOT_FAILED) {}
+
+Vl53l4cxDevice::~Vl53l4cxDevice() {
+    destroyDriver();
+}
+
+Vl53l4cxDevice::ToFDriver* Vl53l4cxDevice::createDriver() {
+    destroyDriver();
+    _driver = new (_driverSlot) ToFDriver(_bus.wire(), -1);
+    return _driver;
+}
+
+void Vl53l4cxDevice::destroyDriver() {
+    if (!_driver) return;
+    _driver->~ToFDriver();
+    _driver = nullptr;
+}
+
+void Vl53l4cxDevice::setup() {
+    // FIX 1: Usa 100kHz per la configurazione (più stabile).
+    // Il limite è per-dispositivo: l'arbitro alza/abbassa il clock da solo.
+    if (_bootDev == I2CBus::INVALID_DEVICE) {
+        _bootDev = _bus.registerDevice(TOF_DEFAULT_I2C_ADDR, "ToF_Boot", I2C_PRIO_LOW, TOF_BOOT_CLOCK_HZ);
+    }
+    _dev = _bus.registerDevice(_address, _name, I2C_PRIO_LOW, 400000);
+}
+
+void Vl53l4cxDevice::powerDown() {
+    pinMode(_xshutPin, OUTPUT);
+    digitalWrite(_xshutPin, LOW);
+}
+
+void Vl53l4cxDevice::powerUp() {
+    // Dopo il reset dell'ESP32 il pin era flottante
+    pinMode(_xshutPin, OUTPUT);
+    digitalWrite(_xshutPin, HIGH);
+}
+
+bool Vl53l4cxDevice::probeDefault() {
+    return _bus.probe(_bootDev);
+}
+
+bool Vl53l4cxDevice::probe() {
+    return _bus.probe(_dev);
+}
+
+bool Vl53l4cxDevice::initDriver() {
+    createDriver();
+    _driver->adoptAddress(TOF_DEFAULT_I2C_ADDR);
+
+    // InitSensor() spezzato nei suoi passi, una transazione ciascuno su 0x29
+    // (ToF_Boot: priorità bassa, TOF_BOOT_CLOCK_HZ): ogni trasferimento è
+    // contato dall'arbitro e tra un passo e l'altro IMU e spettrometro
+    // passano davanti. Dentro l'avvio a freddo sono annidate nella sua.
+    VL53L4CX_Error status;
+    {
+        I2CBus::Transaction tx(_bus, _bootDev);
+        status = _driver->VL53L4CX_WaitDeviceBooted();
+        tx.reportDriverStatus(status);
+    }
+    if (status == VL53L4CX_ERROR_NONE) {
+        I2CBus::Transaction tx(_bus, _bootDev);
+        status = _driver->VL53L4CX_DataInit();  // Il passo lungo: NVM e calibrazione
+        tx.reportDriverStatus(status);
+    }
+    if (status == VL53L4CX_ERROR_NONE) {
+        I2CBus::Transaction tx(_bus, _bootDev);
+        status = _driver->VL53L4CX_SetDeviceAddress(_address);
+        tx.reportDriverStatus(status);
+    }
+    if (status != VL53L4CX_ERROR_NONE) {
+        destroyDriver();
+        return false;
+    }
+    return true;
+}
+
+bool Vl53l4cxDevice::initAtDefault() {
+    // Tutta la configurazione avviene all'indirizzo di default, a 100kHz,
+    // in un unico possesso del bus (all'avvio nessun altro lo aspetta)
+    I2CBus::Transaction tx(_bus, _bootDev);
+    if (!initDriver()) return false;
+    delayMicroseconds(2000); // Breve pausa per stabilizzazione I2C interna
+    return true;
+}
+
+BootStatus Vl53l4cxDevice::initStart() {
+    // Nel task di servizio il task sensori non aspetta l'init; sul bus i
+    // passi di initDriver() si alternano alle transazioni di IMU e altri ToF.
+    _initStatus.store(BOOT_PENDING);
+    if (!s_tofInitWorker.run(initJob, this)) {
+        _initStatus.store(BOOT_FAILED);
+        return BOOT_FAILED; // Si riprova con il backoff di DeviceHealth, mai init bloccante
+    }
+    return BOOT_PENDING;
+}
+
+void Vl53l4cxDevice::initJob(void* arg) {
+    Vl53l4cxDevice* dev = static_cast<Vl53l4cxDevice*>(arg);
+    bool ok = dev->initDriver();
+    if (ok) delay(2); // Stabilizzazione I2C interna, qui senza bloccare nessuno
+    dev->_initStatus.store(ok ? BOOT_DONE : BOOT_FAILED);
+}
+
+bool Vl53l4cxDevice::attachWarm() {
+    createDriver();
+    _driver->adoptAddress(_address);
+
+    I2CBus::Transaction tx(_bus, _dev);
+    // La misura del run precedente può essere ancora in corso
+    _driver->VL53L4CX_StopMeasurement();
+    if (_driver->VL53L4CX_DataInit() != VL53L4CX_ERROR_NONE) {
+        destroyDriver();
+        return false;
+    }
+    return true;
+}
+
+void Vl53l4cxDevice::release() {
+    powerDown(); // Hard Kill
+    destroyDriver();
+}
+
+uint32_t Vl53l4cxDevice::startRanging() {
+    I2CBus::Transaction tx(_bus, _dev);
+    _driver->VL53L4CX_StartMeasurement();
+
+    // Il timing budget reale fa da seme al periodo dello scheduler
+    uint32_t budgetUs = 33000;
+    _driver->VL53L4CX_GetMeasurementTimingBudgetMicroSeconds(&budgetUs);
+    return budgetUs;
+}
+
+void Vl53l4cxDevice::attachDataReady(void (*isr)(void*), void* arg) {
+    if (_intPin < 0) return;
+    pinMode(_intPin, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(_intPin), isr, arg, FALLING);
+}
+
+int Vl53l4cxDevice::checkDataReady(bool& ready) {
+    // Transazione a sé: l'IMU può passare prima del download
+    I2CBus::Transaction tx(_bus, _dev);
+    uint8_t flag = 0;
+    int status = _driver->VL53L4CX_GetMeasurementDataReady(&flag);
+    tx.reportDriverStatus(status);
+    ready = flag != 0;
+    return status;
+}
+
+int Vl53l4cxDevice::readRange(RangeSample& sample) {
+    VL53L4CX_MultiRangingData_t data;
+
+    I2CBus::Transaction tx(_bus, _dev);
+    int status = _driver->VL53L4CX_GetMultiRangingData(&data);
+    tx.reportDriverStatus(status);
+
+    // Pulisci interrupt IMMEDIATAMENTE dopo la lettura
+    _driver->VL53L4CX_ClearInterruptAndStartMeasurement();
+
+    sample.objects = data.NumberOfObjectsFound;
+    sample.distance_mm = sample.objects > 0 ? data.RangeData[0].RangeMilliMeter : 0;
+    sample.rangeStatus = sample.objects > 0 ? data.RangeData[0].RangeStatus : 255;
+    // FixPoint1616: MCps -> kcps, mm interi
+    sample.signalKcps = 0;
+    sample.sigmaMm = 0;
+    if (sample.objects > 0) {
+        uint32_t kcps = (uint32_t)(((uint64_t)data.RangeData[0].SignalRateRtnMegaCps * 1000) >> 16);
+        uint32_t sigma = data.RangeData[0].SigmaMilliMeter >> 16;
+        sample.signalKcps = kcps > 0xFFFF ? 0xFFFF : (uint16_t)kcps;
+        sample.sigmaMm = sigma > 255 ? 255 : (uint8_t)sigma;
+    }
+    return status;
+}
+
+uint32_t Vl53l4cxDevice::reconfigure(ToFDistanceMode mode, uint32_t budgetUs) {
+    // Un solo possesso del bus: il sensore resta fermo per pochi ms, il loop no
+    I2CBus::Transaction tx(_bus, _dev);
+    int status = _driver->VL53L4CX_StopMeasurement();
+    if (status == 0) status = _driver->VL53L4CX_SetDistanceMode(mode);
+    if (status == 0) status = _driver->VL53L4CX_SetMeasurementTimingBudgetMicroSeconds(budgetUs);
+    tx.reportDriverStatus(status);
+
+    // Riparte comunque: con la configurazione nuova o, se rifiutata, con la precedente
+    _driver->VL53L4CX_StartMeasurement();
+    if (status != 0) return 0;
+
+    uint32_t actualUs = budgetUs;
+    _driver->VL53L4CX_GetMeasurementTimingBudgetMicroSeconds(&actualUs);
+    return actualUs;
+}
+
+// ==========================================
+// AS7262
+// ==========================================
+
+// Interfaccia I2C dell'AS726x: tre registri fisici davanti ai registri virtuali.
+// Ogni byte virtuale = indirizzo in WRITE, attesa di RX_VALID, lettura di READ.
+#define AS7262_REG_STATUS 0x00
+#define AS7262_REG_WRITE  0x01
+#define AS7262_REG_READ   0x02
+#define AS7262_STATUS_TX_VALID 0x02 // Scrittura precedente non ancora consumata
+#define AS7262_STATUS_RX_VALID 0x01 // Byte pronto in READ
+#define AS7262_VREG_WRITE_FLAG 0x80
+
+// Registri virtuali
+#define AS7262_VREG_HW_VERSION 0x00
+#define AS7262_VREG_CONTROL 0x04
+#define AS7262_VREG_INT_T   0x05
+#define AS7262_VREG_TEMP    0x06
+#define AS7262_VREG_LED     0x07
+#define AS7262_VREG_CAL_V   0x14 // 6 float big-endian consecutivi: V, B, G, Y, O, R
+#define AS7262_CONTROL_DATA_RDY 0x02
+#define AS7262_CONTROL_GAIN_SHIFT 4
+#define AS7262_CONTROL_ONE_SHOT (3 << 2) // Modalità 3: una conversione dei 6 canali
+#define AS7262_CONTROL_RESET 0x80
+#define AS7262_DEVICE_TYPE 0x40          // HW_VERSION dell'AS726x
+#define AS7262_LED_DRV_ON 0x08
+#define AS7262_LED_DRV_CURRENT_SHIFT 4
+
+As7262Device::As7262Device(I2CBus& bus)
+    : _bus(bus), _dev(I2CBus::INVALID_DEVICE), _controlSetup(0), _ledControl(0),
+      _integrationUs(AS7262_INTEGRATION_VALUE * AS7262_INTEGRATION_STEP_US), _nextPollUs(0),
+      _stats({0, 0, 0, 0, 0}), _bootStatus(BOOT_FAILED) {}
+
+void As7262Device::setup() {
+    _dev = _bus.registerDevice(AS7262_I2C_ADDR, "AS7262", I2C_PRIO_NORMAL, 400000);
+}
+
+// Stack e TCB statici: il re-init a regime gira ad audit delle allocazioni armato
+static StaticWorker<COLOR_BOOT_TASK_STACK> s_colorBootWorker("as7262_boot");
+
+void As7262Device::bootStart() {
+    // Reset software e ~1 s di boot del chip: in un task a parte, il task
+    // sensori non aspetta. Sul bus solo brevi transazioni (bootSensor()).
+    _bootStatus.store(BOOT_PENDING);
+    if (!s_colorBootWorker.run(bootJob, this)) {
+        _bootStatus.store(BOOT_FAILED); // Si riprova con il backoff di DeviceHealth, mai avvio bloccante
+    }
+}
+
+BootStatus As7262Device::bootPoll() {
+    return (BootStatus)_bootStatus.load();
+}
+
+void As7262Device::bootJob(void* arg) {
+    As7262Device* dev = static_cast<As7262Device*>(arg);
+#if AS7262_FAST_READ
+    bool ok = dev->bootSensor();
+#else
+    // Percorso di confronto: begin() della libreria, fuori dall'arbitro e
+    // dalle statistiche (il suo delay(1000) terrebbe il bus per 1 s)
+    bool ok = dev->_sensor.begin(dev->_bus.wire());
+#endif
+    dev->_bootStatus.store(ok ? BOOT_DONE : BOOT_FAILED);
+}
+
+#if AS7262_FAST_READ
+bool As7262Device::bootSensor() {
+    // Gli stessi passi di Adafruit_AS726x::begin(), ognuno in una transazione
+    // AS7262: contati dall'arbitro e in readStats(), mai il bus durante il boot
+    uint32_t startUs = micros();
+    bool ok;
+    {
+        I2CBus::Transaction tx(_bus, _dev);
+        ok = virtualWrite(AS7262_VREG_CONTROL, AS7262_CONTROL_RESET);
+    }
+    _stats.busUs += micros() - startUs;
+    if (!ok) return false;
+
+    vTaskDelay(pdMS_TO_TICKS(AS7262_RESET_BOOT_MS));
+
+    startUs = micros();
+    I2CBus::Transaction tx(_bus, _dev);
+    uint8_t version = 0;
+    ok = virtualRead(AS7262_VREG_HW_VERSION, &version, 1) && version == AS7262_DEVICE_TYPE;
+    // LED spento, corrente minima: li sceglie ColorManager dopo il boot
+    _ledControl = 0;
+    ok = ok && virtualWrite(AS7262_VREG_LED, _ledControl);
+    _stats.busUs += micros() - startUs;
+    return ok;
+}
+#endif
+
+void As7262Device::configure(uint8_t integration, uint8_t gain) {
+    I2CBus::Transaction tx(_bus, _dev);
+#if AS7262_FAST_READ
+    // Il gain entra in CONTROL a ogni startConversion()
+    virtualWrite(AS7262_VREG_INT_T, integration);
+#else
+    _sensor.setIntegrationTime(integration);
+    _sensor.setGain(gain);
+#endif
+    _controlSetup = (uint8_t)((gain & 0x03) << AS7262_CONTROL_GAIN_SHIFT);
+    _integrationUs = (uint32_t)integration * AS7262_INTEGRATION_STEP_US;
+}
+
+void As7262Device::setLed(bool on) {
+    I2CBus::Transaction tx(_bus, _dev);
+#if AS7262_FAST_READ
+    if (on) _ledControl |= AS7262_LED_DRV_ON;
+    else _ledControl &= (uint8_t)~AS7262_LED_DRV_ON;
+    virtualWrite(AS7262_VREG_LED, _ledControl);
+#else
+    if (on) _sensor.drvOn();
+    else _sensor.drvOff();
+#endif
+}
+
+void As7262Device::setLedCurrent(uint8_t level) {
+    I2CBus::Transaction tx(_bus, _dev);
+#if AS7262_FAST_READ
+    _ledControl = (uint8_t)((_ledControl & ~(0x03 << AS7262_LED_DRV_CURRENT_SHIFT)) |
+                            ((level & 0x03) << AS7262_LED_DRV_CURRENT_SHIFT));
+    virtualWrite(AS7262_VREG_LED, _ledControl);
+#else
+    _sensor.setDrvCurrent(level);
+#endif
+}
+
+void As7262Device::startMeasurement() {
+    I2CBus::Transaction tx(_bus, _dev);
+#if AS7262_FAST_READ
+    startConversion();
+#else
+    _sensor.startMeasurement();
+#endif
+}
+
+#if AS7262_FAST_READ
+bool As7262Device::readStatus(uint8_t& status) {
+    _stats.transfers++;
+    return _bus.readRegisters(_dev, AS7262_REG_STATUS, &status, 1);
+}
+
+bool As7262Device::waitStatus(uint8_t mask, bool set) {
+    // Niente delay(5) come nella libreria: il chip risponde in poche decine di us
+    uint8_t status = 0;
+    for (uint8_t i = 0; i < AS7262_VREG_MAX_POLLS; i++) {
+        if (!readStatus(status)) return false;
+        if (((status & mask) != 0) == set) return true;
+    }
+    return false;
+}
+
+bool As7262Device::virtualRead(uint8_t reg, uint8_t* out, uint8_t len) {
+    uint8_t status = 0;
+    if (!readStatus(status)) return false;
+    // Byte rimasto da una sequenza interrotta: si scarta
+    if (status & AS7262_STATUS_RX_VALID) {
+        uint8_t stale;
+        _stats.transfers++;
+        _bus.readRegisters(_dev, AS7262_REG_READ, &stale, 1);
+    }
+    if ((status & AS7262_STATUS_TX_VALID) && !waitStatus(AS7262_STATUS_TX_VALID, false)) return false;
+
+    for (uint8_t i = 0; i < len; i++) {
+        // Dopo RX_VALID lo slave ha già consumato l'indirizzo: TX è libero, niente controllo
+        _stats.transfers++;
+        if (_bus.writeRegister(_dev, AS7262_REG_WRITE, (uint8_t)(reg + i)) != I2C_OK) return false;
+        if (!waitStatus(AS7262_STATUS_RX_VALID, true)) return false;
+        _stats.transfers++;
+        if (!_bus.readRegisters(_dev, AS7262_REG_READ, &out[i], 1)) return false;
+    }
+    return true;
+}
+
+bool As7262Device::virtualWrite(uint8_t reg, uint8_t value) {
+    if (!waitStatus(AS7262_STATUS_TX_VALID, false)) return false;
+    _stats.transfers++;
+    if (_bus.writeRegister(_dev, AS7262_REG_WRITE, reg | AS7262_VREG_WRITE_FLAG) != I2C_OK) return false;
+    if (!waitStatus(AS7262_STATUS_TX_VALID, false)) return false;
+    _stats.transfers++;
+    return _bus.writeRegister(_dev, AS7262_REG_WRITE, value) == I2C_OK;
+}
+
+bool As7262Device::startConversion() {
+    // DATA_RDY azzerato e modalità one-shot in una scrittura (la libreria ne fa due)
+    bool ok = virtualWrite(AS7262_VREG_CONTROL, _controlSetup | AS7262_CONTROL_ONE_SHOT);
+    _nextPollUs = micros() + _integrationUs;
+    return ok;
+}
+
+bool As7262Device::pollSample(float channels[CH_COUNT]) {
+    // Integrazione in corso: il bus non si tocca
+    uint32_t startUs = micros();
+    if ((int32_t)(startUs - _nextPollUs) < 0) return false;
+
+    I2CBus::Transaction tx(_bus, _dev);
+    _stats.polls++;
+    uint8_t control = 0;
+    if (!virtualRead(AS7262_VREG_CONTROL, &control, 1) || !(control & AS7262_CONTROL_DATA_RDY)) {
+        _nextPollUs = micros() + AS7262_POLL_RETRY_US;
+        _stats.busUs += micros() - startUs;
+        return false;
+    }
+
+    // I 24 byte calibrati in un'unica sequenza, poi subito la conversione successiva
+    uint8_t raw[CH_COUNT * 4];
+    bool ok = virtualRead(AS7262_VREG_CAL_V, raw, sizeof(raw));
+    startConversion();
+    uint32_t us = micros() - startUs;
+    _stats.busUs += us;
+    if (!ok) return false;
+
+    for (int c = 0; c < CH_COUNT; c++) {
+        const uint8_t* b = raw + c * 4;
+        uint32_t bits = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+        memcpy(&channels[c], &bits, sizeof(float));
+    }
+    _stats.samples++;
+    if (us > _stats.maxSampleUs) _stats.maxSampleUs = us;
+    return true;
+}
+#else
+bool As7262Device::pollSample(float channels[CH_COUNT]) {
+    uint32_t startUs = micros();
+    I2CBus::Transaction tx(_bus, _dev);
+
+    // Controllo asincrono: il task non viene mai bloccato.
+    _stats.polls++;
+    if (!_sensor.dataReady()) {
+        _stats.busUs += micros() - startUs;
+        return false;
+    }
+
+    // Lettura RAW calibrata (compensata internamente dal chip)
+    channels[V] = _sensor.readCalibratedViolet();
+    channels[B] = _sensor.readCalibratedBlue();
+    channels[G] = _sensor.readCalibratedGreen();
+    channels[Y] = _sensor.readCalibratedYellow();
+    channels[O] = _sensor.readCalibratedOrange();
+    channels[R] = _sensor.readCalibratedRed();
+
+    // Riavvia subito l'integrazione hardware per la prossima lettura (~28ms)
+    _sensor.startMeasurement();
+
+    uint32_t us = micros() - startUs;
+    _stats.busUs += us;
+    _stats.samples++;
+    if (us > _stats.maxSampleUs) _stats.maxSampleUs = us;
+    return true;
+}
+#endif
+
+float As7262Device::readTemperature() {
+    // Temperatura sul chip (compensa derive termiche), un registro virtuale
+    I2CBus::Transaction tx(_bus, _dev);
+#if AS7262_FAST_READ
+    uint8_t celsius = 0;
+    if (!virtualRead(AS7262_VREG_TEMP, &celsius, 1)) return NAN;
+    return (float)celsius;
+#else
+    return _sensor.readTemperature();
+#endif
+}
@@ -0,0 +1,291 @@
+#include "HalReplay.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ImuFifo.h"
+
+// Campione già "avvenuto" rispetto all'orologio (timestamp avvolti a 32 bit)
+static bool isDue(uint32_t timestampUs, uint32_t nowUs) {
+    return (int32_t)(timestampUs - nowUs) <= 0;
+}
+
+// ==========================================
+// MEMORIA
+// ==========================================
+
+bool MemoryStorage::begin(const char* ns, bool readOnly) {
+    _ns = ns;
+    _readOnly = readOnly;
+    return true;
+}
+
+void MemoryStorage::end() {
+    _ns.clear();
+    _readOnly = true;
+}
+
+bool MemoryStorage::isKey(const char* key) {
+    return _values.count(fullKey(key)) > 0;
+}
+
+size_t MemoryStorage::getBytes(const char* key, void* buf, size_t maxLen) {
+    auto it = _values.find(fullKey(key));
+    // Come Preferences: niente copia parziale se il buffer è troppo piccolo
+    if (it == _values.end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t MemoryStorage::putBytes(const char* key, const void* buf, size_t len) {
+    if (_readOnly || _full) return 0;
+    const uint8_t* bytes = static_cast<const uint8_t*>(buf);
+    _values[fullKey(key)].assign(bytes, bytes + len);
+    return len;
+}
+
+uint8_t MemoryStorage::getUChar(const char* key, uint8_t defaultValue) {
+    uint8_t value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+size_t MemoryStorage::putUChar(const char* key, uint8_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+float MemoryStorage::getFloat(const char* key, float defaultValue) {
+    float value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+bool MemoryStorage::clear() {
+    if (_readOnly) return false;
+    std::string prefix = _ns + "/";
+    for (auto it = _values.begin(); it != _values.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) it = _values.erase(it);
+        else ++it;
+    }
+    return true;
+}
+
+// ==========================================
+// TRACCIA
+// ==========================================
+
+SensorTrace::SensorTrace() : _count(0), _originUs(0), _startUs(0), _endUs(0) {}
+
+void SensorTrace::extend(uint32_t timestampUs) {
+    if (_count == 0) {
+        // I frame IMU ricostruiti possono precedere di poco il primo record
+        _originUs = timestampUs - 1000000UL;
+        _startUs = _endUs = timestampUs;
+    } else {
+        if (timestampUs - _originUs < _startUs - _originUs) _startUs = timestampUs;
+        if (timestampUs - _originUs > _endUs - _originUs) _endUs = timestampUs;
+    }
+    _count++;
+}
+
+bool SensorTrace::log(TelemetryType type, uint32_t timestampUs, const void* payload, size_t len) {
+    if (len != telemetryPayloadSize(type)) return false;
+
+    switch (type) {
+        case TLM_IMU_RAW: {
+            TraceImuFrame f;
+            f.timestampUs = timestampUs;
+            memcpy(&f.raw, payload, sizeof(f.raw));
+            _imu.push_back(f);
+            break;
+        }
+        case TLM_TOF_RAW: {
+            TraceRange r;
+            r.timestampUs = timestampUs;
+            memcpy(&r.raw, payload, sizeof(r.raw));
+            if (r.raw.sensor >= TOF_COUNT) return false;
+            _ranges[r.raw.sensor].push_back(r);
+            break;
+        }
+        case TLM_SPECTRAL_RAW: {
+            TelemetrySpectral rec;
+            memcpy(&rec, payload, sizeof(rec));
+            TraceSpectral s;
+            s.timestampUs = timestampUs;
+            memcpy(s.channels, rec.channels, sizeof(s.channels));
+            _spectral.push_back(s);
+            break;
+        }
+        default:
+            return false; // Dati filtrati: li ricalcola la replica
+    }
+    extend(timestampUs);
+    return true;
+}
+
+void SensorTrace::load(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (_decoder.feed(data[i]) != TelemetryDecoder::RECORD) continue;
+        log((TelemetryType)_decoder.header().type, _decoder.header().timestampUs,
+            _decoder.payload(), _decoder.payloadLen());
+    }
+}
+
+bool SensorTrace::loadFile(const char* path) {
+    FILE* in = (path && strcmp(path, "-") != 0) ? fopen(path, "rb") : stdin;
+    if (!in) return false;
+
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) load(buf, n);
+    if (in != stdin) fclose(in);
+    return true;
+}
+
+void SensorTrace::finish() {
+    // Ordinamento stabile sul tempo relativo all'origine: regge l'avvolgimento di micros()
+    const uint32_t origin = _originUs;
+    auto byTime = [origin](const auto& a, const auto& b) {
+        return a.timestampUs - origin < b.timestampUs - origin;
+    };
+    std::stable_sort(_imu.begin(), _imu.end(), byTime);
+    for (int i = 0; i < TOF_COUNT; i++) std::stable_sort(_ranges[i].begin(), _ranges[i].end(), byTime);
+    std::stable_sort(_spectral.begin(), _spectral.end(), byTime);
+}
+
+// ==========================================
+// IMU
+// ==========================================
+
+bool ReplayImu::startFifo() {
+    resetFifo();
+    return true;
+}
+
+void ReplayImu::resetFifo() {
+    // FIFO svuotata: restano solo i frame campionati da adesso in poi
+    const std::vector<TraceImuFrame>& frames = _trace.imu();
+    uint32_t now = halMicros();
+    while (_next < frames.size() && isDue(frames[_next].timestampUs, now)) _next++;
+}
+
+static void putBigEndian(uint8_t* out, int16_t v) {
+    out[0] = (uint8_t)((uint16_t)v >> 8);
+    out[1] = (uint8_t)v;
+}
+
+uint16_t ReplayImu::readFifo(uint8_t* out, uint16_t maxFrames, bool& overflow) {
+    const std::vector<TraceImuFrame>& frames = _trace.imu();
+    uint32_t now = halMicros();
+
+    size_t pending = 0;
+    while (_next + pending < frames.size() && isDue(frames[_next + pending].timestampUs, now)) pending++;
+
+    // Stop-when-full come sul chip: restano i primi MPU_FIFO_MAX_FRAMES, il resto è perso
+    overflow = pending > MPU_FIFO_MAX_FRAMES;
+    uint16_t count = (uint16_t)std::min<size_t>(std::min<size_t>(pending, MPU_FIFO_MAX_FRAMES), maxFrames);
+
+    for (uint16_t k = 0; k < count; k++) {
+        const TelemetryImuRaw& r = frames[_next + k].raw;
+        uint8_t* f = out + k * MPU_FIFO_FRAME_BYTES;
+        putBigEndian(f + 0, r.ax);
+        putBigEndian(f + 2, r.ay);
+        putBigEndian(f + 4, r.az);
+        putBigEndian(f + 6, r.gx);
+        putBigEndian(f + 8, r.gy);
+        putBigEndian(f + 10, r.gz);
+    }
+    _next += count;
+    if (overflow) resetFifo();
+    return count;
+}
+
+bool ReplayImu::readMagnetometer(float& x, float& y, float& z) {
+    x = y = z = 0.0f;
+    return false;
+}
+
+const TraceImuFrame* ReplayImu::latest() const {
+    const std::vector<TraceImuFrame>& frames = _trace.imu();
+    uint32_t now = halMicros();
+    const TraceImuFrame* last = nullptr;
+    for (size_t i = _next; i < frames.size() && isDue(frames[i].timestampUs, now); i++) last = &frames[i];
+    return last;
+}
+
+bool ReplayImu::readGyro(float& x, float& y, float& z) {
+    const TraceImuFrame* f = latest();
+    if (!f) return false;
+    x = f->raw.gx / IMU_GYRO_LSB_PER_DPS;
+    y = f->raw.gy / IMU_GYRO_LSB_PER_DPS;
+    z = f->raw.gz / IMU_GYRO_LSB_PER_DPS;
+    return true;
+}
+
+float ReplayImu::readPitch() {
+    const TraceImuFrame* f = latest();
+    if (!f) return 0.0f;
+    float ax = f->raw.ax, ay = f->raw.ay, az = f->raw.az;
+    return atan2f(-ax, sqrtf(ay * ay + az * az)) * 57.29578f;
+}
+
+// ==========================================
+// TOF
+// ==========================================
+
+uint32_t ReplayRanging::startRanging() {
+    const std::vector<TraceRange>& s = samples();
+    uint32_t now = halMicros();
+    while (_next < s.size() && isDue(s[_next].timestampUs, now)) _next++;
+
+    // Budget stimato dal passo medio della traccia, meno l'overhead che lo scheduler riaggiunge
+    if (s.size() < 2) return 33000;
+    uint32_t span = s.back().timestampUs - s.front().timestampUs;
+    uint32_t period = span / (uint32_t)(s.size() - 1);
+    return period > TOF_SCHED_OVERHEAD_US + 1000 ? period - TOF_SCHED_OVERHEAD_US : 1000;
+}
+
+int ReplayRanging::checkDataReady(bool& ready) {
+    const std::vector<TraceRange>& s = samples();
+    ready = _next < s.size() && isDue(s[_next].timestampUs, halMicros());
+    return 0;
+}
+
+int ReplayRanging::readRange(RangeSample& sample) {
+    const std::vector<TraceRange>& s = samples();
+    uint32_t now = halMicros();
+    if (_next >= s.size() || !isDue(s[_next].timestampUs, now)) return -1;
+
+    // Il sensore tiene solo l'ultima misura: quelle saltate sono perse anche qui
+    while (_next + 1 < s.size() && isDue(s[_next + 1].timestampUs, now)) _next++;
+    const TelemetryToFRaw& r = s[_next++].raw;
+
+    sample.distance_mm = r.distance_mm;
+    sample.rangeStatus = r.rangeStatus;
+    sample.objects = r.rangeStatus == 255 ? 0 : 1;
+    // Non registrati nella traccia
+    sample.signalKcps = 0;
+    sample.sigmaMm = 0;
+    return 0;
+}
+
+// ==========================================
+// SPETTROMETRO
+// ==========================================
+
+void ReplaySpectral::startMeasurement() {
+    const std::vector<TraceSpectral>& s = _trace.spectral();
+    uint32_t now = halMicros();
+    while (_next < s.size() && isDue(s[_next].timestampUs, now)) _next++;
+}
+
+bool ReplaySpectral::pollSample(float channels[CH_COUNT]) {
+    const std::vector<TraceSpectral>& s = _trace.spectral();
+    uint32_t now = halMicros();
+    if (_next >= s.size() || !isDue(s[_next].timestampUs, now)) return false;
+
+    while (_next + 1 < s.size() && isDue(s[_next + 1].timestampUs, now)) _next++;
+    memcpy(channels, s[_next++].channels, sizeof(float) * CH_COUNT);
+    if (_readUs) halClock().delayUs(_readUs);
+    return true;
+}
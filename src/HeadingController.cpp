@@ -0,0 +1,72 @@
+#include "HeadingController.h"
+
+#include <math.h>
+
+static float clampf(float v, float limit) {
+    return v > limit ? limit : (v < -limit ? -limit : v);
+}
+
+// ============================================================================
+// Pid
+// ============================================================================
+
+Pid::Pid(const PidGains& gains) : _gains(gains), _iTerm(0.0f) {}
+
+void Pid::reset() {
+    _iTerm = 0.0f;
+}
+
+float Pid::update(float error, float measureRate, float dtS) {
+    float p = _gains.kp * error;
+    float d = -_gains.kd * measureRate;
+    float out = p + _iTerm + d;
+
+    // Anti-windup: si integra solo se l'uscita non è già saturata nello stesso verso
+    bool saturatedSameSign = (out >= _gains.outLimit && error > 0.0f) || (out <= -_gains.outLimit && error < 0.0f);
+    bool inZone = _gains.iZone <= 0.0f || fabsf(error) < _gains.iZone;
+    if (inZone && !saturatedSameSign) {
+        _iTerm = clampf(_iTerm + _gains.ki * error * dtS, _gains.iLimit);
+        out = p + _iTerm + d;
+    }
+    return clampf(out, _gains.outLimit);
+}
+
+// ============================================================================
+// HeadingController
+// ============================================================================
+
+HeadingController::HeadingController()
+    : _pid({HEADING_KP, HEADING_KI, HEADING_KD, HEADING_I_LIMIT, HEADING_I_ZONE_DEG, HEADING_OUT_LIMIT}),
+      _target(0.0f), _error(0.0f), _base(0) {}
+
+float HeadingController::wrapDeg(float deg) {
+    deg = fmodf(deg, 360.0f);
+    if (deg > 180.0f) deg -= 360.0f;
+    else if (deg <= -180.0f) deg += 360.0f;
+    return deg;
+}
+
+void HeadingController::setBaseSpeed(int16_t speed) {
+    _base = (int16_t)clampf(speed, MOTOR_SPEED_MAX);
+}
+
+void HeadingController::reset() {
+    _pid.reset();
+    _error = 0.0f;
+}
+
+DriveCommand HeadingController::update(float yawDeg, float yawRateDps, float dtS) {
+    _error = wrapDeg(_target - yawDeg);
+    float u = _pid.update(_error, yawRateDps, dtS);
+
+    // La direzione ha la precedenza: si toglie margine alla base
+    float base = _base;
+    float headroom = MOTOR_SPEED_MAX - fabsf(u);
+    if (headroom < 0.0f) headroom = 0.0f;
+    base = clampf(base, headroom);
+
+    DriveCommand cmd;
+    cmd.left = (int16_t)lroundf(clampf(base - u, MOTOR_SPEED_MAX));
+    cmd.right = (int16_t)lroundf(clampf(base + u, MOTOR_SPEED_MAX));
+    return cmd;
+}
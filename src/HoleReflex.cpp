@@ -0,0 +1,137 @@
+#include "HoleReflex.h"
+
+HoleReflex::HoleReflex(DriveOutput& drive)
+    : _drive(drive), _state(REFLEX_ARMED), _releaseRequest(false), _armRequest(ARM_NONE), _holeSamples(0),
+      _offBlack(false), _wasForward(false), _phaseEndUs(0), _fires(0), _lastLatencyUs(0), _maxLatencyUs(0), _overBudget(0), _blindStops(0),
+      _latencySumUs(0) {}
+
+void HoleReflex::applyArm(bool armed) {
+    _holeSamples = 0;
+    _offBlack = false;
+    if (!armed) {
+        // Disarmare non lascia i motori presi dal riflesso
+        if (isEngaged()) _drive.releasePreempt();
+        _state.store(REFLEX_DISARMED, std::memory_order_relaxed);
+    } else if (state() == REFLEX_DISARMED) {
+        _state.store(REFLEX_ARMED, std::memory_order_relaxed);
+    }
+}
+
+bool HoleReflex::onSample(const SpectralMatch& raw, uint32_t sampleUs) {
+    if (state() != REFLEX_ARMED) return false;
+
+    if (raw.type != COLOR_BLACK || raw.confidence < REFLEX_MIN_CONFIDENCE) {
+        _holeSamples = 0;
+        _offBlack = true;
+        return false;
+    }
+    // Ancora sul buco dopo il rilascio: si esce in retromarcia o girando senza scatti
+    if (!_offBlack && _drive.driveCommand(0) + _drive.driveCommand(1) <= 0) return false;
+    if (++_holeSamples < REFLEX_HOLE_SAMPLES) return false;
+
+    fire(raw, sampleUs);
+    return true;
+}
+
+void HoleReflex::fire(const SpectralMatch& raw, uint32_t sampleUs) {
+    // Prima il freno, poi tutto il resto
+    _wasForward = _drive.driveCommand(0) + _drive.driveCommand(1) > 0;
+    _drive.preempt(0, 0);
+    uint32_t brakeUs = halMicros();
+
+    _state.store(REFLEX_BRAKING, std::memory_order_relaxed);
+    _phaseEndUs = brakeUs + REFLEX_BRAKE_US;
+    _holeSamples = 0;
+
+    uint32_t latency = brakeUs - sampleUs;
+    uint32_t fires = _fires.load(std::memory_order_relaxed) + 1;
+    _lastLatencyUs.store(latency, std::memory_order_relaxed);
+    if (latency > _maxLatencyUs.load(std::memory_order_relaxed)) {
+        _maxLatencyUs.store(latency, std::memory_order_relaxed);
+    }
+    if (latency > REFLEX_LATENCY_BUDGET_US) _overBudget.fetch_add(1, std::memory_order_relaxed);
+    _latencySumUs.fetch_add(latency, std::memory_order_relaxed);
+    _fires.store(fires, std::memory_order_relaxed);
+
+    halLog("[RIFLESSO] Buco nero (conf %.2f): freno in %lu us dal campione%s | scatto %lu, max %lu us\n",
+           raw.confidence, (unsigned long)latency, latency > REFLEX_LATENCY_BUDGET_US ? " (OLTRE IL BUDGET)" : "",
+           (unsigned long)fires, (unsigned long)_maxLatencyUs.load(std::memory_order_relaxed));
+}
+
+void HoleReflex::applySensorOnline(bool online) {
+    ReflexState s = state();
+    if (!online && s == REFLEX_ARMED) {
+        // Nessun campione = nessun buco visibile: meglio fermi che ciechi
+        _drive.preempt(0, 0);
+        _holeSamples = 0;
+        _state.store(REFLEX_BLIND, std::memory_order_relaxed);
+        _blindStops.fetch_add(1, std::memory_order_relaxed);
+        halLog("[RIFLESSO] AS7262 non online: motori fermi finché non torna\n");
+    } else if (online && s == REFLEX_BLIND) {
+        _drive.releasePreempt();
+        _offBlack = false;
+        _state.store(REFLEX_ARMED, std::memory_order_relaxed);
+        halLog("[RIFLESSO] AS7262 di nuovo online: motori al controllo\n");
+    }
+}
+
+void HoleReflex::tick(uint32_t nowUs, bool sensorOnline) {
+    uint8_t arm = _armRequest.exchange(ARM_NONE, std::memory_order_acquire);
+    if (arm != ARM_NONE) applyArm(arm == ARM);
+    applySensorOnline(sensorOnline);
+
+    ReflexState s = state();
+
+    if (_releaseRequest.exchange(false, std::memory_order_acquire)) {
+        // Da cieco il rilascio non vale: i motori tornano col sensore
+        if (s >= REFLEX_BRAKING && s != REFLEX_BLIND) {
+            _drive.releasePreempt();
+            _holeSamples = 0;
+            _offBlack = false;
+            _state.store(REFLEX_ARMED, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    if ((int32_t)(nowUs - _phaseEndUs) < 0) return;
+    switch (s) {
+        case REFLEX_BRAKING:
+            if (_wasForward && REFLEX_BACKOFF_US > 0) {
+                _drive.preempt(-REFLEX_BACKOFF_SPEED, -REFLEX_BACKOFF_SPEED);
+                _phaseEndUs = nowUs + REFLEX_BACKOFF_US;
+                _state.store(REFLEX_BACKOFF, std::memory_order_relaxed);
+            } else {
+                _state.store(REFLEX_HOLD, std::memory_order_relaxed);
+            }
+            break;
+
+        case REFLEX_BACKOFF:
+            _drive.preempt(0, 0);
+            _state.store(REFLEX_HOLD, std::memory_order_relaxed);
+            break;
+
+        default:
+            break;
+    }
+}
+
+const char* HoleReflex::stateName(ReflexState state) {
+    switch (state) {
+        case REFLEX_DISARMED: return "DISARMATO";
+        case REFLEX_ARMED:    return "ARMATO";
+        case REFLEX_BRAKING:  return "FRENO";
+        case REFLEX_BACKOFF:  return "RETROMARCIA";
+        case REFLEX_HOLD:     return "FERMO";
+        case REFLEX_BLIND:    return "CIECO";
+    }
+    return "-";
+}
+
+void HoleReflex::printStats() const {
+    uint32_t fires = this->fires();
+    halLog("[RIFLESSO] %s | Scatti %lu | Latenza campione->freno: ultima %lu us, max %lu us, media %.0f us"
+           " | Oltre %u us: %lu | Fermi da cieco: %lu\n",
+           stateName(state()), (unsigned long)fires, (unsigned long)lastLatencyUs(), (unsigned long)maxLatencyUs(),
+           fires ? (double)_latencySumUs.load(std::memory_order_relaxed) / fires : 0.0, (unsigned)REFLEX_LATENCY_BUDGET_US,
+           (unsigned long)overBudget(), (unsigned long)blindStops());
+}
@@ -0,0 +1,240 @@
+#include "I2CBus.h"
+
+#include "Profiler.h"
+
+I2CBus::I2CBus(TwoWire& wire)
+    : _wire(wire), _deviceCount(0), _mutex(nullptr), _owner(nullptr), _depth(0),
+      _maxClockHz(I2C_BUS_MAX_CLOCK_HZ), _currentClockHz(0), _statsSinceUs(0), _busyUs(0) {
+    memset(_devices, 0, sizeof(_devices));
+    for (int p = 0; p < I2C_PRIO_COUNT; p++) _waiting[p].store(0);
+}
+
+bool I2CBus::begin(uint8_t sdaPin, uint8_t sclPin, uint32_t maxClockHz) {
+    if (!_mutex) _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) return false;
+
+    _maxClockHz = maxClockHz;
+    if (!_wire.begin(sdaPin, sclPin, maxClockHz)) return false;
+    _currentClockHz = maxClockHz;
+
+    resetStats();
+    return true;
+}
+
+I2CBus::DeviceId I2CBus::registerDevice(uint8_t address, const char* name, I2CPriority priority, uint32_t maxClockHz) {
+    // Stesso indirizzo già registrato: si riusa (begin() chiamato due volte)
+    for (uint8_t i = 0; i < _deviceCount; i++) {
+        if (_devices[i].stats.address == address && _devices[i].stats.name == name) return i;
+    }
+    if (_deviceCount >= I2C_BUS_MAX_DEVICES) return INVALID_DEVICE;
+
+    Device& d = _devices[_deviceCount];
+    memset(&d.stats, 0, sizeof(I2CDeviceStats));
+    d.stats.address = address;
+    d.stats.name = name;
+    d.priority = priority;
+    d.maxClockHz = maxClockHz;
+    return _deviceCount++;
+}
+
+void I2CBus::setDeviceAddress(DeviceId dev, uint8_t address) {
+    if (dev < _deviceCount) _devices[dev].stats.address = address;
+}
+
+// ==========================================
+// ARBITRAGGIO
+// ==========================================
+
+bool I2CBus::higherPriorityWaiting(I2CPriority prio) const {
+    for (int p = prio + 1; p < I2C_PRIO_COUNT; p++) {
+        if (_waiting[p].load(std::memory_order_relaxed) > 0) return true;
+    }
+    return false;
+}
+
+bool I2CBus::acquire(DeviceId dev) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (_owner == self) {
+        // Transazione annidata: il bus è già nostro
+        _depth++;
+        return false;
+    }
+
+    const Device& d = _devices[dev];
+    _waiting[d.priority].fetch_add(1);
+
+    for (;;) {
+        // Si lascia passare chi ha priorità più alta ed è già in coda
+        if (higherPriorityWaiting(d.priority)) {
+            taskYIELD();
+            continue;
+        }
+        if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(1)) != pdTRUE) continue;
+
+        // Qualcuno più importante è arrivato mentre prendevamo il mutex
+        if (higherPriorityWaiting(d.priority)) {
+            xSemaphoreGive(_mutex);
+            taskYIELD();
+            continue;
+        }
+        break;
+    }
+
+    _waiting[d.priority].fetch_sub(1);
+    _owner = self;
+    _depth = 1;
+
+    applyClock(min(d.maxClockHz, _maxClockHz));
+    return true;
+}
+
+void I2CBus::release(DeviceId dev, uint32_t holdUs) {
+    Device& d = _devices[dev];
+    d.stats.transactions++;
+    d.stats.busTimeUs += holdUs;
+    if (holdUs > d.stats.maxHoldUs) d.stats.maxHoldUs = holdUs;
+    _busyUs += holdUs;
+
+    _depth = 0;
+    _owner = nullptr;
+    xSemaphoreGive(_mutex);
+}
+
+void I2CBus::applyClock(uint32_t clockHz) {
+    if (clockHz == _currentClockHz) return;
+    _wire.setClock(clockHz);
+    _currentClockHz = clockHz;
+}
+
+I2CBus::Transaction::Transaction(I2CBus& bus, DeviceId dev)
+    : _bus(bus), _dev(dev), _outer(false), _startUs(0), _requestTicks(profilerTicks()) {
+    if (dev >= _bus._deviceCount) return;
+
+    uint32_t requestUs = micros();
+    _outer = _bus.acquire(dev);
+    _startUs = micros();
+
+    if (_outer) {
+        I2CDeviceStats& st = _bus._devices[dev].stats;
+        uint32_t waitUs = _startUs - requestUs;
+        st.waitTimeUs += waitUs;
+        if (waitUs > st.maxWaitUs) st.maxWaitUs = waitUs;
+    }
+}
+
+I2CBus::Transaction::~Transaction() {
+    if (_dev >= _bus._deviceCount) return;
+    if (!_outer) {
+        _bus._depth--;
+        return;
+    }
+    _bus.release(_dev, micros() - _startUs);
+    // Attesa + possesso: tempo dello scope chiamante passato sul bus
+    PROFILE_BLOCKED(profilerTicks() - _requestTicks);
+}
+
+void I2CBus::Transaction::reportDriverStatus(int status) {
+    if (status != 0 && _dev < _bus._deviceCount) _bus._devices[_dev].stats.errors++;
+}
+
+void I2CBus::Transaction::reportWireResult(uint8_t result) {
+    _bus.recordWireResult(_dev, result);
+}
+
+void I2CBus::recordWireResult(DeviceId dev, uint8_t result) {
+    if (dev >= _deviceCount) return;
+    I2CDeviceStats& st = _devices[dev].stats;
+    switch (result) {
+        case I2C_OK: break;
+        case I2C_ERR_NACK_ADDR:
+        case I2C_ERR_NACK_DATA: st.nacks++; break;
+        case I2C_ERR_TIMEOUT:   st.timeouts++; break;
+        default:                st.errors++; break;
+    }
+}
+
+// ==========================================
+// HELPER DI BASSO LIVELLO
+// ==========================================
+
+bool I2CBus::probe(DeviceId dev) {
+    if (dev >= _deviceCount) return false;
+    Transaction tx(*this, dev);
+    _wire.beginTransmission(_devices[dev].stats.address);
+    uint8_t result = _wire.endTransmission();
+    tx.reportWireResult(result);
+    return result == I2C_OK;
+}
+
+uint8_t I2CBus::writeRegister(DeviceId dev, uint8_t reg, uint8_t value) {
+    if (dev >= _deviceCount) return I2C_ERR_OTHER;
+    Transaction tx(*this, dev);
+    _wire.beginTransmission(_devices[dev].stats.address);
+    _wire.write(reg);
+    _wire.write(value);
+    uint8_t result = _wire.endTransmission();
+    tx.reportWireResult(result);
+    return result;
+}
+
+bool I2CBus::readRegisters(DeviceId dev, uint8_t reg, uint8_t* buffer, uint8_t len) {
+    if (dev >= _deviceCount) return false;
+    Transaction tx(*this, dev);
+    uint8_t addr = _devices[dev].stats.address;
+
+    _wire.beginTransmission(addr);
+    _wire.write(reg);
+    uint8_t result = _wire.endTransmission(false);
+    tx.reportWireResult(result);
+    if (result != I2C_OK) return false;
+
+    if (_wire.requestFrom(addr, len) != len) {
+        tx.reportWireResult(I2C_ERR_TIMEOUT);
+        return false;
+    }
+    for (uint8_t i = 0; i < len; i++) buffer[i] = _wire.read();
+    return true;
+}
+
+// ==========================================
+// STATISTICHE
+// ==========================================
+
+I2CDeviceStats I2CBus::getStats(DeviceId dev) const {
+    I2CDeviceStats out;
+    memset(&out, 0, sizeof(out));
+    if (dev < _deviceCount) out = _devices[dev].stats;
+    return out;
+}
+
+float I2CBus::utilization() const {
+    uint32_t elapsed = micros() - _statsSinceUs;
+    if (elapsed == 0) return 0.0f;
+    return (float)_busyUs / (float)elapsed;
+}
+
+void I2CBus::resetStats() {
+    for (uint8_t i = 0; i < _deviceCount; i++) {
+        I2CDeviceStats& st = _devices[i].stats;
+        uint8_t addr = st.address;
+        const char* name = st.name;
+        memset(&st, 0, sizeof(I2CDeviceStats));
+        st.address = addr;
+        st.name = name;
+    }
+    _busyUs = 0;
+    _statsSinceUs = micros();
+}
+
+void I2CBus::printStats() const {
+    Serial.printf("[I2C] Utilizzo bus: %.1f%% @ %lu Hz\n", utilization() * 100.0f, (unsigned long)_currentClockHz);
+    Serial.println("[I2C] Device      | Addr | Trans  | Bus(us)  | Hold max | Wait avg/max(us) | NACK | T.out | Err");
+    for (uint8_t i = 0; i < _deviceCount; i++) {
+        const I2CDeviceStats& st = _devices[i].stats;
+        uint32_t waitAvg = st.transactions ? st.waitTimeUs / st.transactions : 0;
+        Serial.printf("[I2C] %-11s | 0x%02X | %6lu | %8lu | %8lu | %7lu / %-6lu | %4lu | %5lu | %lu\n",
+                      st.name, st.address, (unsigned long)st.transactions, (unsigned long)st.busTimeUs,
+                      (unsigned long)st.maxHoldUs, (unsigned long)waitAvg, (unsigned long)st.maxWaitUs,
+                      (unsigned long)st.nacks, (unsigned long)st.timeouts, (unsigned long)st.errors);
+    }
+}
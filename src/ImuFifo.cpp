@@ -0,0 +1,103 @@
+#include "ImuFifo.h"
+
+#include <math.h>
+#include <string.h>
+
+static inline int16_t be16(const uint8_t* p) {
+    return (int16_t)((uint16_t)p[0] << 8 | p[1]);
+}
+
+size_t parseFifoFrames(const uint8_t* bytes, size_t len, ImuRawFrame* out, size_t maxFrames) {
+    size_t frames = len / MPU_FIFO_FRAME_BYTES;
+    if (frames > maxFrames) frames = maxFrames;
+
+    for (size_t i = 0; i < frames; i++) {
+        const uint8_t* p = bytes + i * MPU_FIFO_FRAME_BYTES;
+        out[i].ax = be16(p + 0);
+        out[i].ay = be16(p + 2);
+        out[i].az = be16(p + 4);
+        out[i].gx = be16(p + 6);
+        out[i].gy = be16(p + 8);
+        out[i].gz = be16(p + 10);
+    }
+    return frames;
+}
+
+FifoIntegrator::FifoIntegrator(float gyroLsbPerDps, float accLsbPerG, float sampleDtS)
+    : _gyroScale(1.0f / gyroLsbPerDps), _accScale(1.0f / accLsbPerG), _dt(sampleDtS),
+      _deadbandDps(0.0f),
+      _filter(nullptr), _mx(0), _my(0), _mz(0), _magValid(false),
+      _biasGx(0), _biasGy(0), _biasGz(0), _biasAx(0), _biasAy(0), _biasAz(0),
+      _calibFramesLeft(0), _calibFramesTotal(0),
+      _yaw(0.0f), _pitch(0.0f), _lastGyroZ(0.0f), _samples(0) {
+    memset(_calibSum, 0, sizeof(_calibSum));
+}
+
+void FifoIntegrator::startBiasCalibration(uint16_t frames) {
+    memset(_calibSum, 0, sizeof(_calibSum));
+    _calibFramesLeft = frames;
+    _calibFramesTotal = frames;
+}
+
+void FifoIntegrator::process(const ImuRawFrame* frames, size_t count) {
+    float sumAx = 0, sumAy = 0, sumAz = 0;
+    size_t integrated = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const ImuRawFrame& f = frames[i];
+
+        if (_calibFramesLeft > 0) {
+            _calibSum[0] += f.ax; _calibSum[1] += f.ay; _calibSum[2] += f.az;
+            _calibSum[3] += f.gx; _calibSum[4] += f.gy; _calibSum[5] += f.gz;
+            if (--_calibFramesLeft == 0) {
+                float n = (float)_calibFramesTotal;
+                _biasAx = _calibSum[0] / n;
+                _biasAy = _calibSum[1] / n;
+                // Robot in piano: su Z resta la gravità (1 g)
+                _biasAz = _calibSum[2] / n - 1.0f / _accScale;
+                _biasGx = _calibSum[3] / n;
+                _biasGy = _calibSum[4] / n;
+                _biasGz = _calibSum[5] / n;
+            }
+            continue;
+        }
+
+        float gz = ((float)f.gz - _biasGz) * _gyroScale;
+
+        if (_filter) {
+            const float DPS_TO_RAD = (float)M_PI / 180.0f;
+            float gx = ((float)f.gx - _biasGx) * _gyroScale;
+            float gy = ((float)f.gy - _biasGy) * _gyroScale;
+            _filter->update(gx * DPS_TO_RAD, gy * DPS_TO_RAD, gz * DPS_TO_RAD,
+                            (float)f.ax - _biasAx, (float)f.ay - _biasAy, (float)f.az - _biasAz,
+                            _mx, _my, _mz, _magValid, _dt);
+        }
+
+        if (fabsf(gz) < _deadbandDps) gz = 0.0f;
+
+        // Ogni campione pesa esattamente il suo periodo di campionamento
+        _yaw += gz * _dt;
+        _lastGyroZ = gz;
+
+        sumAx += (float)f.ax - _biasAx;
+        sumAy += (float)f.ay - _biasAy;
+        sumAz += (float)f.az - _biasAz;
+        integrated++;
+    }
+
+    if (integrated == 0) return;
+    _samples += integrated;
+
+    // Pitch dalla media dell'accelerometro del blocco (stessa formula di MPU9250_WE::getPitch)
+    float ax = sumAx / integrated;
+    float ay = sumAy / integrated;
+    float az = sumAz / integrated;
+    _pitch = atan2f(-ax, sqrtf(ay * ay + az * az)) * 180.0f / (float)M_PI;
+}
+
+void FifoIntegrator::bridgeGap(float seconds) {
+    if (seconds <= 0.0f || _calibFramesLeft > 0) return;
+    _yaw += _lastGyroZ * seconds;
+    // Anche il filtro: lo yaw fuso esposto da ImuManager deriva dal suo quaternione
+    if (_filter) _filter->rotateYaw(_lastGyroZ * seconds * (float)M_PI / 180.0f);
+}
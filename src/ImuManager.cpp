@@ -1,95 +1,221 @@
 #include "ImuManager.h"
 
-// Indirizzo I2C standard quando AD0 è a GND
-#define MPU_ADDR 0x68
-
-ImuManager::ImuManager(uint8_t sdaPin, uint8_t sclPin)
-    : _sda(sdaPin), _scl(sclPin), _mpu(MPU9250_WE(MPU_ADDR)),
-      _lastUpdateMicros(0), _yaw(0.0f), _pitch(0.0f) {
+#include <math.h>
+
+#include "Profiler.h"
+
+ImuManager::ImuManager(ImuDevice& device)
+    : _device(device), _lastUpdateMicros(0), _yaw(0.0f), _pitch(0.0f), _roll(0.0f),
+#if IMU_USE_FIFO
+      _fifo(IMU_GYRO_LSB_PER_DPS, IMU_ACC_LSB_PER_G, IMU_FIFO_SAMPLE_DT_S),
+#endif
+#if IMU_USE_FIFO && IMU_FUSION_ENABLED
+      _lastMagMicros(0), _lastFusedYaw(0.0f), _yawOffset(0.0f),
+#endif
+      _fifoOverflows(0), _sampleTimeUs(0), _recorder(nullptr),
+      _bootState(IMU_BOOT_IDLE), _bootWaitUntilUs(0), _chipId(0),
+      _health(HEALTH_IMU_STALE_US), _recovering(false) {
 }
 
 bool ImuManager::begin() {
-    Wire.begin(_sda, _scl);
-    Wire.setClock(400000);
-    delay(100);
-
-    // --- DIAGNOSTICA AVANZATA ---
-    Wire.beginTransmission(MPU_ADDR);
-    Wire.write(0x75); // Registro WHO_AM_I
-    Wire.endTransmission(false);
-    Wire.requestFrom((uint8_t)MPU_ADDR, (uint8_t)1);
-    uint8_t chipID = Wire.read();
-
-    Serial.printf("\n[DIAGNOSTICA] Chip ID letto: 0x%02X\n", chipID);
-    Serial.println("Valori attesi: 0x71 (MPU9250), 0x70 (MPU6500), 0x73 (MPU9255)");
-
-    // --- RESET FORZATO DEL SENSORE ---
-    // Scriviamo nel registro PWR_MGMT_1 per resettare il chip
-    Wire.beginTransmission(MPU_ADDR);
-    Wire.write(0x6B);
-    Wire.write(0x80); // Reset bit
-    Wire.endTransmission();
-    delay(100); // Attesa dopo reset
-
-    // --- SVEGLIA IL SENSORE ---
-    Wire.beginTransmission(MPU_ADDR);
-    Wire.write(0x6B);
-    Wire.write(0x00); // Sveglia (Clock interno)
-    Wire.endTransmission();
-    delay(100);
-
-    // Ora proviamo l'init della libreria
-    if (!_mpu.init()) {
-        Serial.println("[ERRORE] La libreria rifiuta ancora il chip nonostante il reset.");
-        // Non usciamo con false, proviamo a procedere comunque se l'ID è sensato
-        if (chipID == 0x00 || chipID == 0xFF) return false;
+    // Versione bloccante di bootStep(): ritorna quando l'IMU può essere aggiornata
+    // (la calibrazione del bias prosegue dentro update())
+    BootStatus status;
+    while ((status = bootStep(halMicros())) == BOOT_PENDING && _bootState < IMU_BOOT_BIAS) {
+        halDelayMs(1);
     }
+    return status != BOOT_FAILED;
+}
 
-    Serial.println("[OK] Chip svegliato. Calibrazione offset...");
-    _mpu.autoOffsets();
+BootStatus ImuManager::bootStep(uint32_t nowUs) {
+    switch (_bootState) {
+        case IMU_BOOT_IDLE: {
+            _device.setup();
 
-    configureFilters();
+            // --- DIAGNOSTICA AVANZATA ---
+            _chipId = _device.whoAmI(); // Registro WHO_AM_I
 
-    _lastUpdateMicros = micros();
-    return true;
+            halLog("\n[DIAGNOSTICA] Chip ID letto: 0x%02X\n", _chipId);
+            halLog("Valori attesi: 0x71 (MPU9250), 0x70 (MPU6500), 0x73 (MPU9255)\n");
+
+            // --- RESET FORZATO DEL SENSORE ---
+            // Scriviamo nel registro PWR_MGMT_1 per resettare il chip
+            _device.reset();
+            _bootWaitUntilUs = nowUs + IMU_BOOT_RESET_WAIT_US; // Attesa dopo reset (senza bloccare)
+            _bootState = IMU_BOOT_RESET;
+            return BOOT_PENDING;
+        }
+
+        case IMU_BOOT_RESET:
+            if ((int32_t)(nowUs - _bootWaitUntilUs) < 0) return BOOT_PENDING;
+
+            // --- SVEGLIA IL SENSORE ---
+            _device.wake(); // Sveglia (Clock interno)
+            _bootWaitUntilUs = nowUs + IMU_BOOT_RESET_WAIT_US;
+            _bootState = IMU_BOOT_WAKE;
+            return BOOT_PENDING;
+
+        case IMU_BOOT_WAKE: {
+            if ((int32_t)(nowUs - _bootWaitUntilUs) < 0) return BOOT_PENDING;
+
+            // Ora proviamo l'init della libreria
+            if (!_device.init()) {
+                halLog("[ERRORE] La libreria rifiuta ancora il chip nonostante il reset.\n");
+                // Non usciamo con false, proviamo a procedere comunque se l'ID è sensato
+                if (_chipId == 0x00 || _chipId == 0xFF) {
+                    _bootState = IMU_BOOT_FAILED;
+                    return BOOT_FAILED;
+                }
+            }
+
+#if IMU_USE_FIFO
+            // Il bias si calcola sui primi frame della FIFO, senza bloccare (vedi FifoIntegrator)
+            _device.configure();
+
+#if IMU_FUSION_ENABLED
+#if IMU_FUSION_USE_MAG
+            // AK8963 letto dal master I2C interno: va avviato prima della FIFO
+            if (!_device.initMagnetometer()) {
+                halLog("[WARN] Magnetometro non risponde: fusione a 6 assi.\n");
+            }
+#endif
+            _fifo.attachFilter(&_fusion);
+#endif
+
+            // Re-init: il bias misurato all'avvio resta valido (il robot può essere in moto)
+            if (!(_recovering ? _device.startFifo() : startFifo())) {
+                halLog("[ERRORE] Avvio FIFO fallito.\n");
+                _bootState = IMU_BOOT_FAILED;
+                return BOOT_FAILED;
+            }
+            _lastUpdateMicros = halMicros();
+            if (_recovering) {
+                _bootState = IMU_BOOT_DONE;
+                return BOOT_DONE;
+            }
+            halLog("[OK] Chip svegliato. FIFO attiva, calibrazione bias in corso...\n");
+            _bootState = IMU_BOOT_BIAS;
+            return BOOT_PENDING;
+#else
+            if (!_recovering) {
+                halLog("[OK] Chip svegliato. Calibrazione offset...\n");
+                _device.autoOffsets(); // Bloccante: solo senza FIFO
+                _health.start(halMicros());
+            }
+
+            _device.configure();
+            _lastUpdateMicros = halMicros();
+            _bootState = IMU_BOOT_DONE;
+            return BOOT_DONE;
+#endif
+        }
+
+        case IMU_BOOT_BIAS:
+#if IMU_USE_FIFO
+            // Robot fermo: i frame accumulati diventano il bias, mentre il resto si avvia
+            update();
+            if (_fifo.isCalibrating()) return BOOT_PENDING;
+#endif
+            _health.start(nowUs);
+            _bootState = IMU_BOOT_DONE;
+            return BOOT_DONE;
+
+        case IMU_BOOT_DONE:
+            return BOOT_DONE;
+
+        case IMU_BOOT_FAILED:
+            return BOOT_FAILED;
+    }
+    return BOOT_FAILED;
+}
+
+const char* ImuManager::bootPhase() const {
+    switch (_bootState) {
+        case IMU_BOOT_IDLE:
+        case IMU_BOOT_RESET:  return "reset";
+        case IMU_BOOT_WAKE:   return "risveglio";
+        case IMU_BOOT_BIAS:   return "bias gyro";
+        default:              return nullptr;
+    }
 }
 
-void ImuManager::configureFilters() {
-    /*
-     * CONFIGURAZIONE PER ROBOT CINGOLATO (Vibrazioni meccaniche elevate)
-     * Riferimento Datasheet MPU-9250:
-     * DLPF_CFG | Gyro BW (Hz) | Accel BW (Hz)
-     *    4     |      20      |      21.2
-     */
+bool ImuManager::startFifo() {
+#if IMU_USE_FIFO
+    if (!_device.startFifo()) return false;
 
-    // Imposta il divisore della frequenza di campionamento a 0 (1kHz interno)
-    _mpu.setSampleRateDivider(0);
+    _fifo.setDeadband(IMU_GYRO_DEADBAND_DPS);
+    _fifo.startBiasCalibration(IMU_FIFO_BIAS_FRAMES);
+    return true;
+#else
+    return false;
+#endif
+}
 
-    // RANGE:
-    // Accel: 4G è l'ideale per i cingolati (2G è troppo sensibile ai colpi)
-    _mpu.setAccRange(MPU9250_ACC_RANGE_8G);
+bool ImuManager::update() {
+    PROFILE_SCOPE("Imu.update");
+    uint32_t now = halMicros();
+    if (_health.needsRecovery()) {
+        recoveryStep(now);
+        return false;
+    }
 
-    // Gyro: 500 gradi/secondo (sufficiente per rotazioni rapide del robot)
-    _mpu.setGyrRange(MPU6050_GYRO_RANGE_2000);
+#if IMU_USE_FIFO
+    bool updated = updateFromFifo();
+#else
+    bool updated = updateDirect();
+#endif
+    // FIFO vuota non è un errore: lo diventa solo se dura (età del dato)
+    if (updated) _health.onSuccess(now);
+    else if (_device.readFailed()) _health.onError(now);
+
+    if (_health.check(halMicros())) {
+        halLog("[IMU] Guasto (ultimo campione %lu ms fa), re-init in background\n",
+               (unsigned long)(_health.ageUs(halMicros()) / 1000));
+    }
+    return updated;
+}
 
-    // FILTRI DLPF (Digital Low Pass Filter):
-    // Usiamo MPU9250_DLPF_4 che corrisponde a:
-    // -> Accelerometro: ~21.2 Hz Bandwidth
-    // -> Giroscopio:    ~20 Hz Bandwidth
-    // Questo taglierà drasticamente le vibrazioni dei motori e dei cingoli.
+void ImuManager::recoveryStep(uint32_t nowUs) {
+    if (!_recovering) {
+        if (!_health.retryDue(nowUs)) return;
+        _health.beginRecovery(nowUs);
 
-    _mpu.setAccDLPF(MPU9250_DLPF_4);
-    _mpu.setGyrDLPF(MPU9250_DLPF_4);
+        // Nuovo sondaggio: senza risposta a WHO_AM_I non si tenta nemmeno il reset
+        _chipId = _device.whoAmI();
+        if (_chipId == 0x00 || _chipId == 0xFF) {
+            _health.endRecovery(false, nowUs);
+            return;
+        }
+        halLog("[IMU] Re-init (chip 0x%02X, tentativo %lu)...\n", _chipId,
+               (unsigned long)_health.failedReinits() + 1);
+        _recovering = true;
+        _device.reset();
+        _bootWaitUntilUs = nowUs + IMU_BOOT_RESET_WAIT_US;
+        _bootState = IMU_BOOT_RESET;
+        return;
+    }
+
+    // Stesse attese dell'avvio (reset, risveglio), un passo per giro
+    BootStatus status = bootStep(nowUs);
+    if (status == BOOT_PENDING) return;
+    _recovering = false;
+    _bootState = IMU_BOOT_DONE;
+    _health.endRecovery(status == BOOT_DONE, halMicros());
+    // Lo yaw del periodo senza campioni è perso: lo riallineano i muri (WallEstimator)
+    if (status == BOOT_DONE) {
+        halLog("[IMU] Recuperata in %.0f ms (re-init %lu)\n", _health.lastRecoveryUs() / 1000.0f,
+               (unsigned long)_health.reinits());
+    }
 }
 
-void ImuManager::update() {
+bool ImuManager::updateDirect() {
+#if !IMU_USE_FIFO
     // Controllo di sicurezza: se l'ultima lettura era fallata, non aggiornare
-    xyzFloat gValue = _mpu.getGyrValues();
-
-    // Se la libreria restituisce zero o valori assurdi, saltiamo il ciclo
-    if (isnan(gValue.z)) return;
+    float gx, gy, gz;
+    if (!_device.readGyro(gx, gy, gz)) return false;
 
-    unsigned long currentMicros = micros();
+    uint32_t currentMicros = halMicros();
+    _sampleTimeUs = currentMicros;
     _dt = (currentMicros - _lastUpdateMicros) / 1000000.0f;
 
     // Protezione contro dt troppo grandi (es. pause nel codice)
@@ -97,15 +223,121 @@ void ImuManager::update() {
 
     _lastUpdateMicros = currentMicros;
 
-    float gyroZ = gValue.z;
-    if (abs(gyroZ) < 0.25f) gyroZ = 0.0f;
+    float gyroZ = gz;
+    if (fabsf(gyroZ) < 0.25f) gyroZ = 0.0f;
 
     _yaw += gyroZ * _dt;
-    _pitch = _mpu.getPitch();
+    _pitch = _device.readPitch();
+    return true;
+#else
+    return false;
+#endif
 }
 
+bool ImuManager::updateFromFifo() {
+#if IMU_USE_FIFO
+    // Stato, contatore e frame in un solo possesso del bus (vedi ImuDevice::readFifo)
+    bool overflow = false;
+    uint16_t totalFrames = _device.readFifo(_fifoBytes, MPU_FIFO_MAX_FRAMES, overflow);
+    uint32_t samplesBefore = _fifo.samples();
+
+    // L'ultimo frame in coda è stato campionato ~adesso, i precedenti a passi di 1 ms
+    const uint32_t sampleUs = (uint32_t)(IMU_FIFO_SAMPLE_DT_S * 1000000.0f);
+    uint32_t currentMicros = halMicros();
+    uint32_t frameTimeUs = currentMicros - (totalFrames ? totalFrames - 1 : 0) * sampleUs;
+
+    size_t n = parseFifoFrames(_fifoBytes, totalFrames * MPU_FIFO_FRAME_BYTES, _fifoFrames, MPU_FIFO_MAX_FRAMES);
+    _fifo.process(_fifoFrames, n);
+    for (size_t k = 0; k < n; k++, frameTimeUs += sampleUs) {
+        const ImuRawFrame& f = _fifoFrames[k];
+        if (_recorder) _recorder->logImuRaw(f.ax, f.ay, f.az, f.gx, f.gy, f.gz, frameTimeUs);
+        _sampleTimeUs = frameTimeUs;
+    }
+
+    if (overflow) {
+        // FIFO piena (loop fermo > ~42 ms): il resto del tempo trascorso non è
+        // nella FIFO. Lo si integra con l'ultima velocità invece di perderlo,
+        // sia nello yaw integrato sia nel quaternione della fusione.
+        _fifoOverflows++;
+        float elapsed = (currentMicros - _lastUpdateMicros) / 1000000.0f;
+        _fifo.bridgeGap(elapsed - totalFrames * IMU_FIFO_SAMPLE_DT_S);
+    }
+    _lastUpdateMicros = currentMicros;
+
+#if IMU_FUSION_ENABLED
+    readMagnetometer();
+#endif
+
+    if (_fifo.samples() == samplesBefore) return false;
+
+#if IMU_FUSION_ENABLED
+    // Lo yaw esposto resta continuo (non avvolto), come con la sola integrazione
+    float fusedYaw = _fusion.yawDeg();
+    float delta = fusedYaw - _lastFusedYaw;
+    if (delta > 180.0f) delta -= 360.0f;
+    else if (delta < -180.0f) delta += 360.0f;
+    _lastFusedYaw = fusedYaw;
+    _yawOffset += delta;
+
+    _yaw = _yawOffset;
+    _pitch = _fusion.pitchDeg();
+    _roll = _fusion.rollDeg();
+#else
+    _yaw = _fifo.yaw();
+    _pitch = _fifo.pitch();
+#endif
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if IMU_USE_FIFO && IMU_FUSION_ENABLED
+void ImuManager::readMagnetometer() {
+    uint32_t now = halMicros();
+    if (now - _lastMagMicros < IMU_MAG_READ_INTERVAL_US) return;
+    _lastMagMicros = now;
+
+#if IMU_FUSION_USE_MAG
+    float cx, cy, cz; // uT, assi AK8963
+    if (!_device.readMagnetometer(cx, cy, cz)) {
+        _fifo.setMagnetometer(0.0f, 0.0f, 0.0f, false);
+        return;
+    }
+
+    // AK8963: X e Y scambiati, Z invertito rispetto ad accel/gyro
+    float mx = cy, my = cx, mz = -cz;
+    float norm = sqrtf(mx * mx + my * my + mz * mz);
+
+    // Motori o strutture metalliche vicine: campo non plausibile, si usa solo il 6 assi
+    bool valid = !isnan(norm) && norm > IMU_MAG_MIN_UT && norm < IMU_MAG_MAX_UT;
+    _fifo.setMagnetometer(mx, my, mz, valid);
+#endif
+}
+#endif
+
 void ImuManager::resetYaw() {
+#if IMU_USE_FIFO
+    _fifo.resetYaw();
+#endif
     _yaw = 0.0f;
+#if IMU_USE_FIFO && IMU_FUSION_ENABLED
+    _yawOffset = 0.0f;
+#endif
+}
+
+void ImuManager::correctYaw(float deltaDeg) {
+#if IMU_USE_FIFO
+    _fifo.adjustYaw(deltaDeg);
+#endif
+    _yaw += deltaDeg;
+#if IMU_USE_FIFO && IMU_FUSION_ENABLED
+    _yawOffset += deltaDeg;
+#endif
+}
+
+uint32_t ImuManager::getFifoOverflows() const {
+    return _fifoOverflows;
 }
 
 float ImuManager::getYaw() const {
@@ -116,11 +348,18 @@ float ImuManager::getPitch() const {
     return _pitch;
 }
 
-bool ImuManager::isConnected() {
-    Wire.beginTransmission(0x68); // Indirizzo I2C del sensore
-    byte error = Wire.endTransmission();
-    return (error == 0); // Ritorna true se il sensore risponde (ACK)
+float ImuManager::getRoll() const {
+    return _roll;
 }
+
+Quaternion ImuManager::getQuaternion() const {
+#if IMU_USE_FIFO && IMU_FUSION_ENABLED
+    return _fusion.quaternion();
+#else
+    return {1.0f, 0.0f, 0.0f, 0.0f};
+#endif
+}
+
 /*
  * #include <Arduino.h>
 #include <Wire.h>
@@ -0,0 +1,54 @@
+#include "LoopStats.h"
+
+#include <math.h>
+#include <string.h>
+
+LoopStats::LoopStats(uint32_t periodUs) {
+    memset(&_t, 0, sizeof(_t));
+    _t.periodUs = periodUs;
+    reset();
+}
+
+void LoopStats::reset() {
+    uint32_t period = _t.periodUs;
+    memset(&_t, 0, sizeof(_t));
+    _t.periodUs = period;
+    _t.periodMinUs = UINT32_MAX;
+    _startUs = 0;
+    _started = false;
+    _lastOverrun = false;
+    _periods = 0;
+    _jitterSq = 0;
+    _execSum = 0;
+}
+
+void LoopStats::begin(uint32_t nowUs, uint32_t missedReleases) {
+    if (_started) {
+        uint32_t period = nowUs - _startUs;
+        if (period < _t.periodMinUs) _t.periodMinUs = period;
+        if (period > _t.periodMaxUs) _t.periodMaxUs = period;
+        // I periodi saltati non sono jitter: si confronta con il numero di periodi trascorsi
+        int32_t jitter = (int32_t)(period - _t.periodUs * (missedReleases + 1));
+        uint32_t absJitter = (uint32_t)(jitter < 0 ? -jitter : jitter);
+        if (absJitter > _t.jitterMaxUs) _t.jitterMaxUs = absJitter;
+        _jitterSq += (uint64_t)((int64_t)jitter * jitter);
+        _periods++;
+        _t.jitterRmsUs = sqrtf((float)_jitterSq / _periods);
+    }
+    _t.skippedReleases += missedReleases;
+    // Attivazione persa senza sforamento del ciclo prima: il task è partito in ritardo
+    if (missedReleases > 0 && !_lastOverrun) _t.deadlineMisses++;
+    _startUs = nowUs;
+    _started = true;
+}
+
+void LoopStats::end(uint32_t nowUs) {
+    uint32_t exec = nowUs - _startUs;
+    _t.execLastUs = exec;
+    if (exec > _t.execMaxUs) _t.execMaxUs = exec;
+    _t.cycles++;
+    _execSum += exec;
+    _t.execMeanUs = (float)_execSum / _t.cycles;
+    _lastOverrun = exec > _t.periodUs;
+    if (_lastOverrun) _t.deadlineMisses++;
+}
@@ -0,0 +1,263 @@
+#include "MazeMap.h"
+
+#include <string.h>
+
+static const int8_t DIR_DX[MAZE_DIRS] = {0, 1, 0, -1};
+static const int8_t DIR_DY[MAZE_DIRS] = {-1, 0, 1, 0};
+
+// ==========================================
+// MAPPA
+// ==========================================
+
+MazeMap::MazeMap() : _rampCount(0) {
+    clear();
+}
+
+void MazeMap::clear() {
+    memset(_walls, 0, sizeof(_walls));
+    memset(_flags, 0, sizeof(_flags));
+    _rampCount = 0;
+}
+
+MazeTile MazeMap::tileAt(int x, int y, int level) {
+    if (x < 0 || x >= MAZE_WIDTH || y < 0 || y >= MAZE_HEIGHT || level < 0 || level >= MAZE_LEVELS) {
+        return MAZE_NO_TILE;
+    }
+    return (MazeTile)((level * MAZE_HEIGHT + y) * MAZE_WIDTH + x);
+}
+
+MazeTile MazeMap::adjacent(MazeTile t, MazeDir d) const {
+    // Le rampe sostituiscono il vicino sullo stesso piano
+    for (uint8_t i = 0; i < _rampCount; i++) {
+        const Ramp& r = _ramps[i];
+        if (t == r.bottom && d == r.dir) return r.top;
+        if (t == r.top && d == mazeOpposite(r.dir)) return r.bottom;
+    }
+    MazeTile n = tileAt(tileX(t) + DIR_DX[d], tileY(t) + DIR_DY[d], tileLevel(t));
+    // Il lato sostituito da una rampa non porta più alla sua estremità: grafo simmetrico
+    for (uint8_t i = 0; i < _rampCount; i++) {
+        const Ramp& r = _ramps[i];
+        if ((n == r.bottom && d == mazeOpposite(r.dir)) || (n == r.top && d == r.dir)) return MAZE_NO_TILE;
+    }
+    return n;
+}
+
+MazeTile MazeMap::neighbor(MazeTile t, MazeDir d) const {
+    if (hasWall(t, d)) return MAZE_NO_TILE;
+    MazeTile n = adjacent(t, d);
+    if (n == MAZE_NO_TILE || isBlocked(n)) return MAZE_NO_TILE;
+    return n;
+}
+
+bool MazeMap::setWall(MazeTile t, MazeDir d, bool present) {
+    bool changed = hasWall(t, d) != present;
+    uint8_t wall = MAZE_WALL(d);
+    _walls[t] = (uint8_t)((present ? (_walls[t] | wall) : (_walls[t] & ~wall)) | MAZE_SEEN(d));
+
+    // Stesso muro visto dall'altra parte
+    MazeTile n = adjacent(t, d);
+    if (n != MAZE_NO_TILE) {
+        MazeDir o = mazeOpposite(d);
+        wall = MAZE_WALL(o);
+        _walls[n] = (uint8_t)((present ? (_walls[n] | wall) : (_walls[n] & ~wall)) | MAZE_SEEN(o));
+    }
+    return changed;
+}
+
+bool MazeMap::markFloor(MazeTile t, ColorType color) {
+    bool wasBlocked = isBlocked(t);
+    _flags[t] |= TILE_VISITED;
+    switch (color) {
+        case COLOR_BLACK:  _flags[t] |= TILE_BLACK; break;
+        case COLOR_SILVER: _flags[t] |= TILE_CHECKPOINT; break;
+        case COLOR_BLUE:   _flags[t] |= TILE_BLUE; break;
+        default: break;
+    }
+    return !wasBlocked && isBlocked(t);
+}
+
+bool MazeMap::addRamp(MazeTile bottom, MazeDir d, MazeTile top) {
+    if (_rampCount >= MAZE_MAX_RAMPS || bottom >= MAZE_TILES || top >= MAZE_TILES || d >= MAZE_DIRS) {
+        return false;
+    }
+    Ramp& r = _ramps[_rampCount++];
+    r.bottom = bottom;
+    r.top = top;
+    r.dir = d;
+    _flags[bottom] |= TILE_RAMP;
+    _flags[top] |= TILE_RAMP;
+    return true;
+}
+
+int8_t MazeMap::rampFromPitch(float pitchDeg) {
+    if (pitchDeg > MAZE_RAMP_PITCH_DEG) return 1;
+    if (pitchDeg < -MAZE_RAMP_PITCH_DEG) return -1;
+    return 0;
+}
+
+// ==========================================
+// PIANIFICATORE
+// ==========================================
+
+MazePlanner::MazePlanner(const MazeMap& map) : _map(map), _head(0), _count(0), _touched(0) {
+    clear();
+}
+
+void MazePlanner::clear() {
+    memset(_dist, 0xFF, sizeof(_dist));
+    memset(_goal, 0, sizeof(_goal));
+    memset(_invalid, 0, sizeof(_invalid));
+    memset(_queued, 0, sizeof(_queued));
+    _head = _count = 0;
+    _touched = 0;
+}
+
+void MazePlanner::push(MazeTile t) {
+    if (testBit(_queued, t)) return;
+    setBit(_queued, t);
+    _queue[(_head + _count) % MAZE_TILES] = t;
+    _count++;
+}
+
+void MazePlanner::relaxFrom(MazeTile from, MazeTile t) {
+    if (_dist[from] == UNREACHABLE) return;
+    uint16_t d = _dist[from] + 1;
+    if (d < _dist[t]) {
+        _dist[t] = d;
+        push(t);
+    }
+}
+
+void MazePlanner::propagate() {
+    // Coda FIFO con correzione delle etichette: una piastrella può rientrare
+    // se migliora ancora, il risultato finale è comunque quello della BFS
+    while (_count > 0) {
+        MazeTile u = _queue[_head];
+        _head = (_head + 1) % MAZE_TILES;
+        _count--;
+        clearBit(_queued, u);
+        _touched++;
+
+        for (uint8_t d = 0; d < MAZE_DIRS; d++) {
+            MazeTile v = link(u, (MazeDir)d);
+            if (v != MAZE_NO_TILE) relaxFrom(u, v);
+        }
+    }
+}
+
+void MazePlanner::recompute() {
+    _touched = 0;
+    memset(_dist, 0xFF, sizeof(_dist));
+    for (MazeTile t = 0; t < MAZE_TILES; t++) {
+        if (isGoal(t) && !_map.isBlocked(t)) {
+            _dist[t] = 0;
+            push(t);
+        }
+    }
+    propagate();
+}
+
+void MazePlanner::addGoal(MazeTile t) {
+    _touched = 0;
+    setBit(_goal, t);
+    if (_map.isBlocked(t) || _dist[t] == 0) return;
+    _dist[t] = 0;
+    push(t);
+    propagate();
+}
+
+void MazePlanner::removeGoal(MazeTile t) {
+    _touched = 0;
+    if (!isGoal(t)) return;
+    clearBit(_goal, t);
+    raise(&t, 1);
+}
+
+void MazePlanner::onWallChanged(MazeTile t, MazeDir d) {
+    _touched = 0;
+    MazeTile n = _map.adjacent(t, d);
+    if (n == MAZE_NO_TILE) return;
+
+    if (_map.hasWall(t, d)) {
+        MazeTile seeds[2] = {t, n};
+        raise(seeds, 2);
+    } else {
+        // Passaggio aperto: le distanze possono solo scendere
+        if (link(t, d) == MAZE_NO_TILE) return;
+        relaxFrom(t, n);
+        relaxFrom(n, t);
+        propagate();
+    }
+}
+
+void MazePlanner::onTileBlocked(MazeTile t) {
+    _touched = 0;
+    _dist[t] = UNREACHABLE;
+
+    // Le vicine possono aver perso il loro unico appoggio
+    MazeTile seeds[MAZE_DIRS];
+    uint8_t count = 0;
+    for (uint8_t d = 0; d < MAZE_DIRS; d++) {
+        if (_map.hasWall(t, (MazeDir)d)) continue;
+        MazeTile n = _map.adjacent(t, (MazeDir)d);
+        if (n != MAZE_NO_TILE) seeds[count++] = n;
+    }
+    raise(seeds, count);
+}
+
+bool MazePlanner::hasSupport(MazeTile t) const {
+    if (isGoal(t) && !_map.isBlocked(t)) return true;
+    for (uint8_t d = 0; d < MAZE_DIRS; d++) {
+        MazeTile v = link(t, (MazeDir)d);
+        if (v != MAZE_NO_TILE && !testBit(_invalid, v) && _dist[v] != UNREACHABLE && _dist[v] + 1 == _dist[t]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MazePlanner::raise(const MazeTile* seeds, uint8_t count) {
+    // 1) Invalida: piastrelle rimaste senza un vicino valido a distanza d-1.
+    //    Le distanze vecchie restano leggibili finché la fase non è chiusa.
+    uint16_t raised = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        MazeTile s = seeds[i];
+        if (testBit(_invalid, s) || _dist[s] == UNREACHABLE || hasSupport(s)) continue;
+        setBit(_invalid, s);
+        _raised[raised++] = s;
+    }
+    for (uint16_t i = 0; i < raised; i++) {
+        MazeTile u = _raised[i];
+        _touched++;
+        for (uint8_t d = 0; d < MAZE_DIRS; d++) {
+            MazeTile w = link(u, (MazeDir)d);
+            if (w == MAZE_NO_TILE || testBit(_invalid, w)) continue;
+            if (_dist[w] != _dist[u] + 1 || hasSupport(w)) continue;
+            setBit(_invalid, w);
+            _raised[raised++] = w;
+        }
+    }
+
+    // 2) Ripara: si riparte dal bordo valido della regione invalidata
+    for (uint16_t i = 0; i < raised; i++) {
+        _dist[_raised[i]] = UNREACHABLE;
+        clearBit(_invalid, _raised[i]);
+    }
+    for (uint16_t i = 0; i < raised; i++) {
+        MazeTile u = _raised[i];
+        for (uint8_t d = 0; d < MAZE_DIRS; d++) {
+            MazeTile v = link(u, (MazeDir)d);
+            if (v != MAZE_NO_TILE) relaxFrom(v, u);
+        }
+    }
+    propagate();
+}
+
+MazeDir MazePlanner::nextStep(MazeTile t) const {
+    if (_dist[t] == 0 || _dist[t] == UNREACHABLE) return MAZE_DIRS;
+    for (uint8_t d = 0; d < MAZE_DIRS; d++) {
+        MazeTile n = link(t, (MazeDir)d);
+        if (n != MAZE_NO_TILE && _dist[n] + 1 == _dist[t]) return (MazeDir)d;
+    }
+    return MAZE_DIRS;
+}
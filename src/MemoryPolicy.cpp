@@ -0,0 +1,77 @@
+#include "MemoryPolicy.h"
+
+#include <stdlib.h>
+
+#include "AllocAudit.h"
+#include "Constants.h"
+#include "Hal.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#include <esp_memory_utils.h>
+
+static uint32_t capsFor(MemoryRegion region) {
+    return region == MEM_BULK ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+                              : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void* memAlloc(size_t bytes, MemoryRegion region) {
+    allocAudit().onAlloc(bytes, (uintptr_t)__builtin_return_address(0));
+    void* p = heap_caps_malloc(bytes, capsFor(region));
+    if (p || region != MEM_BULK) return p;
+
+    // Senza PSRAM (o piena): in SRAM interna solo buffer piccoli, il chiamante
+    // può riprovare con meno (FlightRecorder dimezza fino a RECORDER_MIN_BYTES)
+    if (bytes > MEM_BULK_SRAM_MAX_BYTES) {
+        halLog("[MEM] PSRAM: %u byte non disponibili, niente ripiego in SRAM oltre %u\n", (unsigned)bytes,
+               (unsigned)MEM_BULK_SRAM_MAX_BYTES);
+        return nullptr;
+    }
+    p = heap_caps_malloc(bytes, capsFor(MEM_HOT));
+    halLog("[MEM] PSRAM: %u byte %s\n", (unsigned)bytes, p ? "ripiegati in SRAM interna" : "non disponibili nemmeno in SRAM");
+    return p;
+}
+
+void memFree(void* ptr) {
+    if (ptr) allocAudit().onFree();
+    heap_caps_free(ptr);
+}
+
+bool memIsExternal(const void* ptr) {
+    return esp_ptr_external_ram(ptr);
+}
+
+size_t memFreeBytes(MemoryRegion region) {
+    return heap_caps_get_free_size(capsFor(region));
+}
+
+size_t memLargestFreeBlock(MemoryRegion region) {
+    return heap_caps_get_largest_free_block(capsFor(region));
+}
+#else
+void* memAlloc(size_t bytes, MemoryRegion) {
+    allocAudit().onAlloc(bytes, (uintptr_t)__builtin_return_address(0));
+    return malloc(bytes);
+}
+
+void memFree(void* ptr) {
+    if (ptr) allocAudit().onFree();
+    free(ptr);
+}
+
+bool memIsExternal(const void*) {
+    return false;
+}
+
+size_t memFreeBytes(MemoryRegion) {
+    return 0;
+}
+
+size_t memLargestFreeBlock(MemoryRegion) {
+    return 0;
+}
+#endif
+
+const char* memRegionName(MemoryRegion region) {
+    return region == MEM_BULK ? "PSRAM" : "SRAM";
+}
@@ -1,56 +1,309 @@
 #include "MotorController.h"
-/*
-const int M1EN = 5;
-const int M1DIR = 6;
-const int M1PWM = 7;
-
-const int M2EN = 15;
-const int M2DIR = 16;
-const int M2PWM = 17;
-*/
-/*
-    // Configurazione Pin
-    pinMode(M1EN, OUTPUT);
-    pinMode(M1DIR, OUTPUT);
-    pinMode(M1PWM, OUTPUT);
-
-    pinMode(M2EN, OUTPUT);
-    pinMode(M2DIR, OUTPUT);
-    pinMode(M2PWM, OUTPUT);
-
-    // ATTIVAZIONE DRIVER
-    digitalWrite(M1EN, HIGH);
-    digitalWrite(M2EN, HIGH);
-
-    Serial.println("Driver Abilitati. Inizio movimento tra 2 secondi...");
-    delay(2000);
-    */
-/*
-    // TEST MOTORE 1 (Sinistro)
-    // Serial.println("M1 Avanti...");
-    // digitalWrite(M1DIR, HIGH);
-    // analogWrite(M1PWM, 150); // Velocità media
-    // delay(2000);
-    //
-    // Serial.println("M1 Indietro...");
-    // digitalWrite(M1DIR, LOW);
-    // analogWrite(M1PWM, 150);
-    // delay(2000);
-    //
-    // analogWrite(M1PWM, 0); // Stop M1
-    // delay(500);
-    //
-    // // TEST MOTORE 2 (Destro)
-    // Serial.println("M2 Avanti...");
-    // digitalWrite(M2DIR, HIGH);
-    // analogWrite(M2PWM, 150);
-    // delay(2000);
-    //
-    // Serial.println("M2 Indietro...");
-    // digitalWrite(M2DIR, LOW);
-    // analogWrite(M2PWM, 150);
-    // delay(2000);
-    //
-    // analogWrite(M2PWM, 0); // Stop M2
-    // Serial.println("Giro completato. Pausa...")
- */
\ No newline at end of file
+
+#include <driver/adc.h>
+
+// Byte per conversione nel formato TYPE2 dell'S3
+#define MOTOR_ADC_RESULT_BYTES 4
+// Letture one-shot per blocco dei canali su ADC2 (fase casuale rispetto al PWM)
+#define MOTOR_ADC2_SAMPLES 4
+
+MotorController::MotorController()
+    : _task(nullptr), _diagPending(false), _preempted(false), _frames(0), _started(false) {
+    const uint8_t pwm[MOTOR_COUNT] = {PIN_M1PWM, PIN_M2PWM};
+    const uint8_t dir[MOTOR_COUNT] = {PIN_M1DIR, PIN_M2DIR};
+    const uint8_t en[MOTOR_COUNT] = {PIN_M1EN, PIN_M2EN};
+    const int8_t enb[MOTOR_COUNT] = {PIN_M1ENB, PIN_M2ENB};
+    const uint8_t cs[MOTOR_COUNT] = {PIN_M1CS, PIN_M2CS};
+    const uint8_t ledc[MOTOR_COUNT] = {MOTOR_PWM_CHANNEL_M1, MOTOR_PWM_CHANNEL_M2};
+    const bool flip[MOTOR_COUNT] = {MOTOR_M1_FLIP != 0, MOTOR_M2_FLIP != 0};
+
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) {
+        Channel& c = _ch[i];
+        c.pwmPin = pwm[i];
+        c.dirPin = dir[i];
+        c.enPin = en[i];
+        c.enbPin = enb[i];
+        c.csPin = cs[i];
+        c.ledcChannel = ledc[i];
+        c.flip = flip[i];
+        c.adcChannel = -1;
+        c.onAdc1 = false;
+        c.command.store(0);
+        c.preemptCommand.store(0);
+        c.tripped.store(false);
+        c.currentMa.store(0.0f);
+        c.flags.store(0);
+        c.clearRequest.store(false);
+        c.rawSum = 0;
+        c.rawCount = 0;
+    }
+}
+
+// ============================================================================
+// Avvio
+// ============================================================================
+
+bool MotorController::begin() {
+    if (_started) return true;
+
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) {
+        Channel& c = _ch[i];
+        pinMode(c.dirPin, OUTPUT);
+        pinMode(c.enPin, OUTPUT);
+        digitalWrite(c.enPin, LOW);
+        if (c.enbPin >= 0) {
+            pinMode(c.enbPin, OUTPUT);
+            digitalWrite(c.enbPin, LOW);
+        }
+        ledcSetup(c.ledcChannel, MOTOR_PWM_FREQ_HZ, MOTOR_PWM_BITS);
+        ledcAttachPin(c.pwmPin, c.ledcChannel);
+
+        // Arduino numera i canali ADC2 dopo quelli di ADC1
+        int8_t adc = digitalPinToAnalogChannel(c.csPin);
+        if (adc < 0) {
+            log_e("Motore %u: GPIO %u non analogico", i + 1, c.csPin);
+            return false;
+        }
+        c.onAdc1 = adc < SOC_ADC_MAX_CHANNEL_NUM;
+        c.adcChannel = c.onAdc1 ? adc : adc - SOC_ADC_MAX_CHANNEL_NUM;
+        if (!c.onAdc1) adc2_config_channel_atten((adc2_channel_t)c.adcChannel, ADC_ATTEN_DB_11);
+
+        applyOutput(c, 0);
+    }
+
+    if (!startAdc()) return false;
+
+    pinMode(PIN_MOTOR_DIAG, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(PIN_MOTOR_DIAG), onDiag, this, FALLING);
+    // Guasto già presente all'avvio: nessun fronte da vedere
+    if (digitalRead(PIN_MOTOR_DIAG) == LOW) _diagPending.store(true);
+
+    if (xTaskCreatePinnedToCore(taskEntry, "motor", MOTOR_TASK_STACK, this, MOTOR_TASK_PRIORITY, &_task,
+                                MOTOR_TASK_CORE) != pdPASS) {
+        detachInterrupt(digitalPinToInterrupt(PIN_MOTOR_DIAG));
+        adc_digi_stop();
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    _started = true;
+    return true;
+}
+
+bool MotorController::startAdc() {
+    uint32_t adc1Mask = 0;
+    adc_digi_pattern_config_t pattern[MOTOR_COUNT] = {};
+    uint8_t patterns = 0;
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) {
+        if (!_ch[i].onAdc1) continue;
+        adc1Mask |= 1u << _ch[i].adcChannel;
+        pattern[patterns].atten = ADC_ATTEN_DB_11;
+        pattern[patterns].channel = _ch[i].adcChannel;
+        pattern[patterns].unit = 0;  // ADC1
+        pattern[patterns].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        patterns++;
+    }
+    // Nessun canale su ADC1: il task legge solo in one-shot
+    if (patterns == 0) return true;
+
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = MOTOR_ADC_BUFFER_BYTES;
+    init.conv_num_each_intr = MOTOR_ADC_FRAME_BYTES;
+    init.adc1_chan_mask = adc1Mask;
+    init.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init) != ESP_OK) {
+        log_e("ADC continuo non inizializzato");
+        return false;
+    }
+
+    adc_digi_configuration_t cfg = {};
+    cfg.conv_limit_en = false;
+    cfg.conv_limit_num = 250;
+    cfg.pattern_num = patterns;
+    cfg.adc_pattern = pattern;
+    cfg.sample_freq_hz = MOTOR_ADC_SAMPLE_HZ;
+    cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_digi_controller_configure(&cfg) != ESP_OK || adc_digi_start() != ESP_OK) {
+        log_e("ADC continuo non avviato");
+        adc_digi_deinitialize();
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Comandi
+// ============================================================================
+
+void MotorController::applyOutput(Channel& c, int16_t speed) {
+    bool reverse = (speed < 0) != c.flip;
+    uint32_t mag = (uint32_t)abs(speed);
+    uint32_t duty = mag * ((1u << MOTOR_PWM_BITS) - 1) / MOTOR_SPEED_MAX;
+
+    digitalWrite(c.dirPin, reverse ? LOW : HIGH);
+    ledcWrite(c.ledcChannel, duty);
+    digitalWrite(c.enPin, HIGH);
+    // Guasto arrivato durante la scrittura: l'ultimo a scrivere EN è trip()
+    if (c.tripped.load()) digitalWrite(c.enPin, LOW);
+}
+
+void MotorController::setSpeed(Motor motor, int16_t speed) {
+    if (motor >= MOTOR_COUNT) return;
+    if (speed > MOTOR_SPEED_MAX) speed = MOTOR_SPEED_MAX;
+    if (speed < -MOTOR_SPEED_MAX) speed = -MOTOR_SPEED_MAX;
+
+    Channel& c = _ch[motor];
+    if (c.tripped.load() || _preempted.load()) return;
+    c.command.store(speed, std::memory_order_relaxed);
+    applyOutput(c, speed);
+    // Riflesso arrivato durante la scrittura: l'ultimo comando è il suo
+    if (_preempted.load()) applyPreempt(c);
+}
+
+void MotorController::applyPreempt(Channel& c) {
+    if (c.tripped.load()) return;
+    int16_t speed = c.preemptCommand.load();
+    c.command.store(speed, std::memory_order_relaxed);
+    applyOutput(c, speed);
+}
+
+void MotorController::preempt(int16_t left, int16_t right) {
+    const int16_t cmd[MOTOR_COUNT] = {left, right};
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) {
+        int16_t speed = cmd[i];
+        if (speed > MOTOR_SPEED_MAX) speed = MOTOR_SPEED_MAX;
+        if (speed < -MOTOR_SPEED_MAX) speed = -MOTOR_SPEED_MAX;
+        _ch[i].preemptCommand.store(speed);
+    }
+    _preempted.store(true);
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) applyPreempt(_ch[i]);
+}
+
+void MotorController::releasePreempt() {
+    // Frenati: il controllo riparte dal prossimo ciclo
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) _ch[i].preemptCommand.store(0);
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) applyPreempt(_ch[i]);
+    _preempted.store(false);
+}
+
+void MotorController::setSpeeds(int16_t m1, int16_t m2) {
+    setSpeed(MOTOR_1, m1);
+    setSpeed(MOTOR_2, m2);
+}
+
+void MotorController::coast() {
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) {
+        _ch[i].command.store(0, std::memory_order_relaxed);
+        ledcWrite(_ch[i].ledcChannel, 0);
+        digitalWrite(_ch[i].enPin, LOW);
+    }
+}
+
+void MotorController::trip(Channel& c, uint8_t flags) {
+    c.tripped.store(true);
+    digitalWrite(c.enPin, LOW);
+    ledcWrite(c.ledcChannel, 0);
+    c.command.store(0, std::memory_order_relaxed);
+    c.flags.fetch_or(flags, std::memory_order_release);
+}
+
+bool MotorController::clearFaults() {
+    if (isDriverFault()) return false;
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) {
+        Channel& c = _ch[i];
+        // Il monitor è del task: lo azzera al prossimo blocco
+        c.clearRequest.store(true);
+        c.flags.store(0, std::memory_order_release);
+        c.tripped.store(false);
+        applyOutput(c, 0);
+    }
+    return true;
+}
+
+// ============================================================================
+// Task di lettura e interrupt DIAG
+// ============================================================================
+
+void IRAM_ATTR MotorController::onDiag(void* arg) {
+    static_cast<MotorController*>(arg)->_diagPending.store(true);
+}
+
+void MotorController::taskEntry(void* arg) {
+    static_cast<MotorController*>(arg)->run();
+}
+
+void MotorController::sampleAdc2(Channel& c) {
+    for (uint8_t n = 0; n < MOTOR_ADC2_SAMPLES; n++) {
+        int raw = 0;
+        // Timeout se l'ADC2 è occupato (Wi-Fi): il campione si perde
+        if (adc2_get_raw((adc2_channel_t)c.adcChannel, ADC_WIDTH_BIT_12, &raw) != ESP_OK) continue;
+        c.rawSum += (uint32_t)raw;
+        c.rawCount++;
+    }
+}
+
+void MotorController::processFrame(const uint8_t* data, uint32_t len, uint32_t nowUs) {
+    for (uint32_t i = 0; i + MOTOR_ADC_RESULT_BYTES <= len; i += MOTOR_ADC_RESULT_BYTES) {
+        const adc_digi_output_data_t* p = reinterpret_cast<const adc_digi_output_data_t*>(data + i);
+        if (p->type2.unit != 0) continue;
+        for (uint8_t m = 0; m < MOTOR_COUNT; m++) {
+            Channel& c = _ch[m];
+            if (c.onAdc1 && p->type2.channel == (uint32_t)c.adcChannel) {
+                c.rawSum += p->type2.data;
+                c.rawCount++;
+                break;
+            }
+        }
+    }
+
+    bool diag = _diagPending.exchange(false);
+    for (uint8_t m = 0; m < MOTOR_COUNT; m++) {
+        Channel& c = _ch[m];
+        if (c.clearRequest.exchange(false)) c.monitor.clear();
+        if (!c.onAdc1) sampleAdc2(c);
+
+        uint8_t raised = diag ? MOTOR_FLAG_DRIVER : 0;
+        if (c.rawCount > 0) {
+            float ma = MotorMonitor::rawToMilliamps((float)c.rawSum / c.rawCount);
+            raised |= c.monitor.update(ma, c.command.load(std::memory_order_relaxed), nowUs);
+            c.currentMa.store(c.monitor.currentMa(), std::memory_order_relaxed);
+        }
+        c.rawSum = 0;
+        c.rawCount = 0;
+
+        if (raised) trip(c, raised);
+    }
+    _frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MotorController::run() {
+    uint8_t buf[MOTOR_ADC_FRAME_BYTES];
+    // Attesa massima di un blocco: anche senza DMA (solo ADC2) il task avanza a questo passo
+    const TickType_t frameTicks = pdMS_TO_TICKS(2);
+    bool dma = _ch[MOTOR_1].onAdc1 || _ch[MOTOR_2].onAdc1;
+
+    for (;;) {
+        uint32_t len = 0;
+        if (dma) {
+            esp_err_t err = adc_digi_read_bytes(buf, sizeof(buf), &len, frameTicks);
+            // Buffer DMA pieno: i dati sono validi, il task è solo in ritardo
+            if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) len = 0;
+        } else {
+            vTaskDelay(frameTicks);
+        }
+        processFrame(buf, len, (uint32_t)micros());
+    }
+}
+
+void MotorController::printStatus() const {
+    Serial.printf("\n--- MOTORI (%lu blocchi ADC) DIAG: %s%s ---\n", (unsigned long)_frames.load(),
+                  isDriverFault() ? "GUASTO" : "ok", isPreempted() ? " | COMANDATI DAL RIFLESSO" : "");
+    Serial.println("Motore | Comando | Corrente mA | Stallo | Sovracorr. | Driver");
+    for (uint8_t i = 0; i < MOTOR_COUNT; i++) {
+        uint8_t f = getFlags((Motor)i);
+        Serial.printf("  M%u   | %7d | %11.0f | %6s | %10s | %6s\n", i + 1, getSpeed((Motor)i),
+                      getCurrentMa((Motor)i), (f & MOTOR_FLAG_STALL) ? "SI" : "-",
+                      (f & MOTOR_FLAG_OVERCURRENT) ? "SI" : "-", (f & MOTOR_FLAG_DRIVER) ? "SI" : "-");
+    }
+}
@@ -0,0 +1,85 @@
+#include "MotorMonitor.h"
+
+#include <stdlib.h>
+
+MotorMonitor::MotorMonitor() {
+    reset();
+}
+
+void MotorMonitor::reset() {
+    _filteredMa = 0.0f;
+    _primed = false;
+    _lastCommand = 0;
+    _blankUntilUs = 0;
+    _overSinceUs = 0;
+    _stallSinceUs = 0;
+    _over = false;
+    _stall = false;
+    _flags = 0;
+}
+
+void MotorMonitor::clear() {
+    _flags = 0;
+    _over = false;
+    _stall = false;
+}
+
+float MotorMonitor::rawToMilliamps(float raw) {
+    float mv = raw * MOTOR_ADC_FULL_SCALE_MV / MOTOR_ADC_MAX_RAW;
+    return mv * 1000.0f / MOTOR_CS_MV_PER_A;
+}
+
+float MotorMonitor::stallThresholdMa(int16_t command) {
+    int mag = abs(command);
+    if (mag < MOTOR_STALL_MIN_CMD) return 0.0f;
+    // A rotore bloccato la corrente segue il duty (nessuna forza controelettromotrice)
+    float limit = MOTOR_STALL_CURRENT_MA * MOTOR_STALL_FRACTION * mag / MOTOR_SPEED_MAX;
+    return limit < MOTOR_STALL_MIN_MA ? MOTOR_STALL_MIN_MA : limit;
+}
+
+uint8_t MotorMonitor::update(float blockMa, int16_t command, uint32_t nowUs) {
+    if (!_primed) {
+        _filteredMa = blockMa;
+        _primed = true;
+    } else {
+        _filteredMa += MOTOR_CURRENT_ALPHA * (blockMa - _filteredMa);
+    }
+
+    // Partenza, inversione o gradino: nuovo periodo di mascheramento dello
+    // stallo. Le piccole variazioni del PID non lo rinnovano, altrimenti con
+    // il comando che cambia a ogni ciclo lo stallo non si valuterebbe mai.
+    int mag = abs(command), lastMag = abs(_lastCommand);
+    bool start = mag >= MOTOR_STALL_MIN_CMD && lastMag < MOTOR_STALL_MIN_CMD;
+    bool reversal = (command ^ _lastCommand) < 0;
+    if (start || reversal || mag - lastMag > MOTOR_STALL_BLANK_STEP) {
+        _blankUntilUs = nowUs + MOTOR_STALL_BLANK_US;
+    }
+    _lastCommand = command;
+
+    uint8_t before = _flags;
+
+    // Sovracorrente sulla media del blocco: il filtro costerebbe qualche blocco di ritardo
+    if (blockMa > MOTOR_OVERCURRENT_MA) {
+        if (!_over) {
+            _over = true;
+            _overSinceUs = nowUs;
+        }
+        if (nowUs - _overSinceUs >= MOTOR_OVERCURRENT_US) _flags |= MOTOR_FLAG_OVERCURRENT;
+    } else {
+        _over = false;
+    }
+
+    float stallMa = stallThresholdMa(command);
+    bool blanked = (int32_t)(nowUs - _blankUntilUs) < 0;
+    if (stallMa > 0.0f && !blanked && _filteredMa > stallMa) {
+        if (!_stall) {
+            _stall = true;
+            _stallSinceUs = nowUs;
+        }
+        if (nowUs - _stallSinceUs >= MOTOR_STALL_US) _flags |= MOTOR_FLAG_STALL;
+    } else {
+        _stall = false;
+    }
+
+    return _flags & ~before;
+}
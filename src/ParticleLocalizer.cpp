@@ -0,0 +1,336 @@
+#include "ParticleLocalizer.h"
+
+#include "RobotLayout.h"
+
+#include <math.h>
+#include <string.h>
+
+static const float DEG_TO_RAD_F = 0.01745329f;
+static const float RAD_TO_DEG_F = 57.29578f;
+static const float TWO_PI_F = 6.2831853f;
+static const float FAR_F = 1e30f;
+
+static float wrapDeg(float deg) {
+    while (deg > 180.0f) deg -= 360.0f;
+    while (deg < -180.0f) deg += 360.0f;
+    return deg;
+}
+
+static int tileCoord(float mm) {
+    return (int)floorf(mm / MAZE_TILE_MM);
+}
+
+// Per particella: 10 float (stato, doppio buffer, scratch) e un indice
+static const size_t FLOAT_ARRAYS = 10;
+
+ParticleLocalizer::ParticleLocalizer(const MazeMap& map)
+    : _map(map), _block(nullptr), _count(0), _x(nullptr), _y(nullptr), _theta(nullptr), _w(nullptr),
+      _nx(nullptr), _ny(nullptr), _ntheta(nullptr), _expected(nullptr), _cos(nullptr), _sin(nullptr),
+      _index(nullptr), _level(0), _lastYawDeg(0.0f), _hasYaw(false), _rng(0x9E3779B9u), _neff(0.0f),
+      _resamples(0), _degenerate(0) {
+    memset(&_pose, 0, sizeof(_pose));
+    _pose.tile = MAZE_NO_TILE;
+}
+
+ParticleLocalizer::~ParticleLocalizer() {
+    if (_block) memFree(_block);
+}
+
+bool ParticleLocalizer::begin(uint16_t count, MemoryRegion region) {
+    if (_block) return true;
+    if (count == 0) return false;
+
+    _block = memAlloc((size_t)count * (FLOAT_ARRAYS * sizeof(float) + sizeof(uint16_t)), region);
+    if (!_block) return false;
+
+    float* f = (float*)_block;
+    float** arrays[FLOAT_ARRAYS] = {&_x, &_y, &_theta, &_w, &_nx, &_ny, &_ntheta, &_expected, &_cos, &_sin};
+    for (size_t i = 0; i < FLOAT_ARRAYS; i++) *arrays[i] = f + i * count;
+    _index = (uint16_t*)(f + FLOAT_ARRAYS * count);
+    _count = count;
+
+    reset(MazeMap::startTile(), 0.0f, 0.0f);
+    return true;
+}
+
+// ==========================================
+// NUMERI CASUALI
+// ==========================================
+
+float ParticleLocalizer::uniform() {
+    // xorshift32: abbastanza per il rumore di moto, nessuno stato condiviso
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return (_rng >> 8) * (1.0f / 16777216.0f);
+}
+
+float ParticleLocalizer::gaussian() {
+    // Somma di 4 uniformi (Irwin-Hall): varianza 1/3, riportata a 1
+    float s = uniform() + uniform() + uniform() + uniform() - 2.0f;
+    return s * 1.7320508f;
+}
+
+// ==========================================
+// INIZIALIZZAZIONE
+// ==========================================
+
+void ParticleLocalizer::reset(MazeTile tile, float yawDeg, float spreadMm) {
+    if (tile == MAZE_NO_TILE) return;
+    resetPose((MazeMap::tileX(tile) + 0.5f) * MAZE_TILE_MM, (MazeMap::tileY(tile) + 0.5f) * MAZE_TILE_MM,
+              (uint8_t)MazeMap::tileLevel(tile), yawDeg, spreadMm);
+}
+
+void ParticleLocalizer::resetPose(float xMm, float yMm, uint8_t level, float yawDeg, float spreadMm) {
+    if (!_block) return;
+    _level = level;
+    _lastYawDeg = yawDeg;
+    _hasYaw = true;
+
+    const float theta = yawDeg * DEG_TO_RAD_F;
+    const float w = 1.0f / _count;
+    for (uint16_t i = 0; i < _count; i++) {
+        _x[i] = xMm + spreadMm * gaussian();
+        _y[i] = yMm + spreadMm * gaussian();
+        _theta[i] = theta;
+        _w[i] = w;
+    }
+    _neff = _count;
+    computeEstimate();
+}
+
+// ==========================================
+// MOTO
+// ==========================================
+
+float ParticleLocalizer::commandToMm(int16_t left, int16_t right, uint32_t dtUs) {
+    float speed = 0.5f * (left + right) / MOTOR_SPEED_MAX * LOCALIZER_MM_PER_S_AT_MAX;
+    return speed * dtUs * 1e-6f;
+}
+
+bool ParticleLocalizer::crossesWall(float x0, float y0, float x1, float y1) const {
+    int tx0 = tileCoord(x0), ty0 = tileCoord(y0);
+    int tx1 = tileCoord(x1), ty1 = tileCoord(y1);
+    if (tx0 == tx1 && ty0 == ty1) return false;
+
+    MazeTile from = MazeMap::tileAt(tx0, ty0, _level);
+    if (from == MAZE_NO_TILE || MazeMap::tileAt(tx1, ty1, _level) == MAZE_NO_TILE) return true;
+    int dx = tx1 - tx0, dy = ty1 - ty0;
+    if (dx < -1 || dx > 1 || dy < -1 || dy > 1) return true;  // Salto implausibile in un passo
+
+    MazeDir dirX = dx > 0 ? MAZE_EAST : MAZE_WEST;
+    MazeDir dirY = dy > 0 ? MAZE_SOUTH : MAZE_NORTH;
+    if (dy == 0) return _map.hasWall(from, dirX);
+    if (dx == 0) return _map.hasWall(from, dirY);
+
+    // Passaggio dallo spigolo: basta uno dei due percorsi a L
+    MazeTile viaX = MazeMap::tileAt(tx1, ty0, _level);
+    MazeTile viaY = MazeMap::tileAt(tx0, ty1, _level);
+    bool openX = !_map.hasWall(from, dirX) && !_map.hasWall(viaX, dirY);
+    bool openY = !_map.hasWall(from, dirY) && !_map.hasWall(viaY, dirX);
+    return !openX && !openY;
+}
+
+void ParticleLocalizer::predict(float forwardMm, float yawDeg) {
+    if (!_block) return;
+    float dYaw = _hasYaw ? wrapDeg(yawDeg - _lastYawDeg) : 0.0f;
+    _lastYawDeg = yawDeg;
+    _hasYaw = true;
+
+    const float dTheta = dYaw * DEG_TO_RAD_F;
+    const float yawSigma = LOCALIZER_YAW_NOISE_DEG * DEG_TO_RAD_F;
+    const float stepSigma = LOCALIZER_MOTION_NOISE * fabsf(forwardMm);
+    for (uint16_t i = 0; i < _count; i++) {
+        float theta = _theta[i] + dTheta + yawSigma * gaussian();
+        float step = forwardMm + stepSigma * gaussian();
+        // Avanti = (-sin, -cos) con y verso sud e theta antiorario da nord
+        float x = _x[i] - step * sinf(theta) + LOCALIZER_POS_NOISE_MM * gaussian();
+        float y = _y[i] - step * cosf(theta) + LOCALIZER_POS_NOISE_MM * gaussian();
+        if (crossesWall(_x[i], _y[i], x, y)) _w[i] = 0.0f;
+        _x[i] = x;
+        _y[i] = y;
+        _theta[i] = theta;
+    }
+    computeEstimate();
+}
+
+// ==========================================
+// MISURA
+// ==========================================
+
+float ParticleLocalizer::raycast(float xMm, float yMm, float dx, float dy) const {
+    int tx = tileCoord(xMm), ty = tileCoord(yMm);
+    MazeTile t = MazeMap::tileAt(tx, ty, _level);
+    if (t == MAZE_NO_TILE) return 0.0f;
+
+    // DDA: distanza lungo il raggio al prossimo bordo verticale (x) e orizzontale (y)
+    const int stepX = dx > 0.0f ? 1 : -1;
+    const int stepY = dy > 0.0f ? 1 : -1;
+    const MazeDir sideX = stepX > 0 ? MAZE_EAST : MAZE_WEST;
+    const MazeDir sideY = stepY > 0 ? MAZE_SOUTH : MAZE_NORTH;
+    const float adx = fabsf(dx), ady = fabsf(dy);
+    const float deltaX = adx > 0.0f ? MAZE_TILE_MM / adx : FAR_F;
+    const float deltaY = ady > 0.0f ? MAZE_TILE_MM / ady : FAR_F;
+    float nextX = adx > 0.0f ? ((stepX > 0 ? (tx + 1) * MAZE_TILE_MM - xMm : xMm - tx * MAZE_TILE_MM) / adx) : FAR_F;
+    float nextY = ady > 0.0f ? ((stepY > 0 ? (ty + 1) * MAZE_TILE_MM - yMm : yMm - ty * MAZE_TILE_MM) / ady) : FAR_F;
+
+    while (true) {
+        float d;
+        MazeDir side;
+        if (nextX < nextY) {
+            d = nextX;
+            side = sideX;
+        } else {
+            d = nextY;
+            side = sideY;
+        }
+        if (d >= LOCALIZER_MAX_RANGE_MM) return LOCALIZER_MAX_RANGE_MM;
+        if (_map.hasWall(t, side)) return d;
+
+        if (side == sideX) {
+            tx += stepX;
+            nextX += deltaX;
+        } else {
+            ty += stepY;
+            nextY += deltaY;
+        }
+        t = MazeMap::tileAt(tx, ty, _level);
+        if (t == MAZE_NO_TILE) return d;  // Bordo della griglia
+    }
+}
+
+float ParticleLocalizer::expectedReading(float xMm, float yMm, float yawDeg, uint8_t sensor) const {
+    for (uint8_t k = 0; k < RobotLayout::TOF_N; k++) {
+        const ToFMountSpec& m = RobotLayout::TOF[k];
+        if (m.position != sensor) continue;
+
+        const float theta = yawDeg * DEG_TO_RAD_F;
+        const float c = cosf(theta), s = sinf(theta);
+        const float ca = cosf(m.angleDeg * DEG_TO_RAD_F), sa = sinf(m.angleDeg * DEG_TO_RAD_F);
+        // Avanti = (-s, -c), sinistra = (-c, s)
+        float ox = xMm - m.forwardMm * s - m.leftMm * c;
+        float oy = yMm - m.forwardMm * c + m.leftMm * s;
+        return raycast(ox, oy, -ca * s - sa * c, -ca * c + sa * s);
+    }
+    return LOCALIZER_MAX_RANGE_MM;  // Non montato su questo telaio
+}
+
+bool ParticleLocalizer::update(const ToFData& tof) {
+    if (!_block) return false;
+
+    for (uint16_t i = 0; i < _count; i++) {
+        _cos[i] = cosf(_theta[i]);
+        _sin[i] = sinf(_theta[i]);
+    }
+
+    const float k = 1.0f / (2.0f * LOCALIZER_RANGE_SIGMA_MM * LOCALIZER_RANGE_SIGMA_MM);
+    uint8_t used = 0;
+    // Solo i ToF montati sul telaio (RobotLayout.h)
+    for (uint8_t n = 0; n < RobotLayout::TOF_N; n++) {
+        const ToFMountSpec& m = RobotLayout::TOF[n];
+        const uint8_t sensor = m.position;
+        if (tof.distance_mm[sensor] < 0) continue;  // Spento
+        // Nessun oggetto, lettura non valida o oltre la portata: tutte "lontano"
+        float z = LOCALIZER_MAX_RANGE_MM;
+        if (tof.valid[sensor] && tof.distance_mm[sensor] < LOCALIZER_MAX_RANGE_MM) z = tof.distance_mm[sensor];
+
+        // Raycast (con salti) in un array, poi il peso con un ciclo lineare
+        const float ca = cosf(m.angleDeg * DEG_TO_RAD_F), sa = sinf(m.angleDeg * DEG_TO_RAD_F);
+        for (uint16_t i = 0; i < _count; i++) {
+            const float c = _cos[i], s = _sin[i];
+            float ox = _x[i] - m.forwardMm * s - m.leftMm * c;
+            float oy = _y[i] - m.forwardMm * c + m.leftMm * s;
+            _expected[i] = raycast(ox, oy, -ca * s - sa * c, -ca * c + sa * s);
+        }
+        for (uint16_t i = 0; i < _count; i++) {
+            float e = z - _expected[i];
+            _w[i] *= expf(-e * e * k) + LOCALIZER_OUTLIER_WEIGHT;
+        }
+        used++;
+    }
+    if (used == 0) return false;
+
+    float sum = 0.0f;
+    for (uint16_t i = 0; i < _count; i++) sum += _w[i];
+    if (sum <= 0.0f) {
+        // Nessuna particella compatibile (mappa sbagliata o robot spostato a mano)
+        _degenerate++;
+        sum = (float)_count;
+        for (uint16_t i = 0; i < _count; i++) _w[i] = 1.0f;
+    }
+    const float inv = 1.0f / sum;
+    float sq = 0.0f;
+    for (uint16_t i = 0; i < _count; i++) {
+        _w[i] *= inv;
+        sq += _w[i] * _w[i];
+    }
+    _neff = 1.0f / sq;
+
+    computeEstimate();
+    if (_neff < LOCALIZER_RESAMPLE_NEFF * _count) resample();
+    return true;
+}
+
+// ==========================================
+// RICAMPIONAMENTO E STIMA
+// ==========================================
+
+void ParticleLocalizer::systematicResample(const float* w, uint16_t n, float u0, uint16_t* out) {
+    const float step = 1.0f / n;
+    float target = u0 * step;
+    float cumulative = w[0];
+    uint16_t i = 0;
+    for (uint16_t j = 0; j < n; j++) {
+        while (target > cumulative && i < n - 1) cumulative += w[++i];
+        out[j] = i;
+        target += step;
+    }
+}
+
+void ParticleLocalizer::resample() {
+    systematicResample(_w, _count, uniform(), _index);
+
+    const float w = 1.0f / _count;
+    for (uint16_t j = 0; j < _count; j++) {
+        uint16_t i = _index[j];
+        _nx[j] = _x[i];
+        _ny[j] = _y[i];
+        _ntheta[j] = _theta[i];
+        _w[j] = w;
+    }
+    float* t;
+    t = _x; _x = _nx; _nx = t;
+    t = _y; _y = _ny; _ny = t;
+    t = _theta; _theta = _ntheta; _ntheta = t;
+
+    _neff = _count;
+    _resamples++;
+}
+
+void ParticleLocalizer::computeEstimate() {
+    // Direzioni vicine tra loro: media degli scarti dalla prima, riportati in ±pi (niente trigonometria)
+    const float ref = _theta[0];
+    float sw = 0.0f, sx = 0.0f, sy = 0.0f, st = 0.0f;
+    for (uint16_t i = 0; i < _count; i++) {
+        float d = _theta[i] - ref;
+        d -= TWO_PI_F * floorf(d / TWO_PI_F + 0.5f);
+        sw += _w[i];
+        sx += _w[i] * _x[i];
+        sy += _w[i] * _y[i];
+        st += _w[i] * d;
+    }
+    if (sw <= 0.0f) return;  // Tutte morte: resta la stima precedente
+
+    const float mx = sx / sw, my = sy / sw;
+    float var = 0.0f;
+    for (uint16_t i = 0; i < _count; i++) {
+        float dx = _x[i] - mx, dy = _y[i] - my;
+        var += _w[i] * (dx * dx + dy * dy);
+    }
+
+    _pose.xMm = mx;
+    _pose.yMm = my;
+    _pose.yawDeg = wrapDeg((ref + st / sw) * RAD_TO_DEG_F);
+    _pose.spreadMm = sqrtf(var / sw);
+    _pose.tile = MazeMap::tileAt(tileCoord(mx), tileCoord(my), _level);
+}
@@ -0,0 +1,227 @@
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Hal.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_timer.h>
+#include <rom/ets_sys.h>
+
+uint32_t ProfileTimer::traceMicros() {
+    return (uint32_t)esp_timer_get_time();
+}
+
+float Profiler::ticksPerUs() {
+    return (float)ets_get_cpu_frequency();
+}
+#else
+#include <chrono>
+
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+uint32_t profilerTicks() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch)
+        .count();
+}
+
+uint32_t ProfileTimer::traceMicros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_epoch)
+        .count();
+}
+
+float Profiler::ticksPerUs() {
+    return 1000.0f;
+}
+#endif
+
+static Profiler s_profiler;
+
+Profiler& profiler() {
+    return s_profiler;
+}
+
+Profiler::Profiler() : _scopeCount(0), _trace(nullptr), _traceCount(0), _tracing(false) {
+    for (uint8_t i = 0; i < PROFILER_CORES; i++) _active[i] = nullptr;
+    for (uint8_t i = 0; i < PROFILER_MAX_SCOPES; i++) {
+        _scopes[i].name = nullptr;
+        clearScope(_scopes[i]);
+    }
+}
+
+Profiler::~Profiler() {
+    if (_trace) memFree(_trace);
+}
+
+void Profiler::clearScope(Scope& s) {
+    s.count = 0;
+    s.minTicks = UINT32_MAX;
+    s.maxTicks = 0;
+    s.sumTicks = 0;
+    s.blockedTicks = 0;
+    s.blockedMaxTicks = 0;
+    memset(s.hist, 0, sizeof(s.hist));
+}
+
+uint8_t Profiler::registerScope(const char* name) {
+    for (uint8_t i = 0; i < _scopeCount; i++) {
+        if (strcmp(_scopes[i].name, name) == 0) return i;
+    }
+    if (_scopeCount >= PROFILER_MAX_SCOPES) return PROFILER_NO_SCOPE;
+    _scopes[_scopeCount].name = name;
+    return _scopeCount++;
+}
+
+// ============================================================================
+// Istogramma log-lineare
+// ============================================================================
+
+uint16_t Profiler::bucketOf(uint32_t ticks) {
+    if (ticks < PROFILER_HIST_SUB) return (uint16_t)ticks;
+    uint8_t octave = (uint8_t)(31 - __builtin_clz(ticks));
+    uint32_t sub = (ticks >> (octave - PROFILER_HIST_SUB_BITS)) & (PROFILER_HIST_SUB - 1);
+    return (uint16_t)((octave - PROFILER_HIST_SUB_BITS + 1) * PROFILER_HIST_SUB + sub);
+}
+
+uint32_t Profiler::bucketUpper(uint16_t bucket) {
+    if (bucket < PROFILER_HIST_SUB) return bucket;
+    uint8_t shift = (uint8_t)(bucket / PROFILER_HIST_SUB - 1);
+    uint64_t lower = (uint64_t)(PROFILER_HIST_SUB + bucket % PROFILER_HIST_SUB) << shift;
+    uint64_t upper = lower + ((uint64_t)1 << shift) - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : (uint32_t)upper;
+}
+
+// ============================================================================
+// Registrazione
+// ============================================================================
+
+ProfileTimer* Profiler::enter(ProfileTimer* timer, uint8_t core) {
+    if (core >= PROFILER_CORES) return nullptr;
+    ProfileTimer* parent = _active[core];
+    _active[core] = timer;
+    return parent;
+}
+
+void Profiler::addBlocked(uint32_t ticks) {
+    uint8_t core = profilerCore();
+    if (core < PROFILER_CORES && _active[core]) _active[core]->addBlocked(ticks);
+}
+
+void Profiler::record(uint8_t scope, uint32_t ticks, uint32_t blockedTicks, uint8_t core, uint32_t startUs) {
+    if (scope >= _scopeCount) return;
+    Scope& s = _scopes[scope];
+    s.count++;
+    s.sumTicks += ticks;
+    if (ticks < s.minTicks) s.minTicks = ticks;
+    if (ticks > s.maxTicks) s.maxTicks = ticks;
+    s.blockedTicks += blockedTicks;
+    if (blockedTicks > s.blockedMaxTicks) s.blockedMaxTicks = blockedTicks;
+    s.hist[bucketOf(ticks)]++;
+
+    if (_tracing) {
+        TraceEvent& e = _trace[_traceCount % PROFILER_TRACE_EVENTS];
+        e.startUs = startUs;
+        e.ticks = ticks;
+        e.blockedTicks = blockedTicks;
+        e.scope = scope;
+        e.core = core;
+        _traceCount++;
+    }
+}
+
+void Profiler::reset() {
+    bool tracing = _tracing;
+    _tracing = false;
+    for (uint8_t i = 0; i < _scopeCount; i++) clearScope(_scopes[i]);
+    _traceCount = 0;
+    _tracing = tracing;
+}
+
+bool Profiler::reserveTrace() {
+    if (!_trace) _trace = (TraceEvent*)memAlloc(PROFILER_TRACE_EVENTS * sizeof(TraceEvent), PROFILER_TRACE_REGION);
+    return _trace != nullptr;
+}
+
+bool Profiler::startTrace() {
+    if (!reserveTrace()) return false;
+    _traceCount = 0;
+    _tracing = true;
+    return true;
+}
+
+// ============================================================================
+// Lettura ed esportazione
+// ============================================================================
+
+uint32_t Profiler::quantileTicks(uint8_t scope, float q) const {
+    if (scope >= _scopeCount || _scopes[scope].count == 0) return 0;
+    const Scope& s = _scopes[scope];
+    // Rango del campione (1..count) che il quantile deve coprire
+    uint32_t rank = (uint32_t)(q * s.count + 0.999999f);
+    if (rank < 1) rank = 1;
+    uint32_t seen = 0;
+    for (uint16_t b = 0; b < PROFILER_HIST_BUCKETS; b++) {
+        seen += s.hist[b];
+        if (seen >= rank) {
+            uint32_t upper = bucketUpper(b);
+            return upper < s.maxTicks ? upper : s.maxTicks;
+        }
+    }
+    return s.maxTicks;
+}
+
+bool Profiler::summary(uint8_t scope, ProfileSummary& out) const {
+    if (scope >= _scopeCount) return false;
+    const Scope& s = _scopes[scope];
+    float k = 1.0f / ticksPerUs();
+    out.name = s.name;
+    out.count = s.count;
+    if (s.count == 0) {
+        out.minUs = out.meanUs = out.p99Us = out.maxUs = out.blockedMeanUs = out.blockedMaxUs = 0.0f;
+        return true;
+    }
+    out.minUs = s.minTicks * k;
+    out.meanUs = (float)s.sumTicks / s.count * k;
+    out.p99Us = quantileTicks(scope, 0.99f) * k;
+    out.maxUs = s.maxTicks * k;
+    out.blockedMeanUs = (float)s.blockedTicks / s.count * k;
+    out.blockedMaxUs = s.blockedMaxTicks * k;
+    return true;
+}
+
+void Profiler::printStats() const {
+    halLog("\n--- PROFILER (%.0f tick/us, traccia %s, %lu eventi) ---\n", ticksPerUs(), _tracing ? "ON" : "OFF",
+           (unsigned long)traceEvents());
+    halLog("Scope            |  Chiamate |   Min us |  Media us |    p99 us |    Max us | I2C med us | I2C max us\n");
+    for (uint8_t i = 0; i < _scopeCount; i++) {
+        ProfileSummary s;
+        summary(i, s);
+        halLog("%-16s | %9lu | %8.1f | %9.1f | %9.1f | %9.1f | %10.1f | %10.1f\n", s.name, (unsigned long)s.count,
+               s.minUs, s.meanUs, s.p99Us, s.maxUs, s.blockedMeanUs, s.blockedMaxUs);
+    }
+}
+
+void Profiler::exportChromeTrace(ProfilerWriter write, void* ctx) const {
+    char line[192];
+    float k = 1.0f / ticksPerUs();
+    uint32_t n = traceEvents();
+    uint32_t first = _traceCount - n;
+
+    write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", ctx);
+    // Nomi dei thread: un thread per core
+    for (uint8_t c = 0; c < PROFILER_CORES; c++) {
+        snprintf(line, sizeof(line),
+                 "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"core %u\"}},\n", c, c);
+        write(line, ctx);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        const TraceEvent& e = _trace[(first + i) % PROFILER_TRACE_EVENTS];
+        snprintf(line, sizeof(line),
+                 "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lu,\"dur\":%.2f,\"args\":{\"i2c_us\":%.2f}}%s\n",
+                 _scopes[e.scope].name, e.core, (unsigned long)e.startUs, e.ticks * k, e.blockedTicks * k,
+                 i + 1 < n ? "," : "");
+        write(line, ctx);
+    }
+    write("]}\n", ctx);
+}
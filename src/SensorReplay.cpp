@@ -0,0 +1,76 @@
+#include "SensorReplay.h"
+
+static bool hasRanges(const SensorTrace& trace) {
+    for (uint8_t i = 0; i < TOF_COUNT; i++) {
+        if (!trace.ranges(i).empty()) return true;
+    }
+    return false;
+}
+
+SensorReplay::SensorReplay(const SensorTrace& trace)
+    : _trace(trace), _clock(trace.startUs() - REPLAY_BOOT_LEAD_US),
+      _imuDevice(trace),
+      _rangingDevices{{trace, TOF_FRONT_LEFT, "Front_Left"}, {trace, TOF_FRONT_RIGHT, "Front_Right"},
+                      {trace, TOF_BACK_LEFT, "Back_Left"}, {trace, TOF_BACK_RIGHT, "Back_Right"},
+                      {trace, TOF_CENTER, "Center"}},
+      _rangingPtrs{&_rangingDevices[0], &_rangingDevices[1], &_rangingDevices[2],
+                   &_rangingDevices[3], &_rangingDevices[4]},
+      _spectralDevice(trace),
+      _imu(_imuDevice), _tof(_rangingPtrs), _color(_spectralDevice, _storage),
+      // Tipi assenti dalla traccia: componente assente, come un sensore non montato
+      _boot(hasRanges(trace) ? &_tof : nullptr,
+            trace.imu().empty() ? nullptr : &_imu,
+            trace.spectral().empty() ? nullptr : &_color),
+      _sink(nullptr), _outputs(0), _floorSub(_color.floorEvents().subscribe()) {
+    halSetClock(&_clock);
+}
+
+SensorReplay::~SensorReplay() {
+    halSetClock(nullptr);
+}
+
+bool SensorReplay::boot() {
+    return _boot.run();
+}
+
+bool SensorReplay::step(uint32_t tickUs) {
+    if ((int32_t)(_clock.micros() - _trace.endUs()) > 0) return false;
+    _clock.advance(tickUs);
+
+    // Stesso ordine e stessi record del task sensori (SensorTask::run)
+    if (_boot.isReady(BootSequence::BOOT_IMU) && _imu.update()) {
+        if (_sink) _sink->logImu(_imu.getYaw(), _imu.getPitch(), _imu.getRoll(), _imu.getSampleTimeUs());
+        _outputs++;
+    }
+    if (_boot.isReady(BootSequence::BOOT_TOF) && _tof.update()) {
+        if (_sink) _sink->logToF(_tof.getReadings(), _tof.getSampleTimeUs());
+        _walls.update(_tof.getReadings());
+#if WALL_YAW_CORRECTION
+        if (_boot.isReady(BootSequence::BOOT_IMU)) {
+            float correction = _walls.yawCorrection(_imu.getYaw());
+            if (correction != 0.0f) _imu.correctYaw(correction);
+        }
+#endif
+        _outputs++;
+    }
+    if (_boot.isReady(BootSequence::BOOT_COLOR) && _color.update()) {
+        const SpectralMatch& match = _color.getMatch();
+        if (_sink) {
+            _sink->logSpectral(_color.getCurrentData(), _color.getSampleTimeUs());
+            _sink->logColor(match.type, match.classId, match.distance, _color.getSampleTimeUs());
+            FloorEvent event;
+            while (_color.floorEvents().poll(_floorSub, event)) {
+                _sink->logFloorEvent(event.from, event.to, event.toClass, event.confidence, event.confirmUs,
+                                     event.timestampUs);
+            }
+        }
+        _outputs++;
+    }
+    return true;
+}
+
+uint32_t SensorReplay::run(uint32_t tickUs) {
+    uint32_t steps = 0;
+    while (step(tickUs)) steps++;
+    return steps;
+}
@@ -0,0 +1,175 @@
+#include "SensorTask.h"
+
+SensorTask::SensorTask(ToFManager* tof, ImuManager* imu, ColorManager* color)
+    : _tof(tof), _imu(imu), _color(color), _sinkCount(0), _handle(nullptr), _commands(nullptr),
+      _motionHint(MOTION_DRIVING), _yawRateDps(0.0f),
+      _floorSub(color ? color->floorEvents().subscribe() : -1) {
+    memset(&_state, 0, sizeof(SensorSnapshot));
+    for (int i = 0; i < TOF_COUNT; i++) _state.tof.distance_mm[i] = -1;
+    _state.walls = _walls.estimate();
+    _state.color = COLOR_NONE;
+    _state.colorClass = SpectralClassifier::NO_CLASS;
+}
+
+bool SensorTask::start(BaseType_t core, UBaseType_t priority) {
+    if (_handle) return true;
+
+    _commands = xQueueCreate(4, sizeof(Command));
+    if (!_commands) return false;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(taskEntry, "sensors", SENSOR_TASK_STACK_SIZE,
+                                            this, priority, &_handle, core);
+    return ok == pdPASS;
+}
+
+bool SensorTask::attachSink(RecordSink* sink) {
+    if (!sink || _sinkCount >= SENSOR_MAX_SINKS) return false;
+    _sinks[_sinkCount++] = sink;
+    return true;
+}
+
+bool SensorTask::requestCalibration(ColorType type) {
+    if (!_commands) return false;
+    Command cmd = {CMD_CALIBRATE, type, ""};
+    return xQueueSend(_commands, &cmd, 0) == pdTRUE;
+}
+
+bool SensorTask::requestClassDefinition(const char* name) {
+    return sendNamed(CMD_DEFINE_CLASS, name);
+}
+
+bool SensorTask::requestProfile(const char* name) {
+    return sendNamed(CMD_SELECT_PROFILE, name);
+}
+
+bool SensorTask::requestProfileList() {
+    if (!_commands) return false;
+    Command cmd = {CMD_LIST_PROFILES, COLOR_NONE, ""};
+    return xQueueSend(_commands, &cmd, 0) == pdTRUE;
+}
+
+bool SensorTask::sendNamed(CommandType type, const char* name) {
+    if (!_commands || !name || !name[0]) return false;
+    Command cmd = {type, COLOR_NONE, ""};
+    strncpy(cmd.name, name, sizeof(cmd.name) - 1);
+    return xQueueSend(_commands, &cmd, 0) == pdTRUE;
+}
+
+bool SensorTask::requestCalibrationExport() {
+    if (!_commands) return false;
+    Command cmd = {CMD_EXPORT_CALIBRATION, COLOR_NONE, ""};
+    return xQueueSend(_commands, &cmd, 0) == pdTRUE;
+}
+
+void SensorTask::taskEntry(void* arg) {
+    static_cast<SensorTask*>(arg)->run();
+}
+
+void SensorTask::run() {
+    for (;;) {
+        bool changed = false;
+
+        // IMU per primo: è il dato con la dinamica più veloce
+        if (_imu && _imu->update()) {
+            float prevYaw = _state.yaw;
+            uint32_t prevUs = _state.imuTimestampUs;
+            _state.yaw = _imu->getYaw();
+            _state.pitch = _imu->getPitch();
+            _state.imuTimestampUs = _imu->getSampleTimeUs();
+            if (prevUs != 0 && _state.imuTimestampUs != prevUs) {
+                _yawRateDps = (_state.yaw - prevYaw) * 1e6f / (float)(_state.imuTimestampUs - prevUs);
+            }
+            changed = true;
+            publishHeading();
+            float roll = _imu->getRoll();
+            for (uint8_t s = 0; s < _sinkCount; s++)
+                _sinks[s]->logImu(_state.yaw, _state.pitch, roll, _state.imuTimestampUs);
+        }
+
+        if (_tof) {
+            // In rotazione conta il rate, qualunque cosa dica il controllo
+            RobotMotion motion = (RobotMotion)_motionHint.load(std::memory_order_relaxed);
+            _tof->setMotion(fabsf(_yawRateDps) > TOF_POLICY_TURN_DPS ? MOTION_TURNING : motion);
+        }
+
+        if (_tof && _tof->update()) {
+            _state.tof = _tof->getReadings();
+            _state.tofTimestampUs = _tof->getSampleTimeUs();
+            _walls.update(_state.tof);
+            _state.walls = _walls.estimate();
+#if WALL_YAW_CORRECTION
+            // Deriva del gyro corretta dai muri: stesso core dell'IMU, nessuna race
+            if (_imu) {
+                float correction = _walls.yawCorrection(_imu->getYaw());
+                if (correction != 0.0f) {
+                    _imu->correctYaw(correction);
+                    _state.yaw = _imu->getYaw();
+                    publishHeading();
+                }
+            }
+#endif
+            changed = true;
+            for (uint8_t s = 0; s < _sinkCount; s++) _sinks[s]->logToF(_state.tof, _state.tofTimestampUs);
+        }
+
+        if (_color && _color->update()) {
+            _state.spectral = _color->getCurrentData();
+            // Classificazione fatta qui, una volta per campione, non dal consumatore
+            const SpectralMatch& match = _color->getMatch();
+            _state.color = match.type;
+            _state.colorClass = match.classId;
+            _state.colorTimestampUs = _color->getSampleTimeUs();
+            changed = true;
+            for (uint8_t s = 0; s < _sinkCount; s++) {
+                _sinks[s]->logSpectral(_state.spectral, _state.colorTimestampUs);
+                _sinks[s]->logColor(match.type, match.classId, match.distance, _state.colorTimestampUs);
+            }
+            FloorEvent event;
+            while (_color->floorEvents().poll(_floorSub, event)) {
+                for (uint8_t s = 0; s < _sinkCount; s++) {
+                    _sinks[s]->logFloorEvent(event.from, event.to, event.toClass, event.confidence, event.confirmUs,
+                                             event.timestampUs);
+                }
+            }
+        }
+
+        handleCommands();
+
+        if (changed) publish();
+
+        // Cede il core 0 almeno un tick (idle task e watchdog)
+        vTaskDelay(1);
+    }
+}
+
+void SensorTask::handleCommands() {
+    Command cmd;
+    while (xQueueReceive(_commands, &cmd, 0) == pdTRUE) {
+        if (!_color) continue;
+        switch (cmd.type) {
+            case CMD_CALIBRATE:          _color->calibrate(cmd.color); break;
+            case CMD_DEFINE_CLASS:       _color->defineClass(cmd.name); break;
+            case CMD_SELECT_PROFILE:
+                if (_color->selectProfile(cmd.name)) Serial.printf("Profilo attivo: %s\n", _color->getProfileName());
+                break;
+            case CMD_LIST_PROFILES:      _color->printProfiles(); break;
+            case CMD_EXPORT_CALIBRATION: _color->exportCalibrationToSerial(); break;
+        }
+    }
+}
+
+void SensorTask::publishHeading() {
+    HeadingSample& h = _heading.writeBuffer();
+    h.yaw = _state.yaw;
+    h.yawRateDps = _yawRateDps;
+    h.timestampUs = _state.imuTimestampUs;
+    _heading.publish();
+}
+
+void SensorTask::publish() {
+    _state.sequence++;
+    _state.timestampUs = micros();
+
+    _snapshots.writeBuffer() = _state;
+    _snapshots.publish();
+}
@@ -0,0 +1,185 @@
+#include "SpectralClassifier.h"
+
+#include <float.h>
+#include <string.h>
+
+SpectralClassifier::SpectralClassifier() : _count(0), _revision(0) {
+    clear();
+}
+
+void SpectralClassifier::clear() {
+    memset(_classes, 0, sizeof(_classes));
+    memset(_norm, 0, sizeof(_norm));
+    memset(_normValid, 0, sizeof(_normValid));
+    _count = 0;
+    _revision++;
+    refreshAnchors();
+}
+
+int8_t SpectralClassifier::addClass(const char* name, ColorType type, uint8_t flags, const SpectralData& ref) {
+    if (_count >= COLOR_MAX_CLASSES) return NO_CLASS;
+
+    uint8_t id = _count++;
+    SpectralClass& c = _classes[id];
+    strncpy(c.name, name, SPECTRAL_CLASS_NAME_LEN - 1);
+    c.name[SPECTRAL_CLASS_NAME_LEN - 1] = '\0';
+    c.type = type;
+    c.flags = flags;
+    c.ref = ref;
+
+    normalize(id);
+    refreshAnchors();
+    _revision++;
+    return (int8_t)id;
+}
+
+bool SpectralClassifier::setReference(uint8_t id, const SpectralData& ref) {
+    if (id >= _count) return false;
+    _classes[id].ref = ref;
+    normalize(id);
+    refreshAnchors();
+    _revision++;
+    return true;
+}
+
+int8_t SpectralClassifier::findByType(ColorType type) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_classes[i].type == type) return (int8_t)i;
+    }
+    return NO_CLASS;
+}
+
+int8_t SpectralClassifier::findByName(const char* name) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (strncmp(_classes[i].name, name, SPECTRAL_CLASS_NAME_LEN) == 0) return (int8_t)i;
+    }
+    return NO_CLASS;
+}
+
+void SpectralClassifier::normalize(uint8_t id) {
+    const SpectralData& ref = _classes[id].ref;
+    _normValid[id] = ref.sum != 0.0f;
+    if (!_normValid[id]) return;
+
+    float inv = 1.0f / ref.sum;
+    for (int ch = 0; ch < CH_COUNT; ch++) {
+        _norm[id][ch] = ref.channels[ch] * inv;
+    }
+}
+
+void SpectralClassifier::refreshAnchors() {
+    // Senza riferimenti calibrati: argento mai, ombra solo sotto l'offset
+    _silverSum = FLT_MAX;
+    _darkThreshold = COLOR_DARK_OFFSET;
+    _darkId = NO_CLASS;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_classes[i].flags & SPECTRAL_BRIGHT_REF) {
+            _silverSum = _classes[i].ref.sum * DEFAULT_SILVER_RATIO;
+        }
+        if (_classes[i].flags & SPECTRAL_DARK_REF) {
+            _darkThreshold = _classes[i].ref.sum * COLOR_DARK_SCALE + COLOR_DARK_OFFSET;
+            _darkId = (int8_t)i;
+        }
+    }
+}
+
+// ==========================================
+// CLASSIFICAZIONE
+// ==========================================
+
+SpectralMatch SpectralClassifier::classify(const SpectralData& sample) const {
+    SpectralMatch match = {COLOR_NONE, NO_CLASS, 0.0f, 0.0f};
+
+    // 1. ARGENTO: riflesso speculare, più luce del bianco calibrato
+    if (sample.sum > _silverSum) {
+        match.type = COLOR_SILVER;
+        match.confidence = sumMargin(sample.sum / _silverSum - 1.0f);
+        return match;
+    }
+
+    // 2. Luce quasi assente (robot sollevato): nessun colore calcolabile
+    if (sample.sum < COLOR_MIN_SUM) {
+        match.type = COLOR_BLACK;
+        match.classId = _darkId;
+        match.confidence = 1.0f;
+        return match;
+    }
+
+    // 3. Distanza quadratica su valori normalizzati: il campione si normalizza una volta
+    float inv = 1.0f / sample.sum;
+    float s[CH_COUNT];
+    for (int ch = 0; ch < CH_COUNT; ch++) s[ch] = sample.channels[ch] * inv;
+
+    float dist[COLOR_MAX_CLASSES];
+    int8_t best = NO_CLASS;
+    float bestDist = 9999.0f;
+    for (uint8_t i = 0; i < _count; i++) {
+        dist[i] = -1.0f;
+        if (!(_classes[i].flags & SPECTRAL_MATCH_SHAPE) || !_normValid[i]) continue;
+
+        const float* ref = _norm[i];
+        float d = 0.0f;
+        for (int ch = 0; ch < CH_COUNT; ch++) {
+            float diff = s[ch] - ref[ch];
+            d += diff * diff;
+        }
+        dist[i] = d;
+        if (d < bestDist) {
+            bestDist = d;
+            best = (int8_t)i;
+        }
+    }
+
+    // 4. ZONA D'OMBRA: poca luce, nastro nero oppure un colore lontano.
+    // Vince solo una firma spettrale netta di una classe ammessa in ombra.
+    if (sample.sum < _darkThreshold) {
+        if (best != NO_CLASS && (_classes[best].flags & SPECTRAL_SHADOW_OK)
+            && bestDist < COLOR_SHAPE_CONFIDENCE) {
+            match.type = _classes[best].type;
+            match.classId = best;
+            match.distance = bestDist;
+            float shape = 1.0f - bestDist / COLOR_SHAPE_CONFIDENCE;
+            float margin = shapeMargin(best, dist);
+            match.confidence = shape < margin ? shape : margin;
+            return match;
+        }
+        match.type = COLOR_BLACK;
+        match.classId = _darkId;
+        match.confidence = sumMargin(1.0f - sample.sum / _darkThreshold);
+        return match;
+    }
+
+    // 5. ZONA NORMALE: vince la distanza minore. Appena sopra la soglia
+    // d'ombra la decisione resta incerta anche con una forma netta.
+    if (best != NO_CLASS) {
+        match.type = _classes[best].type;
+        match.classId = best;
+        match.distance = bestDist;
+        float light = _darkThreshold > 0.0f ? sumMargin(sample.sum / _darkThreshold - 1.0f) : 1.0f;
+        float margin = shapeMargin(best, dist);
+        match.confidence = light < margin ? light : margin;
+    }
+    return match;
+}
+
+float SpectralClassifier::sumMargin(float relative) {
+    float c = relative / COLOR_SUM_MARGIN;
+    return c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+}
+
+float SpectralClassifier::shapeMargin(int8_t best, const float* dist) const {
+    // Seconda classe di tipo diverso: due classi utente (COLOR_NONE) sono sempre diverse
+    ColorType type = _classes[best].type;
+    float second = -1.0f;
+    for (uint8_t i = 0; i < _count; i++) {
+        if ((int8_t)i == best || dist[i] < 0.0f) continue;
+        if (type != COLOR_NONE && _classes[i].type == type) continue;
+        if (second < 0.0f || dist[i] < second) second = dist[i];
+    }
+    // Classe unica: conta solo la distanza assoluta
+    if (second < 0.0f) second = COLOR_SHAPE_CONFIDENCE;
+    if (second <= 0.0f) return 0.0f;
+    float c = 1.0f - dist[best] / second;
+    return c < 0.0f ? 0.0f : c;
+}
@@ -0,0 +1,204 @@
+#include "Telemetry.h"
+
+#include <string.h>
+
+#include "Crc32.h"
+
+size_t telemetryPayloadSize(uint8_t type) {
+    switch (type) {
+        case TLM_TOF:      return sizeof(TelemetryToF);
+        case TLM_IMU:      return sizeof(TelemetryImu);
+        case TLM_SPECTRAL: return sizeof(TelemetrySpectral);
+        case TLM_COLOR:    return sizeof(TelemetryColor);
+        case TLM_IMU_RAW:  return sizeof(TelemetryImuRaw);
+        case TLM_TOF_RAW:  return sizeof(TelemetryToFRaw);
+        case TLM_SPECTRAL_RAW: return sizeof(TelemetrySpectral);
+        case TLM_FLOOR_EVENT:  return sizeof(TelemetryFloorEvent);
+    }
+    return 0;
+}
+
+// ==========================================
+// RECORD SINK
+// ==========================================
+
+bool RecordSink::logToF(const ToFData& data, uint32_t timestampUs) {
+    TelemetryToF rec;
+    rec.validMask = 0;
+    for (int i = 0; i < TOF_COUNT; i++) {
+        rec.distance_mm[i] = data.distance_mm[i];
+        if (data.valid[i]) rec.validMask |= (1 << i);
+    }
+    return log(TLM_TOF, timestampUs, &rec, sizeof(rec));
+}
+
+bool RecordSink::logImu(float yaw, float pitch, float roll, uint32_t timestampUs) {
+    TelemetryImu rec = {yaw, pitch, roll};
+    return log(TLM_IMU, timestampUs, &rec, sizeof(rec));
+}
+
+bool RecordSink::logSpectral(const SpectralData& data, uint32_t timestampUs) {
+    TelemetrySpectral rec;
+    memcpy(rec.channels, data.channels, sizeof(rec.channels));
+    rec.sum = data.sum;
+    return log(TLM_SPECTRAL, timestampUs, &rec, sizeof(rec));
+}
+
+bool RecordSink::logColor(ColorType type, int8_t classId, float distance, uint32_t timestampUs) {
+    TelemetryColor rec = {(uint8_t)type, classId, distance};
+    return log(TLM_COLOR, timestampUs, &rec, sizeof(rec));
+}
+
+bool RecordSink::logImuRaw(int16_t ax, int16_t ay, int16_t az, int16_t gx, int16_t gy, int16_t gz,
+                           uint32_t timestampUs) {
+    TelemetryImuRaw rec = {ax, ay, az, gx, gy, gz};
+    return log(TLM_IMU_RAW, timestampUs, &rec, sizeof(rec));
+}
+
+bool RecordSink::logToFRaw(uint8_t sensor, uint8_t rangeStatus, int16_t distance, uint32_t timestampUs) {
+    TelemetryToFRaw rec = {sensor, rangeStatus, distance};
+    return log(TLM_TOF_RAW, timestampUs, &rec, sizeof(rec));
+}
+
+bool RecordSink::logSpectralRaw(const float channels[CH_COUNT], uint32_t timestampUs) {
+    TelemetrySpectral rec;
+    rec.sum = 0;
+    for (int i = 0; i < CH_COUNT; i++) {
+        rec.channels[i] = channels[i];
+        rec.sum += channels[i];
+    }
+    return log(TLM_SPECTRAL_RAW, timestampUs, &rec, sizeof(rec));
+}
+
+bool RecordSink::logFloorEvent(ColorType from, ColorType to, int8_t toClass, float confidence, uint32_t confirmUs,
+                               uint32_t timestampUs) {
+    TelemetryFloorEvent rec = {(uint8_t)from, (uint8_t)to, toClass, confidence, confirmUs};
+    return log(TLM_FLOOR_EVENT, timestampUs, &rec, sizeof(rec));
+}
+
+// ==========================================
+// COBS
+// ==========================================
+
+size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t write = 1;
+    size_t codeIndex = 0;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+            continue;
+        }
+        out[write++] = in[i];
+        if (++code == 0xFF) {
+            // Blocco pieno (254 byte non nulli): nuovo codice senza zero implicito
+            out[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+        }
+    }
+    out[codeIndex] = code;
+    return write;
+}
+
+size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out, size_t cap) {
+    size_t read = 0;
+    size_t write = 0;
+
+    while (read < len) {
+        uint8_t code = in[read++];
+        if (code == 0 || read + code - 1 > len) return 0;
+
+        for (uint8_t i = 1; i < code; i++) {
+            if (write >= cap) return 0;
+            out[write++] = in[read++];
+        }
+        // Zero implicito, tranne dopo un blocco pieno o alla fine del frame
+        if (code != 0xFF && read < len) {
+            if (write >= cap) return 0;
+            out[write++] = 0;
+        }
+    }
+    return write;
+}
+
+// ==========================================
+// ENCODER
+// ==========================================
+
+size_t telemetryEncodeRecord(const uint8_t* record, size_t len, uint8_t* out, size_t cap) {
+    if (len < sizeof(TelemetryHeader) || len > TELEMETRY_MAX_RAW - 4) return 0;
+    if (cap < len + 4 + (len + 4) / 254 + 2) return 0;
+
+    uint8_t raw[TELEMETRY_MAX_RAW];
+    memcpy(raw, record, len);
+    uint32_t crc = crc32(raw, len);
+    memcpy(raw + len, &crc, 4);
+
+    size_t n = cobsEncode(raw, len + 4, out);
+    out[n++] = 0x00;
+    return n;
+}
+
+size_t telemetryEncodeFrame(const TelemetryHeader& header, const void* payload, size_t payloadLen,
+                            uint8_t* out, size_t cap) {
+    if (payloadLen > TELEMETRY_MAX_PAYLOAD) return 0;
+
+    uint8_t record[sizeof(TelemetryHeader) + TELEMETRY_MAX_PAYLOAD];
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), payload, payloadLen);
+    return telemetryEncodeRecord(record, sizeof(header) + payloadLen, out, cap);
+}
+
+// ==========================================
+// DECODER
+// ==========================================
+
+TelemetryDecoder::TelemetryDecoder()
+    : _frameLen(0), _overflow(false), _payloadLen(0),
+      _haveSequence(false), _lastSequence(0), _records(0), _badFrames(0), _lost(0) {
+    memset(&_header, 0, sizeof(_header));
+}
+
+TelemetryDecoder::Result TelemetryDecoder::feed(uint8_t byte) {
+    if (byte != 0x00) {
+        if (_frameLen < sizeof(_frame)) _frame[_frameLen++] = byte;
+        else _overflow = true; // Troppo lungo per essere un frame: verrà scartato
+        return NONE;
+    }
+
+    // Delimitatore: frame completo (vuoto = doppio zero, si ignora)
+    if (_frameLen == 0 && !_overflow) return NONE;
+    Result r = _overflow ? BAD_FRAME : decodeFrame();
+    if (r == BAD_FRAME) _badFrames++;
+    _frameLen = 0;
+    _overflow = false;
+    return r;
+}
+
+TelemetryDecoder::Result TelemetryDecoder::decodeFrame() {
+    size_t n = cobsDecode(_frame, _frameLen, _raw, sizeof(_raw));
+    if (n < sizeof(TelemetryHeader) + 4) return BAD_FRAME;
+
+    uint32_t crc;
+    memcpy(&crc, _raw + n - 4, 4);
+    if (crc != crc32(_raw, n - 4)) return BAD_FRAME;
+
+    memcpy(&_header, _raw, sizeof(_header));
+    if (_header.version != TELEMETRY_SCHEMA_VERSION) return BAD_VERSION;
+
+    _payloadLen = n - 4 - sizeof(TelemetryHeader);
+    if (_payloadLen != telemetryPayloadSize(_header.type)) return BAD_RECORD;
+
+    if (_haveSequence) {
+        uint16_t gap = (uint16_t)(_header.sequence - _lastSequence - 1);
+        _lost += gap;
+    }
+    _haveSequence = true;
+    _lastSequence = _header.sequence;
+    _records++;
+    return RECORD;
+}
@@ -0,0 +1,96 @@
+#include "TelemetryWriter.h"
+
+TelemetryWriter::TelemetryWriter(Print& out)
+    : _out(out), _ring(nullptr), _handle(nullptr),
+      _enabled(TELEMETRY_STREAM_AT_BOOT != 0), _sequence(0), _dropped(0),
+      _batchLen(0), _written(0), _bytes(0), _encodeUs(0) {}
+
+bool TelemetryWriter::start(BaseType_t core, UBaseType_t priority) {
+    if (_handle) return true;
+
+    // NOSPLIT: ogni record resta contiguo, niente ricomposizione lato lettore
+    _ring = xRingbufferCreate(TELEMETRY_RING_BYTES, RINGBUF_TYPE_NOSPLIT);
+    if (!_ring) return false;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(taskEntry, "telemetry", TELEMETRY_TASK_STACK_SIZE,
+                                            this, priority, &_handle, core);
+    return ok == pdPASS;
+}
+
+// ==========================================
+// PRODUTTORI
+// ==========================================
+
+bool TelemetryWriter::log(TelemetryType type, uint32_t timestampUs, const void* payload, size_t len) {
+    if (!_ring || !isEnabled() || len > TELEMETRY_MAX_PAYLOAD) return false;
+
+    uint8_t record[sizeof(TelemetryHeader) + TELEMETRY_MAX_PAYLOAD];
+    TelemetryHeader header;
+    header.version = TELEMETRY_SCHEMA_VERSION;
+    header.type = type;
+    // La sequenza avanza anche se il record poi si perde: il buco lo segnala all'host
+    header.sequence = _sequence.fetch_add(1, std::memory_order_relaxed);
+    header.timestampUs = timestampUs;
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), payload, len);
+
+    if (xRingbufferSend(_ring, record, sizeof(header) + len, 0) != pdTRUE) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// ==========================================
+// TASK DI SCRITTURA
+// ==========================================
+
+void TelemetryWriter::taskEntry(void* arg) {
+    static_cast<TelemetryWriter*>(arg)->run();
+}
+
+void TelemetryWriter::run() {
+    for (;;) {
+        size_t size = 0;
+        TickType_t wait = _batchLen ? pdMS_TO_TICKS(TELEMETRY_FLUSH_MS) : portMAX_DELAY;
+        uint8_t* item = (uint8_t*)xRingbufferReceive(_ring, &size, wait);
+
+        if (!item) {
+            // Coda ferma: spedisce quello che c'è invece di aspettare il blocco pieno
+            flush();
+            continue;
+        }
+
+        if (TELEMETRY_BATCH_BYTES - _batchLen < TELEMETRY_MAX_FRAME) flush();
+
+        if (_batchLen == 0) {
+            // Delimitatore iniziale: chiude eventuale testo di debug rimasto a metà riga
+            _batch[_batchLen++] = 0x00;
+        }
+
+        uint32_t t0 = micros();
+        size_t n = telemetryEncodeRecord(item, size, _batch + _batchLen, TELEMETRY_BATCH_BYTES - _batchLen);
+        _encodeUs += micros() - t0;
+        vRingbufferReturnItem(_ring, item);
+
+        _batchLen += n;
+        if (n) _written++;
+    }
+}
+
+void TelemetryWriter::flush() {
+    if (_batchLen == 0) return;
+    _out.write(_batch, _batchLen);
+    _bytes += _batchLen;
+    _batchLen = 0;
+}
+
+void TelemetryWriter::printStats() {
+    // Letture non atomiche dei contatori del task: bastano per una stampa
+    uint32_t written = _written;
+    Serial.printf("[TLM] Flusso: %s | Record: %lu | Persi: %lu | Byte: %lu | Coda libera: %u\n",
+                  isEnabled() ? "ON" : "OFF", (unsigned long)written,
+                  (unsigned long)_dropped.load(), (unsigned long)_bytes,
+                  _ring ? (unsigned)xRingbufferGetCurFreeSize(_ring) : 0u);
+    if (written) Serial.printf("[TLM] Codifica: %.2f us/record\n", (float)_encodeUs / written);
+}
@@ -0,0 +1,100 @@
+#include "ToFHistory.h"
+
+#include <stdlib.h>
+
+static_assert((TOF_HISTORY_LEN & (TOF_HISTORY_LEN - 1)) == 0, "TOF_HISTORY_LEN deve essere una potenza di 2");
+
+// Mediana di n valori (n <= TOF_HAMPEL_WINDOW): insertion sort su copia, n è piccolo
+static int16_t medianOf(int16_t* v, uint8_t n) {
+    for (uint8_t i = 1; i < n; i++) {
+        int16_t x = v[i];
+        int8_t j = (int8_t)(i - 1);
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+    // Numero pari: media dei due centrali
+    return (n & 1) ? v[n / 2] : (int16_t)((v[n / 2 - 1] + v[n / 2]) / 2);
+}
+
+ToFHistory::ToFHistory() {
+    clear();
+}
+
+void ToFHistory::clear() {
+    _head = 0;
+    _count = 0;
+    _windowHead = 0;
+    _windowCount = 0;
+    _filtered = -1;
+    _filteredUs = 0;
+    _outliers = 0;
+}
+
+const ToFSample& ToFHistory::at(uint8_t age) const {
+    return _ring[(uint8_t)(_head - 1 - age) & (TOF_HISTORY_LEN - 1)];
+}
+
+uint8_t ToFHistory::window(ToFSample* out, uint8_t maxSamples) const {
+    uint8_t n = maxSamples < _count ? maxSamples : _count;
+    for (uint8_t i = 0; i < n; i++) out[i] = at(i);
+    return n;
+}
+
+uint32_t ToFHistory::ageUs(uint32_t nowUs) const {
+    return hasFiltered() ? nowUs - _filteredUs : UINT32_MAX;
+}
+
+void ToFHistory::windowStats(int16_t& median, int16_t& mad) const {
+    int16_t v[TOF_HAMPEL_WINDOW];
+    for (uint8_t i = 0; i < _windowCount; i++) v[i] = _window[i];
+    median = medianOf(v, _windowCount);
+    for (uint8_t i = 0; i < _windowCount; i++) v[i] = (int16_t)abs(_window[i] - median);
+    mad = medianOf(v, _windowCount);
+}
+
+const ToFSample& ToFHistory::push(const RangeSample& sample, uint32_t timestampUs) {
+    ToFSample& s = _ring[_head];
+    _head = (_head + 1) & (TOF_HISTORY_LEN - 1);
+    if (_count < TOF_HISTORY_LEN) _count++;
+
+    bool hasObject = sample.objects > 0;
+    s.timestampUs = timestampUs;
+    s.distance_mm = hasObject ? sample.distance_mm : TOF_NO_OBJECT_MM;
+    s.rangeStatus = hasObject ? sample.rangeStatus : 255;
+    s.signalKcps = sample.signalKcps;
+    s.sigmaMm = sample.sigmaMm;
+    s.flags = 0;
+
+    // Fuori portata o lettura sporca: storico sì, filtro no
+    if (!hasObject || sample.rangeStatus != 0) {
+        s.filtered_mm = _filtered;
+        return s;
+    }
+    s.flags |= TOF_SAMPLE_VALID;
+
+    // La misura entra sempre nella finestra: un gradino vero diventa la nuova mediana
+    _window[_windowHead] = sample.distance_mm;
+    _windowHead = (_windowHead + 1) % TOF_HAMPEL_WINDOW;
+    if (_windowCount < TOF_HAMPEL_WINDOW) _windowCount++;
+
+    int16_t value = sample.distance_mm;
+    if (_windowCount >= 3) {
+        int16_t median, mad;
+        windowStats(median, mad);
+        float limit = TOF_HAMPEL_K * 1.4826f * mad;
+        if (limit < TOF_HAMPEL_MIN_DEV_MM) limit = TOF_HAMPEL_MIN_DEV_MM;
+        if (abs(value - median) > limit) {
+            value = median;
+            s.flags |= TOF_SAMPLE_OUTLIER;
+            _outliers++;
+        }
+    }
+
+    _filtered = value;
+    _filteredUs = timestampUs;
+    s.filtered_mm = value;
+    return s;
+}
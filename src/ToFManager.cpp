@@ -1,145 +1,452 @@
 #include "ToFManager.h"
 
-ToFManager::ToFManager() {
-    _i2c = nullptr;
+#include "Profiler.h"
 
-    // Configurazione Mappatura (Solo dati, niente hardware qui!)
-    _sensors[TOF_FRONT_LEFT]  = {nullptr, PIN_XSHUT_FRONT_LEFT,  ADDR_TOF_FL, false, -1, false, "Front_Left"};
-    _sensors[TOF_FRONT_RIGHT] = {nullptr, PIN_XSHUT_FRONT_RIGHT, ADDR_TOF_FR, false, -1, false, "Front_Right"};
-    _sensors[TOF_BACK_LEFT]   = {nullptr, PIN_XSHUT_BACK_LEFT,   ADDR_TOF_BL, false, -1, false, "Back_Left"};
-    _sensors[TOF_BACK_RIGHT]  = {nullptr, PIN_XSHUT_BACK_RIGHT,  ADDR_TOF_BR, false, -1, false, "Back_Right"};
-    _sensors[TOF_CENTER]      = {nullptr, PIN_XSHUT_CENTER,      ADDR_TOF_C,  false, -1, false, "Center"};
-}
+ToFManager::ToFManager(RangingDevice* const devices[TOF_COUNT]) {
+    _recorder = nullptr;
+    _sampleTimeUs = 0;
+    _bootState = TOF_BOOT_IDLE;
+    _bootIndex = 0;
+    _bootWaitUntilUs = 0;
+    _warmStart = false;
+    _motion = MOTION_DRIVING;
+    _recoverState = TOF_RECOVER_IDLE;
+    _recoverIndex = TOF_COUNT - 1; // Il primo candidato è il sensore 0
+    _recoverWaitUntilUs = 0;
 
-ToFManager::~ToFManager() {
+    // Configurazione Mappatura (Solo dati, niente hardware qui!)
     for (int i = 0; i < TOF_COUNT; i++) {
-        if (_sensors[i].driver) delete _sensors[i].driver;
+        _sensors[i].device = devices[i];
+        _sensors[i].isOnline = false;
+        _sensors[i].health.setStaleTimeout(HEALTH_TOF_STALE_US);
+        _isrCtx[i] = {&_scheduler, (uint8_t)i};
+        _readings.distance_mm[i] = -1;
+        _readings.valid[i] = false;
+        _readings.timestampUs[i] = 0;
     }
 }
 
+const char* ToFManager::sensorName(int i) const {
+    return _sensors[i].device ? _sensors[i].device->name() : "-";
+}
+
 void ToFManager::shutdownAll() {
-    Serial.println("[ToF] Forcing Hard Reset on all sensors...");
+    halLog("[ToF] Forcing Hard Reset on all sensors...\n");
 
-    // 1. Configura TUTTI i pin come OUTPUT e portali a LOW
+    // Porta TUTTI i pin XSHUT a LOW.
+    // La scarica dei condensatori (TOF_BOOT_SHUTDOWN_US) la attende bootStep()
     for (int i = 0; i < TOF_COUNT; i++) {
-        pinMode(_sensors[i].xshutPin, OUTPUT);
-        digitalWrite(_sensors[i].xshutPin, LOW);
+        if (_sensors[i].device) _sensors[i].device->powerDown();
     }
+}
 
-    // 2. Attendi scarica condensatori (Tempo critico: i sensori VL hanno condensatori interni)
-    delay(50);
+bool ToFManager::begin() {
+    // Versione bloccante di bootStep()
+    BootStatus status;
+    while ((status = bootStep(halMicros())) == BOOT_PENDING) {
+        halDelayMs(1);
+    }
+    return status == BOOT_DONE;
 }
 
-bool ToFManager::begin(TwoWire* wireBus) {
-    _i2c = wireBus;
+BootStatus ToFManager::bootStep(uint32_t nowUs) {
+    switch (_bootState) {
+        case TOF_BOOT_IDLE: {
+            for (int i = 0; i < TOF_COUNT; i++) {
+                if (_sensors[i].device) _sensors[i].device->setup();
+            }
+
+            // Reset a caldo (solo ESP32 riavviato): i sensori sono rimasti alimentati
+            // e rispondono già al loro indirizzo. Niente spegnimento né riassegnazione.
+            if (detectWarmStart()) {
+                halLog("[ToF] Warm start: sensors already addressed.\n");
+                _bootIndex = 0;
+                _bootState = TOF_BOOT_WARM;
+                return BOOT_PENDING;
+            }
 
-    // FIX 1: Usa 100kHz per la configurazione (più stabile)
-    _i2c->setClock(100000);
+            // FIX 2: Sequenza di spegnimento rigorosa
+            shutdownAll();
+            halLog("[ToF] Init Sequence Started...\n");
+            _bootWaitUntilUs = nowUs + TOF_BOOT_SHUTDOWN_US;
+            _bootIndex = 0;
+            _bootState = TOF_BOOT_SHUTDOWN;
+            return BOOT_PENDING;
+        }
 
-    // FIX 2: Sequenza di spegnimento rigorosa
-    shutdownAll();
+        case TOF_BOOT_SHUTDOWN:
+        case TOF_BOOT_NEXT: {
+            if ((int32_t)(nowUs - _bootWaitUntilUs) < 0) return BOOT_PENDING;
+            // Posizioni senza sensore: si passa oltre
+            while (_bootIndex < TOF_COUNT && !_sensors[_bootIndex].device) _bootIndex++;
+            if (_bootIndex >= TOF_COUNT) return finishBoot();
 
-    int activeSensors = 0;
-    Serial.println("[ToF] Init Sequence Started...");
+            // --- FASE 1: Risveglio Sensore Corrente ---
+            RangingDevice* dev = _sensors[_bootIndex].device;
+            halLog("[ToF] Booting %s (Pin %d)...\n", dev->name(), dev->xshutPin());
+            dev->powerUp();
 
+            // Attendi boot firmware sensore (Datasheet dice 1.2ms, noi diamo 10ms per sicurezza)
+            _bootWaitUntilUs = nowUs + TOF_BOOT_FIRMWARE_US;
+            _bootState = TOF_BOOT_FIRMWARE;
+            return BOOT_PENDING;
+        }
+
+        case TOF_BOOT_FIRMWARE:
+            if ((int32_t)(nowUs - _bootWaitUntilUs) < 0) return BOOT_PENDING;
+            initSensor(_bootIndex);
+            _bootIndex++;
+            _bootWaitUntilUs = nowUs; // Il prossimo sensore può partire subito
+            _bootState = TOF_BOOT_NEXT;
+            return BOOT_PENDING;
+
+        case TOF_BOOT_WARM:
+            // Un sensore per passo: tra l'uno e l'altro girano IMU e spettrometro
+            if (_bootIndex >= TOF_COUNT) return finishBoot();
+            if (_sensors[_bootIndex].device) attachWarmSensor(_bootIndex);
+            _bootIndex++;
+            return BOOT_PENDING;
+
+        case TOF_BOOT_DONE:
+            return BOOT_DONE;
+
+        case TOF_BOOT_FAILED:
+            return BOOT_FAILED;
+    }
+    return BOOT_FAILED;
+}
+
+const char* ToFManager::bootPhase() const {
+    switch (_bootState) {
+        case TOF_BOOT_IDLE:
+        case TOF_BOOT_SHUTDOWN: return "spegnimento";
+        case TOF_BOOT_WARM:     return "riavvio a caldo";
+        case TOF_BOOT_NEXT:
+        case TOF_BOOT_FIRMWARE: return _bootIndex < TOF_COUNT ? sensorName(_bootIndex) : nullptr;
+        default:                return nullptr;
+    }
+}
+
+bool ToFManager::isWarmStart() const {
+    return _warmStart;
+}
+
+bool ToFManager::detectWarmStart() {
+    int answering = 0;
     for (int i = 0; i < TOF_COUNT; i++) {
-        // --- FASE 1: Risveglio Sensore Corrente ---
-        Serial.printf("[ToF] Booting %s (Pin %d)... ", _sensors[i].name, _sensors[i].xshutPin);
+        RangingDevice* dev = _sensors[i].device;
+        if (!dev) continue;
+        // Qualcosa a 0x29 = almeno un sensore appena acceso: serve la sequenza completa
+        if (dev->probeDefault()) return false;
+        if (dev->probe()) answering++;
+    }
+    _warmStart = answering > 0;
+    return _warmStart;
+}
 
-        digitalWrite(_sensors[i].xshutPin, HIGH);
+void ToFManager::attachWarmSensor(int i) {
+    RangingDevice* dev = _sensors[i].device;
 
-        // Attendi boot firmware sensore (Datasheet dice 1.2ms, noi diamo 10ms per sicurezza)
-        delay(10);
+    if (!dev->probe()) {
+        // Nessuna risposta all'indirizzo assegnato: resta spento
+        halLog("[ToF] %s: FAIL (No Ack at 0x%02X)\n", dev->name(), dev->address());
+        dev->powerDown();
+        return;
+    }
+    // Tiene acceso il sensore: dopo il reset dell'ESP32 il pin era flottante
+    dev->powerUp();
 
-        // --- FASE 2: Verifica Preliminare ---
-        // Prima di istanziare, controlliamo se QUALCOSA risponde a 0x29
-        _i2c->beginTransmission(0x29);
-        if (_i2c->endTransmission() != 0) {
-            Serial.println("FAIL (No Ack at 0x29) - Check Wiring/XSHUT");
-            digitalWrite(_sensors[i].xshutPin, LOW); // Spegnilo e passa oltre
-            continue;
-        }
+    // La misura del run precedente può essere ancora in corso
+    if (!dev->attachWarm()) {
+        halLog("[ToF] %s: FAIL (DataInit)\n", dev->name());
+        dev->release();
+        return;
+    }
+    startRanging(i);
+    halLog("[ToF] %s: OK (warm) -> Addr: 0x%02X\n", dev->name(), dev->address());
+}
 
-        // --- FASE 3: Configurazione Driver ---
-        _sensors[i].driver = new VL53L4CX(_i2c, -1);
+void ToFManager::initSensor(int i) {
+    if (probeAtDefault(i)) finishInit(i, _sensors[i].device->initAtDefault());
+}
 
-        if (!_sensors[i].driver) {
-            Serial.println("FAIL (Mem Error)");
-            continue;
-        }
+bool ToFManager::probeAtDefault(int i) {
+    RangingDevice* dev = _sensors[i].device;
 
-        // InitSensor
-        if (_sensors[i].driver->InitSensor(0x29) == VL53L4CX_ERROR_NONE) {
+    // --- FASE 2: Verifica Preliminare ---
+    // Prima di istanziare, controlliamo se QUALCOSA risponde a 0x29
+    if (dev->probeDefault()) return true;
+    halLog("[ToF] %s: FAIL (No Ack at 0x29) - Check Wiring/XSHUT\n", dev->name());
+    dev->powerDown(); // Spegnilo e passa oltre
+    return false;
+}
 
-            _sensors[i].driver->VL53L4CX_SetDeviceAddress(_sensors[i].targetAddr);
-            delay(2); // Breve pausa per stabilizzazione I2C interna
+void ToFManager::finishInit(int i, bool ok) {
+    RangingDevice* dev = _sensors[i].device;
 
-            // Avvio Misura
-            _sensors[i].driver->VL53L4CX_StartMeasurement();
+    // --- FASE 3: Configurazione all'indirizzo di default, poi cambio indirizzo ---
+    if (ok) {
+        startRanging(i);
+        halLog("[ToF] %s: OK -> Addr: 0x%02X\n", dev->name(), dev->address());
+    } else {
+        halLog("[ToF] %s: FAIL (Init Error)\n", dev->name());
+        _sensors[i].isOnline = false;
+        dev->release(); // Hard Kill
+    }
+}
+
+void ToFManager::startRanging(int i) {
+    RangingDevice* dev = _sensors[i].device;
+
+    // Avvio Misura: il timing budget reale fa da seme al periodo dello scheduler
+    uint32_t budgetUs = dev->startRanging();
+    _scheduler.configure(i, budgetUs, halMicros());
+    // Configurazione di avvio della libreria: distance mode LONG
+    ToFRangingConfig config = {TOF_MODE_LONG, budgetUs};
+    _policy.reset(i, config, halMicros());
+
+    // GPIO1 cablato: niente poll, il sensore ci avvisa da solo
+    if (dev->hasDataReadyPin()) {
+        dev->attachDataReady(onDataReadyIsr, &_isrCtx[i]);
+        _scheduler.setInterruptDriven(i, true);
+    }
 
-            _sensors[i].isOnline = true;
+    _sensors[i].isOnline = true;
+}
+
+BootStatus ToFManager::finishBoot() {
+    int activeSensors = 0;
+    uint32_t now = halMicros();
+    for (int i = 0; i < TOF_COUNT; i++) {
+        if (!_sensors[i].device) continue;
+        // I sensori non partiti restano in coda per il re-init in background
+        if (_sensors[i].isOnline) {
+            _sensors[i].health.start(now);
             activeSensors++;
-            Serial.printf("OK -> Addr: 0x%02X\n", _sensors[i].targetAddr);
         } else {
-            Serial.println("FAIL (Init Error)");
-            _sensors[i].isOnline = false;
-            digitalWrite(_sensors[i].xshutPin, LOW); // Hard Kill
-            delete _sensors[i].driver;
-            _sensors[i].driver = nullptr;
+            _sensors[i].health.fail(now);
         }
     }
+    halLog("[ToF] Init Complete. Active: %d/%d\n", activeSensors, TOF_COUNT);
+    _bootState = activeSensors > 0 ? TOF_BOOT_DONE : TOF_BOOT_FAILED;
+    return activeSensors > 0 ? BOOT_DONE : BOOT_FAILED;
+}
 
-    // FIX 3: Ripristina velocità alta solo dopo aver configurato tutti gli indirizzi
-    _i2c->setClock(400000);
+void HAL_ISR_ATTR ToFManager::onDataReadyIsr(void* arg) {
+    IsrContext* ctx = static_cast<IsrContext*>(arg);
+    ctx->scheduler->notifyDataReady(ctx->index);
+}
+
+bool ToFManager::adaptRanging(int i, const ToFSample& s) {
+    // Lettura sporca: non dice nulla sulla distanza
+    int16_t distance = (s.flags & TOF_SAMPLE_VALID) ? s.filtered_mm
+                     : (s.rangeStatus == 255 ? TOF_NO_OBJECT_MM : -1);
+    ToFRangingConfig config;
+    if (!_policy.evaluate(i, distance, _motion, halMicros(), config)) return false;
 
-    Serial.printf("[ToF] Init Complete. Active: %d/%d\n", activeSensors, TOF_COUNT);
-    return (activeSensors > 0);
+    // Il sensore ha appena riavviato la misura: si perde solo quella
+    uint32_t budgetUs = _sensors[i].device->reconfigure(config.mode, config.budgetUs);
+    uint32_t now = halMicros();
+    if (budgetUs == 0) {
+        _policy.onFailed(i, now);
+        return true;
+    }
+    _scheduler.configure(i, budgetUs, now);
+    _policy.onApplied(i, config, now);
+    return true;
 }
 
-void ToFManager::update() {
-    VL53L4CX_MultiRangingData_t data;
-    uint8_t ready = 0;
-    uint8_t status = 0;
+bool ToFManager::update() {
+    PROFILE_SCOPE("ToF.update");
+    RangeSample sample;
+    bool ready = false;
+    int status = 0;
+    bool newData = false;
+    bool reconfigured = false; // Al più una riconfigurazione per giro
+
+    recoveryStep(halMicros());
+
+    for (int i = 0; i < TOF_COUNT; i++) {
+        if (!_sensors[i].isOnline) continue;
+        RangingDevice* dev = _sensors[i].device;
+
+        // Il bus si tocca solo quando la misura è attesa (o GPIO1 l'ha segnalata)
+        ToFScheduler::Action action = _scheduler.nextAction(i, halMicros());
+        if (action == ToFScheduler::IDLE) continue;
+
+        if (action == ToFScheduler::POLL) {
+            // Controllo non bloccante (transazione a sé: l'IMU può passare prima del download)
+            status = dev->checkDataReady(ready);
+            _scheduler.onPollResult(i, halMicros(), status == 0 && ready);
+            if (status != 0) { // Status 0 = VL53L4CX_ERROR_NONE
+                _sensors[i].health.onError(halMicros());
+                continue;
+            }
+            if (!ready) continue;
+        }
+
+        uint32_t readStart = halMicros();
+        status = dev->readRange(sample);
+        _scheduler.onReadComplete(i, readStart, halMicros());
+
+        if (status == 0) {
+            newData = true;
+            _sampleTimeUs = halMicros();
 
+            // Storico + Hampel: fuori portata (TOF_NO_OBJECT_MM) e RangeStatus != 0
+            // (4 = Phase Fail, ...) restano nello storico ma non toccano il filtro
+            const ToFSample& s = _sensors[i].history.push(sample, _sampleTimeUs);
+            bool valid = s.flags & TOF_SAMPLE_VALID;
+            _readings.distance_mm[i] = valid ? s.filtered_mm : s.distance_mm;
+            _readings.valid[i] = valid;
+            _readings.timestampUs[i] = _sampleTimeUs;
+
+            if (_recorder) _recorder->logToFRaw(i, s.rangeStatus, s.distance_mm, _sampleTimeUs);
+#if TOF_ADAPTIVE_RANGING
+            if (!reconfigured) reconfigured = adaptRanging(i, s);
+#endif
+            _sensors[i].health.onSuccess(_sampleTimeUs);
+        } else {
+            _sensors[i].health.onError(halMicros());
+        }
+    }
+
+    // Errori di fila o nessuna misura da troppo: il sensore esce dal giro
+    uint32_t now = halMicros();
     for (int i = 0; i < TOF_COUNT; i++) {
-        if (!_sensors[i].isOnline || !_sensors[i].driver) continue;
-
-        // Controllo non bloccante
-        status = _sensors[i].driver->VL53L4CX_GetMeasurementDataReady(&ready);
-
-        if (status == 0 && ready) { // Status 0 = VL53L4CX_ERROR_NONE
-
-            status = _sensors[i].driver->VL53L4CX_GetMultiRangingData(&data);
-
-            // Pulisci interrupt IMMEDIATAMENTE dopo la lettura
-            _sensors[i].driver->VL53L4CX_ClearInterruptAndStartMeasurement();
-
-            if (status == 0) {
-                if (data.NumberOfObjectsFound > 0) {
-                    // Validiamo lo status hardware del range (0 = Ok, 4 = Phase Fail, etc)
-                    if (data.RangeData[0].RangeStatus == 0) {
-                        _sensors[i].lastDistance = data.RangeData[0].RangeMilliMeter;
-                        _sensors[i].dataValid = true;
-                    } else {
-                        // Oggetto visto ma lettura sporca
-                        _sensors[i].lastDistance = data.RangeData[0].RangeMilliMeter;
-                        _sensors[i].dataValid = false;
-                    }
-                } else {
-                    // Nessun oggetto (Out of range)
-                    _sensors[i].lastDistance = 8888; // <--- MODIFICA QUI
-                    _sensors[i].dataValid = false;
+        if (_sensors[i].isOnline && _sensors[i].health.check(now)) takeOffline(i, now);
+    }
+    return newData;
+}
+
+// ============================================================================
+// Re-init in background
+// ============================================================================
+
+void ToFManager::takeOffline(int i, uint32_t nowUs) {
+    SensorUnit& s = _sensors[i];
+    halLog("[ToF] %s: guasto (ultima misura %lu ms fa), re-init in background\n", sensorName(i),
+           (unsigned long)(s.health.ageUs(nowUs) / 1000));
+    s.isOnline = false;
+    _scheduler.disable(i);
+    _readings.distance_mm[i] = -1;
+    _readings.valid[i] = false;
+    s.history.clear();
+    // XSHUT basso: il sensore non torna a 0x29 finché non è il suo turno
+    s.device->release();
+}
+
+void ToFManager::recoveryStep(uint32_t nowUs) {
+    if (_bootState != TOF_BOOT_DONE && _bootState != TOF_BOOT_FAILED) return;
+
+    switch (_recoverState) {
+        case TOF_RECOVER_IDLE: {
+            // A turno dal sensore dopo l'ultimo tentato: nessuno resta indietro
+            for (int k = 1; k <= TOF_COUNT; k++) {
+                int i = (_recoverIndex + k) % TOF_COUNT;
+                if (!_sensors[i].device || !_sensors[i].health.retryDue(nowUs)) continue;
+
+                RangingDevice* dev = _sensors[i].device;
+                halLog("[ToF] %s: re-init (tentativo %lu)...\n", dev->name(),
+                       (unsigned long)_sensors[i].health.failedReinits() + 1);
+                // Sempre da spento: un sensore rimasto a metà non risponde all'init
+                dev->release();
+                _sensors[i].health.beginRecovery(nowUs);
+                _recoverIndex = (uint8_t)i;
+                _recoverWaitUntilUs = nowUs + TOF_BOOT_SHUTDOWN_US;
+                _recoverState = TOF_RECOVER_SHUTDOWN;
+                return;
+            }
+            return;
+        }
+
+        case TOF_RECOVER_SHUTDOWN:
+            if ((int32_t)(nowUs - _recoverWaitUntilUs) < 0) return;
+            _sensors[_recoverIndex].device->powerUp();
+            _recoverWaitUntilUs = nowUs + TOF_BOOT_FIRMWARE_US;
+            _recoverState = TOF_RECOVER_FIRMWARE;
+            return;
+
+        case TOF_RECOVER_FIRMWARE: {
+            if ((int32_t)(nowUs - _recoverWaitUntilUs) < 0) return;
+            // Unico sensore a 0x29: gli altri sono al loro indirizzo o spenti
+            if (!probeAtDefault(_recoverIndex)) {
+                endRecovery();
+                return;
+            }
+            // InitSensor blocca per decine di ms: qui solo l'avvio, il loop continua
+            BootStatus status = _sensors[_recoverIndex].device->initStart();
+            if (status == BOOT_PENDING) {
+                _recoverWaitUntilUs = nowUs + TOF_RECOVER_INIT_TIMEOUT_US;
+                _recoverState = TOF_RECOVER_INIT;
+                return;
+            }
+            finishInit(_recoverIndex, status == BOOT_DONE);
+            endRecovery();
+            return;
+        }
+
+        case TOF_RECOVER_INIT: {
+            RangingDevice* dev = _sensors[_recoverIndex].device;
+            BootStatus status = dev->initPoll();
+            if (status == BOOT_PENDING) {
+                // Init bloccato sul bus: XSHUT basso, i trasferimenti falliscono e il task si libera
+                if ((int32_t)(nowUs - _recoverWaitUntilUs) >= 0) {
+                    halLog("[ToF] %s: init oltre %lu ms, sensore spento\n", dev->name(),
+                           (unsigned long)(TOF_RECOVER_INIT_TIMEOUT_US / 1000));
+                    dev->powerDown();
+                    _recoverWaitUntilUs = nowUs + TOF_RECOVER_INIT_TIMEOUT_US;
                 }
+                return;
             }
+            finishInit(_recoverIndex, status == BOOT_DONE);
+            endRecovery();
+            return;
         }
     }
 }
 
-ToFData ToFManager::getReadings() {
-    ToFData d;
+void ToFManager::endRecovery() {
+    SensorUnit& s = _sensors[_recoverIndex];
+    s.health.endRecovery(s.isOnline, halMicros());
+    if (s.isOnline) {
+        halLog("[ToF] %s: recuperato in %.0f ms (re-init %lu)\n", sensorName(_recoverIndex),
+               s.health.lastRecoveryUs() / 1000.0f, (unsigned long)s.health.reinits());
+    }
+    _recoverState = TOF_RECOVER_IDLE;
+}
+
+bool ToFManager::getFiltered(ToFPosition pos, int16_t& distanceMm, uint32_t& ageUs) const {
+    const ToFHistory& h = _sensors[pos].history;
+    if (!_sensors[pos].isOnline || !h.hasFiltered()) return false;
+    distanceMm = h.filtered();
+    ageUs = h.ageUs(halMicros());
+    return true;
+}
+
+ToFSchedulerStats ToFManager::getSchedulerStats(ToFPosition pos) const {
+    return _scheduler.getStats(pos);
+}
+
+void ToFManager::printSchedulerStats() const {
+    halLog("[ToF] Sensore      |   Hz  | Poll  | Sprecati | Periodo(us) | Lettura avg/max(us) | Modo   | Budget(ms) | Cambi\n");
     for (int i = 0; i < TOF_COUNT; i++) {
-        d.distance_mm[i] = _sensors[i].isOnline ? _sensors[i].lastDistance : -1;
-        d.valid[i] = _sensors[i].isOnline ? _sensors[i].dataValid : false;
+        if (!_sensors[i].isOnline) {
+            halLog("[ToF] %-11s | OFFLINE\n", sensorName(i));
+            continue;
+        }
+        ToFSchedulerStats st = _scheduler.getStats(i);
+        const ToFRangingConfig& rc = _policy.current(i);
+        halLog("[ToF] %-11s | %5.1f | %5u | %8u | %11u | %6.0f / %-10u | %-6s | %10.1f | %u\n",
+               sensorName(i), st.achievedHz, st.polls, st.wastedPolls,
+               st.periodUs, st.avgReadLatencyUs, st.maxReadLatencyUs,
+               ToFRangingPolicy::modeName(rc.mode), rc.budgetUs / 1000.0f, _policy.changes(i));
     }
-    return d;
-}
\ No newline at end of file
+}
+
+void ToFManager::printHealth() const {
+    uint32_t now = halMicros();
+    for (int i = 0; i < TOF_COUNT; i++) {
+        if (_sensors[i].device) _sensors[i].health.print(sensorName(i), now);
+    }
+}
@@ -0,0 +1,66 @@
+#include "ToFRangingPolicy.h"
+
+ToFRangingPolicy::ToFRangingPolicy() {
+    for (uint8_t i = 0; i < TOF_COUNT; i++) {
+        ToFRangingConfig def = {TOF_MODE_LONG, TOF_BUDGET_DEFAULT_US};
+        reset(i, def, 0);
+    }
+}
+
+void ToFRangingPolicy::reset(uint8_t index, const ToFRangingConfig& current, uint32_t nowUs) {
+    if (index >= TOF_COUNT) return;
+    Slot& s = _slots[index];
+    s.current = current;
+    s.holdUntilUs = nowUs;
+    s.changes = 0;
+    s.farMode = current.mode == TOF_MODE_LONG;
+}
+
+bool ToFRangingPolicy::evaluate(uint8_t index, int16_t distanceMm, RobotMotion motion, uint32_t nowUs,
+                                ToFRangingConfig& out) {
+    if (index >= TOF_COUNT || distanceMm < 0) return false;
+    Slot& s = _slots[index];
+
+    // Isteresi aggiornata a ogni misura, anche durante il tempo minimo
+    if (distanceMm >= TOF_NO_OBJECT_MM || distanceMm > TOF_POLICY_LONG_ABOVE_MM) s.farMode = true;
+    else if (distanceMm < TOF_POLICY_SHORT_BELOW_MM) s.farMode = false;
+
+    if ((int32_t)(nowUs - s.holdUntilUs) < 0) return false;
+
+    out.mode = s.farMode ? TOF_MODE_LONG : TOF_MODE_SHORT;
+    if (s.farMode) {
+        // In LONG la portata ha bisogno di tempo di integrazione
+        out.budgetUs = motion == MOTION_STATIONARY ? TOF_BUDGET_SLOW_US : TOF_BUDGET_DEFAULT_US;
+    } else if (motion == MOTION_TURNING || distanceMm < TOF_POLICY_NEAR_MM) {
+        out.budgetUs = TOF_BUDGET_FAST_US;
+    } else if (motion == MOTION_STATIONARY) {
+        out.budgetUs = TOF_BUDGET_SLOW_US;
+    } else {
+        out.budgetUs = TOF_BUDGET_DEFAULT_US;
+    }
+
+    return out.mode != s.current.mode || out.budgetUs != s.current.budgetUs;
+}
+
+void ToFRangingPolicy::onApplied(uint8_t index, const ToFRangingConfig& applied, uint32_t nowUs) {
+    if (index >= TOF_COUNT) return;
+    Slot& s = _slots[index];
+    s.current = applied;
+    s.holdUntilUs = nowUs + TOF_POLICY_HOLD_US;
+    s.changes++;
+}
+
+void ToFRangingPolicy::onFailed(uint8_t index, uint32_t nowUs) {
+    if (index >= TOF_COUNT) return;
+    // Si riprova più tardi, non a ogni misura
+    _slots[index].holdUntilUs = nowUs + TOF_POLICY_HOLD_US;
+}
+
+const char* ToFRangingPolicy::modeName(ToFDistanceMode mode) {
+    switch (mode) {
+        case TOF_MODE_SHORT:  return "SHORT";
+        case TOF_MODE_MEDIUM: return "MEDIUM";
+        case TOF_MODE_LONG:   return "LONG";
+    }
+    return "?";
+}
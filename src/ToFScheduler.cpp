@@ -0,0 +1,132 @@
+#include "ToFScheduler.h"
+
+#include <string.h>
+
+// Peso dei nuovi campioni nelle medie mobili (1/8)
+static const float SCHED_EMA = 0.125f;
+
+ToFScheduler::ToFScheduler() {
+    for (int i = 0; i < TOF_COUNT; i++) {
+        Slot& s = _slots[i];
+        s.enabled = false;
+        s.irqMode = false;
+        s.missedSinceRestart = false;
+        s.restartUs = s.nextPollUs = s.lastMissUs = s.lastCompleteUs = 0;
+        s.periodUs = s.intervalUs = s.readLatencyUs = 0.0f;
+        memset(&s.stats, 0, sizeof(ToFSchedulerStats));
+        s.irqPending.store(false);
+    }
+}
+
+void ToFScheduler::configure(uint8_t index, uint32_t timingBudgetUs, uint32_t nowUs) {
+    if (index >= TOF_COUNT) return;
+    Slot& s = _slots[index];
+
+    s.enabled = true;
+    s.missedSinceRestart = false;
+    s.restartUs = nowUs;
+    s.lastCompleteUs = nowUs;
+    s.periodUs = (float)(timingBudgetUs + TOF_SCHED_OVERHEAD_US);
+    s.intervalUs = s.periodUs;
+    s.irqPending.store(false);
+    scheduleNext(s);
+}
+
+void ToFScheduler::disable(uint8_t index) {
+    if (index >= TOF_COUNT) return;
+    _slots[index].enabled = false;
+}
+
+void ToFScheduler::setInterruptDriven(uint8_t index, bool enabled) {
+    if (index >= TOF_COUNT) return;
+    _slots[index].irqMode = enabled;
+}
+
+void ToFScheduler::scheduleNext(Slot& s) {
+    uint32_t lead = (uint32_t)s.periodUs;
+    lead = (lead > TOF_SCHED_GUARD_US) ? lead - TOF_SCHED_GUARD_US : 0;
+    s.nextPollUs = s.restartUs + lead;
+}
+
+ToFScheduler::Action ToFScheduler::nextAction(uint8_t index, uint32_t nowUs) const {
+    if (index >= TOF_COUNT) return IDLE;
+    const Slot& s = _slots[index];
+    if (!s.enabled) return IDLE;
+
+    if (s.irqMode) {
+        if (s.irqPending.load(std::memory_order_acquire)) return READ;
+        // Rete di sicurezza: interrupt perso o linea scollegata
+        uint32_t timeout = (uint32_t)(s.periodUs * TOF_SCHED_IRQ_TIMEOUT_PERIODS);
+        return reached(nowUs, s.restartUs + timeout) ? POLL : IDLE;
+    }
+
+    return reached(nowUs, s.nextPollUs) ? POLL : IDLE;
+}
+
+void ToFScheduler::onPollResult(uint8_t index, uint32_t nowUs, bool ready) {
+    if (index >= TOF_COUNT) return;
+    Slot& s = _slots[index];
+    s.stats.polls++;
+
+    if (ready) {
+        // Il dato è diventato pronto tra l'ultimo poll negativo e questo.
+        // Senza poll negativi sappiamo solo che era già pronto: stimiamo un
+        // po' prima, così il prossimo poll anticipa fino a trovare il confine.
+        float readyAt;
+        if (s.missedSinceRestart) {
+            readyAt = (float)(s.lastMissUs - s.restartUs) + (float)(nowUs - s.lastMissUs) * 0.5f;
+        } else {
+            readyAt = (float)(nowUs - s.restartUs) - TOF_SCHED_RETRY_US * 0.5f;
+            // È solo un limite superiore: un poll in ritardo (loop fermo, fine
+            // dell'avvio) non deve allungare il periodo appreso
+            if (readyAt > s.periodUs) return;
+        }
+        if (readyAt < 0.0f) readyAt = 0.0f;
+        s.periodUs += (readyAt - s.periodUs) * SCHED_EMA;
+        return;
+    }
+
+    s.stats.wastedPolls++;
+    s.missedSinceRestart = true;
+    s.lastMissUs = nowUs;
+    s.nextPollUs = nowUs + TOF_SCHED_RETRY_US;
+}
+
+void ToFScheduler::onReadComplete(uint8_t index, uint32_t startUs, uint32_t endUs) {
+    if (index >= TOF_COUNT) return;
+    Slot& s = _slots[index];
+
+    float latency = (float)(endUs - startUs);
+    if (s.stats.measurements == 0) s.readLatencyUs = latency;
+    else s.readLatencyUs += (latency - s.readLatencyUs) * SCHED_EMA;
+    if ((uint32_t)latency > s.stats.maxReadLatencyUs) s.stats.maxReadLatencyUs = (uint32_t)latency;
+
+    float interval = (float)(endUs - s.lastCompleteUs);
+    s.intervalUs += (interval - s.intervalUs) * SCHED_EMA;
+    s.lastCompleteUs = endUs;
+    s.stats.measurements++;
+
+    // ClearInterruptAndStartMeasurement appena eseguito: nuovo ciclo
+    s.restartUs = endUs;
+    s.missedSinceRestart = false;
+    s.irqPending.store(false, std::memory_order_release);
+    scheduleNext(s);
+}
+
+void ToFScheduler::notifyDataReady(uint8_t index) {
+    if (index >= TOF_COUNT) return;
+    _slots[index].irqPending.store(true, std::memory_order_release);
+}
+
+ToFSchedulerStats ToFScheduler::getStats(uint8_t index) const {
+    ToFSchedulerStats out;
+    memset(&out, 0, sizeof(out));
+    if (index >= TOF_COUNT) return out;
+
+    const Slot& s = _slots[index];
+    out = s.stats;
+    out.periodUs = (uint32_t)s.periodUs;
+    out.avgReadLatencyUs = s.readLatencyUs;
+    out.achievedHz = (s.stats.measurements > 0 && s.intervalUs > 0.0f) ? 1000000.0f / s.intervalUs : 0.0f;
+    return out;
+}
@@ -0,0 +1,119 @@
+#include "WallEstimator.h"
+
+#include <math.h>
+#include <string.h>
+
+static const float RAD_TO_DEG_F = 57.29578f;
+static const float DEG_TO_RAD_F = 0.01745329f;
+
+// Sensori di ogni lato: anteriore, posteriore
+static const uint8_t SIDE_FRONT[2] = {TOF_FRONT_LEFT, TOF_FRONT_RIGHT};
+static const uint8_t SIDE_BACK[2] = {TOF_BACK_LEFT, TOF_BACK_RIGHT};
+
+// Lettura valida di un muro del lato della piastrella attuale
+static bool isNear(const ToFData& tof, uint8_t i) {
+    return tof.valid[i] && tof.distance_mm[i] >= 0 && tof.distance_mm[i] < WALL_DETECT_MM;
+}
+
+WallEstimator::WallEstimator() : _headingSides(0) {
+    reset();
+}
+
+void WallEstimator::reset() {
+    memset(&_est, 0, sizeof(_est));
+    _est.frontDistanceMm = -1;
+    _headingSides = 0;
+}
+
+float WallEstimator::sensorVote(const ToFData& tof, uint8_t i) {
+    if (tof.distance_mm[i] < 0) return -1.0f;  // Offline: non vota
+    // Fuori portata o errore lontano: niente muro su questo lato
+    return isNear(tof, i) ? 1.0f : 0.0f;
+}
+
+void WallEstimator::vote(WallSide side, float v) {
+    if (v < 0.0f) return;
+    float& c = _est.confidence[side];
+    c += WALL_CONFIDENCE_ALPHA * (v - c);
+    if (c >= WALL_PRESENT_ON) _est.present[side] = true;
+    else if (c <= WALL_PRESENT_OFF) _est.present[side] = false;
+}
+
+void WallEstimator::update(const ToFData& tof) {
+    // --- Presenza: media dei voti dei sensori accesi del lato ---
+    for (uint8_t s = 0; s < 2; s++) {
+        float a = sensorVote(tof, SIDE_FRONT[s]);
+        float b = sensorVote(tof, SIDE_BACK[s]);
+        if (a < 0.0f) a = b;
+        else if (b >= 0.0f) a = 0.5f * (a + b);
+        vote((WallSide)s, a);
+    }
+    vote(WALL_FRONT, sensorVote(tof, TOF_CENTER));
+
+    // --- Direzione: ogni coppia che vede lo stesso muro dà un angolo ---
+    // Ruotando a sinistra il sensore anteriore sinistro si avvicina al muro, il destro si allontana
+    float headingSum = 0.0f;
+    uint8_t headingCount = 0;
+    float sideMm[2] = {0.0f, 0.0f};
+    bool sideOk[2] = {false, false};
+    _headingSides = 0;
+    for (uint8_t s = 0; s < 2; s++) {
+        bool nearFront = isNear(tof, SIDE_FRONT[s]);
+        bool nearBack = isNear(tof, SIDE_BACK[s]);
+        float df = tof.distance_mm[SIDE_FRONT[s]];
+        float db = tof.distance_mm[SIDE_BACK[s]];
+        sideOk[s] = nearFront || nearBack;
+
+        if (nearFront && nearBack) {
+            float diff = (s == WALL_LEFT) ? (db - df) : (df - db);
+            float e = atan2f(diff, TOF_SIDE_BASELINE_MM) * RAD_TO_DEG_F;
+            if (fabsf(e) > WALL_PAIR_MAX_HEADING_DEG) {
+                sideOk[s] = false;  // Le due letture non sono dello stesso muro
+                continue;
+            }
+            headingSum += e;
+            headingCount++;
+            _headingSides |= (uint8_t)(1u << s);
+            sideMm[s] = 0.5f * (df + db);
+        } else if (sideOk[s]) {
+            sideMm[s] = nearFront ? df : db;
+        }
+    }
+
+    _est.headingValid = headingCount > 0;
+    _est.headingErrorDeg = headingCount ? headingSum / headingCount : 0.0f;
+    // Senza angolo misurato si assume il robot allineato
+    float cosHeading = cosf(_est.headingErrorDeg * DEG_TO_RAD_F);
+
+    // --- Offset laterale: distanze perpendicolari dal centro del robot ---
+    float left = (sideMm[WALL_LEFT] + TOF_SIDE_OFFSET_MM) * cosHeading;
+    float right = (sideMm[WALL_RIGHT] + TOF_SIDE_OFFSET_MM) * cosHeading;
+    _est.lateralValid = sideOk[WALL_LEFT] || sideOk[WALL_RIGHT];
+    if (sideOk[WALL_LEFT] && sideOk[WALL_RIGHT]) {
+        _est.lateralOffsetMm = 0.5f * (left - right);
+    } else if (sideOk[WALL_LEFT]) {
+        _est.lateralOffsetMm = left - 0.5f * MAZE_TILE_MM;
+    } else if (sideOk[WALL_RIGHT]) {
+        _est.lateralOffsetMm = 0.5f * MAZE_TILE_MM - right;
+    } else {
+        _est.lateralOffsetMm = 0.0f;
+    }
+
+    _est.frontDistanceMm = tof.valid[TOF_CENTER] && tof.distance_mm[TOF_CENTER] >= 0
+        ? (int16_t)((tof.distance_mm[TOF_CENTER] + TOF_CENTER_OFFSET_MM) * cosHeading)
+        : -1;
+}
+
+float WallEstimator::yawCorrection(float yawDeg) const {
+    if (!_est.headingValid) return 0.0f;
+    for (uint8_t s = 0; s < 2; s++) {
+        if ((_headingSides & (1u << s)) && _est.confidence[s] < WALL_YAW_MIN_CONFIDENCE) return 0.0f;
+    }
+
+    // Yaw vero = k * 90 + errore misurato, con k il multiplo più vicino
+    float e = _est.headingErrorDeg;
+    float k = roundf((yawDeg - e) / 90.0f);
+    float drift = yawDeg - (k * 90.0f + e);
+    if (fabsf(drift) > WALL_YAW_MAX_DRIFT_DEG) return 0.0f;
+    return -WALL_YAW_GAIN * drift;
+}
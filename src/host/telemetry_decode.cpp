@@ -0,0 +1,144 @@
+/**
+ * @file telemetry_decode.cpp
+ * @brief Decoder host della telemetria binaria: un CSV per tipo di record.
+ *
+ * Uso:
+ *   telemetry_decode [file|-] [prefisso]
+ *
+ * Legge il flusso grezzo della seriale (file catturato o stdin, es.
+ * `cat /dev/ttyACM0 | telemetry_decode - run1`) e scrive
+ * <prefisso>_tof.csv, _imu.csv, _spectral.csv, _color.csv, _floor.csv e, per i dump del
+ * registratore di volo, _imu_raw.csv, _tof_raw.csv, _spectral_raw.csv.
+ * Testo di debug e frame corrotti vengono scartati dal decoder;
+ * il riepilogo finale va su stderr.
+ *
+ * Build: pio run -e telemetry_decoder (binario in .pio/build/telemetry_decoder/program).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Telemetry.h"
+
+static const char* COLOR_NAMES[] = {"NONE", "BLACK", "SILVER", "WHITE", "RED", "BLUE"};
+
+static FILE* openCsv(const char* prefix, const char* suffix, const char* header) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s_%s.csv", prefix, suffix);
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Impossibile creare %s\n", path);
+        return nullptr;
+    }
+    fprintf(f, "%s\n", header);
+    return f;
+}
+
+int main(int argc, char** argv) {
+    const char* input = argc > 1 ? argv[1] : "-";
+    const char* prefix = argc > 2 ? argv[2] : "telemetry";
+
+    FILE* in = strcmp(input, "-") == 0 ? stdin : fopen(input, "rb");
+    if (!in) {
+        fprintf(stderr, "Impossibile aprire %s\n", input);
+        return 1;
+    }
+
+    FILE* tof = openCsv(prefix, "tof", "seq,t_us,d0_mm,d1_mm,d2_mm,d3_mm,d4_mm,valid_mask");
+    FILE* imu = openCsv(prefix, "imu", "seq,t_us,yaw,pitch,roll");
+    FILE* spectral = openCsv(prefix, "spectral", "seq,t_us,violet,blue,green,yellow,orange,red,sum");
+    FILE* color = openCsv(prefix, "color", "seq,t_us,type,class_id,distance");
+    FILE* floorEvents = openCsv(prefix, "floor", "seq,t_us,from,to,class_id,confidence,confirm_us");
+    FILE* imuRaw = openCsv(prefix, "imu_raw", "seq,t_us,ax,ay,az,gx,gy,gz");
+    FILE* tofRaw = openCsv(prefix, "tof_raw", "seq,t_us,sensor,range_status,distance_mm");
+    FILE* spectralRaw = openCsv(prefix, "spectral_raw", "seq,t_us,violet,blue,green,yellow,orange,red,sum");
+    if (!tof || !imu || !spectral || !color || !floorEvents || !imuRaw || !tofRaw || !spectralRaw) return 1;
+
+    TelemetryDecoder decoder;
+    uint32_t badVersion = 0;
+    uint32_t badRecord = 0;
+
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            TelemetryDecoder::Result r = decoder.feed(buf[i]);
+            if (r == TelemetryDecoder::BAD_VERSION) badVersion++;
+            if (r == TelemetryDecoder::BAD_RECORD) badRecord++;
+            if (r != TelemetryDecoder::RECORD) continue;
+
+            const TelemetryHeader& h = decoder.header();
+            switch (h.type) {
+                case TLM_TOF: {
+                    TelemetryToF rec;
+                    memcpy(&rec, decoder.payload(), sizeof(rec));
+                    fprintf(tof, "%u,%u", h.sequence, h.timestampUs);
+                    for (int s = 0; s < TOF_COUNT; s++) fprintf(tof, ",%d", rec.distance_mm[s]);
+                    fprintf(tof, ",%u\n", rec.validMask);
+                    break;
+                }
+                case TLM_IMU: {
+                    TelemetryImu rec;
+                    memcpy(&rec, decoder.payload(), sizeof(rec));
+                    fprintf(imu, "%u,%u,%.3f,%.3f,%.3f\n", h.sequence, h.timestampUs, rec.yaw, rec.pitch, rec.roll);
+                    break;
+                }
+                case TLM_SPECTRAL:
+                case TLM_SPECTRAL_RAW: {
+                    TelemetrySpectral rec;
+                    memcpy(&rec, decoder.payload(), sizeof(rec));
+                    FILE* f = h.type == TLM_SPECTRAL ? spectral : spectralRaw;
+                    fprintf(f, "%u,%u", h.sequence, h.timestampUs);
+                    for (int c = 0; c < CH_COUNT; c++) fprintf(f, ",%.2f", rec.channels[c]);
+                    fprintf(f, ",%.2f\n", rec.sum);
+                    break;
+                }
+                case TLM_IMU_RAW: {
+                    TelemetryImuRaw rec;
+                    memcpy(&rec, decoder.payload(), sizeof(rec));
+                    fprintf(imuRaw, "%u,%u,%d,%d,%d,%d,%d,%d\n", h.sequence, h.timestampUs,
+                            rec.ax, rec.ay, rec.az, rec.gx, rec.gy, rec.gz);
+                    break;
+                }
+                case TLM_TOF_RAW: {
+                    TelemetryToFRaw rec;
+                    memcpy(&rec, decoder.payload(), sizeof(rec));
+                    fprintf(tofRaw, "%u,%u,%u,%u,%d\n", h.sequence, h.timestampUs,
+                            rec.sensor, rec.rangeStatus, rec.distance_mm);
+                    break;
+                }
+                case TLM_COLOR: {
+                    TelemetryColor rec;
+                    memcpy(&rec, decoder.payload(), sizeof(rec));
+                    const char* name = rec.type < sizeof(COLOR_NAMES) / sizeof(COLOR_NAMES[0])
+                                       ? COLOR_NAMES[rec.type] : "?";
+                    fprintf(color, "%u,%u,%s,%d,%.4f\n", h.sequence, h.timestampUs, name, rec.classId, rec.distance);
+                    break;
+                }
+                case TLM_FLOOR_EVENT: {
+                    TelemetryFloorEvent rec;
+                    memcpy(&rec, decoder.payload(), sizeof(rec));
+                    const size_t names = sizeof(COLOR_NAMES) / sizeof(COLOR_NAMES[0]);
+                    fprintf(floorEvents, "%u,%u,%s,%s,%d,%.3f,%u\n", h.sequence, h.timestampUs,
+                            rec.from < names ? COLOR_NAMES[rec.from] : "?", rec.to < names ? COLOR_NAMES[rec.to] : "?",
+                            rec.toClass, rec.confidence, rec.confirmUs);
+                    break;
+                }
+            }
+        }
+    }
+
+    fprintf(stderr, "Record: %u | Persi (sequenza): %u | Frame scartati: %u | Versione errata: %u | Tipo sconosciuto: %u\n",
+            decoder.records(), decoder.lostRecords(), decoder.badFrames(), badVersion, badRecord);
+
+    if (in != stdin) fclose(in);
+    fclose(tof);
+    fclose(imu);
+    fclose(spectral);
+    fclose(color);
+    fclose(floorEvents);
+    fclose(imuRaw);
+    fclose(tofRaw);
+    fclose(spectralRaw);
+    return 0;
+}
@@ -3,13 +3,60 @@
 #include <Adafruit_NeoPixel.h>
 #include "Pins.h"
 #include "Constants.h"
+#include "I2CBus.h"
+#include "HalEsp32.h"
 #include "ColorManager.h"
+#include "ImuManager.h"
+#include "ToFManager.h"
+#include "BootSequence.h"
+#include "SensorTask.h"
+#include "TelemetryWriter.h"
+#include "FlightRecorder.h"
+#include "FlightRecorderIO.h"
+#include "MotorController.h"
+#include "HoleReflex.h"
+#include "ControlTask.h"
+#include "Profiler.h"
+#include "AllocAudit.h"
 
 #define PIN_RGB_LED 48
 #define NUM_PIXELS 1
 
 Adafruit_NeoPixel pixels(NUM_PIXELS, PIN_RGB_LED, NEO_GRB + NEO_KHZ800);
-ColorManager colorMgr;
+I2CBus i2cBus(Wire);
+
+// Dispositivi reali (HalEsp32.h): i manager vedono solo le interfacce di Hal.h
+Mpu9250Device imuDevice(i2cBus);
+As7262Device spectralDevice(i2cBus);
+NvsStorage calibStorage;
+// ToF del telaio scelto (RobotLayout.h), uno per sensore montato
+Vl53l4cxArray<RobotLayout> tofArray(i2cBus);
+static_assert(!layout_check::usesAnyPin<RobotLayout>({PIN_I2C_SDA, PIN_I2C_SCL, PIN_M1PWM, PIN_M1DIR, PIN_M1EN,
+                                                    PIN_M2PWM, PIN_M2DIR, PIN_M2EN, PIN_M1ENB, PIN_M2ENB,
+                                                    PIN_MOTOR_DIAG, PIN_M1CS, PIN_M2CS, PIN_RGB_LED}),
+              "RobotLayout: pin ToF già usato da I2C, motori o LED");
+
+ColorManager colorMgr(spectralDevice, calibStorage);
+ImuManager imu(imuDevice);
+ToFManager tofMgr(tofArray.devices());
+BootSequence boot(&tofMgr, &imu, &colorMgr);
+// Acquisizione su core 0: qui (core 1) si leggono solo gli snapshot.
+// Creato dopo l'avvio, con i soli sensori partiti correttamente.
+SensorTask* sensorTask = nullptr;
+// Flusso binario sulla stessa seriale (decoder: src/host/telemetry_decode.cpp)
+TelemetryWriter telemetry(Serial);
+// Tutti i campioni grezzi e filtrati della prova, in PSRAM
+FlightRecorder recorder;
+// Motori frenati finché il controllo non li comanda
+MotorController motors;
+// Anello a 500 Hz su timer hardware (core 1), creato dopo il task sensori
+ControlTask* controlTask = nullptr;
+// Freno sul buco nero dal task sensori, appena arriva il campione AS7262
+HoleReflex holeReflex(motors);
+
+// Colore della piastrella per il LED: cambia solo con gli eventi del pavimento
+int8_t ledFloorSub = -1;
+ColorType ledFloorColor = COLOR_NONE;
 
 unsigned long lastPrintTime = 0;
 const unsigned long PRINT_INTERVAL = 200;
@@ -17,15 +64,31 @@ const unsigned long PRINT_INTERVAL = 200;
 void printMenu() {
     Serial.println("\n--- CLIMBER COLOR VISUALIZER ---");
     Serial.println("[w] -> Calibra BIANCO (Reference)");
-    Serial.println("[n] -> Calibra NERO (Soglia dinamica)");
+    Serial.println("[n] -> Calibra NERO (Soglia dinamica, disarma il riflesso)");
     Serial.println("[r] -> Calibra ROSSO");
     Serial.println("[b] -> Calibra BLU");
+    Serial.println("[c<nome>] -> Nuovo colore dal campione attuale (es. cVERDE)");
+    Serial.println("[p<nome>] -> Attiva/crea profilo di calibrazione (es. pARENA2)");
+    Serial.println("[l] -> Elenco profili");
     Serial.println("[e] -> ESPORTA Calibrazioni per Constants.h"); // NUOVO COMANDO
+    Serial.println("[i] -> Statistiche bus I2C");
+    Serial.println("[t] -> Timeline di avvio");
+    Serial.println("[x] -> Telemetria binaria ON/OFF");
+    Serial.println("[f] -> Registratore di volo START/STOP");
+    Serial.println("[d] -> Scarica registrazione (binario, telemetry_decode)");
+    Serial.println("[s] -> Salva registrazione su flash / [o] -> scarica il file salvato");
+    Serial.println("[m] -> Stato motori / [M] -> Azzera guasti motori");
+    Serial.println("[h] -> Mantenimento direzione ON/OFF / [j] -> Tempi del controllo");
+    Serial.println("[u] -> Profiler / [U] -> Azzera profiler / [g] -> Traccia START/STOP (JSON Chrome)");
+    Serial.println("[k] -> Salute sensori (errori, re-init, tempi di recupero)");
+    Serial.println("[z] -> Riflesso buco nero: stato e latenze / [Z] -> Rilascia i motori (riarma)");
+    Serial.println("[R] -> Riarma il riflesso (dopo la calibrazione del nero)");
+    Serial.println("[a] -> Allocazioni dinamiche dopo l'avvio");
     Serial.println("--------------------------------");
 }
 
 void setup() {
-    delay(2000); // Essenziale per ESP32-S3 USB Nativa
+    // Niente attesa della USB nativa: la timeline resta disponibile con [t]
     Serial.begin(115200);
 
     pixels.begin();
@@ -33,15 +96,88 @@ void setup() {
     pixels.clear();
     pixels.show();
 
-    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
+    if (!i2cBus.begin(PIN_I2C_SDA, PIN_I2C_SCL)) {
+        Serial.println("ERRORE: Bus I2C non avviato!");
+        while (1) { delay(100); }
+    }
+
+    Serial.printf("Telaio: %s (%u ToF)\n", RobotLayout::NAME, (unsigned)RobotLayout::TOF_N);
 
-    if (!colorMgr.begin(&Wire)) {
+    // IMU, ToF e AS7262 in parallelo: le attese di ciascuno si sovrappongono
+    boot.run();
+    boot.printTimeline();
+
+    if (!boot.isReady(BootSequence::BOOT_COLOR)) {
         Serial.println("ERRORE: AS7262 non trovato!");
         while (1) { delay(100); }
     }
 
+    static SensorTask task(boot.isReady(BootSequence::BOOT_TOF) ? &tofMgr : nullptr,
+                           boot.isReady(BootSequence::BOOT_IMU) ? &imu : nullptr,
+                           &colorMgr);
+    sensorTask = &task;
+    if (telemetry.start()) sensorTask->attachSink(&telemetry);
+    else Serial.println("ATTENZIONE: Telemetria non disponibile.");
+
+    if (recorder.begin()) {
+        // Grezzi dai manager, filtrati dal task: tutti scritti dal solo core 0
+        if (boot.isReady(BootSequence::BOOT_IMU)) imu.attachRecorder(&recorder);
+        if (boot.isReady(BootSequence::BOOT_TOF)) tofMgr.attachRecorder(&recorder);
+        colorMgr.attachRecorder(&recorder);
+        sensorTask->attachSink(&recorder);
+        Serial.printf("Registratore: %lu record (%u KB in %s)\n", (unsigned long)recorder.capacity(),
+                      (unsigned)(recorder.bytes() / 1024), recorder.isExternal() ? "PSRAM" : "SRAM");
+    } else {
+        Serial.println("ATTENZIONE: Registratore di volo non disponibile.");
+    }
+    // Abbonati agli eventi del pavimento prima che il task sensori li produca
+    ledFloorSub = colorMgr.floorEvents().subscribe();
+    // Motori prima del task sensori: il riflesso sul buco li comanda da lì
+    bool motorsReady = motors.begin();
+    if (motorsReady) colorMgr.attachReflex(&holeReflex);
+    if (!sensorTask->start()) {
+        Serial.println("ERRORE: Task sensori non avviato!");
+        while (1) { delay(100); }
+    }
+
+    if (!motorsReady) {
+        Serial.println("ATTENZIONE: Driver motori non avviato.");
+    } else {
+        static ControlTask control(*sensorTask, motors);
+        if (control.start()) controlTask = &control;
+        else Serial.println("ATTENZIONE: Task di controllo non avviato.");
+    }
+
+    // Buffer della traccia [g] riservato ora: a regime l'heap non si tocca più
+    if (!profiler().reserveTrace()) Serial.println("ATTENZIONE: Traccia del profiler non disponibile.");
+
     Serial.println("Sensore OK.");
     printMenu();
+
+    // Ultima riga di setup(): da qui ogni allocazione finisce nel rapporto [a]
+    allocAudit().arm();
+}
+
+// Testo del profiler direttamente sulla seriale
+static void writeSerial(const char* text, void*) {
+    Serial.print(text);
+}
+
+// Statistiche scritte dal task sensori: lettura diagnostica, senza lock
+static void printHealth() {
+    uint32_t now = micros();
+    Serial.println("\n--- SALUTE SENSORI ---");
+    DeviceHealth::printHeader();
+    tofMgr.printHealth();
+    imu.getHealth().print("MPU9250", now);
+    colorMgr.getHealth().print("AS7262", now);
+}
+
+// Legge il resto della riga (nome di classe o profilo)
+static void readName(char* name, size_t size) {
+    size_t len = Serial.readBytesUntil('\n', name, size - 1);
+    while (len > 0 && isSpace(name[len - 1])) len--;
+    name[len] = '\0';
 }
 
 void handleSerialInput() {
@@ -50,26 +186,157 @@ void handleSerialInput() {
         while(Serial.available() && isSpace(Serial.peek())) Serial.read();
 
         switch (cmd) {
-            case 'w': colorMgr.calibrate(COLOR_WHITE); Serial.println("BIANCO Calibrato."); break;
-            case 'n': colorMgr.calibrate(COLOR_BLACK); Serial.println("NERO Calibrato."); break;
-            case 'r': colorMgr.calibrate(COLOR_RED);   Serial.println("ROSSO Calibrato."); break;
-            case 'b': colorMgr.calibrate(COLOR_BLUE);  Serial.println("BLU Calibrato."); break;
+            // La calibrazione viene eseguita dal task sensori (core 0)
+            case 'w': sensorTask->requestCalibration(COLOR_WHITE); Serial.println("BIANCO Calibrato."); break;
+            case 'n':
+                // Robot appoggiato sul nero: il riflesso va spento prima, riarmato con [R] fuori dal nero.
+                // Il disarmo si applica al giro del task sensori che poi esegue la calibrazione.
+                holeReflex.requestArmed(false);
+                sensorTask->requestCalibration(COLOR_BLACK);
+                Serial.println("NERO Calibrato. Riflesso disarmato: [R] per riarmarlo.");
+                break;
+            case 'r': sensorTask->requestCalibration(COLOR_RED);   Serial.println("ROSSO Calibrato."); break;
+            case 'b': sensorTask->requestCalibration(COLOR_BLUE);  Serial.println("BLU Calibrato."); break;
             case 'e':
                 // NUOVO COMANDO: Stampa i valori su Seriale
-                colorMgr.exportCalibrationToSerial();
+                sensorTask->requestCalibrationExport();
+                break;
+            case 'c': {
+                // Colore utente: nessuna modifica al codice, solo una nuova riga in tabella
+                char name[SPECTRAL_CLASS_NAME_LEN];
+                readName(name, sizeof(name));
+                if (sensorTask->requestClassDefinition(name)) Serial.printf("%s Calibrato.\n", name);
+                break;
+            }
+            case 'p': {
+                char name[CALIB_PROFILE_NAME_LEN];
+                readName(name, sizeof(name));
+                sensorTask->requestProfile(name);
+                break;
+            }
+            case 'l': sensorTask->requestProfileList(); break;
+            case 'i':
+                i2cBus.printStats();
+                colorMgr.printReadStats();
+                break;
+            case 't': boot.printTimeline(); break;
+            case 'x':
+                telemetry.setEnabled(!telemetry.isEnabled());
+                if (!telemetry.isEnabled()) telemetry.printStats();
+                break;
+            case 'f':
+                if (recorder.isRecording()) {
+                    recorder.stop();
+                    Serial.printf("[REC] Stop: %lu record (%lu sovrascritti)\n",
+                                  (unsigned long)recorder.size(), (unsigned long)recorder.overwritten());
+                } else {
+                    recorder.start();
+                    Serial.println("[REC] Registrazione avviata.");
+                }
+                break;
+            case 'd':
+            case 'o': {
+                // Una sola sorgente binaria alla volta sulla seriale
+                bool streaming = telemetry.isEnabled();
+                telemetry.setEnabled(false);
+                delay(TELEMETRY_FLUSH_MS * 2);
+                if (cmd == 'd') {
+                    flightDump(recorder, Serial);
+                } else {
+                    AllocAudit::Exempt exempt;  // LittleFS alloca i suoi buffer
+                    if (!flightDumpFile(Serial)) Serial.println("[REC] Nessun file salvato.");
+                }
+                telemetry.setEnabled(streaming);
+                break;
+            }
+            case 's': {
+                AllocAudit::Exempt exempt;
+                if (!flightSave(recorder)) Serial.println("[REC] Salvataggio su flash fallito.");
+                break;
+            }
+            case 'm': motors.printStatus(); break;
+            case 'M':
+                if (!motors.clearFaults()) Serial.println("DIAG ancora attivo: guasto non azzerato.");
+                break;
+            case 'h':
+                if (!controlTask) break;
+                if (holeReflex.isEngaged()) {
+                    // I comandi del controllo sarebbero ignorati: niente toggle silenzioso
+                    if (holeReflex.state() == REFLEX_BLIND) {
+                        Serial.println("[RIFLESSO] Motori fermi: AS7262 non online (vedi [k]).");
+                    } else {
+                        Serial.printf("[RIFLESSO] Motori presi dal riflesso (%s): [Z] per rilasciarli.\n",
+                                      HoleReflex::stateName(holeReflex.state()));
+                    }
+                    break;
+                }
+                // Tiene la direzione attuale, da fermo
+                controlTask->setHeading(sensorTask->latest().yaw);
+                controlTask->setBaseSpeed(0);
+                controlTask->setEnabled(!controlTask->isEnabled());
+                Serial.printf("Mantenimento direzione: %s\n", controlTask->isEnabled() ? "ON" : "OFF");
+                break;
+            case 'j':
+                if (controlTask) controlTask->printStats();
+                break;
+            case 'u': profiler().printStats(); break;
+            case 'U': profiler().reset(); Serial.println("Profiler azzerato."); break;
+            case 'k': printHealth(); break;
+            case 'z': holeReflex.printStats(); break;
+            case 'Z':
+                holeReflex.requestRelease();
+                Serial.println("[RIFLESSO] Motori restituiti al controllo.");
+                break;
+            case 'R':
+                holeReflex.requestArmed(true);
+                Serial.println("[RIFLESSO] Riarmato.");
+                break;
+            case 'a': allocAudit().print(); break;
+            case 'g':
+                if (!profiler().isTracing()) {
+                    if (profiler().startTrace()) Serial.println("[PROF] Traccia avviata.");
+                    else Serial.println("[PROF] Memoria insufficiente per la traccia.");
+                } else {
+                    // JSON sulla seriale: niente flusso binario in mezzo
+                    profiler().stopTrace();
+                    bool streaming = telemetry.isEnabled();
+                    telemetry.setEnabled(false);
+                    delay(TELEMETRY_FLUSH_MS * 2);
+                    profiler().exportChromeTrace(writeSerial, nullptr);
+                    telemetry.setEnabled(streaming);
+                }
                 break;
         }
     }
 }
 
+// Argento e "nessun colore" non hanno una classe in tabella
+static const char* floorName(ColorType type, int8_t classId) {
+    if (classId >= 0) return colorMgr.getClassName(classId);
+    return type == COLOR_SILVER ? "ARGENTO" : "-";
+}
+
 void loop() {
-    colorMgr.update();
     handleSerialInput();
 
+    // Snapshot lock-free pubblicato dal task sensori
+    const SensorSnapshot& snap = sensorTask->latest();
+
+    // Transizioni confermate (debounce e isteresi in ColorManager): nessun confronto qui
+    FloorEvent event;
+    while (colorMgr.floorEvents().poll(ledFloorSub, event)) {
+        ledFloorColor = event.to;
+        if (!telemetry.isEnabled()) {
+            Serial.printf("[PAVIMENTO] %s -> %s (conf %.2f, conferma in %lu ms)\n",
+                          floorName(event.from, event.fromClass), floorName(event.to, event.toClass),
+                          event.confidence, (unsigned long)((event.confirmUs - event.timestampUs) / 1000));
+        }
+    }
+
     // ==========================================
     // LOGICA LED CON COLORI PURI ASSOLUTI
     // ==========================================
-    ColorType detected = colorMgr.getDominantColor();
+    ColorType detected = ledFloorColor;
 
     if (detected == COLOR_BLACK) {
         pixels.setPixelColor(0, pixels.Color(0, 0, 0)); // Spento
@@ -91,24 +358,27 @@ void loop() {
     else {
         // Se non è sicuro (es. sul parquet o in transizione),
         // usiamo la conversione RGB grezza riutilizzando il metodo isolato.
-        RGBColor raw = colorMgr.getVisualRGB();
+        RGBColor raw = ColorManager::toVisualRGB(snap.spectral);
         pixels.setPixelColor(0, pixels.Color(raw.r, raw.g, raw.b));
     }
 
     pixels.show();
 
-    // Debug Seriale
-    if (millis() - lastPrintTime > PRINT_INTERVAL) {
-        const SpectralData& data = colorMgr.getCurrentData();
+    // Debug Seriale (muto durante il flusso binario)
+    if (!telemetry.isEnabled() && millis() - lastPrintTime > PRINT_INTERVAL) {
+        const SpectralData& data = snap.spectral;
 
         Serial.printf("SUM: %6.1f | Detect: ", data.sum);
-        switch(detected) {
+        switch(snap.color) {
             case COLOR_BLACK: Serial.print("NERO (BUCO)"); break;
             case COLOR_SILVER: Serial.print("ARGENTO (CHECKPOINT)"); break;
             case COLOR_WHITE: Serial.print("BIANCO"); break;
             case COLOR_RED: Serial.print("ROSSO"); break;
             case COLOR_BLUE: Serial.print("BLU"); break;
-            default: Serial.print("SCONOSCIUTO"); break;
+            default:
+                if (snap.colorClass >= 0) Serial.print(colorMgr.getClassName(snap.colorClass));
+                else Serial.print("SCONOSCIUTO");
+                break;
         }
         Serial.println();
         lastPrintTime = millis();
@@ -1,14 +1,7 @@
 #include <Arduino.h>
 #include <Wire.h>
-#include "Pins.h" // Assicurati che i pin XSHUT siano corretti qui!
-
-// Array dei pin per iterare facilmente
-int xshutPins[] = {
-    PIN_XSHUT_FRONT_LEFT, PIN_XSHUT_FRONT_RIGHT,
-    PIN_XSHUT_BACK_LEFT, PIN_XSHUT_BACK_RIGHT, PIN_XSHUT_CENTER
-};
-
-const char* names[] = { "FL", "FR", "BL", "BR", "CC" };
+#include "Pins.h"
+#include "RobotLayout.h" // Pin XSHUT del telaio: assicurati che siano corretti qui!
 
 void setup() {
     Serial.begin(115200);
@@ -19,14 +12,14 @@ void setup() {
 
     // 1. SPEGNIMENTO TOTALE
     Serial.println("1. Spengo TUTTI i sensori (XSHUT LOW)...");
-    for(int i=0; i<5; i++) {
-        pinMode(xshutPins[i], OUTPUT);
-        digitalWrite(xshutPins[i], LOW);
+    for(int i=0; i<RobotLayout::TOF_N; i++) {
+        pinMode(RobotLayout::TOF[i].xshutPin, OUTPUT);
+        digitalWrite(RobotLayout::TOF[i].xshutPin, LOW);
     }
     delay(100);
 
     // VERIFICA: Ora il bus deve essere VUOTO.
-    Wire.beginTransmission(0x29);
+    Wire.beginTransmission(TOF_DEFAULT_I2C_ADDR);
     if (Wire.endTransmission() == 0) {
         Serial.println("ERRORE GRAVE: Qualcuno risponde ancora a 0x29! Controlla i collegamenti XSHUT.");
         // Se vedi questo messaggio, hai un errore hardware: un XSHUT non è collegato bene.
@@ -36,17 +29,17 @@ void setup() {
     }
 
     // 2. TEST SINGOLO (Uno alla volta)
-    for(int i=0; i<5; i++) {
+    for(int i=0; i<RobotLayout::TOF_N; i++) {
         Serial.print("Test attivazione ");
-        Serial.print(names[i]);
-        Serial.print(" (Pin "); Serial.print(xshutPins[i]); Serial.print(")... ");
+        Serial.print(RobotLayout::TOF[i].name);
+        Serial.print(" (Pin "); Serial.print(RobotLayout::TOF[i].xshutPin); Serial.print(")... ");
 
         // Accendi SOLO questo
-        digitalWrite(xshutPins[i], HIGH);
+        digitalWrite(RobotLayout::TOF[i].xshutPin, HIGH);
         delay(50); // Tempo di boot sensore
 
         // Cerca a 0x29
-        Wire.beginTransmission(0x29);
+        Wire.beginTransmission(TOF_DEFAULT_I2C_ADDR);
         if (Wire.endTransmission() == 0) {
             Serial.println("SUCCESSO! Sensore Trovato.");
         } else {
@@ -54,7 +47,7 @@ void setup() {
         }
 
         // Spegni di nuovo prima di passare al prossimo
-        digitalWrite(xshutPins[i], LOW);
+        digitalWrite(RobotLayout::TOF[i].xshutPin, LOW);
         delay(50);
     }
 
@@ -0,0 +1,218 @@
+/*
+ * Test host dell'audit delle allocazioni: conteggio di new/delete e
+ * memAlloc solo ad audit armato, chiamanti registrati, sospensione con
+ * Exempt, gestore di violazione, zero allocazioni a regime nella replica
+ * dei sensori (anche durante un re-init dell'AS7262) e nel localizzatore,
+ * costo del gancio.
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+
+#include "AllocAudit.h"
+#include "ParticleLocalizer.h"
+#include "SensorReplay.h"
+
+void setUp() {}
+void tearDown() {
+    allocAudit().disarm();
+    allocAudit().setViolationHandler(nullptr);
+}
+
+// Il compilatore può eliminare coppie new/delete inutilizzate: il puntatore esce di qui
+static int* volatile g_sink;
+
+static uint32_t s_violations;
+static size_t   s_lastBytes;
+
+static void onViolation(size_t bytes, uintptr_t) {
+    s_violations++;
+    s_lastBytes = bytes;
+}
+
+static const uint32_t T0 = 5000000;
+
+// Robot fermo: IMU a 1 kHz, due ToF, AS7262 a 35 Hz tranne in [gapFrom, gapTo)
+static void buildTrace(SensorTrace& trace, uint32_t durationUs = 1000000, uint32_t gapFrom = 0,
+                       uint32_t gapTo = 0) {
+    for (uint32_t t = 0; t < durationUs; t += 1000) {
+        trace.logImuRaw(0, 0, (int16_t)IMU_ACC_LSB_PER_G, 0, 0, 0, T0 + t);
+        if (t % 33000 == 0) {
+            trace.logToFRaw(TOF_FRONT_LEFT, 0, 150, T0 + t + 500);
+            trace.logToFRaw(TOF_CENTER, 0, 600, T0 + t + 700);
+        }
+        if (t % 28000 == 0 && (t < gapFrom || t >= gapTo)) {
+            float ch[CH_COUNT] = {150, 160, 170, 170, 170, 180};
+            trace.logSpectralRaw(ch, T0 + t + 300);
+        }
+    }
+    trace.finish();
+}
+
+void test_counts_only_when_armed() {
+    AllocAudit& audit = allocAudit();
+    audit.arm();
+    audit.disarm();
+    g_sink = new int(1);
+    delete g_sink;
+    TEST_ASSERT_EQUAL(0, audit.allocations());
+    TEST_ASSERT_EQUAL(0, audit.frees());
+
+    audit.arm();
+    g_sink = new int[4];
+    delete[] g_sink;
+    void* block = memAlloc(64, MEM_HOT);
+    memFree(block);
+    audit.disarm();
+
+    TEST_ASSERT_EQUAL(2, audit.allocations());
+    TEST_ASSERT_EQUAL(2, audit.frees());
+    TEST_ASSERT_EQUAL(4 * sizeof(int) + 64, audit.bytes());
+    TEST_ASSERT_EQUAL(2, audit.callerCount());
+    TEST_ASSERT_NOT_EQUAL(0, audit.caller(0));
+    TEST_ASSERT_NOT_EQUAL(0, audit.caller(1));
+
+    // Un nuovo arm() riparte da zero
+    audit.arm();
+    TEST_ASSERT_EQUAL(0, audit.allocations());
+    TEST_ASSERT_EQUAL(0, audit.callerCount());
+}
+
+void test_exempt_handler_and_caller_limit() {
+    AllocAudit& audit = allocAudit();
+    s_violations = 0;
+    audit.setViolationHandler(onViolation);
+    audit.arm();
+    {
+        AllocAudit::Exempt exempt;  // Come i comandi che scrivono su LittleFS
+        TEST_ASSERT_FALSE(audit.isArmed());
+        g_sink = new int(2);
+        delete g_sink;
+    }
+    TEST_ASSERT_TRUE(audit.isArmed());
+    TEST_ASSERT_EQUAL(0, audit.allocations());
+    TEST_ASSERT_EQUAL(0, s_violations);
+
+    for (int i = 0; i < ALLOC_AUDIT_MAX_CALLERS + 3; i++) {
+        g_sink = new int(i);
+        delete g_sink;
+    }
+    TEST_ASSERT_EQUAL(ALLOC_AUDIT_MAX_CALLERS + 3, s_violations);
+    TEST_ASSERT_EQUAL(sizeof(int), s_lastBytes);
+    TEST_ASSERT_EQUAL(ALLOC_AUDIT_MAX_CALLERS, audit.callerCount());
+
+    // Exempt su un audit disarmato non lo arma all'uscita
+    audit.disarm();
+    { AllocAudit::Exempt exempt; }
+    TEST_ASSERT_FALSE(audit.isArmed());
+}
+
+void test_sensor_replay_steady_state_allocates_nothing() {
+    SensorTrace trace;
+    buildTrace(trace);
+    SensorReplay replay(trace);
+    TEST_ASSERT_TRUE(replay.boot());  // L'equivalente di setup()
+
+    allocAudit().setViolationHandler(onViolation);
+    s_violations = 0;
+    allocAudit().arm();
+    uint32_t steps = replay.run();
+    allocAudit().disarm();
+
+    TEST_ASSERT_GREATER_THAN(0, replay.outputs());
+    TEST_ASSERT_EQUAL(0, allocAudit().allocations());
+    TEST_ASSERT_EQUAL(0, allocAudit().frees());
+    TEST_ASSERT_EQUAL(0, s_violations);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "replica a regime: %lu passi, %lu uscite, 0 allocazioni", (unsigned long)steps,
+             (unsigned long)replay.outputs());
+    TEST_MESSAGE(msg);
+}
+
+void test_color_reinit_allocates_nothing() {
+    // AS7262 muto per 1,5 s: guasto, re-init a regime, campioni di nuovo
+    SensorTrace trace;
+    buildTrace(trace, 3000000, 500000, 2000000);
+    SensorReplay replay(trace);
+    TEST_ASSERT_TRUE(replay.boot());
+
+    allocAudit().setViolationHandler(onViolation);
+    s_violations = 0;
+    allocAudit().arm();
+    replay.run();
+    allocAudit().disarm();
+
+    const DeviceHealth& h = replay.color().getHealth();
+    TEST_ASSERT_EQUAL(1, h.reinits());
+    TEST_ASSERT_EQUAL(HEALTH_OK, h.state());
+    TEST_ASSERT_EQUAL(0, allocAudit().allocations());
+    TEST_ASSERT_EQUAL(0, s_violations);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "re-init AS7262 ad audit armato: recupero %.0f ms, 0 allocazioni",
+             h.lastRecoveryUs() / 1000.0f);
+    TEST_MESSAGE(msg);
+}
+
+void test_localizer_loop_allocates_nothing() {
+    MazeMap map;
+    MazeTile start = MazeMap::tileAt(MAZE_WIDTH / 2, MAZE_HEIGHT / 2, 0);
+    map.setWall(start, MAZE_NORTH, true);
+    map.setWall(start, MAZE_WEST, true);
+    ParticleLocalizer loc(map);
+    TEST_ASSERT_TRUE(loc.begin(256, MEM_HOT));
+    loc.reset(start, 0.0f, 50.0f);
+
+    ToFData tof;
+    for (uint8_t i = 0; i < TOF_COUNT; i++) {
+        tof.distance_mm[i] = 120;
+        tof.valid[i] = true;
+    }
+
+    allocAudit().arm();
+    for (int i = 0; i < 50; i++) {
+        loc.predict(2.0f, 0.0f);
+        loc.update(tof);
+    }
+    allocAudit().disarm();
+
+    TEST_ASSERT_GREATER_THAN(0, loc.resamples());
+    TEST_ASSERT_EQUAL(0, allocAudit().allocations());
+    // begin() ripetuto a regime non rialloca
+    allocAudit().arm();
+    TEST_ASSERT_TRUE(loc.begin(256, MEM_HOT));
+    TEST_ASSERT_EQUAL(0, allocAudit().allocations());
+}
+
+void test_hook_overhead() {
+    const int N = 200000;
+    double ns[2];
+    for (int armed = 0; armed < 2; armed++) {
+        if (armed) allocAudit().arm();
+        else allocAudit().disarm();
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; i++) {
+            g_sink = new int(i);
+            delete g_sink;
+        }
+        ns[armed] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+    }
+    allocAudit().disarm();
+    TEST_ASSERT_EQUAL(N, allocAudit().allocations());
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "new+delete: %.1f ns disarmato, %.1f ns armato", ns[0], ns[1]);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_counts_only_when_armed);
+    RUN_TEST(test_exempt_handler_and_caller_limit);
+    RUN_TEST(test_sensor_replay_steady_state_allocates_nothing);
+    RUN_TEST(test_color_reinit_allocates_nothing);
+    RUN_TEST(test_localizer_loop_allocates_nothing);
+    RUN_TEST(test_hook_overhead);
+    return UNITY_END();
+}
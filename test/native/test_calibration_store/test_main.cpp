@@ -0,0 +1,130 @@
+/*
+ * Test host della serializzazione della calibrazione: round trip del blob,
+ * rilevamento di blob corrotti/troncati/di altra versione, CRC di riferimento.
+ */
+#include <unity.h>
+#include <string.h>
+
+#include "CalibrationStore.h"
+#include "Crc32.h"
+
+static SpectralData makeData(float v, float b, float g, float y, float o, float r) {
+    SpectralData d = {{v, b, g, y, o, r}, v + b + g + y + o + r};
+    return d;
+}
+
+static const SpectralData WHITE = makeData(180, 210, 230, 240, 235, 220);
+static const SpectralData BLACK = makeData(4, 5, 5, 6, 5, 5);
+static const SpectralData RED   = makeData(30, 25, 30, 60, 160, 260);
+static const SpectralData BLUE  = makeData(150, 230, 120, 60, 40, 35);
+static const SpectralData GREEN = makeData(40, 90, 220, 150, 60, 40);
+
+static void buildTable(SpectralClassifier& c) {
+    loadDefaultClasses(c, WHITE, BLACK, RED, BLUE);
+    c.addClass("GREEN", COLOR_NONE, SPECTRAL_MATCH_SHAPE | SPECTRAL_SHADOW_OK, GREEN);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_crc32_reference_vector() {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32("123456789", 9));
+    // Concatenabile a pezzi
+    uint32_t crc = crc32Update(0, "1234", 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32Update(crc, "56789", 5));
+}
+
+void test_round_trip_preserves_table_and_profile() {
+    SpectralClassifier src;
+    buildTable(src);
+    CalibrationBlob blob;
+    packCalibration(src, "ARENA2", blob);
+
+    SpectralClassifier dst;
+    char name[CALIB_PROFILE_NAME_LEN];
+    TEST_ASSERT_EQUAL(CALIB_OK, unpackCalibration(&blob, sizeof(blob), dst, name));
+    TEST_ASSERT_EQUAL_STRING("ARENA2", name);
+    TEST_ASSERT_EQUAL(src.count(), dst.count());
+
+    for (uint8_t i = 0; i < src.count(); i++) {
+        TEST_ASSERT_EQUAL_STRING(src.get(i).name, dst.get(i).name);
+        TEST_ASSERT_EQUAL(src.get(i).type, dst.get(i).type);
+        TEST_ASSERT_EQUAL(src.get(i).flags, dst.get(i).flags);
+        TEST_ASSERT_EQUAL_MEMORY(&src.get(i).ref, &dst.get(i).ref, sizeof(SpectralData));
+    }
+
+    // Stessa classificazione: anche le soglie derivate (argento, ombra) sono ricostruite
+    TEST_ASSERT_EQUAL_FLOAT(src.darkThreshold(), dst.darkThreshold());
+    TEST_ASSERT_EQUAL(src.classify(GREEN).classId, dst.classify(GREEN).classId);
+}
+
+void test_corruption_is_rejected_without_touching_table() {
+    SpectralClassifier src;
+    buildTable(src);
+    CalibrationBlob blob;
+    packCalibration(src, "default", blob);
+
+    SpectralClassifier dst;
+    dst.addClass("KEEP", COLOR_NONE, SPECTRAL_MATCH_SHAPE, WHITE);
+    uint32_t rev = dst.revision();
+
+    // Un bit a caso in mezzo ai profili
+    CalibrationBlob bad = blob;
+    reinterpret_cast<uint8_t*>(&bad)[60] ^= 0x10;
+    TEST_ASSERT_EQUAL(CALIB_BAD_CRC, unpackCalibration(&bad, sizeof(bad), dst));
+
+    bad = blob;
+    bad.magic = 0;
+    TEST_ASSERT_EQUAL(CALIB_BAD_MAGIC, unpackCalibration(&bad, sizeof(bad), dst));
+
+    bad = blob;
+    bad.version = CALIB_BLOB_VERSION + 1;
+    TEST_ASSERT_EQUAL(CALIB_BAD_VERSION, unpackCalibration(&bad, sizeof(bad), dst));
+
+    // Scrittura interrotta: blob troncato
+    TEST_ASSERT_EQUAL(CALIB_BAD_SIZE, unpackCalibration(&blob, sizeof(blob) - 7, dst));
+    TEST_ASSERT_EQUAL(CALIB_BAD_SIZE, unpackCalibration(&blob, 3, dst));
+
+    TEST_ASSERT_EQUAL(1, dst.count());
+    TEST_ASSERT_EQUAL(rev, dst.revision());
+}
+
+void test_class_count_checked_after_crc() {
+    SpectralClassifier src;
+    buildTable(src);
+    CalibrationBlob blob;
+    packCalibration(src, "default", blob);
+
+    // CRC ricalcolato su un contenuto incoerente
+    blob.classCount = COLOR_MAX_CLASSES + 1;
+    blob.crc = crc32(&blob, offsetof(CalibrationBlob, crc));
+    SpectralClassifier dst;
+    TEST_ASSERT_EQUAL(CALIB_BAD_CONTENT, unpackCalibration(&blob, sizeof(blob), dst));
+}
+
+void test_default_classes_match_legacy_layout() {
+    // Stesse classi e flag che la migrazione ricostruisce dalle vecchie chiavi NVS
+    SpectralClassifier c;
+    loadDefaultClasses(c, WHITE, BLACK, RED, BLUE);
+    TEST_ASSERT_EQUAL(4, c.count());
+    TEST_ASSERT_EQUAL(COLOR_WHITE, c.classify(WHITE).type);
+    TEST_ASSERT_EQUAL(COLOR_RED, c.classify(RED).type);
+    TEST_ASSERT_EQUAL(COLOR_BLUE, c.classify(BLUE).type);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, BLACK.sum * COLOR_DARK_SCALE + COLOR_DARK_OFFSET, c.darkThreshold());
+}
+
+void test_blob_layout_is_stable() {
+    // Il blob va in NVS: la dimensione cambia solo insieme a CALIB_BLOB_VERSION
+    TEST_ASSERT_EQUAL(16 + CALIB_PROFILE_NAME_LEN + COLOR_MAX_CLASSES * 42, sizeof(CalibrationBlob));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_reference_vector);
+    RUN_TEST(test_round_trip_preserves_table_and_profile);
+    RUN_TEST(test_corruption_is_rejected_without_touching_table);
+    RUN_TEST(test_class_count_checked_after_crc);
+    RUN_TEST(test_default_classes_match_legacy_layout);
+    RUN_TEST(test_blob_layout_is_stable);
+    return UNITY_END();
+}
@@ -0,0 +1,378 @@
+/*
+ * Test host del monitor di salute e del re-init in background: ToF spento e
+ * riavviato mentre gli altri misurano (anche con l'init in un task di
+ * servizio, e il suo timeout), IMU recuperata dopo un brown-out.
+ * Dispositivi finti su orologio virtuale.
+ */
+#include <unity.h>
+
+#include "HalReplay.h"
+#include "ImuManager.h"
+#include "ToFManager.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_error_rate_and_consecutive_errors() {
+    DeviceHealth h(100000);
+    h.start(0);
+    TEST_ASSERT_EQUAL(HEALTH_OK, h.state());
+
+    // Errori sparsi: degradato ma ancora in uso
+    uint32_t t = 0;
+    for (int i = 0; i < 40; i++) {
+        t += 1000;
+        if (i % 2) h.onError(t);
+        else h.onSuccess(t);
+    }
+    TEST_ASSERT_FALSE(h.check(t));
+    TEST_ASSERT_EQUAL(HEALTH_DEGRADED, h.state());
+    TEST_ASSERT_TRUE(h.isOnline());
+
+    // Di nuovo solo successi: isteresi a metà soglia
+    for (int i = 0; i < 40; i++) h.onSuccess(t += 1000);
+    TEST_ASSERT_EQUAL(HEALTH_OK, h.state());
+
+    // Errori di fila: guasto segnalato una volta sola
+    for (int i = 0; i < HEALTH_MAX_CONSECUTIVE_ERRORS; i++) h.onError(t += 1000);
+    TEST_ASSERT_TRUE(h.check(t));
+    TEST_ASSERT_FALSE(h.check(t));
+    TEST_ASSERT_EQUAL(HEALTH_FAILED, h.state());
+    TEST_ASSERT_EQUAL(1, h.failures());
+}
+
+void test_stale_backoff_and_recovery_time() {
+    DeviceHealth h(100000);
+    h.start(0);
+    TEST_ASSERT_FALSE(h.check(100000));
+    TEST_ASSERT_TRUE(h.check(100001));
+
+    // Primo tentativo dopo HEALTH_RETRY_MIN_US
+    TEST_ASSERT_FALSE(h.retryDue(100001 + HEALTH_RETRY_MIN_US - 1));
+    uint32_t t = 100001 + HEALTH_RETRY_MIN_US;
+    TEST_ASSERT_TRUE(h.retryDue(t));
+    h.beginRecovery(t);
+    TEST_ASSERT_EQUAL(HEALTH_RECOVERING, h.state());
+    TEST_ASSERT_FALSE(h.retryDue(t));
+
+    // Fallito: attesa raddoppiata
+    h.endRecovery(false, t);
+    TEST_ASSERT_FALSE(h.retryDue(t + 2 * HEALTH_RETRY_MIN_US - 1));
+    t += 2 * HEALTH_RETRY_MIN_US;
+    TEST_ASSERT_TRUE(h.retryDue(t));
+    h.beginRecovery(t);
+    h.endRecovery(true, t + 5000);
+
+    TEST_ASSERT_EQUAL(HEALTH_OK, h.state());
+    TEST_ASSERT_EQUAL(1, h.reinits());
+    TEST_ASSERT_EQUAL(1, h.failedReinits());
+    TEST_ASSERT_EQUAL(t + 5000 - 100001, h.lastRecoveryUs());
+    TEST_ASSERT_EQUAL(h.lastRecoveryUs(), h.maxRecoveryUs());
+}
+
+// ToF finto: XSHUT, indirizzo di fabbrica dopo l'accensione, misure ogni budget
+class FakeRanging : public RangingDevice {
+public:
+    FakeRanging()
+        : alive(true), bootable(true), on(false), atDefault(false), ranging(false), restartUs(0), samples(0),
+          inits(0), asyncPolls(0), pendingPolls(0) {}
+
+    const char* name() const override { return "fake"; }
+    uint8_t address() const override { return RobotLayout::TOF[0].address; }
+    void powerDown() override {
+        on = false;
+        ranging = false;
+    }
+    void powerUp() override {
+        if (!on) atDefault = alive;
+        on = true;
+    }
+    bool probeDefault() override { return on && atDefault; }
+    bool probe() override { return false; } // Avvio a freddo
+    bool initAtDefault() override {
+        if (!bootable || !probeDefault()) return false;
+        atDefault = false;
+        inits++;
+        return true;
+    }
+    // Come il task di servizio sul robot: l'esito arriva dopo asyncPolls controlli
+    BootStatus initStart() override {
+        if (asyncPolls == 0) return RangingDevice::initStart();
+        pendingPolls = asyncPolls;
+        return BOOT_PENDING;
+    }
+    BootStatus initPoll() override {
+        if (--pendingPolls > 0) return BOOT_PENDING;
+        return initAtDefault() ? BOOT_DONE : BOOT_FAILED;
+    }
+    bool attachWarm() override { return false; }
+    void release() override { powerDown(); }
+
+    uint32_t startRanging() override {
+        ranging = true;
+        restartUs = halMicros();
+        return 20000;
+    }
+    int checkDataReady(bool& ready) override {
+        ready = false;
+        if (!alive) return -1; // Nessun ACK
+        ready = ranging && halMicros() - restartUs >= 20000 + TOF_SCHED_OVERHEAD_US;
+        return 0;
+    }
+    int readRange(RangeSample& s) override {
+        if (!alive) return -1;
+        s.distance_mm = 300;
+        s.rangeStatus = 0;
+        s.objects = 1;
+        s.signalKcps = 0;
+        s.sigmaMm = 0;
+        restartUs = halMicros();
+        samples++;
+        return 0;
+    }
+
+    bool     alive;     // Alimentato e collegato
+    bool     bootable;  // InitSensor riesce
+    bool     on;
+    bool     atDefault;
+    bool     ranging;
+    uint32_t restartUs;
+    int      samples;
+    int      inits;
+    int      asyncPolls;    // 0 = init sincrono
+    int      pendingPolls;
+};
+
+void test_tof_recovers_one_sensor_while_others_range() {
+    VirtualClock clock(1000000);
+    halSetClock(&clock);
+
+    FakeRanging dev[TOF_COUNT];
+    RangingDevice* const devices[TOF_COUNT] = {&dev[0], &dev[1], &dev[2], &dev[3], &dev[4]};
+    ToFManager tof(devices);
+    TEST_ASSERT_TRUE(tof.begin());
+
+    for (int i = 0; i < 200; i++) {
+        clock.advance(1000);
+        tof.update();
+    }
+    // Brown-out del sensore 2: niente ACK finché non torna l'alimentazione
+    dev[2].alive = false;
+    int before[TOF_COUNT];
+    for (int k = 0; k < TOF_COUNT; k++) before[k] = dev[k].samples;
+
+    uint32_t outageUs = 0;
+    for (int i = 0; i < 3000; i++) {
+        clock.advance(1000);
+        tof.update();
+        if (!tof.getHealth(TOF_BACK_LEFT).isOnline()) outageUs += 1000;
+        if (i == 100) dev[2].alive = true; // Connettore di nuovo a posto
+    }
+
+    const DeviceHealth& h = tof.getHealth(TOF_BACK_LEFT);
+    TEST_ASSERT_EQUAL(HEALTH_OK, h.state());
+    TEST_ASSERT_EQUAL(1, h.failures());
+    TEST_ASSERT_EQUAL(1, h.reinits());
+    TEST_ASSERT_EQUAL(2, dev[2].inits);
+    // Recupero: primo tentativo dopo HEALTH_RETRY_MIN_US, poi XSHUT e boot firmware
+    TEST_ASSERT_EQUAL_UINT32(HEALTH_RETRY_MIN_US + TOF_BOOT_SHUTDOWN_US + TOF_BOOT_FIRMWARE_US, h.lastRecoveryUs());
+    TEST_ASSERT_TRUE(dev[2].samples > before[2]);
+
+    // Gli altri hanno continuato a ~40 Hz per tutti i 3 s
+    for (int k = 0; k < TOF_COUNT; k++) {
+        if (k == 2) continue;
+        TEST_ASSERT_TRUE(dev[k].samples - before[k] > 100);
+        TEST_ASSERT_EQUAL(0, tof.getHealth((ToFPosition)k).failures());
+    }
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "ToF offline %.0f ms, recupero %.1f ms", outageUs / 1000.0f,
+             h.lastRecoveryUs() / 1000.0f);
+    TEST_MESSAGE(msg);
+    tof.printHealth();
+    halSetClock(nullptr);
+}
+
+void test_tof_failed_at_boot_is_retried_with_backoff() {
+    VirtualClock clock(1000000);
+    halSetClock(&clock);
+
+    FakeRanging dev[TOF_COUNT];
+    dev[4].bootable = false;
+    RangingDevice* const devices[TOF_COUNT] = {&dev[0], &dev[1], &dev[2], &dev[3], &dev[4]};
+    ToFManager tof(devices);
+    TEST_ASSERT_TRUE(tof.begin());
+    TEST_ASSERT_EQUAL(HEALTH_FAILED, tof.getHealth(TOF_CENTER).state());
+
+    // Tre tentativi falliti (200 + 400 + 800 ms di attesa), poi il sensore si avvia
+    for (int i = 0; i < 1800; i++) {
+        clock.advance(1000);
+        tof.update();
+    }
+    TEST_ASSERT_EQUAL(3, tof.getHealth(TOF_CENTER).failedReinits());
+    dev[4].bootable = true;
+    for (int i = 0; i < 2000; i++) {
+        clock.advance(1000);
+        tof.update();
+    }
+    TEST_ASSERT_EQUAL(HEALTH_OK, tof.getHealth(TOF_CENTER).state());
+    TEST_ASSERT_EQUAL(1, tof.getHealth(TOF_CENTER).reinits());
+    TEST_ASSERT_TRUE(dev[4].samples > 0);
+    halSetClock(nullptr);
+}
+
+void test_tof_reinit_in_worker_keeps_others_ranging() {
+    VirtualClock clock(1000000);
+    halSetClock(&clock);
+
+    FakeRanging dev[TOF_COUNT];
+    RangingDevice* const devices[TOF_COUNT] = {&dev[0], &dev[1], &dev[2], &dev[3], &dev[4]};
+    ToFManager tof(devices);
+    TEST_ASSERT_TRUE(tof.begin());
+    for (int i = 0; i < 200; i++) {
+        clock.advance(1000);
+        tof.update();
+    }
+
+    // Init a regime da 80 ms (InitSensor a 0x29): gli altri non devono fermarsi
+    dev[2].asyncPolls = 80;
+    dev[2].alive = false;
+    int during[TOF_COUNT] = {0};
+    uint32_t initUs = 0;
+    for (int i = 0; i < 1500; i++) {
+        clock.advance(1000);
+        int before[TOF_COUNT];
+        for (int k = 0; k < TOF_COUNT; k++) before[k] = dev[k].samples;
+        tof.update();
+        if (dev[2].pendingPolls > 0) {
+            initUs += 1000;
+            for (int k = 0; k < TOF_COUNT; k++) during[k] += dev[k].samples - before[k];
+        }
+        if (i == 100) dev[2].alive = true;
+    }
+    const DeviceHealth& h = tof.getHealth(TOF_BACK_LEFT);
+    TEST_ASSERT_EQUAL(HEALTH_OK, h.state());
+    TEST_ASSERT_EQUAL_UINT32(HEALTH_RETRY_MIN_US + TOF_BOOT_SHUTDOWN_US + TOF_BOOT_FIRMWARE_US + 80000,
+                             h.lastRecoveryUs());
+    for (int k = 0; k < TOF_COUNT; k++) {
+        if (k != 2) TEST_ASSERT_TRUE(during[k] >= 3);  // ~40 Hz per 80 ms
+    }
+
+    // Init che non torna mai: dopo TOF_RECOVER_INIT_TIMEOUT_US il sensore viene spento
+    dev[4].asyncPolls = 1000000;
+    dev[4].alive = false;
+    for (int i = 0; i < (int)(TOF_RECOVER_INIT_TIMEOUT_US / 1000) + 600; i++) {
+        clock.advance(1000);
+        tof.update();
+        if (i == 100) dev[4].alive = true;
+    }
+    TEST_ASSERT_TRUE(dev[4].pendingPolls > 0);
+    TEST_ASSERT_FALSE(dev[4].on);
+    TEST_ASSERT_EQUAL(HEALTH_RECOVERING, tof.getHealth(TOF_CENTER).state());
+    dev[4].pendingPolls = 1;  // Senza alimentazione il task di servizio fallisce e si libera
+    clock.advance(1000);
+    tof.update();
+    TEST_ASSERT_EQUAL(HEALTH_FAILED, tof.getHealth(TOF_CENTER).state());
+    TEST_ASSERT_EQUAL(1, tof.getHealth(TOF_CENTER).failedReinits());
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "init in background %.0f ms: Front_Left %d misure nel frattempo", initUs / 1000.0f,
+             during[0]);
+    TEST_MESSAGE(msg);
+    halSetClock(nullptr);
+}
+
+// MPU9250 finto: un frame al millisecondo, fermo e in piano
+class FakeImu : public ImuDevice {
+public:
+    FakeImu() : alive(true), awake(false), failed(false), lastUs(0), resets(0) {}
+
+    uint8_t whoAmI() override { return alive ? 0x71 : 0xFF; }
+    void    reset() override {
+        awake = false;
+        resets++;
+    }
+    void wake() override { awake = alive; }
+    bool init() override { return alive; }
+    void configure() override {}
+    bool initMagnetometer() override { return false; }
+    bool isConnected() override { return alive; }
+
+    bool startFifo() override {
+        lastUs = halMicros();
+        return alive && awake;
+    }
+    void resetFifo() override { lastUs = halMicros(); }
+    uint16_t readFifo(uint8_t* out, uint16_t maxFrames, bool& overflow) override {
+        overflow = false;
+        failed = !alive;
+        // Dopo un brown-out il chip riparte in sleep: FIFO ferma
+        if (!alive || !awake) return 0;
+        uint16_t n = (uint16_t)((halMicros() - lastUs) / 1000);
+        if (n > maxFrames) n = maxFrames;
+        lastUs += n * 1000;
+        memset(out, 0, n * MPU_FIFO_FRAME_BYTES);
+        for (uint16_t k = 0; k < n; k++) out[k * MPU_FIFO_FRAME_BYTES + 4] = 0x10; // az = 1 g
+        return n;
+    }
+    bool readFailed() const override { return failed; }
+    bool readMagnetometer(float&, float&, float&) override { return false; }
+
+    void  autoOffsets() override {}
+    bool  readGyro(float&, float&, float&) override { return false; }
+    float readPitch() override { return 0.0f; }
+
+    bool     alive;
+    bool     awake;
+    bool     failed;
+    uint32_t lastUs;
+    int      resets;
+};
+
+void test_imu_recovers_after_brownout() {
+    VirtualClock clock(1000000);
+    halSetClock(&clock);
+
+    FakeImu dev;
+    ImuManager imu(dev);
+    TEST_ASSERT_TRUE(imu.begin());
+    while (imu.bootStep(clock.micros()) == BOOT_PENDING) clock.advance(1000);
+    TEST_ASSERT_TRUE(imu.isConnected());
+
+    // Brown-out di 50 ms: al ritorno il chip dorme e la FIFO non si muove
+    dev.alive = false;
+    for (int i = 0; i < 50; i++) {
+        clock.advance(1000);
+        imu.update();
+    }
+    dev.alive = true;
+    dev.awake = false;
+
+    int updates = 0;
+    for (int i = 0; i < 1000; i++) {
+        clock.advance(1000);
+        if (imu.update()) updates++;
+    }
+
+    const DeviceHealth& h = imu.getHealth();
+    TEST_ASSERT_TRUE(imu.isConnected());
+    TEST_ASSERT_EQUAL(1, h.failures());
+    TEST_ASSERT_EQUAL(1, h.reinits());
+    // Guasto dichiarato dagli errori di fila, senza aspettare HEALTH_IMU_STALE_US
+    TEST_ASSERT_EQUAL(HEALTH_MAX_CONSECUTIVE_ERRORS, h.errors());
+    // Primo tentativo dopo HEALTH_RETRY_MIN_US, poi reset e risveglio
+    TEST_ASSERT_EQUAL_UINT32(HEALTH_RETRY_MIN_US + 2 * IMU_BOOT_RESET_WAIT_US, h.lastRecoveryUs());
+    TEST_ASSERT_TRUE(updates > 400);
+    halSetClock(nullptr);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_error_rate_and_consecutive_errors);
+    RUN_TEST(test_stale_backoff_and_recovery_time);
+    RUN_TEST(test_tof_recovers_one_sensor_while_others_range);
+    RUN_TEST(test_tof_failed_at_boot_is_retried_with_backoff);
+    RUN_TEST(test_tof_reinit_in_worker_keeps_others_ranging);
+    RUN_TEST(test_imu_recovers_after_brownout);
+    return UNITY_END();
+}
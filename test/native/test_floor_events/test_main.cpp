@@ -0,0 +1,376 @@
+/*
+ * Test host degli eventi del pavimento: confidenza del classificatore,
+ * debounce e isteresi di FloorEventDetector, bus SPSC a più abbonati
+ * (std::thread al posto dei task FreeRTOS) e una traccia spettrale
+ * registrata riprodotta con SensorReplay fino ai record TLM_FLOOR_EVENT.
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "CalibrationStore.h"
+#include "FloorEvents.h"
+#include "SensorReplay.h"
+
+void setUp() {}
+void tearDown() {}
+
+static SpectralData makeData(float v, float b, float g, float y, float o, float r) {
+    SpectralData d = {{v, b, g, y, o, r}, v + b + g + y + o + r};
+    return d;
+}
+
+// Stessi profili di test_spectral_classifier (LED a 25 mA, ~1 cm)
+static const SpectralData WHITE = makeData(180, 210, 230, 240, 235, 220);
+static const SpectralData BLACK = makeData(4, 5, 5, 6, 5, 5);
+static const SpectralData RED   = makeData(30, 25, 30, 60, 160, 260);
+static const SpectralData BLUE  = makeData(150, 230, 120, 60, 40, 35);
+
+static SpectralData mix(const SpectralData& a, const SpectralData& b, float t) {
+    SpectralData d;
+    d.sum = 0;
+    for (int c = 0; c < CH_COUNT; c++) {
+        d.channels[c] = a.channels[c] * (1.0f - t) + b.channels[c] * t;
+        d.sum += d.channels[c];
+    }
+    return d;
+}
+
+static SpectralMatch m(ColorType type, int8_t classId, float confidence) {
+    SpectralMatch r = {type, classId, 0.0f, confidence};
+    return r;
+}
+
+// ==========================================
+// CONFIDENZA
+// ==========================================
+
+void test_classifier_confidence_tracks_margin() {
+    SpectralClassifier c;
+    loadDefaultClasses(c, WHITE, BLACK, RED, BLUE);
+
+    SpectralMatch red = c.classify(RED);
+    TEST_ASSERT_EQUAL(COLOR_RED, red.type);
+    TEST_ASSERT_GREATER_THAN(0.9f, red.confidence);
+
+    // Sul bordo rosso/bianco (le somme diverse spostano il punto di incrocio) vince di poco
+    SpectralMatch edge = c.classify(mix(WHITE, RED, 0.7f));
+    TEST_ASSERT_LESS_THAN(FLOOR_ENTER_CONFIDENCE, edge.confidence);
+
+    // Argento: nulla sulla soglia, piena a COLOR_SUM_MARGIN sopra
+    float silverSum = WHITE.sum * DEFAULT_SILVER_RATIO;
+    SpectralData bright = WHITE;
+    for (int ch = 0; ch < CH_COUNT; ch++) bright.channels[ch] *= 1.02f * DEFAULT_SILVER_RATIO;
+    bright.sum = WHITE.sum * 1.02f * DEFAULT_SILVER_RATIO;
+    SpectralMatch weak = c.classify(bright);
+    TEST_ASSERT_EQUAL(COLOR_SILVER, weak.type);
+    TEST_ASSERT_LESS_THAN(0.2f, weak.confidence);
+    bright.sum = silverSum * (1.0f + COLOR_SUM_MARGIN);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, c.classify(bright).confidence);
+
+    // Nastro nero ben sotto la soglia d'ombra
+    SpectralMatch black = c.classify(BLACK);
+    TEST_ASSERT_EQUAL(COLOR_BLACK, black.type);
+    TEST_ASSERT_GREATER_THAN(0.9f, black.confidence);
+}
+
+// ==========================================
+// DEBOUNCE E ISTERESI
+// ==========================================
+
+void test_detector_debounces_glitches() {
+    FloorEventDetector d;
+    FloorEvent ev;
+    uint32_t t = 1000;
+
+    // Primo colore confermato: evento da COLOR_NONE
+    for (int i = 0; i < FLOOR_DEBOUNCE_SAMPLES - 1; i++) TEST_ASSERT_FALSE(d.update(m(COLOR_WHITE, 0, 0.9f), t += 28000, ev));
+    TEST_ASSERT_TRUE(d.update(m(COLOR_WHITE, 0, 0.9f), t += 28000, ev));
+    TEST_ASSERT_EQUAL(COLOR_NONE, ev.from);
+    TEST_ASSERT_EQUAL(COLOR_WHITE, ev.to);
+
+    // Riflesso di un campione (e di FLOOR_DEBOUNCE_SAMPLES - 1): nessun evento
+    for (int n = 1; n < FLOOR_DEBOUNCE_SAMPLES; n++) {
+        for (int i = 0; i < n; i++) TEST_ASSERT_FALSE(d.update(m(COLOR_SILVER, -1, 1.0f), t += 28000, ev));
+        TEST_ASSERT_FALSE(d.update(m(COLOR_WHITE, 0, 0.9f), t += 28000, ev));
+    }
+    TEST_ASSERT_EQUAL(FLOOR_DEBOUNCE_SAMPLES - 1, d.rejected());
+    TEST_ASSERT_EQUAL(COLOR_WHITE, d.stableColor());
+
+    // Buco vero: il timestamp è il primo campione nero, non la conferma
+    uint32_t edge = t + 28000;
+    for (int i = 0; i < FLOOR_DEBOUNCE_SAMPLES - 1; i++) TEST_ASSERT_FALSE(d.update(m(COLOR_BLACK, 1, 0.8f), t += 28000, ev));
+    TEST_ASSERT_TRUE(d.update(m(COLOR_BLACK, 1, 0.6f), t += 28000, ev));
+    TEST_ASSERT_EQUAL(COLOR_WHITE, ev.from);
+    TEST_ASSERT_EQUAL(COLOR_BLACK, ev.to);
+    TEST_ASSERT_EQUAL(1, ev.toClass);
+    TEST_ASSERT_EQUAL(edge, ev.timestampUs);
+    TEST_ASSERT_EQUAL(t, ev.confirmUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, (0.8f * (FLOOR_DEBOUNCE_SAMPLES - 1) + 0.6f) / FLOOR_DEBOUNCE_SAMPLES,
+                             ev.confidence);
+    TEST_ASSERT_EQUAL(2, d.transitions());
+}
+
+void test_detector_hysteresis_on_uncertain_samples() {
+    FloorEventDetector d;
+    FloorEvent ev;
+    uint32_t t = 0;
+    for (int i = 0; i < FLOOR_DEBOUNCE_SAMPLES; i++) d.update(m(COLOR_WHITE, 0, 0.9f), t += 28000, ev);
+
+    // Bordo rosso/bianco: tanti campioni rossi incerti non spostano il colore stabile
+    uint32_t edge = t + 28000;
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_FALSE(d.update(m(COLOR_RED, 2, FLOOR_ENTER_CONFIDENCE * 0.5f), t += 28000, ev));
+    }
+    TEST_ASSERT_EQUAL(COLOR_WHITE, d.stableColor());
+
+    // Campioni incerti in mezzo alla transizione: non la annullano. Il bordo
+    // resta il primo campione rosso, anche se incerto
+    TEST_ASSERT_FALSE(d.update(m(COLOR_RED, 2, 0.1f), t += 28000, ev));
+    bool fired = false;
+    for (int i = 0; i < FLOOR_DEBOUNCE_SAMPLES; i++) {
+        fired = d.update(m(COLOR_RED, 2, 0.8f), t += 28000, ev);
+        if (i < FLOOR_DEBOUNCE_SAMPLES - 1) TEST_ASSERT_FALSE(d.update(m(COLOR_RED, 2, 0.1f), t += 28000, ev));
+    }
+    TEST_ASSERT_TRUE(fired);
+    TEST_ASSERT_EQUAL(COLOR_RED, ev.to);
+    TEST_ASSERT_EQUAL(edge, ev.timestampUs);
+
+    // Un colore diverso riparte da zero (rosso -> blu -> rosso non conferma il rosso)
+    d.update(m(COLOR_BLUE, 3, 0.9f), t += 28000, ev);
+    d.update(m(COLOR_WHITE, 0, 0.9f), t += 28000, ev);
+    TEST_ASSERT_FALSE(d.update(m(COLOR_BLUE, 3, 0.9f), t += 28000, ev));
+    TEST_ASSERT_EQUAL(COLOR_RED, d.stableColor());
+}
+
+void test_detector_keeps_transition_across_uncertain_third_class() {
+    FloorEventDetector d;
+    FloorEvent ev;
+    uint32_t t = 0;
+    for (int i = 0; i < FLOOR_DEBOUNCE_SAMPLES; i++) d.update(m(COLOR_WHITE, 0, 0.9f), t += 28000, ev);
+
+    // Bianco -> nero con campioni misti che cadono, incerti, sul blu
+    uint32_t edge = t + 28000;
+    bool fired = false;
+    for (int i = 0; i < FLOOR_DEBOUNCE_SAMPLES && !fired; i++) {
+        fired = d.update(m(COLOR_BLACK, 1, 0.8f), t += 28000, ev);
+        if (!fired) TEST_ASSERT_FALSE(d.update(m(COLOR_BLUE, 3, FLOOR_ENTER_CONFIDENCE * 0.5f), t += 28000, ev));
+    }
+    TEST_ASSERT_TRUE(fired);
+    TEST_ASSERT_EQUAL(COLOR_BLACK, ev.to);
+    TEST_ASSERT_EQUAL(edge, ev.timestampUs);
+    TEST_ASSERT_EQUAL(0, d.rejected());
+
+    // Una terza classe sicura invece riparte da zero
+    d.update(m(COLOR_WHITE, 0, 0.9f), t += 28000, ev);
+    d.update(m(COLOR_RED, 2, 0.9f), t += 28000, ev);
+    TEST_ASSERT_EQUAL(1, d.rejected());
+    TEST_ASSERT_EQUAL(COLOR_BLACK, d.stableColor());
+}
+
+// ==========================================
+// BUS
+// ==========================================
+
+void test_bus_fanout_and_drops_per_subscriber() {
+    FloorEventBus bus;
+    int8_t fast = bus.subscribe();
+    int8_t slow = bus.subscribe();
+    for (int i = 2; i < FLOOR_MAX_SUBSCRIBERS; i++) TEST_ASSERT_GREATER_OR_EQUAL(0, bus.subscribe());
+    TEST_ASSERT_EQUAL(-1, bus.subscribe());
+
+    FloorEvent ev = {COLOR_WHITE, COLOR_BLACK, 0, 1, 0.9f, 0, 0};
+    FloorEvent out;
+    const uint32_t total = FLOOR_QUEUE_LEN * 3;
+    for (uint32_t i = 0; i < total; i++) {
+        ev.timestampUs = i;
+        bus.publish(ev);
+        // L'abbonato veloce svuota subito, quello lento mai
+        TEST_ASSERT_TRUE(bus.poll(fast, out));
+        TEST_ASSERT_EQUAL(i, out.timestampUs);
+    }
+    TEST_ASSERT_EQUAL(total, bus.published());
+    TEST_ASSERT_EQUAL(0, bus.dropped(fast));
+    TEST_ASSERT_EQUAL(total - FLOOR_QUEUE_LEN, bus.dropped(slow));
+
+    // Il lento trova i primi FLOOR_QUEUE_LEN, in ordine
+    for (uint32_t i = 0; i < FLOOR_QUEUE_LEN; i++) {
+        TEST_ASSERT_TRUE(bus.poll(slow, out));
+        TEST_ASSERT_EQUAL(i, out.timestampUs);
+    }
+    TEST_ASSERT_FALSE(bus.poll(slow, out));
+    TEST_ASSERT_FALSE(bus.poll(FLOOR_MAX_SUBSCRIBERS, out));
+}
+
+void test_bus_cross_thread_order_and_throughput() {
+    FloorEventBus bus;
+    int8_t a = bus.subscribe();
+    int8_t b = bus.subscribe();
+    const uint32_t N = 50000;
+
+    struct Consumer {
+        std::atomic<uint32_t> received{0};
+        uint32_t outOfOrder = 0;
+        uint32_t last = 0;
+    } ca, cb;
+    auto consume = [&](int8_t id, Consumer& c) {
+        FloorEvent ev;
+        while (c.received.load(std::memory_order_relaxed) < N) {
+            if (!bus.poll(id, ev)) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (ev.timestampUs != c.last + 1) c.outOfOrder++;
+            if (ev.confirmUs != ev.timestampUs * 3u) c.outOfOrder++;  // Evento strappato
+            c.last = ev.timestampUs;
+            c.received.fetch_add(1, std::memory_order_release);
+        }
+    };
+    std::thread ta(consume, a, std::ref(ca));
+    std::thread tb(consume, b, std::ref(cb));
+
+    // Il produttore non supera mai la coda dell'abbonato più lento: nessuna perdita attesa
+    auto t0 = std::chrono::steady_clock::now();
+    FloorEvent ev = {COLOR_WHITE, COLOR_BLACK, 0, 1, 0.9f, 0, 0};
+    for (uint32_t i = 1; i <= N; i++) {
+        while (i - 1 - ca.received.load(std::memory_order_acquire) >= FLOOR_QUEUE_LEN ||
+               i - 1 - cb.received.load(std::memory_order_acquire) >= FLOOR_QUEUE_LEN) {
+            std::this_thread::yield();
+        }
+        ev.timestampUs = i;
+        ev.confirmUs = i * 3u;
+        bus.publish(ev);
+    }
+    ta.join();
+    tb.join();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+
+    TEST_ASSERT_EQUAL(0, ca.outOfOrder);
+    TEST_ASSERT_EQUAL(0, cb.outOfOrder);
+    TEST_ASSERT_EQUAL(N, ca.received.load());
+    TEST_ASSERT_EQUAL(N, cb.received.load());
+    TEST_ASSERT_EQUAL(0, bus.dropped(a) + bus.dropped(b));
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%u eventi a 2 abbonati su thread diversi: %.0f ns/evento, in ordine, nessuno perso",
+             N, ns);
+    TEST_MESSAGE(msg);
+}
+
+// ==========================================
+// TRACCIA REGISTRATA
+// ==========================================
+
+// Sink della replica: tiene solo gli eventi del pavimento
+class FloorSink : public RecordSink {
+public:
+    struct Entry {
+        uint32_t            timestampUs;
+        TelemetryFloorEvent rec;
+    };
+    std::vector<Entry> events;
+    uint32_t colors = 0;
+
+    bool log(TelemetryType type, uint32_t timestampUs, const void* payload, size_t len) override {
+        if (type == TLM_COLOR) colors++;
+        if (type != TLM_FLOOR_EVENT) return true;
+        if (len != sizeof(TelemetryFloorEvent)) return false;
+        Entry e;
+        e.timestampUs = timestampUs;
+        memcpy(&e.rec, payload, sizeof(e.rec));
+        events.push_back(e);
+        return true;
+    }
+};
+
+static const uint32_t T0 = 2000000;
+static const uint32_t PERIOD_US = 28000;  // ~35 Hz, come l'AS7262
+
+// Prova sul campo ricostruita: bianco con un riflesso, buco nero con bordo
+// sfumato, di nuovo bianco, checkpoint argento. Ritorna gli istanti dei bordi.
+static void buildTrace(SensorTrace& trace, uint32_t edges[3]) {
+    uint32_t t = T0;
+    auto sample = [&](const SpectralData& d) {
+        trace.logSpectralRaw(d.channels, t);
+        t += PERIOD_US;
+    };
+    SpectralData silver = WHITE, sparkle = WHITE;
+    for (int ch = 0; ch < CH_COUNT; ch++) {
+        silver.channels[ch] *= 2.0f;
+        sparkle.channels[ch] *= 3.0f;
+    }
+
+    for (int i = 0; i < 20; i++) sample(i == 10 ? sparkle : WHITE);  // Riflesso isolato
+    edges[0] = t;
+    sample(mix(WHITE, BLACK, 0.5f));                                 // Bordo della piastrella
+    for (int i = 0; i < 15; i++) sample(BLACK);
+    edges[1] = t;
+    sample(mix(BLACK, WHITE, 0.5f));
+    for (int i = 0; i < 20; i++) sample(WHITE);
+    edges[2] = t;
+    for (int i = 0; i < 15; i++) sample(silver);
+    trace.finish();
+}
+
+void test_replay_trace_emits_only_real_transitions() {
+    SensorTrace trace;
+    uint32_t edges[3];
+    buildTrace(trace, edges);
+
+    SensorReplay replay(trace);
+    // Calibrazione salvata come sul robot (profilo attivo p0)
+    SpectralClassifier table;
+    loadDefaultClasses(table, WHITE, BLACK, RED, BLUE);
+    CalibrationBlob blob;
+    packCalibration(table, "arena", blob);
+    replay.storage().begin(CALIB_NVS_NAMESPACE, false);
+    replay.storage().putBytes("p0", &blob, sizeof(blob));
+    replay.storage().putUChar("active", 0);
+    replay.storage().end();
+
+    FloorSink sink;
+    replay.attachSink(&sink);
+    TEST_ASSERT_TRUE(replay.boot());
+    replay.run();
+
+    const ColorType expected[][2] = {
+        {COLOR_NONE, COLOR_WHITE}, {COLOR_WHITE, COLOR_BLACK}, {COLOR_BLACK, COLOR_WHITE}, {COLOR_WHITE, COLOR_SILVER}};
+    TEST_ASSERT_EQUAL(4, sink.events.size());
+    for (size_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(expected[i][0], sink.events[i].rec.from);
+        TEST_ASSERT_EQUAL(expected[i][1], sink.events[i].rec.to);
+        TEST_ASSERT_GREATER_OR_EQUAL(FLOOR_ENTER_CONFIDENCE, sink.events[i].rec.confidence);
+    }
+    TEST_ASSERT_EQUAL(COLOR_SILVER, replay.color().getFloorColor());
+    TEST_ASSERT_GREATER_OR_EQUAL(1, replay.color().getFloorRejected());  // Il riflesso
+
+    // Bordo stimato (EMA compresa) e conferma entro pochi campioni dal bordo vero
+    char msg[200];
+    int n = snprintf(msg, sizeof(msg), "%u campioni, 4 eventi | bordo->evento (ms):", sink.colors);
+    for (int i = 0; i < 3; i++) {
+        const FloorSink::Entry& e = sink.events[i + 1];
+        n += snprintf(msg + n, sizeof(msg) - n, " %.0f/%.0f", (e.timestampUs - edges[i]) / 1000.0f,
+                      (e.rec.confirmUs - edges[i]) / 1000.0f);
+    }
+    TEST_MESSAGE(msg);
+    for (int i = 0; i < 3; i++) {
+        const FloorSink::Entry& e = sink.events[i + 1];
+        TEST_ASSERT_TRUE(e.timestampUs >= edges[i]);
+        TEST_ASSERT_LESS_OR_EQUAL(edges[i] + (FLOOR_DEBOUNCE_SAMPLES + 6) * PERIOD_US, e.rec.confirmUs);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_classifier_confidence_tracks_margin);
+    RUN_TEST(test_detector_debounces_glitches);
+    RUN_TEST(test_detector_hysteresis_on_uncertain_samples);
+    RUN_TEST(test_detector_keeps_transition_across_uncertain_third_class);
+    RUN_TEST(test_bus_fanout_and_drops_per_subscriber);
+    RUN_TEST(test_bus_cross_thread_order_and_throughput);
+    RUN_TEST(test_replay_trace_emits_only_real_transitions);
+    return UNITY_END();
+}
@@ -0,0 +1,128 @@
+/*
+ * Test host del PID di direzione: avvolgimento dell'errore, anti-windup,
+ * priorità della correzione sulla base, anello chiuso su un modello del
+ * robot e costo di un passo (benchmark).
+ */
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "HeadingController.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const float DT = CONTROL_PERIOD_US * 1e-6f;
+
+void test_error_wraps_shortest_way() {
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, HeadingController::wrapDeg(720.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 180.0f, HeadingController::wrapDeg(-180.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, -170.0f, HeadingController::wrapDeg(190.0f));
+
+    // Da 350° a 10° (yaw non avvolto): si gira di +20°, non di -340°
+    HeadingController hc;
+    hc.setTarget(10.0f);
+    DriveCommand cmd = hc.update(350.0f, 0.0f, DT);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 20.0f, hc.error());
+    TEST_ASSERT_TRUE(cmd.right > 0 && cmd.left < 0);
+    TEST_ASSERT_EQUAL(-cmd.left, cmd.right);
+}
+
+void test_integral_stops_when_saturated() {
+    PidGains g = {10.0f, 5.0f, 0.0f, 50.0f, 0.0f, 100.0f};
+    Pid pid(g);
+    // Errore grande per molto tempo: uscita saturata, integrale fermo
+    for (int i = 0; i < 1000; i++) TEST_ASSERT_EQUAL_FLOAT(100.0f, pid.update(30.0f, 0.0f, DT));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, pid.integral());
+
+    // Errore piccolo: l'integrale cresce fino al suo limite
+    for (int i = 0; i < 5000; i++) pid.update(2.0f, 0.0f, DT);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 50.0f, pid.integral());
+
+    // Derivata sulla misura: rotazione verso il riferimento frena l'uscita
+    PidGains pd = {1.0f, 0.0f, 0.5f, 0.0f, 0.0f, 1000.0f};
+    Pid d(pd);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10.0f - 0.5f * 40.0f, d.update(10.0f, 40.0f, DT));
+}
+
+void test_heading_has_priority_over_base_speed() {
+    HeadingController hc;
+    hc.setBaseSpeed(MOTOR_SPEED_MAX);
+    hc.setTarget(0.0f);
+
+    // In asse: entrambe le ruote al massimo
+    DriveCommand cmd = hc.update(0.0f, 0.0f, DT);
+    TEST_ASSERT_EQUAL(MOTOR_SPEED_MAX, cmd.left);
+    TEST_ASSERT_EQUAL(MOTOR_SPEED_MAX, cmd.right);
+
+    // Fuori asse: la differenza tra le ruote resta intera, cala la base
+    hc.reset();
+    cmd = hc.update(-5.0f, 0.0f, DT);
+    float u = HEADING_KP * 5.0f;  // Al bordo della zona di integrazione: solo P
+    TEST_ASSERT_INT_WITHIN(1, (int)lroundf(2.0f * u), cmd.right - cmd.left);
+    TEST_ASSERT_TRUE(cmd.right <= MOTOR_SPEED_MAX);
+}
+
+// Robot come integratore con ritardo del primo ordine sul comando differenziale
+void test_closed_loop_turns_and_settles() {
+    HeadingController hc;
+    hc.setTarget(90.0f);
+    const float maxRateDps = 360.0f;  // Rotazione sul posto a piena velocità
+    const float tauS = 0.05f;
+    float yaw = 0.0f, rate = 0.0f, maxYaw = 0.0f;
+    int settledAt = -1;
+
+    for (int i = 0; i < 1500; i++) {  // 3 s
+        DriveCommand cmd = hc.update(yaw, rate, DT);
+        float target = maxRateDps * (cmd.right - cmd.left) / (2.0f * MOTOR_SPEED_MAX);
+        rate += (target - rate) * DT / tauS;
+        yaw += rate * DT;
+        if (yaw > maxYaw) maxYaw = yaw;
+        if (settledAt < 0 && fabsf(yaw - 90.0f) < 1.0f && fabsf(rate) < 5.0f) settledAt = i;
+    }
+
+    TEST_ASSERT_TRUE(settledAt >= 0);
+    TEST_ASSERT_TRUE(settledAt * DT < 1.5f);
+    TEST_ASSERT_TRUE(maxYaw < 90.0f + 10.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 90.0f, yaw);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "90 gradi: assestato in %.0f ms, sovraelongazione %.1f gradi", settledAt * DT * 1000.0f,
+             maxYaw - 90.0f);
+    TEST_MESSAGE(msg);
+}
+
+void test_step_cost_benchmark() {
+    HeadingController hc;
+    hc.setBaseSpeed(200);
+    hc.setTarget(45.0f);
+    const int steps = 1000000;
+    volatile int32_t sink = 0;
+    float yaw = 0.0f;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) {
+        DriveCommand cmd = hc.update(yaw, 10.0f, DT);
+        sink += cmd.left - cmd.right;
+        yaw += 0.00004f;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / steps;
+    (void)sink;
+
+    // Ordini di grandezza sotto il periodo dell'anello
+    TEST_ASSERT_TRUE(ns < CONTROL_PERIOD_US * 1000.0 / 100.0);
+    char msg[64];
+    snprintf(msg, sizeof(msg), "update(): %.1f ns per passo", ns);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_error_wraps_shortest_way);
+    RUN_TEST(test_integral_stops_when_saturated);
+    RUN_TEST(test_heading_has_priority_over_base_speed);
+    RUN_TEST(test_closed_loop_turns_and_settles);
+    RUN_TEST(test_step_cost_benchmark);
+    return UNITY_END();
+}
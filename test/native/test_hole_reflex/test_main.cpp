@@ -0,0 +1,409 @@
+/*
+ * Test host del riflesso sul buco nero: ColorManager su una traccia spettrale
+ * (SensorReplay) con un'uscita motori finta. Verifica lo scatto sul primo
+ * campione grezzo nero, le fasi freno/retromarcia/fermo, il rilascio (anche
+ * sul nero, senza nuovo scatto) e la latenza campione->freno (dal DATA_RDY,
+ * lettura dei canali inclusa), confrontata con l'evento del pavimento (EMA +
+ * debounce), il fermo da cieco con l'AS7262 non online.
+ */
+#include <unity.h>
+#include <cstdio>
+#include <vector>
+
+#include "CalibrationStore.h"
+#include "HoleReflex.h"
+#include "SensorReplay.h"
+
+void setUp() {}
+void tearDown() {}
+
+static SpectralData makeData(float v, float b, float g, float y, float o, float r) {
+    SpectralData d = {{v, b, g, y, o, r}, v + b + g + y + o + r};
+    return d;
+}
+
+static const SpectralData WHITE = makeData(180, 210, 230, 240, 235, 220);
+static const SpectralData BLACK = makeData(4, 5, 5, 6, 5, 5);
+static const SpectralData RED   = makeData(30, 25, 30, 60, 160, 260);
+static const SpectralData BLUE  = makeData(150, 230, 120, 60, 40, 35);
+
+static const uint32_t T0 = 2000000;
+static const uint32_t PERIOD_US = 28000;
+
+// Motori finti: registra i comandi; ogni preempt() costa writeUs di tempo virtuale (GPIO + LEDC)
+class FakeDrive : public DriveOutput {
+public:
+    explicit FakeDrive(VirtualClock& clock, uint32_t writeUs = 20) : _clock(clock), _writeUs(writeUs) {}
+
+    struct Command {
+        uint32_t timeUs;
+        int16_t  left, right;
+    };
+    std::vector<Command> commands;
+    bool    preempted = false;
+    int16_t left = 0, right = 0;
+
+    void preempt(int16_t l, int16_t r) override {
+        _clock.advance(_writeUs);
+        preempted = true;
+        left = l;
+        right = r;
+        commands.push_back({_clock.micros(), l, r});
+    }
+    void releasePreempt() override {
+        preempted = false;
+        left = right = 0;
+    }
+    int16_t driveCommand(uint8_t side) const override { return side == 0 ? left : right; }
+
+    // Il controllo: ignorato finché il riflesso ha i motori
+    void drive(int16_t l, int16_t r) {
+        if (preempted) return;
+        left = l;
+        right = r;
+    }
+
+private:
+    VirtualClock& _clock;
+    uint32_t      _writeUs;
+};
+
+// Bianco, poi il buco (bordo netto), poi di nuovo bianco. Ritorna l'istante del primo campione nero.
+static uint32_t buildTrace(SensorTrace& trace, int whiteBefore, int black, const SpectralData& dark = BLACK) {
+    uint32_t t = T0;
+    for (int i = 0; i < whiteBefore; i++, t += PERIOD_US) trace.logSpectralRaw(WHITE.channels, t);
+    uint32_t edge = t;
+    for (int i = 0; i < black; i++, t += PERIOD_US) trace.logSpectralRaw(dark.channels, t);
+    for (int i = 0; i < 10; i++, t += PERIOD_US) trace.logSpectralRaw(WHITE.channels, t);
+    trace.finish();
+    return edge;
+}
+
+static void storeCalibration(SensorReplay& replay) {
+    SpectralClassifier table;
+    loadDefaultClasses(table, WHITE, BLACK, RED, BLUE);
+    CalibrationBlob blob;
+    packCalibration(table, "arena", blob);
+    replay.storage().begin(CALIB_NVS_NAMESPACE, false);
+    replay.storage().putBytes("p0", &blob, sizeof(blob));
+    replay.storage().putUChar("active", 0);
+    replay.storage().end();
+}
+
+// Avanza finché il riflesso scatta (o la traccia finisce). Ritorna l'istante del freno, 0 se mai.
+static uint32_t runUntilFire(SensorReplay& replay, HoleReflex& reflex) {
+    while (replay.step()) {
+        if (reflex.fires() > 0) return replay.clock().micros();
+    }
+    return 0;
+}
+
+void test_fires_on_first_raw_black_sample_before_floor_event() {
+    SensorTrace trace;
+    uint32_t edge = buildTrace(trace, 20, 15);
+    SensorReplay replay(trace);
+    storeCalibration(replay);
+    FakeDrive drive(replay.clock());
+    HoleReflex reflex(drive);
+    replay.color().attachReflex(&reflex);
+    int8_t sub = replay.color().floorEvents().subscribe();
+    TEST_ASSERT_TRUE(replay.boot());
+
+    drive.drive(200, 200);
+    TEST_ASSERT_NOT_EQUAL(0, runUntilFire(replay, reflex));
+    TEST_ASSERT_EQUAL(1, reflex.fires());
+    TEST_ASSERT_EQUAL(REFLEX_BRAKING, reflex.state());
+    TEST_ASSERT_TRUE(drive.preempted);
+    TEST_ASSERT_EQUAL(0, drive.commands[0].left);
+    TEST_ASSERT_EQUAL(0, drive.commands[0].right);
+
+    // Primo campione nero: letto al massimo un tick di replica dopo la traccia
+    uint32_t sampleUs = replay.color().getSampleTimeUs();
+    TEST_ASSERT_TRUE(sampleUs >= edge && sampleUs - edge <= REPLAY_TICK_US);
+    TEST_ASSERT_EQUAL(20, reflex.lastLatencyUs());  // Solo la scrittura dei motori
+    TEST_ASSERT_EQUAL(0, reflex.overBudget());
+
+    // L'evento del pavimento (EMA + debounce) arriva molto dopo
+    FloorEvent ev;
+    uint32_t eventUs = 0;
+    while (replay.step()) {
+        while (replay.color().floorEvents().poll(sub, ev)) {
+            if (ev.to == COLOR_BLACK) eventUs = ev.confirmUs;
+        }
+        if (eventUs) break;
+    }
+    TEST_ASSERT_NOT_EQUAL(0, eventUs);
+    TEST_ASSERT_TRUE(eventUs > sampleUs + PERIOD_US);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "bordo->freno %lu us (riflesso) | bordo->evento NERO %.1f ms"
+             " (EMA + debounce)", (unsigned long)(drive.commands[0].timeUs - edge), (eventUs - edge) / 1000.0f);
+    TEST_MESSAGE(msg);
+}
+
+void test_brake_backoff_hold_and_release() {
+    SensorTrace trace;
+    buildTrace(trace, 10, 40);
+    SensorReplay replay(trace);
+    storeCalibration(replay);
+    FakeDrive drive(replay.clock());
+    HoleReflex reflex(drive);
+    replay.color().attachReflex(&reflex);
+    TEST_ASSERT_TRUE(replay.boot());
+
+    drive.drive(300, 280);
+    uint32_t brakeUs = runUntilFire(replay, reflex);
+    TEST_ASSERT_NOT_EQUAL(0, brakeUs);
+
+    // Il controllo continua a comandare, senza effetto
+    drive.drive(300, 280);
+    TEST_ASSERT_EQUAL(0, drive.left);
+
+    // Dopo REFLEX_BRAKE_US: retromarcia, poi di nuovo freno e attesa
+    while (replay.clock().micros() - brakeUs < REFLEX_BRAKE_US + REPLAY_TICK_US * 2) replay.step();
+    TEST_ASSERT_EQUAL(REFLEX_BACKOFF, reflex.state());
+    TEST_ASSERT_EQUAL(-REFLEX_BACKOFF_SPEED, drive.left);
+    TEST_ASSERT_EQUAL(-REFLEX_BACKOFF_SPEED, drive.right);
+    while (replay.clock().micros() - brakeUs < REFLEX_BRAKE_US + REFLEX_BACKOFF_US + REPLAY_TICK_US * 2) {
+        replay.step();
+    }
+    TEST_ASSERT_EQUAL(REFLEX_HOLD, reflex.state());
+    TEST_ASSERT_EQUAL(0, drive.left);
+    TEST_ASSERT_EQUAL(3, drive.commands.size());
+
+    // Ancora sul nero in attesa: nessun nuovo scatto finché non viene rilasciato
+    for (int i = 0; i < 100; i++) replay.step();
+    TEST_ASSERT_EQUAL(1, reflex.fires());
+
+    reflex.requestRelease();
+    replay.step();
+    TEST_ASSERT_EQUAL(REFLEX_ARMED, reflex.state());
+    TEST_ASSERT_FALSE(drive.preempted);
+    drive.drive(100, 100);
+    TEST_ASSERT_EQUAL(100, drive.left);
+}
+
+void test_release_on_black_lets_the_robot_back_out() {
+    // Buco lungo: dopo freno e retromarcia il sensore vede ancora nero
+    SensorTrace trace;
+    uint32_t t = T0;
+    for (int i = 0; i < 10; i++, t += PERIOD_US) trace.logSpectralRaw(WHITE.channels, t);
+    for (int i = 0; i < 40; i++, t += PERIOD_US) trace.logSpectralRaw(BLACK.channels, t);
+    for (int i = 0; i < 10; i++, t += PERIOD_US) trace.logSpectralRaw(WHITE.channels, t);
+    uint32_t secondHole = t;
+    for (int i = 0; i < 10; i++, t += PERIOD_US) trace.logSpectralRaw(BLACK.channels, t);
+    trace.finish();
+
+    SensorReplay replay(trace);
+    storeCalibration(replay);
+    FakeDrive drive(replay.clock());
+    HoleReflex reflex(drive);
+    replay.color().attachReflex(&reflex);
+    TEST_ASSERT_TRUE(replay.boot());
+
+    drive.drive(200, 200);
+    uint32_t brakeUs = runUntilFire(replay, reflex);
+    TEST_ASSERT_NOT_EQUAL(0, brakeUs);
+    while (reflex.state() != REFLEX_HOLD) replay.step();
+
+    // Rilascio sul nero, robot fermo: nessun nuovo scatto
+    reflex.requestRelease();
+    for (int i = 0; i < 60; i++) replay.step();
+    TEST_ASSERT_EQUAL(REFLEX_ARMED, reflex.state());
+    TEST_ASSERT_EQUAL(1, reflex.fires());
+
+    // Il controllo esce dal buco in retromarcia, sempre sul nero
+    drive.drive(-150, -150);
+    while (replay.clock().micros() < secondHole - PERIOD_US) replay.step();
+    TEST_ASSERT_EQUAL(1, reflex.fires());
+    TEST_ASSERT_FALSE(drive.preempted);
+    TEST_ASSERT_EQUAL(-150, drive.left);
+
+    // Fuori dal nero il riflesso torna a scattare sul buco successivo
+    drive.drive(200, 200);
+    while (reflex.fires() < 2 && replay.step()) {}
+    TEST_ASSERT_EQUAL(2, reflex.fires());
+    TEST_ASSERT_TRUE(drive.preempted);
+}
+
+void test_stationary_robot_only_brakes() {
+    SensorTrace trace;
+    buildTrace(trace, 10, 40);
+    SensorReplay replay(trace);
+    storeCalibration(replay);
+    FakeDrive drive(replay.clock());
+    HoleReflex reflex(drive);
+    replay.color().attachReflex(&reflex);
+    TEST_ASSERT_TRUE(replay.boot());
+
+    // Fermo (es. appoggiato sul nero): nessuna retromarcia
+    uint32_t brakeUs = runUntilFire(replay, reflex);
+    TEST_ASSERT_NOT_EQUAL(0, brakeUs);
+    while (replay.clock().micros() - brakeUs < REFLEX_BRAKE_US + REPLAY_TICK_US * 2) replay.step();
+    TEST_ASSERT_EQUAL(REFLEX_HOLD, reflex.state());
+    TEST_ASSERT_EQUAL(1, drive.commands.size());
+}
+
+void test_shadow_and_disarm_do_not_fire() {
+    // Ombra appena sotto la soglia: NERO, ma con confidenza bassa
+    SpectralClassifier table;
+    loadDefaultClasses(table, WHITE, BLACK, RED, BLUE);
+    float scale = table.darkThreshold() * 0.95f / WHITE.sum;
+    SpectralData shadow = WHITE;
+    for (int ch = 0; ch < CH_COUNT; ch++) shadow.channels[ch] *= scale;
+    shadow.sum *= scale;
+    SpectralMatch m = table.classify(shadow);
+    TEST_ASSERT_EQUAL(COLOR_BLACK, m.type);
+    TEST_ASSERT_LESS_THAN(REFLEX_MIN_CONFIDENCE, m.confidence);
+
+    SensorTrace trace;
+    buildTrace(trace, 10, 20, shadow);
+    SensorReplay replay(trace);
+    storeCalibration(replay);
+    FakeDrive drive(replay.clock());
+    HoleReflex reflex(drive);
+    replay.color().attachReflex(&reflex);
+    TEST_ASSERT_TRUE(replay.boot());
+    drive.drive(200, 200);
+    TEST_ASSERT_EQUAL(0, runUntilFire(replay, reflex));
+
+    // Buco vero ma riflesso disarmato (calibrazione del nero)
+    SensorTrace trace2;
+    buildTrace(trace2, 10, 20);
+    SensorReplay replay2(trace2);
+    storeCalibration(replay2);
+    FakeDrive drive2(replay2.clock());
+    HoleReflex reflex2(drive2);
+    replay2.color().attachReflex(&reflex2);
+    reflex2.requestArmed(false);
+    TEST_ASSERT_TRUE(replay2.boot());
+    TEST_ASSERT_EQUAL(0, runUntilFire(replay2, reflex2));
+    TEST_ASSERT_EQUAL(REFLEX_DISARMED, reflex2.state());
+    TEST_ASSERT_TRUE(drive2.commands.empty());
+}
+
+void test_latency_over_budget_is_counted() {
+    SensorTrace trace;
+    buildTrace(trace, 10, 5);
+    SensorReplay replay(trace);
+    storeCalibration(replay);
+    FakeDrive drive(replay.clock(), REFLEX_LATENCY_BUDGET_US + 500);  // Scrittura lenta (bus conteso)
+    HoleReflex reflex(drive);
+    replay.color().attachReflex(&reflex);
+    TEST_ASSERT_TRUE(replay.boot());
+    TEST_ASSERT_NOT_EQUAL(0, runUntilFire(replay, reflex));
+    TEST_ASSERT_EQUAL(REFLEX_LATENCY_BUDGET_US + 500, reflex.maxLatencyUs());
+    TEST_ASSERT_EQUAL(1, reflex.overBudget());
+}
+
+void test_blind_stop_while_sensor_offline() {
+    // Bianco, poi l'AS7262 tace 1,5 s (guasto e re-init), poi di nuovo bianco
+    SensorTrace trace;
+    uint32_t t = T0;
+    for (int i = 0; i < 10; i++, t += PERIOD_US) trace.logSpectralRaw(WHITE.channels, t);
+    uint32_t silentUs = t;
+    for (t += 1500000; t < silentUs + 2500000; t += PERIOD_US) trace.logSpectralRaw(WHITE.channels, t);
+    trace.finish();
+
+    SensorReplay replay(trace);
+    storeCalibration(replay);
+    FakeDrive drive(replay.clock());
+    HoleReflex reflex(drive);
+    replay.color().attachReflex(&reflex);
+    TEST_ASSERT_TRUE(replay.boot());
+    drive.drive(200, 200);
+
+    // Fermo appena la salute lascia OK, non al primo campione mancato
+    uint32_t blindUs = 0;
+    while (replay.step()) {
+        if (reflex.state() == REFLEX_BLIND) {
+            blindUs = replay.clock().micros();
+            break;
+        }
+    }
+    TEST_ASSERT_NOT_EQUAL(0, blindUs);
+    TEST_ASSERT_FALSE(replay.color().getHealth().isOnline());
+    TEST_ASSERT_TRUE(drive.preempted);
+    TEST_ASSERT_EQUAL(0, drive.left);
+    TEST_ASSERT_EQUAL(0, reflex.fires());
+
+    // Il rilascio manuale non vale da cieco
+    reflex.requestRelease();
+    replay.step();
+    TEST_ASSERT_EQUAL(REFLEX_BLIND, reflex.state());
+    drive.drive(200, 200);
+    TEST_ASSERT_EQUAL(0, drive.left);
+
+    // Sensore recuperato: motori di nuovo al controllo, riflesso armato
+    while (replay.step() && reflex.state() == REFLEX_BLIND) {}
+    uint32_t backUs = replay.clock().micros();
+    TEST_ASSERT_EQUAL(REFLEX_ARMED, reflex.state());
+    TEST_ASSERT_TRUE(replay.color().getHealth().isOnline());
+    TEST_ASSERT_FALSE(drive.preempted);
+    TEST_ASSERT_EQUAL(1, reflex.blindStops());
+
+    // Disarmato (calibrazione del nero) un nuovo guasto non prende i motori
+    reflex.requestArmed(false);
+    while (replay.step()) {}
+    for (uint32_t us = 0; us < HEALTH_COLOR_STALE_US * 2 && replay.color().getHealth().isOnline();
+         us += REPLAY_TICK_US) {
+        replay.clock().advance(REPLAY_TICK_US);
+        replay.color().update();
+    }
+    replay.color().update();
+    TEST_ASSERT_FALSE(replay.color().getHealth().isOnline());
+    TEST_ASSERT_EQUAL(REFLEX_DISARMED, reflex.state());
+    TEST_ASSERT_FALSE(drive.preempted);
+    TEST_ASSERT_EQUAL(1, reflex.blindStops());
+
+    char msg[112];
+    snprintf(msg, sizeof(msg), "AS7262 muto: fermo dopo %.0f ms, motori restituiti dopo %.0f ms",
+             (blindUs - silentUs) / 1000.0f, (backUs - blindUs) / 1000.0f);
+    TEST_MESSAGE(msg);
+}
+
+// Latenza dal DATA_RDY visto: la lettura dei canali sul bus è inclusa
+static uint32_t latencyWithRead(uint32_t readUs, uint32_t& overBudget) {
+    SensorTrace trace;
+    buildTrace(trace, 10, 5);
+    SensorReplay replay(trace);
+    storeCalibration(replay);
+    replay.spectral().setReadUs(readUs);
+    FakeDrive drive(replay.clock());
+    HoleReflex reflex(drive);
+    replay.color().attachReflex(&reflex);
+    overBudget = 0;
+    if (!replay.boot() || runUntilFire(replay, reflex) == 0) return 0;
+    overBudget = reflex.overBudget();
+    return reflex.maxLatencyUs();
+}
+
+void test_latency_counts_the_channel_read() {
+    uint32_t over = 0;
+    // Lettura a registri virtuali in un'unica sequenza (AS7262_FAST_READ), ~8 ms stimati
+    uint32_t fast = latencyWithRead(8000, over);
+    TEST_ASSERT_EQUAL(8000 + 20, fast);
+    TEST_ASSERT_EQUAL(0, over);
+    // Lettura più lenta del budget (bus conteso, o la libreria): contata
+    uint32_t slow = latencyWithRead(REFLEX_LATENCY_BUDGET_US + 200, over);
+    TEST_ASSERT_EQUAL(REFLEX_LATENCY_BUDGET_US + 200 + 20, slow);
+    TEST_ASSERT_EQUAL(1, over);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "poll con DATA_RDY->freno: %lu us (lettura veloce), %lu us (lenta), budget %u us",
+             (unsigned long)fast, (unsigned long)slow, (unsigned)REFLEX_LATENCY_BUDGET_US);
+    TEST_MESSAGE(msg);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fires_on_first_raw_black_sample_before_floor_event);
+    RUN_TEST(test_brake_backoff_hold_and_release);
+    RUN_TEST(test_release_on_black_lets_the_robot_back_out);
+    RUN_TEST(test_stationary_robot_only_brakes);
+    RUN_TEST(test_shadow_and_disarm_do_not_fire);
+    RUN_TEST(test_latency_over_budget_is_counted);
+    RUN_TEST(test_latency_counts_the_channel_read);
+    RUN_TEST(test_blind_stop_while_sensor_offline);
+    return UNITY_END();
+}
@@ -0,0 +1,151 @@
+/*
+ * Test host del parser FIFO MPU9250 e dell'integratore a passo fisso,
+ * alimentati con stream di byte costruiti come li emette il chip.
+ */
+#include <unity.h>
+#include <math.h>
+#include <vector>
+
+#include "ImuFifo.h"
+
+static void pushBe16(std::vector<uint8_t>& out, int16_t v) {
+    out.push_back((uint8_t)((uint16_t)v >> 8));
+    out.push_back((uint8_t)(v & 0xFF));
+}
+
+// Stream FIFO "registrato": n frame identici
+static std::vector<uint8_t> recordFifo(size_t n, int16_t ax, int16_t ay, int16_t az,
+                                       int16_t gx, int16_t gy, int16_t gz) {
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i < n; i++) {
+        pushBe16(bytes, ax); pushBe16(bytes, ay); pushBe16(bytes, az);
+        pushBe16(bytes, gx); pushBe16(bytes, gy); pushBe16(bytes, gz);
+    }
+    return bytes;
+}
+
+static const int16_t ONE_G = (int16_t)IMU_ACC_LSB_PER_G;
+
+void setUp() {}
+void tearDown() {}
+
+void test_parse_big_endian_frame() {
+    const uint8_t raw[MPU_FIFO_FRAME_BYTES] = {
+        0x01, 0x02, 0xFF, 0xFE, 0x10, 0x00, // ax=258, ay=-2, az=4096
+        0x80, 0x00, 0x7F, 0xFF, 0x00, 0x52  // gx=-32768, gy=32767, gz=82
+    };
+    ImuRawFrame f;
+    TEST_ASSERT_EQUAL(1, parseFifoFrames(raw, sizeof(raw), &f, 1));
+    TEST_ASSERT_EQUAL(258, f.ax);
+    TEST_ASSERT_EQUAL(-2, f.ay);
+    TEST_ASSERT_EQUAL(4096, f.az);
+    TEST_ASSERT_EQUAL(-32768, f.gx);
+    TEST_ASSERT_EQUAL(32767, f.gy);
+    TEST_ASSERT_EQUAL(82, f.gz);
+}
+
+void test_parse_ignores_partial_frame_and_respects_capacity() {
+    std::vector<uint8_t> bytes = recordFifo(3, 0, 0, ONE_G, 0, 0, 0);
+    bytes.resize(bytes.size() - 5); // Ultimo frame troncato
+    ImuRawFrame frames[4];
+    TEST_ASSERT_EQUAL(2, parseFifoFrames(bytes.data(), bytes.size(), frames, 4));
+    TEST_ASSERT_EQUAL(1, parseFifoFrames(bytes.data(), bytes.size(), frames, 1));
+}
+
+void test_every_sample_integrated_at_1ms() {
+    FifoIntegrator integ(IMU_GYRO_LSB_PER_DPS, IMU_ACC_LSB_PER_G, IMU_FIFO_SAMPLE_DT_S);
+    // 90 °/s per 1 s = 90°, consegnati in blocchi irregolari (loop con singhiozzi)
+    int16_t gz = (int16_t)(90.0f * IMU_GYRO_LSB_PER_DPS);
+    std::vector<uint8_t> bytes = recordFifo(1000, 0, 0, ONE_G, 0, 0, gz);
+
+    ImuRawFrame frames[64];
+    size_t offset = 0;
+    const size_t bursts[] = {1, 7, 42, 3, 10, 42, 25};
+    size_t b = 0;
+    while (offset < bytes.size()) {
+        size_t want = bursts[b++ % 7] * MPU_FIFO_FRAME_BYTES;
+        if (offset + want > bytes.size()) want = bytes.size() - offset;
+        size_t n = parseFifoFrames(bytes.data() + offset, want, frames, 64);
+        integ.process(frames, n);
+        offset += n * MPU_FIFO_FRAME_BYTES;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(1000, integ.samples());
+    // 90 dps quantizzato a 1476 LSB -> 90.0 °
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 1476.0f / IMU_GYRO_LSB_PER_DPS, integ.yaw());
+}
+
+void test_bias_calibration_and_deadband() {
+    FifoIntegrator integ(IMU_GYRO_LSB_PER_DPS, IMU_ACC_LSB_PER_G, IMU_FIFO_SAMPLE_DT_S);
+    integ.setDeadband(IMU_GYRO_DEADBAND_DPS);
+    integ.startBiasCalibration(100);
+
+    // Giroscopio fermo con offset di 20 LSB (~1.2 °/s)
+    std::vector<uint8_t> still = recordFifo(100, 30, -40, ONE_G + 50, 5, -7, 20);
+    ImuRawFrame frames[100];
+    size_t n = parseFifoFrames(still.data(), still.size(), frames, 100);
+    integ.process(frames, n);
+    TEST_ASSERT_FALSE(integ.isCalibrating());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, integ.yaw());
+
+    // Dopo la calibrazione, lo stesso segnale non deve far derivare lo yaw
+    integ.process(frames, n);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, integ.yaw());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, integ.pitch());
+}
+
+void test_pitch_from_accelerometer() {
+    FifoIntegrator integ(IMU_GYRO_LSB_PER_DPS, IMU_ACC_LSB_PER_G, IMU_FIFO_SAMPLE_DT_S);
+    // Rampa di 20°: gravità proiettata su -X e Z
+    int16_t ax = (int16_t)(-sinf(20.0f * (float)M_PI / 180.0f) * ONE_G);
+    int16_t az = (int16_t)(cosf(20.0f * (float)M_PI / 180.0f) * ONE_G);
+    std::vector<uint8_t> bytes = recordFifo(10, ax, 0, az, 0, 0, 0);
+    ImuRawFrame frames[10];
+    integ.process(frames, parseFifoFrames(bytes.data(), bytes.size(), frames, 10));
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 20.0f, integ.pitch());
+}
+
+void test_gap_bridging_keeps_rotation() {
+    FifoIntegrator integ(IMU_GYRO_LSB_PER_DPS, IMU_ACC_LSB_PER_G, IMU_FIFO_SAMPLE_DT_S);
+    int16_t gz = (int16_t)(-45.0f * IMU_GYRO_LSB_PER_DPS);
+    std::vector<uint8_t> bytes = recordFifo(100, 0, 0, ONE_G, 0, 0, gz);
+    ImuRawFrame frames[100];
+    integ.process(frames, parseFifoFrames(bytes.data(), bytes.size(), frames, 100));
+    float before = integ.yaw();
+
+    // Overflow: 200 ms di campioni persi alla stessa velocità
+    integ.bridgeGap(0.2f);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, before + integ.gyroZDps() * 0.2f, integ.yaw());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -13.5f, integ.yaw());
+}
+
+void test_gap_bridging_rotates_attached_filter() {
+    FifoIntegrator integ(IMU_GYRO_LSB_PER_DPS, IMU_ACC_LSB_PER_G, IMU_FIFO_SAMPLE_DT_S);
+    OrientationFilter filter;
+    integ.attachFilter(&filter);
+    int16_t ax = (int16_t)(-sinf(10.0f * (float)M_PI / 180.0f) * ONE_G);
+    int16_t az = (int16_t)(cosf(10.0f * (float)M_PI / 180.0f) * ONE_G);
+    int16_t gz = (int16_t)(90.0f * IMU_GYRO_LSB_PER_DPS);
+    std::vector<uint8_t> bytes = recordFifo(42, ax, 0, az, 0, 0, gz);
+    ImuRawFrame frames[42];
+    integ.process(frames, parseFifoFrames(bytes.data(), bytes.size(), frames, 42));
+    float yawBefore = filter.yawDeg();
+    float pitchBefore = filter.pitchDeg();
+
+    // Stallo da 100 ms: 58 ms fuori dalla FIFO
+    integ.bridgeGap(0.058f);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, yawBefore + 90.0f * 0.058f, filter.yawDeg());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, pitchBefore, filter.pitchDeg());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_big_endian_frame);
+    RUN_TEST(test_parse_ignores_partial_frame_and_respects_capacity);
+    RUN_TEST(test_every_sample_integrated_at_1ms);
+    RUN_TEST(test_bias_calibration_and_deadband);
+    RUN_TEST(test_pitch_from_accelerometer);
+    RUN_TEST(test_gap_bridging_keeps_rotation);
+    RUN_TEST(test_gap_bridging_rotates_attached_filter);
+    return UNITY_END();
+}
@@ -0,0 +1,240 @@
+/*
+ * Test host della localizzazione a particelle: raycast sui muri della mappa,
+ * ricampionamento sistematico, inseguimento lungo un corridoio con un
+ * comando motori sbagliato del 15%, convergenza da una posa iniziale errata,
+ * particelle che attraversano i muri e aggiornamenti al secondo contro il
+ * numero di particelle.
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <math.h>
+#include <random>
+
+#include "ParticleLocalizer.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const int X0 = MAZE_WIDTH / 2;
+static const int Y0 = MAZE_HEIGHT / 2;
+static const int CORRIDOR_TILES = 4;
+static const float T = MAZE_TILE_MM;
+// Muso verso est: avanti = (-sin, -cos) = (1, 0)
+static const float EAST_YAW = -90.0f;
+
+// Corridoio chiuso di CORRIDOR_TILES piastrelle verso est dalla partenza
+static void buildCorridor(MazeMap& map) {
+    for (int i = 0; i < CORRIDOR_TILES; i++) {
+        MazeTile t = MazeMap::tileAt(X0 + i, Y0, 0);
+        map.setWall(t, MAZE_NORTH, true);
+        map.setWall(t, MAZE_SOUTH, true);
+    }
+    map.setWall(MazeMap::tileAt(X0, Y0, 0), MAZE_WEST, true);
+    map.setWall(MazeMap::tileAt(X0 + CORRIDOR_TILES - 1, Y0, 0), MAZE_EAST, true);
+}
+
+// Letture simulate dalla posa vera: rumore gaussiano, oltre la portata "nessun oggetto"
+static ToFData simulateToF(const ParticleLocalizer& loc, float x, float y, float yawDeg, std::mt19937& rng) {
+    std::normal_distribution<float> noise(0.0f, 10.0f);
+    ToFData tof;
+    for (uint8_t i = 0; i < TOF_COUNT; i++) {
+        float d = loc.expectedReading(x, y, yawDeg, i);
+        if (d >= LOCALIZER_MAX_RANGE_MM) {
+            tof.distance_mm[i] = TOF_NO_OBJECT_MM;
+            tof.valid[i] = false;
+        } else {
+            tof.distance_mm[i] = (int16_t)lroundf(d + noise(rng));
+            tof.valid[i] = true;
+        }
+    }
+    return tof;
+}
+
+void test_raycast_hits_tile_walls() {
+    MazeMap map;
+    buildCorridor(map);
+    ParticleLocalizer loc(map);
+    const float cx = (X0 + 0.5f) * T, cy = (Y0 + 0.5f) * T;
+
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, CORRIDOR_TILES * T - T / 2, loc.raycast(cx, cy, 1.0f, 0.0f));  // Est: fondo
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, T / 2, loc.raycast(cx, cy, -1.0f, 0.0f));                      // Ovest
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, T / 2, loc.raycast(cx, cy, 0.0f, -1.0f));                      // Nord
+    // A 45° verso sud-est: il muro sud a T/2 in y
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, T / 2 * sqrtf(2.0f), loc.raycast(cx, cy, 0.7071068f, 0.7071068f));
+
+    // Griglia aperta: fino alla portata massima
+    MazeMap open;
+    ParticleLocalizer far(open);
+    TEST_ASSERT_EQUAL_FLOAT(LOCALIZER_MAX_RANGE_MM, far.raycast(cx, cy, 1.0f, 0.0f));
+
+    // Letture attese dei sensori, muso a est al centro della prima piastrella
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, T / 2 - TOF_SIDE_OFFSET_MM, loc.expectedReading(cx, cy, EAST_YAW, TOF_FRONT_LEFT));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, T / 2 - TOF_SIDE_OFFSET_MM, loc.expectedReading(cx, cy, EAST_YAW, TOF_BACK_RIGHT));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, CORRIDOR_TILES * T - T / 2 - TOF_CENTER_OFFSET_MM,
+                             loc.expectedReading(cx, cy, EAST_YAW, TOF_CENTER));
+}
+
+void test_systematic_resample_follows_weights() {
+    const float w[4] = {0.5f, 0.25f, 0.25f, 0.0f};
+    uint16_t idx[4];
+    ParticleLocalizer::systematicResample(w, 4, 0.5f, idx);
+    TEST_ASSERT_EQUAL(0, idx[0]);
+    TEST_ASSERT_EQUAL(0, idx[1]);
+    TEST_ASSERT_EQUAL(1, idx[2]);
+    TEST_ASSERT_EQUAL(2, idx[3]);
+
+    // Molte particelle: ogni indice compare ~n*w volte, mai quelli a peso zero
+    const uint16_t N = 1000;
+    static float weights[N];
+    static uint16_t out[N];
+    float sum = 0.0f;
+    for (uint16_t i = 0; i < N; i++) sum += weights[i] = (i % 10 == 0) ? 0.0f : (float)(i % 7 + 1);
+    for (uint16_t i = 0; i < N; i++) weights[i] /= sum;
+    ParticleLocalizer::systematicResample(weights, N, 0.3f, out);
+    static uint16_t hits[N];
+    for (uint16_t j = 0; j < N; j++) {
+        TEST_ASSERT_TRUE(j == 0 || out[j] >= out[j - 1]);  // Una sola passata, indici crescenti
+        hits[out[j]]++;
+    }
+    for (uint16_t i = 0; i < N; i++) {
+        if (weights[i] == 0.0f) TEST_ASSERT_EQUAL(0, hits[i]);
+        TEST_ASSERT_TRUE(fabsf(hits[i] - weights[i] * N) < 1.0f);
+    }
+}
+
+void test_tracks_corridor_with_biased_motion_command() {
+    MazeMap map;
+    buildCorridor(map);
+    ParticleLocalizer loc(map);
+    TEST_ASSERT_TRUE(loc.begin());
+    loc.reset(MazeMap::tileAt(X0, Y0, 0), EAST_YAW, 10.0f);
+
+    std::mt19937 rng(7);
+    const uint32_t dtUs = 28000;
+    float x = (X0 + 0.5f) * T, y = (Y0 + 0.5f) * T;
+    float deadReckoning = x;
+    float maxErr = 0.0f;
+    for (int step = 0; x < (X0 + 3.0f) * T; step++) {
+        // Il robot fa il 15% in più di quanto dice il modello del comando, con una leggera oscillazione
+        float cmdMm = ParticleLocalizer::commandToMm(200, 200, dtUs);
+        float yaw = EAST_YAW + 3.0f * sinf(step * 0.1f);
+        x += 1.15f * cmdMm * cosf((yaw - EAST_YAW) * 0.01745329f);
+        y -= 1.15f * cmdMm * sinf((yaw - EAST_YAW) * 0.01745329f);
+        deadReckoning += cmdMm;
+
+        loc.predict(cmdMm, yaw);
+        loc.update(simulateToF(loc, x, y, yaw, rng));
+        float err = hypotf(loc.estimate().xMm - x, loc.estimate().yMm - y);
+        if (step > 10 && err > maxErr) maxErr = err;
+    }
+
+    const LocalizerPose& pose = loc.estimate();
+    float err = hypotf(pose.xMm - x, pose.yMm - y);
+    TEST_ASSERT_EQUAL(MazeMap::tileAt(X0 + 2, Y0, 0), pose.tile);
+    TEST_ASSERT_TRUE(err < 30.0f);
+    TEST_ASSERT_TRUE(fabsf(x - deadReckoning) > 3.0f * err);
+    TEST_ASSERT_TRUE(loc.resamples() > 0);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "errore finale %.1f mm (max %.1f) | solo comando %.1f mm | ricampionamenti %lu",
+             err, maxErr, fabsf(x - deadReckoning), (unsigned long)loc.resamples());
+    TEST_MESSAGE(msg);
+}
+
+void test_converges_from_wrong_initial_pose() {
+    MazeMap map;
+    buildCorridor(map);
+    ParticleLocalizer loc(map);
+    TEST_ASSERT_TRUE(loc.begin());
+
+    // Fermo al centro della seconda piastrella, creduto 120 mm più avanti
+    std::mt19937 rng(11);
+    const float x = (X0 + 1.5f) * T, y = (Y0 + 0.5f) * T;
+    loc.resetPose(x + 120.0f, y, 0, EAST_YAW, 100.0f);
+    TEST_ASSERT_TRUE(fabsf(loc.estimate().xMm - x) > 60.0f);
+
+    for (int i = 0; i < 15; i++) {
+        loc.predict(0.0f, EAST_YAW);
+        TEST_ASSERT_TRUE(loc.update(simulateToF(loc, x, y, EAST_YAW, rng)));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, x, loc.estimate().xMm);
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, y, loc.estimate().yMm);
+    TEST_ASSERT_TRUE(loc.estimate().spreadMm < 30.0f);
+
+    // Tutti i sensori spenti: nessuna correzione
+    ToFData off;
+    for (uint8_t i = 0; i < TOF_COUNT; i++) {
+        off.distance_mm[i] = -1;
+        off.valid[i] = false;
+    }
+    TEST_ASSERT_FALSE(loc.update(off));
+}
+
+void test_allocates_once_and_walls_stop_particles() {
+    MazeMap map;
+    buildCorridor(map);
+    ParticleLocalizer loc(map);
+    TEST_ASSERT_TRUE(loc.begin(256));
+    TEST_ASSERT_TRUE(loc.begin(1024));  // Già allocato: nessuna nuova allocazione
+    TEST_ASSERT_EQUAL(256, loc.count());
+    TEST_ASSERT_FALSE(loc.isExternal());  // Su host nessuna PSRAM
+
+    // Muso a nord contro il muro: chi lo attraversa muore, il colpo di update() ripristina i pesi
+    MazeTile start = MazeMap::tileAt(X0, Y0, 0);
+    loc.reset(start, 0.0f, 5.0f);
+    loc.predict(T, 0.0f);
+    std::mt19937 rng(3);
+    TEST_ASSERT_TRUE(loc.update(simulateToF(loc, (X0 + 0.5f) * T, (Y0 + 0.5f) * T, 0.0f, rng)));
+    TEST_ASSERT_EQUAL(1, loc.degenerate());
+
+    // Lungo il corridoio (verso est) invece si passa
+    loc.reset(start, EAST_YAW, 5.0f);
+    loc.predict(T, EAST_YAW);
+    TEST_ASSERT_TRUE(loc.update(simulateToF(loc, (X0 + 1.5f) * T, (Y0 + 0.5f) * T, EAST_YAW, rng)));
+    TEST_ASSERT_EQUAL(1, loc.degenerate());
+    TEST_ASSERT_EQUAL(MazeMap::tileAt(X0 + 1, Y0, 0), loc.estimate().tile);
+}
+
+void test_benchmark_updates_per_second() {
+    MazeMap map;
+    buildCorridor(map);
+    const uint16_t counts[] = {128, 256, 512, 1024, 2048};
+    const int CYCLES = 200;
+    double usAtDefault = 0.0;
+
+    for (uint16_t n : counts) {
+        ParticleLocalizer loc(map);
+        TEST_ASSERT_TRUE(loc.begin(n));
+        loc.reset(MazeMap::tileAt(X0, Y0, 0), EAST_YAW, 20.0f);
+        std::mt19937 rng(5);
+        const float x = (X0 + 1.5f) * T, y = (Y0 + 0.5f) * T;
+        ToFData tof = simulateToF(loc, x, y, EAST_YAW, rng);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < CYCLES; i++) {
+            loc.predict(1.0f, EAST_YAW);
+            loc.update(tof);
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / CYCLES;
+        if (n == LOCALIZER_PARTICLES) usAtDefault = us;
+
+        char msg[128];
+        snprintf(msg, sizeof(msg), "%4u particelle: %8.1f us/aggiornamento, %8.0f aggiornamenti/s, %.0f ns/particella",
+                 n, us, 1e6 / us, us * 1000.0 / n);
+        TEST_MESSAGE(msg);
+    }
+    // Un campione ToF ogni ~33 ms: su host ci deve stare con ampio margine
+    TEST_ASSERT_TRUE(usAtDefault > 0.0 && usAtDefault < TOF_BUDGET_DEFAULT_US / 10);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_raycast_hits_tile_walls);
+    RUN_TEST(test_systematic_resample_follows_weights);
+    RUN_TEST(test_tracks_corridor_with_biased_motion_command);
+    RUN_TEST(test_converges_from_wrong_initial_pose);
+    RUN_TEST(test_allocates_once_and_walls_stop_particles);
+    RUN_TEST(test_benchmark_updates_per_second);
+    return UNITY_END();
+}
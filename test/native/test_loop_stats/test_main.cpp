@@ -0,0 +1,72 @@
+/*
+ * Test host delle metriche dell'anello periodico: jitter, WCET, scadenze
+ * perse per sforamento e per attivazioni saltate.
+ */
+#include <unity.h>
+
+#include "LoopStats.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_jitter_and_wcet() {
+    LoopStats s(2000);
+    // Inizi a 0, 2000, 4030, 5990: jitter +30 e -40
+    const uint32_t starts[] = {0, 2000, 4030, 5990};
+    const uint32_t exec[] = {100, 120, 400, 110};
+    for (int i = 0; i < 4; i++) {
+        s.begin(starts[i]);
+        s.end(starts[i] + exec[i]);
+    }
+
+    const LoopTiming& t = s.timing();
+    TEST_ASSERT_EQUAL(4, t.cycles);
+    TEST_ASSERT_EQUAL(1960, t.periodMinUs);
+    TEST_ASSERT_EQUAL(2030, t.periodMaxUs);
+    TEST_ASSERT_EQUAL(40, t.jitterMaxUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 28.87f, t.jitterRmsUs);  // sqrt((0 + 900 + 1600) / 3)
+    TEST_ASSERT_EQUAL(400, t.execMaxUs);
+    TEST_ASSERT_EQUAL(110, t.execLastUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 182.5f, t.execMeanUs);
+    TEST_ASSERT_EQUAL(0, t.deadlineMisses);
+}
+
+void test_overrun_and_skipped_releases() {
+    LoopStats s(2000);
+    s.begin(0);
+    s.end(100);
+    // Ciclo troppo lungo: una scadenza persa, e l'attivazione successiva arriva doppia
+    s.begin(2000);
+    s.end(4500);
+    s.begin(4500, 1);
+    s.end(4600);
+    TEST_ASSERT_EQUAL(1, s.timing().deadlineMisses);
+    TEST_ASSERT_EQUAL(1, s.timing().skippedReleases);
+    // Periodo 2500 su due attivazioni: non è jitter
+    TEST_ASSERT_EQUAL(1500, s.timing().jitterMaxUs);
+
+    // Task partito in ritardo senza sforamento (preempted): scadenza persa
+    s.begin(8100, 1);
+    s.end(8200);
+    TEST_ASSERT_EQUAL(2, s.timing().deadlineMisses);
+    TEST_ASSERT_EQUAL(2, s.timing().skippedReleases);
+}
+
+void test_reset_keeps_period() {
+    LoopStats s(1000);
+    s.begin(0);
+    s.end(5000);
+    s.reset();
+    TEST_ASSERT_EQUAL(1000, s.timing().periodUs);
+    TEST_ASSERT_EQUAL(0, s.timing().cycles);
+    TEST_ASSERT_EQUAL(0, s.timing().deadlineMisses);
+    TEST_ASSERT_EQUAL(0, s.timing().execMaxUs);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_jitter_and_wcet);
+    RUN_TEST(test_overrun_and_skipped_releases);
+    RUN_TEST(test_reset_keeps_period);
+    return UNITY_END();
+}
@@ -0,0 +1,208 @@
+/*
+ * Test host della mappa del labirinto e del flood-fill incrementale:
+ * muri condivisi, colori, rampe, confronto con il ricalcolo completo su
+ * labirinti casuali e benchmark della latenza di ripianificazione.
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "MazeMap.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Oggetti grandi (decine di KB): statici, come sul robot
+static MazeMap map;
+static MazePlanner planner(map);
+static MazePlanner reference(map);
+
+static bool sameDistances() {
+    for (MazeTile t = 0; t < MAZE_TILES; t++) {
+        if (planner.distance(t) != reference.distance(t)) return false;
+    }
+    return true;
+}
+
+void test_walls_are_shared_between_tiles() {
+    map.clear();
+    MazeTile a = MazeMap::tileAt(3, 4, 0);
+    MazeTile b = MazeMap::tileAt(4, 4, 0);
+    TEST_ASSERT_EQUAL(MAZE_NO_TILE, MazeMap::tileAt(-1, 0, 0));
+    TEST_ASSERT_EQUAL(MAZE_NO_TILE, MazeMap::tileAt(0, MAZE_HEIGHT, 0));
+    TEST_ASSERT_EQUAL(b, map.neighbor(a, MAZE_EAST));
+
+    TEST_ASSERT_TRUE(map.setWall(a, MAZE_EAST, true));
+    TEST_ASSERT_TRUE(map.hasWall(b, MAZE_WEST));
+    TEST_ASSERT_TRUE(map.isSideSeen(b, MAZE_WEST));
+    TEST_ASSERT_EQUAL(MAZE_NO_TILE, map.neighbor(b, MAZE_WEST));
+    TEST_ASSERT_FALSE(map.setWall(b, MAZE_WEST, true));  // Già noto
+
+    // Lato osservato aperto: nessun cambio di passaggio, ma resta "visto"
+    TEST_ASSERT_FALSE(map.setWall(a, MAZE_NORTH, false));
+    TEST_ASSERT_TRUE(map.isSideSeen(a, MAZE_NORTH));
+    TEST_ASSERT_FALSE(map.hasWall(a, MAZE_NORTH));
+    TEST_ASSERT_EQUAL(MAZE_SEEN(MAZE_NORTH) | MAZE_SEEN(MAZE_EAST) | MAZE_WALL(MAZE_EAST), map.walls(a));
+}
+
+void test_floor_colors_and_ramps() {
+    map.clear();
+    MazeTile t = MazeMap::startTile();
+    TEST_ASSERT_FALSE(map.markFloor(t, COLOR_SILVER));
+    TEST_ASSERT_EQUAL(TILE_VISITED | TILE_CHECKPOINT, map.flags(t));
+    MazeTile blue = map.adjacent(t, MAZE_SOUTH);
+    map.markFloor(blue, COLOR_BLUE);
+    TEST_ASSERT_EQUAL(TILE_VISITED | TILE_BLUE, map.flags(blue));
+
+    MazeTile hole = map.adjacent(t, MAZE_EAST);
+    TEST_ASSERT_TRUE(map.markFloor(hole, COLOR_BLACK));
+    TEST_ASSERT_FALSE(map.markFloor(hole, COLOR_BLACK));
+    TEST_ASSERT_EQUAL(MAZE_NO_TILE, map.neighbor(t, MAZE_EAST));
+
+    TEST_ASSERT_EQUAL(1, MazeMap::rampFromPitch(20.0f));
+    TEST_ASSERT_EQUAL(-1, MazeMap::rampFromPitch(-20.0f));
+    TEST_ASSERT_EQUAL(0, MazeMap::rampFromPitch(5.0f));
+
+    // Rampa verso nord dal piano 0: si arriva al piano 1 e si torna indietro
+    MazeTile bottom = map.adjacent(t, MAZE_NORTH);
+    MazeTile top = MazeMap::tileAt(MazeMap::tileX(bottom), MazeMap::tileY(bottom) - 2, 1);
+    TEST_ASSERT_TRUE(map.addRamp(bottom, MAZE_NORTH, top));
+    TEST_ASSERT_EQUAL(top, map.neighbor(bottom, MAZE_NORTH));
+    TEST_ASSERT_EQUAL(bottom, map.neighbor(top, MAZE_SOUTH));
+    TEST_ASSERT_TRUE(map.flags(top) & TILE_RAMP);
+
+    planner.clear();
+    planner.addGoal(MazeMap::tileAt(MazeMap::tileX(top), 0, 1));
+    TEST_ASSERT_EQUAL(MazeMap::tileY(top) + 2, planner.distance(t));
+    TEST_ASSERT_EQUAL(MAZE_NORTH, planner.nextStep(t));
+    TEST_ASSERT_EQUAL(MAZE_NORTH, planner.nextStep(bottom));
+}
+
+void test_hole_and_wall_reroute() {
+    map.clear();
+    planner.clear();
+    MazeTile goal = MazeMap::tileAt(10, 10, 0);
+    MazeTile from = MazeMap::tileAt(10, 13, 0);
+    planner.addGoal(goal);
+    TEST_ASSERT_EQUAL(3, planner.distance(from));
+
+    // Buco sulla colonna: si gira attorno (+2)
+    MazeTile hole = MazeMap::tileAt(10, 11, 0);
+    TEST_ASSERT_TRUE(map.markFloor(hole, COLOR_BLACK));
+    planner.onTileBlocked(hole);
+    TEST_ASSERT_EQUAL(MazePlanner::UNREACHABLE, planner.distance(hole));
+    TEST_ASSERT_EQUAL(5, planner.distance(from));
+
+    // Muro che chiude l'obiettivo su tre lati: resta solo nord
+    map.setWall(goal, MAZE_EAST, true);
+    planner.onWallChanged(goal, MAZE_EAST);
+    map.setWall(goal, MAZE_WEST, true);
+    planner.onWallChanged(goal, MAZE_WEST);
+    TEST_ASSERT_EQUAL(7, planner.distance(from));
+
+    // Riaperto: si torna indietro
+    map.setWall(goal, MAZE_WEST, false);
+    planner.onWallChanged(goal, MAZE_WEST);
+    TEST_ASSERT_EQUAL(5, planner.distance(from));
+
+    // Obiettivo rimosso: niente più percorso
+    planner.removeGoal(goal);
+    TEST_ASSERT_EQUAL(MazePlanner::UNREACHABLE, planner.distance(from));
+    TEST_ASSERT_EQUAL(MAZE_DIRS, planner.nextStep(from));
+}
+
+// Muri, buchi e cambi di obiettivo casuali: l'incrementale deve coincidere col ricalcolo
+void test_incremental_matches_full_recompute() {
+    std::mt19937 rng(1234);
+    map.clear();
+    planner.clear();
+    reference.clear();
+    for (int i = 0; i < 3; i++) {
+        MazeTile g = (MazeTile)(rng() % MAZE_TILES);
+        planner.addGoal(g);
+        reference.addGoal(g);
+    }
+    map.addRamp(MazeMap::tileAt(5, 5, 0), MAZE_EAST, MazeMap::tileAt(7, 5, 1));
+    planner.recompute();
+
+    int mismatches = 0;
+    for (int step = 0; step < 3000; step++) {
+        MazeTile t = (MazeTile)(rng() % MAZE_TILES);
+        uint32_t kind = rng() % 20;
+        if (kind < 16) {
+            MazeDir d = (MazeDir)(rng() % MAZE_DIRS);
+            if (map.setWall(t, d, kind < 13)) planner.onWallChanged(t, d);
+        } else if (kind < 17) {
+            if (map.markFloor(t, COLOR_BLACK)) planner.onTileBlocked(t);
+        } else if (kind < 19) {
+            planner.addGoal(t);
+            reference.addGoal(t);
+        } else if (reference.isGoal(t)) {
+            planner.removeGoal(t);
+            reference.removeGoal(t);
+        }
+        if (step % 50 == 0) {
+            reference.recompute();
+            if (!sameDistances()) mismatches++;
+        }
+    }
+    reference.recompute();
+    TEST_ASSERT_EQUAL(0, mismatches);
+    TEST_ASSERT_TRUE(sameDistances());
+}
+
+// Latenza di ripianificazione su griglia piena (tutti i piani), un solo obiettivo
+void test_replanning_latency_benchmark() {
+    std::mt19937 rng(42);
+    map.clear();
+    planner.clear();
+    MazeTile goal = MazeMap::startTile();
+    planner.addGoal(goal);
+
+    // Labirinto denso: ~35% dei lati murati, poi ricalcolo completo di partenza
+    for (int i = 0; i < MAZE_TILES; i++) {
+        MazeTile t = (MazeTile)(rng() % MAZE_TILES);
+        map.setWall(t, (MazeDir)(rng() % MAZE_DIRS), true);
+    }
+    map.addRamp(MazeMap::tileAt(30, 30, 0), MAZE_SOUTH, MazeMap::tileAt(30, 32, 1));
+
+    const int rounds = 50;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) planner.recompute();
+    double fullUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / rounds;
+    uint16_t fullTouched = planner.lastTouched();
+
+    // Scoperte una alla volta, come durante l'esplorazione
+    const int discoveries = 2000;
+    uint32_t touched = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < discoveries; i++) {
+        MazeTile t = (MazeTile)(rng() % MAZE_TILES);
+        MazeDir d = (MazeDir)(rng() % MAZE_DIRS);
+        if (map.setWall(t, d, rng() % 4 != 0)) planner.onWallChanged(t, d);
+        touched += planner.lastTouched();
+    }
+    double incUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / discoveries;
+
+    reference.clear();
+    reference.addGoal(goal);
+    TEST_ASSERT_TRUE(sameDistances());
+    TEST_ASSERT_TRUE(incUs < fullUs);
+    TEST_ASSERT_TRUE(touched / discoveries < fullTouched);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%ux%ux%u piastrelle: ricalcolo %.1f us (%u visite), incrementale %.2f us (%.1f visite medie)",
+             MAZE_WIDTH, MAZE_HEIGHT, MAZE_LEVELS, fullUs, fullTouched, incUs, (double)touched / discoveries);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_walls_are_shared_between_tiles);
+    RUN_TEST(test_floor_colors_and_ramps);
+    RUN_TEST(test_hole_and_wall_reroute);
+    RUN_TEST(test_incremental_matches_full_recompute);
+    RUN_TEST(test_replanning_latency_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,121 @@
+/*
+ * Test host del monitor di corrente dei motori: conversione del CS,
+ * sovracorrente in pochi blocchi DMA, stallo mascherato allo spunto e
+ * rilevato dopo, nessuno stallo a comando basso, azzeramento degli eventi,
+ * correzioni del PID che non rinnovano il mascheramento.
+ */
+#include <unity.h>
+
+#include "MotorMonitor.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Un blocco DMA ogni 1.6 ms (MOTOR_ADC_FRAME_BYTES a MOTOR_ADC_SAMPLE_HZ)
+static const uint32_t FRAME_US = 1600;
+
+void test_raw_to_milliamps() {
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, MotorMonitor::rawToMilliamps(0));
+    // Fondo scala: 3100 mV / 500 mV/A
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 6200.0f, MotorMonitor::rawToMilliamps(MOTOR_ADC_MAX_RAW));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, MotorMonitor::stallThresholdMa(MOTOR_STALL_MIN_CMD - 1));
+    TEST_ASSERT_EQUAL_FLOAT(MotorMonitor::stallThresholdMa(300), MotorMonitor::stallThresholdMa(-300));
+}
+
+void test_overcurrent_within_few_ms() {
+    MotorMonitor m;
+    uint32_t t = 0;
+    for (int i = 0; i < 20; i++, t += FRAME_US) TEST_ASSERT_EQUAL(0, m.update(800.0f, 200, t));
+
+    // Corto sul motore: la soglia va superata con continuità per MOTOR_OVERCURRENT_US
+    uint32_t start = t;
+    uint8_t raised = 0;
+    while (!raised && t - start < 20000) {
+        raised = m.update(6000.0f, 200, t);
+        t += FRAME_US;
+    }
+    TEST_ASSERT_EQUAL(MOTOR_FLAG_OVERCURRENT, raised & MOTOR_FLAG_OVERCURRENT);
+    TEST_ASSERT_TRUE(t - start <= MOTOR_OVERCURRENT_US + 4 * FRAME_US);
+
+    // L'evento resta, ma si segnala una volta sola
+    TEST_ASSERT_EQUAL(0, m.update(6000.0f, 200, t) & MOTOR_FLAG_OVERCURRENT);
+    TEST_ASSERT_TRUE(m.flags() & MOTOR_FLAG_OVERCURRENT);
+}
+
+void test_stall_blanked_at_startup_then_detected() {
+    MotorMonitor m;
+    uint32_t t = 0;
+    float stallMa = MOTOR_STALL_CURRENT_MA * 300 / MOTOR_SPEED_MAX;
+
+    // Spunto: corrente di rotore bloccato, ma il motore sta accelerando
+    for (; t < MOTOR_STALL_BLANK_US - FRAME_US; t += FRAME_US) TEST_ASSERT_EQUAL(0, m.update(stallMa, 300, t));
+
+    // Il motore non parte: stallo entro pochi ms dalla fine del mascheramento
+    uint8_t raised = 0;
+    uint32_t blankEnd = MOTOR_STALL_BLANK_US;
+    while (!raised && t < blankEnd + 50000) {
+        raised = m.update(stallMa, 300, t);
+        t += FRAME_US;
+    }
+    TEST_ASSERT_EQUAL(MOTOR_FLAG_STALL, raised);
+    TEST_ASSERT_TRUE(t - blankEnd <= MOTOR_STALL_US + 3 * FRAME_US);
+
+    m.clear();
+    TEST_ASSERT_EQUAL(0, m.flags());
+}
+
+void test_no_stall_when_running_or_low_command() {
+    MotorMonitor m;
+    uint32_t t = 0;
+    // Marcia normale: corrente ben sotto quella di stallo
+    for (int i = 0; i < 500; i++, t += FRAME_US) m.update(600.0f, 300, t);
+    // Comando minimo (sotto MOTOR_STALL_MIN_CMD): il CS è solo rumore
+    for (int i = 0; i < 500; i++, t += FRAME_US) m.update(400.0f, 20, t);
+    TEST_ASSERT_EQUAL(0, m.flags());
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 400.0f, m.currentMa());
+
+    // Inversione: nuovo spunto, mascherato anche se il modulo non cresce
+    float stallMa = MOTOR_STALL_CURRENT_MA * 200 / MOTOR_SPEED_MAX;
+    for (int i = 0; i < 200; i++, t += FRAME_US) m.update(stallMa, 200, t);
+    TEST_ASSERT_TRUE(m.flags() & MOTOR_FLAG_STALL);
+    m.clear();
+    uint32_t reverse = t;
+    for (; t - reverse < MOTOR_STALL_BLANK_US - FRAME_US; t += FRAME_US) m.update(stallMa, -200, t);
+    TEST_ASSERT_EQUAL(0, m.flags());
+}
+
+void test_pid_corrections_do_not_rearm_blanking() {
+    MotorMonitor m;
+    uint32_t t = 0;
+    float stallMa = MOTOR_STALL_CURRENT_MA * 250 / MOTOR_SPEED_MAX;
+
+    // Mantenimento direzione: il PID ritocca il comando a ogni blocco (250 +- 12)
+    uint8_t raised = 0;
+    int i = 0;
+    while (!raised && t < MOTOR_STALL_BLANK_US + 50000) {
+        int16_t cmd = (int16_t)(250 + ((i * 7) % 25) - 12);
+        raised = m.update(stallMa, cmd, t);
+        t += FRAME_US;
+        i++;
+    }
+    TEST_ASSERT_EQUAL(MOTOR_FLAG_STALL, raised);
+    TEST_ASSERT_TRUE(t - MOTOR_STALL_BLANK_US <= MOTOR_STALL_US + 3 * FRAME_US);
+
+    // Un gradino vero (accelerazione) riapre il mascheramento
+    m.clear();
+    uint32_t step = t;
+    int16_t big = (int16_t)(250 + MOTOR_STALL_BLANK_STEP + 20);
+    float bigStallMa = MOTOR_STALL_CURRENT_MA * big / MOTOR_SPEED_MAX;
+    for (; t - step < MOTOR_STALL_BLANK_US - FRAME_US; t += FRAME_US) m.update(bigStallMa, big, t);
+    TEST_ASSERT_EQUAL(0, m.flags());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_raw_to_milliamps);
+    RUN_TEST(test_overcurrent_within_few_ms);
+    RUN_TEST(test_stall_blanked_at_startup_then_detected);
+    RUN_TEST(test_no_stall_when_running_or_low_command);
+    RUN_TEST(test_pid_corrections_do_not_rearm_blanking);
+    return UNITY_END();
+}
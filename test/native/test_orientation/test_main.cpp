@@ -0,0 +1,203 @@
+/*
+ * Benchmark host dei filtri di orientamento (Madgwick e Mahony): ns per
+ * update (9 e 6 assi) e deriva rispetto a rotazioni sintetiche note.
+ */
+#include <unity.h>
+#include <math.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "OrientationFilter.h"
+
+static const float DEG = 3.14159265f / 180.0f;
+static const float DT = IMU_FIFO_SAMPLE_DT_S;
+
+// Quaternione "vero" integrato esattamente (asse-angolo) dalla velocità nel corpo
+struct TruthQ {
+    double w = 1, x = 0, y = 0, z = 0;
+
+    void rotateBody(double gx, double gy, double gz, double dt) {
+        double wn = sqrt(gx * gx + gy * gy + gz * gz);
+        if (wn < 1e-12) return;
+        double half = 0.5 * wn * dt;
+        double s = sin(half) / wn;
+        double dw = cos(half), dx = gx * s, dy = gy * s, dz = gz * s;
+        double nw = w * dw - x * dx - y * dy - z * dz;
+        double nx = w * dx + x * dw + y * dz - z * dy;
+        double ny = w * dy - x * dz + y * dw + z * dx;
+        double nz = w * dz + x * dy - y * dx + z * dw;
+        w = nw; x = nx; y = ny; z = nz;
+    }
+
+    // Vettore terra -> corpo (R^T v)
+    void toBody(const double v[3], double out[3]) const {
+        double r[3][3] = {
+            {1 - 2 * (y * y + z * z), 2 * (x * y - w * z),     2 * (x * z + w * y)},
+            {2 * (x * y + w * z),     1 - 2 * (x * x + z * z), 2 * (y * z - w * x)},
+            {2 * (x * z - w * y),     2 * (y * z + w * x),     1 - 2 * (x * x + y * y)}};
+        for (int i = 0; i < 3; i++) out[i] = r[0][i] * v[0] + r[1][i] * v[1] + r[2][i] * v[2];
+    }
+
+    double yawDeg() const { return atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z)) / DEG; }
+    double pitchDeg() const { return asin(2 * (w * y - x * z)) / DEG; }
+};
+
+static float wrap180(float a) {
+    while (a > 180.0f) a -= 360.0f;
+    while (a < -180.0f) a += 360.0f;
+    return a;
+}
+
+struct DriftResult {
+    float maxYawErr;
+    float maxPitchErr;
+    float finalYawErr;
+};
+
+// 60 s di manovre: rotazioni sul posto, rampe, vibrazioni; gyro con bias residuo
+template <class Filter>
+static DriftResult runScenario(bool useMag) {
+    Filter filter;
+    TruthQ truth;
+    std::mt19937 rng(42);
+    std::normal_distribution<float> gyroNoise(0.0f, 0.3f * DEG);
+    std::normal_distribution<float> accNoise(0.0f, 0.02f);
+    std::normal_distribution<float> magNoise(0.0f, 0.01f);
+
+    const double gravity[3] = {0, 0, 1};
+    const double field[3] = {cos(60 * DEG), 0, -sin(60 * DEG)}; // Inclinazione ~60°
+    const float bias = 0.2f * DEG; // Bias residuo dopo calibrazione
+
+    DriftResult res = {0, 0, 0};
+    const int steps = 60000;
+    for (int i = 0; i < steps; i++) {
+        double t = i * DT;
+        // Yaw a tratti (90°/s per 2 s, poi fermo 3 s), pitch sinusoidale da rampa
+        double gz = (fmod(t, 5.0) < 2.0) ? 90.0 * DEG : 0.0;
+        double gy = 10.0 * DEG * sin(2 * 3.14159265 * 0.2 * t);
+        truth.rotateBody(0, gy, gz, DT);
+
+        double a[3], m[3];
+        truth.toBody(gravity, a);
+        truth.toBody(field, m);
+
+        filter.update(gyroNoise(rng) + bias, (float)gy + gyroNoise(rng) + bias, (float)gz + gyroNoise(rng) + bias,
+                      (float)a[0] + accNoise(rng), (float)a[1] + accNoise(rng), (float)a[2] + accNoise(rng),
+                      (float)m[0] + magNoise(rng), (float)m[1] + magNoise(rng), (float)m[2] + magNoise(rng),
+                      useMag, DT);
+
+        // Si misura dopo 2 s di convergenza
+        if (t > 2.0) {
+            float yawErr = fabsf(wrap180(filter.yawDeg() - (float)truth.yawDeg()));
+            float pitchErr = fabsf(filter.pitchDeg() - (float)truth.pitchDeg());
+            if (yawErr > res.maxYawErr) res.maxYawErr = yawErr;
+            if (pitchErr > res.maxPitchErr) res.maxPitchErr = pitchErr;
+            res.finalYawErr = yawErr;
+        }
+    }
+    return res;
+}
+
+template <class Filter>
+static double benchmarkNsPerUpdate(bool useMag) {
+    Filter filter;
+    const int N = 2000000;
+    volatile float sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        float k = (float)(i & 1023) * 1e-4f;
+        filter.update(0.01f + k, -0.02f, 0.5f - k, 0.05f, -0.02f + k, 0.99f, 0.4f, 0.02f + k, -0.8f, useMag, DT);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    sink = filter.quaternion().w;
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+}
+
+void setUp() {}
+void tearDown() {}
+
+template <class Filter>
+static void checkLevelAndStill() {
+    Filter f;
+    for (int i = 0; i < 5000; i++) f.update(0, 0, 0, 0, 0, 1, 1, 0, 0, false, DT);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, f.pitchDeg());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, f.rollDeg());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, f.yawDeg());
+}
+
+template <class Filter>
+static void checkPitchSign() {
+    // Stessa convenzione di atan2(-ax, sqrt(ay^2 + az^2)) usata finora
+    Filter f;
+    float ax = -sinf(15 * DEG), az = cosf(15 * DEG);
+    for (int i = 0; i < 20000; i++) f.update(0, 0, 0, ax, 0, az, 0, 0, 0, false, DT);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 15.0f, f.pitchDeg());
+}
+
+template <class Filter>
+static void checkYawSign() {
+    Filter f;
+    for (int i = 0; i < 1000; i++) f.update(0, 0, 45 * DEG, 0, 0, 1, 0, 0, 0, false, DT);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 45.0f, f.yawDeg());
+}
+
+template <class Filter>
+static void checkDrift(const char* name) {
+    DriftResult ref6 = runScenario<Filter>(false);
+    DriftResult ref9 = runScenario<Filter>(true);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "%s 6 assi: yaw max %.2f° finale %.2f°, pitch max %.2f°",
+             name, ref6.maxYawErr, ref6.finalYawErr, ref6.maxPitchErr);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "%s 9 assi: yaw max %.2f° finale %.2f°, pitch max %.2f°",
+             name, ref9.maxYawErr, ref9.finalYawErr, ref9.maxPitchErr);
+    TEST_MESSAGE(msg);
+
+    // Il magnetometro deve tenere a bada la deriva da bias del gyro
+    TEST_ASSERT_LESS_THAN(3.0f, ref9.maxYawErr);
+    TEST_ASSERT_LESS_THAN(ref6.finalYawErr, ref9.finalYawErr);
+    TEST_ASSERT_LESS_THAN(2.0f, ref9.maxPitchErr);
+}
+
+void test_level_and_still_converges_to_identity() {
+    checkLevelAndStill<MadgwickFilter>();
+    checkLevelAndStill<MahonyFilter>();
+}
+
+void test_pitch_sign_matches_accelerometer_formula() {
+    checkPitchSign<MadgwickFilter>();
+    checkPitchSign<MahonyFilter>();
+}
+
+void test_yaw_follows_positive_z_rotation() {
+    checkYawSign<MadgwickFilter>();
+    checkYawSign<MahonyFilter>();
+}
+
+void test_drift_against_ground_truth() {
+    checkDrift<MadgwickFilter>("Madgwick");
+    checkDrift<MahonyFilter>("Mahony");
+}
+
+void test_benchmark_ns_per_update() {
+    char msg[160];
+    snprintf(msg, sizeof(msg), "ns/update Madgwick: 9 assi %.1f, 6 assi %.1f",
+             benchmarkNsPerUpdate<MadgwickFilter>(true), benchmarkNsPerUpdate<MadgwickFilter>(false));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "ns/update Mahony:   9 assi %.1f, 6 assi %.1f",
+             benchmarkNsPerUpdate<MahonyFilter>(true), benchmarkNsPerUpdate<MahonyFilter>(false));
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_level_and_still_converges_to_identity);
+    RUN_TEST(test_pitch_sign_matches_accelerometer_formula);
+    RUN_TEST(test_yaw_follows_positive_z_rotation);
+    RUN_TEST(test_drift_against_ground_truth);
+    RUN_TEST(test_benchmark_ns_per_update);
+    return UNITY_END();
+}
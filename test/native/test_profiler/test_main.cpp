@@ -0,0 +1,145 @@
+/*
+ * Test host del profiler: precisione dell'istogramma log-lineare, p99,
+ * tempo I2C attribuito agli scope annidati, esportazione Chrome trace con
+ * anello che si avvolge e costo di un PROFILE_SCOPE (benchmark).
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "Profiler.h"
+
+void setUp() {
+    profiler().stopTrace();
+    profiler().reset();
+}
+void tearDown() {}
+
+static uint8_t scopeId(const char* name) {
+    for (uint8_t i = 0; i < profiler().scopeCount(); i++) {
+        ProfileSummary s;
+        profiler().summary(i, s);
+        if (std::string(s.name) == name) return i;
+    }
+    return PROFILER_NO_SCOPE;
+}
+
+void test_histogram_buckets_bound_values() {
+    std::mt19937 rng(7);
+    uint16_t prev = 0;
+    for (uint32_t v = 0; v < 5000; v++) {
+        uint16_t b = Profiler::bucketOf(v);
+        TEST_ASSERT_TRUE(b >= prev);  // Monotono
+        prev = b;
+    }
+    for (int i = 0; i < 100000; i++) {
+        uint32_t v = rng() >> (rng() % 32);
+        uint16_t b = Profiler::bucketOf(v);
+        TEST_ASSERT_TRUE(b < PROFILER_HIST_BUCKETS);
+        uint32_t upper = Profiler::bucketUpper(b);
+        TEST_ASSERT_TRUE(upper >= v);
+        // Errore relativo entro un intervallo dell'ottava
+        TEST_ASSERT_TRUE((double)(upper - v) <= (double)v / PROFILER_HIST_SUB);
+    }
+    TEST_ASSERT_EQUAL(PROFILER_HIST_BUCKETS - 1, Profiler::bucketOf(UINT32_MAX));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, Profiler::bucketUpper(PROFILER_HIST_BUCKETS - 1));
+}
+
+void test_percentile_and_summary() {
+    uint8_t id = profiler().registerScope("test.p99");
+    TEST_ASSERT_EQUAL(id, profiler().registerScope("test.p99"));
+
+    // 1..1000 us (1000 tick/us su host): p99 ~990 us
+    for (uint32_t us = 1; us <= 1000; us++) profiler().record(id, us * 1000, us == 1000 ? 5000 : 0, 0, 0);
+
+    ProfileSummary s;
+    TEST_ASSERT_TRUE(profiler().summary(id, s));
+    TEST_ASSERT_EQUAL(1000, s.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, s.minUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 500.5f, s.meanUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1000.0f, s.maxUs);
+    TEST_ASSERT_TRUE(s.p99Us >= 990.0f && s.p99Us <= 990.0f * (1.0f + 1.0f / PROFILER_HIST_SUB));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 5.0f, s.blockedMaxUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.005f, s.blockedMeanUs);
+}
+
+static void innerWork() {
+    PROFILE_SCOPE("test.inner");
+    PROFILE_BLOCKED(500);  // Transazione I2C dentro lo scope interno
+}
+
+void test_blocked_time_goes_to_innermost_and_parent() {
+    {
+        PROFILE_SCOPE("test.outer");
+        innerWork();
+        PROFILE_BLOCKED(200);
+    }
+    // Fuori da ogni scope: nessuno a cui attribuirlo
+    PROFILE_BLOCKED(1000);
+
+    ProfileSummary inner, outer;
+    profiler().summary(scopeId("test.inner"), inner);
+    profiler().summary(scopeId("test.outer"), outer);
+    TEST_ASSERT_EQUAL(1, inner.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, inner.blockedMaxUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.7f, outer.blockedMaxUs);
+    TEST_ASSERT_TRUE(outer.maxUs >= inner.maxUs);
+}
+
+static void appendText(const char* text, void* ctx) {
+    static_cast<std::string*>(ctx)->append(text);
+}
+
+static int occurrences(const std::string& s, const std::string& what) {
+    int n = 0;
+    for (size_t pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + 1)) n++;
+    return n;
+}
+
+void test_chrome_trace_export() {
+    TEST_ASSERT_TRUE(profiler().startTrace());
+    const int calls = PROFILER_TRACE_EVENTS + 10;
+    for (int i = 0; i < calls; i++) innerWork();
+    profiler().stopTrace();
+    // Dopo lo stop gli scope non finiscono nella traccia
+    innerWork();
+
+    TEST_ASSERT_EQUAL(PROFILER_TRACE_EVENTS, profiler().traceEvents());
+    std::string json;
+    profiler().exportChromeTrace(appendText, &json);
+
+    TEST_ASSERT_EQUAL(0, json.find("{\"displayTimeUnit\""));
+    TEST_ASSERT_EQUAL(PROFILER_TRACE_EVENTS, occurrences(json, "\"ph\":\"X\""));
+    TEST_ASSERT_EQUAL(PROFILER_CORES, occurrences(json, "\"thread_name\""));
+    TEST_ASSERT_EQUAL(PROFILER_TRACE_EVENTS, occurrences(json, "\"name\":\"test.inner\""));
+    TEST_ASSERT_EQUAL(0, occurrences(json, "},\n]"));  // Nessuna virgola finale
+    TEST_ASSERT_TRUE(json.size() > 3 && json.compare(json.size() - 3, 3, "]}\n") == 0);
+}
+
+void test_scope_overhead_benchmark() {
+    const int calls = 1000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++) {
+        PROFILE_SCOPE("test.empty");
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / calls;
+
+    ProfileSummary s;
+    profiler().summary(scopeId("test.empty"), s);
+    TEST_ASSERT_EQUAL(calls, s.count);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "PROFILE_SCOPE: %.1f ns per scope (host, due letture del clock)", ns);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_buckets_bound_values);
+    RUN_TEST(test_percentile_and_summary);
+    RUN_TEST(test_blocked_time_goes_to_innermost_and_parent);
+    RUN_TEST(test_chrome_trace_export);
+    RUN_TEST(test_scope_overhead_benchmark);
+    return UNITY_END();
+}
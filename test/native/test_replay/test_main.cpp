@@ -0,0 +1,239 @@
+/*
+ * Test host della replica: memoria e traccia di HalReplay, manager reali
+ * avviati con BootSequence su un orologio virtuale, emulazione della FIFO
+ * IMU piena e rapporto di velocità rispetto al tempo reale.
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <math.h>
+#include <string.h>
+
+#include "FlightRecorder.h"
+#include "SensorReplay.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t T0 = 5000000;       // Inizio traccia (us)
+static const uint32_t STILL_US = 700000;  // Fermo: bias gyro
+static const uint32_t TURN_US = 1000000;  // Rotazione a 90 dps
+static const uint32_t TAIL_US = 300000;
+
+// Robot fermo, poi 90° attorno a Z; un ToF a 150 mm, uno fuori portata; AS7262 a 35 Hz
+static void buildTrace(RecordSink& sink) {
+    const uint32_t total = STILL_US + TURN_US + TAIL_US;
+    for (uint32_t t = 0; t < total; t += 1000) {
+        int16_t gz = (t >= STILL_US && t < STILL_US + TURN_US) ? (int16_t)(90.0f * IMU_GYRO_LSB_PER_DPS) : 0;
+        sink.logImuRaw(0, 0, (int16_t)IMU_ACC_LSB_PER_G, 0, 0, gz, T0 + t);
+        if (t % 33000 == 0) {
+            sink.logToFRaw(TOF_FRONT_LEFT, 0, 150, T0 + t + 500);
+            sink.logToFRaw(TOF_CENTER, 255, 8888, T0 + t + 700);
+        }
+        if (t % 28000 == 0) {
+            float ch[CH_COUNT] = {150, 160, 170, 170, 170, 180};
+            sink.logSpectralRaw(ch, T0 + t + 300);
+        }
+    }
+}
+
+void test_memory_storage_namespaces() {
+    MemoryStorage storage;
+    TEST_ASSERT_TRUE(storage.begin("a", true));
+    TEST_ASSERT_EQUAL(0, storage.putUChar("k", 7));  // Sola lettura
+    storage.end();
+
+    storage.begin("a", false);
+    storage.putUChar("k", 7);
+    float f = 1.5f;
+    storage.putBytes("f", &f, sizeof(f));
+    storage.end();
+    storage.begin("b", false);
+    storage.putUChar("k", 9);
+    storage.end();
+
+    storage.begin("a", true);
+    TEST_ASSERT_EQUAL(7, storage.getUChar("k", 0));
+    TEST_ASSERT_EQUAL_FLOAT(1.5f, storage.getFloat("f", 0.0f));
+    TEST_ASSERT_FALSE(storage.isKey("x"));
+    storage.end();
+
+    storage.begin("a", false);
+    TEST_ASSERT_TRUE(storage.clear());
+    storage.end();
+    storage.begin("b", true);
+    TEST_ASSERT_EQUAL(9, storage.getUChar("k", 0));
+    storage.end();
+    storage.begin("a", true);
+    TEST_ASSERT_EQUAL(3, storage.getUChar("k", 3));
+    storage.end();
+}
+
+// Vecchio formato: una chiave per float nel namespace "color_calib"
+static void storeLegacyCalibration(MemoryStorage& storage) {
+    storage.begin("color_calib", false);
+    float sum = 1000.0f, ch = 1000.0f / CH_COUNT;
+    storage.putBytes("w_sum", &sum, sizeof(sum));
+    char key[12];
+    for (int i = 0; i < CH_COUNT; i++) {
+        snprintf(key, sizeof(key), "w_ch_%d", i);
+        storage.putBytes(key, &ch, sizeof(ch));
+    }
+    storage.end();
+}
+
+void test_legacy_keys_kept_until_blob_is_written() {
+    SensorTrace trace;
+    buildTrace(trace);
+    trace.finish();
+
+    // NVS piena: il blob non si scrive, le vecchie chiavi devono restare
+    {
+        SensorReplay replay(trace);
+        MemoryStorage& nvs = replay.storage();
+        storeLegacyCalibration(nvs);
+        nvs.setFull(true);
+        TEST_ASSERT_TRUE(replay.boot());
+        nvs.begin("color_calib", true);
+        TEST_ASSERT_TRUE(nvs.isKey("w_sum"));
+        nvs.end();
+        nvs.begin(CALIB_NVS_NAMESPACE, true);
+        TEST_ASSERT_FALSE(nvs.isKey("active"));
+        nvs.end();
+    }
+
+    // Con spazio la migrazione scrive il blob e solo dopo cancella
+    SensorReplay replay(trace);
+    MemoryStorage& nvs = replay.storage();
+    storeLegacyCalibration(nvs);
+    TEST_ASSERT_TRUE(replay.boot());
+    nvs.begin("color_calib", true);
+    TEST_ASSERT_FALSE(nvs.isKey("w_sum"));
+    nvs.end();
+    nvs.begin(CALIB_NVS_NAMESPACE, true);
+    TEST_ASSERT_TRUE(nvs.isKey("p0"));
+    nvs.end();
+    TEST_ASSERT_EQUAL_STRING("default", replay.color().getProfileName());
+}
+
+void test_trace_loads_flight_dump_in_time_order() {
+    FlightRecorder rec;
+    TEST_ASSERT_TRUE(rec.begin(64 * sizeof(FlightRecord), MEM_BULK));
+    rec.start();
+    // Frame IMU ricostruiti fuori ordine rispetto ai ToF, più un record filtrato da ignorare
+    rec.logToFRaw(2, 0, 300, 1500);
+    rec.logImuRaw(1, 0, 0, 0, 0, 0, 2000);
+    rec.logImuRaw(2, 0, 0, 0, 0, 0, 1000);
+    rec.logImu(1.0f, 2.0f, 3.0f, 1200);
+    float ch[CH_COUNT] = {1, 2, 3, 4, 5, 6};
+    rec.logSpectralRaw(ch, 1800);
+
+    struct Dump {
+        uint8_t buf[1024];
+        size_t  len;
+        static bool visit(const FlightRecord& r, void* ctx) {
+            Dump& d = *static_cast<Dump*>(ctx);
+            d.len += telemetryEncodeFrame(r.header, r.payload, r.length, d.buf + d.len, sizeof(d.buf) - d.len);
+            return true;
+        }
+    } dump;
+    dump.len = 0;
+    rec.forEach(Dump::visit, &dump);
+
+    SensorTrace trace;
+    trace.load(dump.buf, dump.len / 2);  // A blocchi, come da fread()
+    trace.load(dump.buf + dump.len / 2, dump.len - dump.len / 2);
+    trace.finish();
+
+    TEST_ASSERT_EQUAL(4, trace.records());
+    TEST_ASSERT_EQUAL(2, trace.imu().size());
+    TEST_ASSERT_EQUAL(1000, trace.imu()[0].timestampUs);
+    TEST_ASSERT_EQUAL(2, trace.imu()[0].raw.ax);
+    TEST_ASSERT_EQUAL(1, trace.ranges(2).size());
+    TEST_ASSERT_EQUAL(300, trace.ranges(2)[0].raw.distance_mm);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, trace.spectral()[0].channels[2]);
+    TEST_ASSERT_EQUAL(1000, trace.startUs());
+    TEST_ASSERT_EQUAL(2000, trace.endUs());
+}
+
+void test_replay_reproduces_turn_and_readings() {
+    SensorTrace trace;
+    buildTrace(trace);
+    trace.finish();
+
+    SensorReplay replay(trace);
+    TEST_ASSERT_TRUE(replay.boot());
+    TEST_ASSERT_TRUE(replay.bootSequence().isReady(BootSequence::BOOT_IMU));
+    TEST_ASSERT_TRUE(replay.bootSequence().isReady(BootSequence::BOOT_TOF));
+    TEST_ASSERT_TRUE(replay.bootSequence().isReady(BootSequence::BOOT_COLOR));
+    replay.run();
+
+    TEST_ASSERT_EQUAL(0, replay.imu().getFifoOverflows());
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 90.0f, fabsf(replay.imu().getYaw()));
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, replay.imu().getPitch());
+
+    ToFData tof = replay.tof().getReadings();
+    TEST_ASSERT_EQUAL(150, tof.distance_mm[TOF_FRONT_LEFT]);
+    TEST_ASSERT_TRUE(tof.valid[TOF_FRONT_LEFT]);
+    TEST_ASSERT_EQUAL(8888, tof.distance_mm[TOF_CENTER]);
+    TEST_ASSERT_FALSE(tof.valid[TOF_CENTER]);
+    TEST_ASSERT_EQUAL(-1, tof.distance_mm[TOF_BACK_LEFT]);  // Nessuna misura: offline
+
+    // EMA a regime sui canali registrati
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 1000.0f, replay.color().getCurrentData().sum);
+    TEST_ASSERT_GREATER_THAN(0, replay.color().getSampleGeneration());
+}
+
+void test_slow_loop_overflows_fifo() {
+    SensorTrace trace;
+    buildTrace(trace);
+    trace.finish();
+
+    SensorReplay replay(trace);
+    TEST_ASSERT_TRUE(replay.boot());
+    // Passi da 100 ms: la FIFO (42 frame) si riempie a ogni giro, come con un loop bloccato
+    replay.run(100000);
+
+    TEST_ASSERT_GREATER_THAN(10, replay.imu().getFifoOverflows());
+    // Stop-when-full: arrivano solo i primi 42 frame di ogni 100. Il resto
+    // lo ricostruisce bridgeGap, anche nel quaternione della fusione: lo yaw
+    // esposto vede tutta la rotazione, non solo quella rimasta nella FIFO.
+    float yaw = fabsf(replay.imu().getYaw());
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 90.0f, yaw);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "loop a 10 Hz: yaw %.1f su 90 gradi (solo FIFO: %.1f)", yaw,
+             90.0f * MPU_FIFO_MAX_FRAMES / 100.0f);
+    TEST_MESSAGE(msg);
+}
+
+void test_replay_faster_than_real_time() {
+    SensorTrace trace;
+    buildTrace(trace);
+    trace.finish();
+
+    auto t0 = std::chrono::steady_clock::now();
+    SensorReplay replay(trace);
+    replay.boot();
+    replay.run();
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double traceS = (trace.endUs() - trace.startUs()) / 1e6;
+
+    TEST_ASSERT_GREATER_THAN(0, replay.outputs());
+    TEST_ASSERT_TRUE(wallS < traceS);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "replica: %.2f s di traccia in %.1f ms (%.0fx)", traceS, wallS * 1000, traceS / wallS);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_memory_storage_namespaces);
+    RUN_TEST(test_trace_loads_flight_dump_in_time_order);
+    RUN_TEST(test_legacy_keys_kept_until_blob_is_written);
+    RUN_TEST(test_replay_reproduces_turn_and_readings);
+    RUN_TEST(test_slow_loop_overflows_fifo);
+    RUN_TEST(test_replay_faster_than_real_time);
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+/*
+ * Test host della configurazione del telaio: la tabella del telaio attuale,
+ * le verifiche constexpr su telai sbagliati (qui anche come static_assert:
+ * gli stessi errori fermano la compilazione del firmware), un telaio con
+ * meno sensori e gli indirizzi dei ToF simulati dalla replica.
+ */
+#include <unity.h>
+#include <cstdio>
+
+#include "HalReplay.h"
+#include "RobotLayout.h"
+
+void setUp() {}
+void tearDown() {}
+
+// --- Telai di prova ---
+
+// Solo davanti: i due anteriori e il centrale, con GPIO1 cablato sul centrale
+struct ChassisThreeToF {
+    static constexpr const char* NAME = "3 ToF";
+    static constexpr uint8_t TOF_N = 3;
+    static constexpr ToFMountSpec TOF[TOF_N] = {
+        {TOF_FRONT_LEFT,  7, -1, 0x30, 40.0f,  55.0f,  90.0f, "Front_Left"},
+        {TOF_FRONT_RIGHT, 15, -1, 0x31, 40.0f, -55.0f, -90.0f, "Front_Right"},
+        {TOF_CENTER,      18, 21, 0x34, 70.0f,   0.0f,   0.0f, "Center"},
+    };
+};
+
+struct DuplicateAddress {
+    static constexpr uint8_t TOF_N = 2;
+    static constexpr ToFMountSpec TOF[TOF_N] = {
+        {TOF_FRONT_LEFT,  7, -1, 0x30, 0, 0, 90.0f, "A"},
+        {TOF_FRONT_RIGHT, 15, -1, 0x30, 0, 0, -90.0f, "B"},
+    };
+};
+
+struct FactoryAddress {
+    static constexpr uint8_t TOF_N = 1;
+    static constexpr ToFMountSpec TOF[TOF_N] = {{TOF_CENTER, 18, -1, TOF_DEFAULT_I2C_ADDR, 0, 0, 0, "C"}};
+};
+
+struct ColorSensorAddress {
+    static constexpr uint8_t TOF_N = 1;
+    static constexpr ToFMountSpec TOF[TOF_N] = {{TOF_CENTER, 18, -1, AS7262_I2C_ADDR, 0, 0, 0, "C"}};
+};
+
+struct SharedXshut {
+    static constexpr uint8_t TOF_N = 2;
+    static constexpr ToFMountSpec TOF[TOF_N] = {
+        {TOF_FRONT_LEFT,  7, -1, 0x30, 0, 0, 90.0f, "A"},
+        {TOF_FRONT_RIGHT, 7, -1, 0x31, 0, 0, -90.0f, "B"},
+    };
+};
+
+struct IrqOnOtherXshut {
+    static constexpr uint8_t TOF_N = 2;
+    static constexpr ToFMountSpec TOF[TOF_N] = {
+        {TOF_FRONT_LEFT,  7, 15, 0x30, 0, 0, 90.0f, "A"},
+        {TOF_FRONT_RIGHT, 15, -1, 0x31, 0, 0, -90.0f, "B"},
+    };
+};
+
+struct PsramPin {
+    static constexpr uint8_t TOF_N = 1;
+    static constexpr ToFMountSpec TOF[TOF_N] = {{TOF_CENTER, 33, -1, 0x34, 0, 0, 0, "C"}};
+};
+
+struct DuplicatePosition {
+    static constexpr uint8_t TOF_N = 2;
+    static constexpr ToFMountSpec TOF[TOF_N] = {
+        {TOF_CENTER, 7, -1, 0x30, 0, 0, 0, "A"},
+        {TOF_CENTER, 15, -1, 0x31, 0, 0, 0, "B"},
+    };
+};
+
+static_assert(CheckedLayout<ChassisFiveToF>::value, "");
+static_assert(CheckedLayout<ChassisThreeToF>::value, "");
+static_assert(!layout_check::addressesValid<DuplicateAddress>(), "");
+static_assert(!layout_check::addressesValid<FactoryAddress>(), "");
+static_assert(!layout_check::addressesValid<ColorSensorAddress>(), "");
+static_assert(!layout_check::pinsValid<SharedXshut>(), "");
+static_assert(!layout_check::pinsValid<IrqOnOtherXshut>(), "");
+static_assert(!layout_check::pinsValid<PsramPin>(), "");
+static_assert(!layout_check::positionsUnique<DuplicatePosition>(), "");
+
+void test_current_chassis_table() {
+    TEST_ASSERT_EQUAL(TOF_COUNT, ChassisFiveToF::TOF_N);
+    for (uint8_t p = 0; p < TOF_COUNT; p++) {
+        const ToFMountSpec* m = layoutMount<ChassisFiveToF>((ToFPosition)p);
+        TEST_ASSERT_NOT_NULL(m);
+        TEST_ASSERT_EQUAL(p, m->position);
+    }
+
+    // Geometria coerente con quella che usa WallEstimator
+    const ToFMountSpec* fl = layoutMount<ChassisFiveToF>(TOF_FRONT_LEFT);
+    const ToFMountSpec* bl = layoutMount<ChassisFiveToF>(TOF_BACK_LEFT);
+    const ToFMountSpec* fr = layoutMount<ChassisFiveToF>(TOF_FRONT_RIGHT);
+    const ToFMountSpec* c = layoutMount<ChassisFiveToF>(TOF_CENTER);
+    TEST_ASSERT_EQUAL_FLOAT(TOF_SIDE_BASELINE_MM, fl->forwardMm - bl->forwardMm);
+    TEST_ASSERT_EQUAL_FLOAT(TOF_SIDE_OFFSET_MM, fl->leftMm);
+    TEST_ASSERT_EQUAL_FLOAT(-TOF_SIDE_OFFSET_MM, fr->leftMm);
+    TEST_ASSERT_EQUAL_FLOAT(TOF_CENTER_OFFSET_MM, c->forwardMm);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, c->angleDeg);
+    TEST_ASSERT_EQUAL_STRING("Center", c->name);
+}
+
+void test_invalid_layouts_are_rejected() {
+    TEST_ASSERT_TRUE(layout_check::addressesValid<ChassisFiveToF>());
+    TEST_ASSERT_TRUE(layout_check::pinsValid<ChassisFiveToF>());
+    TEST_ASSERT_TRUE(layout_check::positionsUnique<ChassisFiveToF>());
+
+    TEST_ASSERT_FALSE(layout_check::addressesValid<DuplicateAddress>());
+    TEST_ASSERT_FALSE(layout_check::addressesValid<FactoryAddress>());
+    TEST_ASSERT_FALSE(layout_check::addressesValid<ColorSensorAddress>());
+    TEST_ASSERT_FALSE(layout_check::pinsValid<SharedXshut>());
+    TEST_ASSERT_FALSE(layout_check::pinsValid<IrqOnOtherXshut>());
+    TEST_ASSERT_FALSE(layout_check::pinsValid<PsramPin>());
+    TEST_ASSERT_FALSE(layout_check::positionsUnique<DuplicatePosition>());
+
+    // Strapping e oltre GPIO48
+    TEST_ASSERT_TRUE(layout_check::pinReserved(0));
+    TEST_ASSERT_TRUE(layout_check::pinReserved(46));
+    TEST_ASSERT_TRUE(layout_check::pinReserved(49));
+    TEST_ASSERT_FALSE(layout_check::pinReserved(18));
+}
+
+void test_partial_chassis_and_pin_lookup() {
+    TEST_ASSERT_NULL(layoutMount<ChassisThreeToF>(TOF_BACK_LEFT));
+    TEST_ASSERT_NULL(layoutMount<ChassisThreeToF>(TOF_BACK_RIGHT));
+    TEST_ASSERT_EQUAL(21, layoutMount<ChassisThreeToF>(TOF_CENTER)->intPin);
+
+    TEST_ASSERT_TRUE(layout_check::usesPin<ChassisThreeToF>(21));  // GPIO1
+    TEST_ASSERT_TRUE(layout_check::usesPin<ChassisThreeToF>(15));  // XSHUT
+    TEST_ASSERT_FALSE(layout_check::usesPin<ChassisThreeToF>(16));
+    // -1 = non cablato: non collide con i GPIO1 assenti
+    TEST_ASSERT_FALSE(layout_check::usesPin<ChassisThreeToF>(-1));
+    TEST_ASSERT_FALSE(layout_check::usesAnyPin<ChassisFiveToF>({8, 9, 1, 2, 42, -1}));
+    TEST_ASSERT_TRUE(layout_check::usesAnyPin<ChassisFiveToF>({8, 9, 17}));
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "telaio firmware: %s (%u righe), sizeof(ToFMountSpec) = %u byte",
+             RobotLayout::NAME, (unsigned)RobotLayout::TOF_N, (unsigned)sizeof(ToFMountSpec));
+    TEST_MESSAGE(msg);
+}
+
+void test_replay_devices_use_layout_addresses() {
+    SensorTrace trace;
+    trace.finish();
+    for (uint8_t i = 0; i < RobotLayout::TOF_N; i++) {
+        const ToFMountSpec& m = RobotLayout::TOF[i];
+        ReplayRanging device(trace, m.position, m.name);
+        TEST_ASSERT_EQUAL(m.address, device.address());
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_current_chassis_table);
+    RUN_TEST(test_invalid_layouts_are_rejected);
+    RUN_TEST(test_partial_chassis_and_pin_lookup);
+    RUN_TEST(test_replay_devices_use_layout_addresses);
+    return UNITY_END();
+}
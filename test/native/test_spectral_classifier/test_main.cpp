@@ -0,0 +1,192 @@
+/*
+ * Test host del classificatore spettrale a N classi e micro-benchmark
+ * (classificazioni/s) rispetto all'algoritmo a 4 colori originale.
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "SpectralClassifier.h"
+
+static SpectralData makeData(float v, float b, float g, float y, float o, float r) {
+    SpectralData d = {{v, b, g, y, o, r}, v + b + g + y + o + r};
+    return d;
+}
+
+// Profili tipici misurati sul campo (LED a 25 mA, ~1 cm)
+static const SpectralData WHITE = makeData(180, 210, 230, 240, 235, 220);
+static const SpectralData BLACK = makeData(4, 5, 5, 6, 5, 5);
+static const SpectralData RED   = makeData(30, 25, 30, 60, 160, 260);
+static const SpectralData BLUE  = makeData(150, 230, 120, 60, 40, 35);
+static const SpectralData GREEN = makeData(40, 90, 220, 150, 60, 40);
+
+static void loadDefaults(SpectralClassifier& c) {
+    c.clear();
+    c.addClass("WHITE", COLOR_WHITE, SPECTRAL_MATCH_SHAPE | SPECTRAL_BRIGHT_REF, WHITE);
+    c.addClass("BLACK", COLOR_BLACK, SPECTRAL_DARK_REF, BLACK);
+    c.addClass("RED",   COLOR_RED,   SPECTRAL_MATCH_SHAPE | SPECTRAL_SHADOW_OK, RED);
+    c.addClass("BLUE",  COLOR_BLUE,  SPECTRAL_MATCH_SHAPE | SPECTRAL_SHADOW_OK, BLUE);
+}
+
+// Algoritmo originale di ColorManager::getDominantColor(), come riferimento
+static float legacyDistance(const SpectralData& s, const SpectralData& r) {
+    if (s.sum == 0 || r.sum == 0) return 9999.0f;
+    float d = 0.0f;
+    for (int i = 0; i < CH_COUNT; i++) {
+        float diff = s.channels[i] / s.sum - r.channels[i] / r.sum;
+        d += diff * diff;
+    }
+    return d;
+}
+
+// Riferimenti caricati a runtime, come i membri _ref* del vecchio ColorManager
+struct LegacyRefs {
+    SpectralData white, red, blue, black;
+};
+
+static ColorType legacyClassify(const SpectralData& s, const LegacyRefs& ref) {
+    if (s.sum > ref.white.sum * DEFAULT_SILVER_RATIO) return COLOR_SILVER;
+    if (s.sum < 15.0f) return COLOR_BLACK;
+    float dW = legacyDistance(s, ref.white), dR = legacyDistance(s, ref.red), dB = legacyDistance(s, ref.blue);
+    if (s.sum < ref.black.sum * 1.5f + 10.0f) {
+        if (dR < 0.15f && dR < dB && dR < dW) return COLOR_RED;
+        if (dB < 0.15f && dB < dR && dB < dW) return COLOR_BLUE;
+        return COLOR_BLACK;
+    }
+    if (dW < dR && dW < dB) return COLOR_WHITE;
+    if (dR < dW && dR < dB) return COLOR_RED;
+    return COLOR_BLUE;
+}
+
+static std::vector<SpectralData> randomSamples(size_t n) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> scale(0.02f, 1.8f);
+    std::uniform_real_distribution<float> jitter(0.8f, 1.2f);
+    const SpectralData* bases[] = {&WHITE, &RED, &BLUE, &GREEN, &BLACK};
+    std::vector<SpectralData> out(n);
+    for (size_t i = 0; i < n; i++) {
+        const SpectralData& b = *bases[i % 5];
+        float k = scale(rng);
+        float sum = 0;
+        for (int ch = 0; ch < CH_COUNT; ch++) {
+            out[i].channels[ch] = b.channels[ch] * k * jitter(rng);
+            sum += out[i].channels[ch];
+        }
+        out[i].sum = sum;
+    }
+    return out;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_matches_legacy_four_color_algorithm() {
+    SpectralClassifier c;
+    loadDefaults(c);
+    const LegacyRefs refs = {WHITE, RED, BLUE, BLACK};
+    std::vector<SpectralData> samples = randomSamples(20000);
+    int mismatches = 0;
+    for (const SpectralData& s : samples) {
+        if (c.classify(s).type != legacyClassify(s, refs)) mismatches++;
+    }
+    TEST_ASSERT_EQUAL(0, mismatches);
+}
+
+void test_user_class_needs_no_code() {
+    SpectralClassifier c;
+    loadDefaults(c);
+    int8_t green = c.addClass("GREEN", COLOR_NONE, SPECTRAL_MATCH_SHAPE | SPECTRAL_SHADOW_OK, GREEN);
+    TEST_ASSERT_EQUAL(4, green);
+
+    SpectralMatch m = c.classify(GREEN);
+    TEST_ASSERT_EQUAL(green, m.classId);
+    TEST_ASSERT_EQUAL(COLOR_NONE, m.type);
+    TEST_ASSERT_EQUAL_STRING("GREEN", c.get(m.classId).name);
+
+    // Le classi predefinite continuano a vincere sui loro profili
+    TEST_ASSERT_EQUAL(COLOR_RED, c.classify(RED).type);
+    TEST_ASSERT_EQUAL(COLOR_WHITE, c.classify(WHITE).type);
+}
+
+void test_anchors_silver_and_shadow() {
+    SpectralClassifier c;
+    loadDefaults(c);
+
+    SpectralData bright = WHITE;
+    for (int ch = 0; ch < CH_COUNT; ch++) bright.channels[ch] *= 2.0f;
+    bright.sum *= 2.0f;
+    SpectralMatch m = c.classify(bright);
+    TEST_ASSERT_EQUAL(COLOR_SILVER, m.type);
+    TEST_ASSERT_EQUAL(SpectralClassifier::NO_CLASS, m.classId);
+
+    // Rosso lontano (poca luce, firma netta) resta rosso; grigio scuro è nero
+    SpectralData farRed = RED;
+    for (int ch = 0; ch < CH_COUNT; ch++) farRed.channels[ch] *= 0.05f;
+    farRed.sum *= 0.05f;
+    TEST_ASSERT_TRUE(farRed.sum < c.darkThreshold());
+    TEST_ASSERT_EQUAL(COLOR_RED, c.classify(farRed).type);
+
+    SpectralData grey = makeData(6, 6, 6, 6, 6, 6);
+    m = c.classify(grey);
+    TEST_ASSERT_EQUAL(COLOR_BLACK, m.type);
+    TEST_ASSERT_EQUAL(c.findByType(COLOR_BLACK), m.classId);
+}
+
+void test_recalibration_bumps_revision() {
+    SpectralClassifier c;
+    loadDefaults(c);
+    uint32_t rev = c.revision();
+    TEST_ASSERT_TRUE(c.setReference(c.findByType(COLOR_WHITE), WHITE));
+    TEST_ASSERT_NOT_EQUAL(rev, c.revision());
+    TEST_ASSERT_FALSE(c.setReference(COLOR_MAX_CLASSES, WHITE));
+}
+
+void test_table_capacity() {
+    SpectralClassifier c;
+    for (int i = 0; i < COLOR_MAX_CLASSES; i++) {
+        TEST_ASSERT_EQUAL(i, c.addClass("X", COLOR_NONE, SPECTRAL_MATCH_SHAPE, WHITE));
+    }
+    TEST_ASSERT_EQUAL(SpectralClassifier::NO_CLASS, c.addClass("Y", COLOR_NONE, 0, WHITE));
+}
+
+void test_benchmark_classifications_per_second() {
+    SpectralClassifier c;
+    loadDefaults(c);
+    c.addClass("GREEN", COLOR_NONE, SPECTRAL_MATCH_SHAPE | SPECTRAL_SHADOW_OK, GREEN);
+    std::vector<SpectralData> samples = randomSamples(4096);
+    // Copia opaca per il compilatore: niente profili costanti ripiegati a compile time
+    static volatile bool runtime = true;
+    LegacyRefs refs = {WHITE, RED, BLUE, BLACK};
+    if (!runtime) refs.white.sum = 0;
+    const int rounds = 500;
+    volatile int sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (const SpectralData& s : samples) sink += legacyClassify(s, refs);
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (const SpectralData& s : samples) sink += c.classify(s).type;
+    auto t2 = std::chrono::steady_clock::now();
+
+    double n = (double)rounds * samples.size();
+    double legacy = n / std::chrono::duration<double>(t1 - t0).count();
+    double table = n / std::chrono::duration<double>(t2 - t1).count();
+    char msg[160];
+    snprintf(msg, sizeof(msg), "classificazioni/s: originale (4 classi) %.2f M, tabella (5 classi) %.2f M",
+             legacy / 1e6, table / 1e6);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_legacy_four_color_algorithm);
+    RUN_TEST(test_user_class_needs_no_code);
+    RUN_TEST(test_anchors_silver_and_shadow);
+    RUN_TEST(test_recalibration_bumps_revision);
+    RUN_TEST(test_table_capacity);
+    RUN_TEST(test_benchmark_classifications_per_second);
+    return UNITY_END();
+}
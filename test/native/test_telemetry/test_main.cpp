@@ -0,0 +1,200 @@
+/*
+ * Test host del protocollo di telemetria: COBS sui casi limite, round trip
+ * dei record, risincronizzazione dopo testo/byte persi, frame corrotti,
+ * e costo di codifica per record (ns).
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <string.h>
+
+#include "Telemetry.h"
+
+static TelemetryHeader makeHeader(uint8_t type, uint16_t seq, uint32_t t) {
+    TelemetryHeader h = {TELEMETRY_SCHEMA_VERSION, type, seq, t};
+    return h;
+}
+
+static size_t encodeImu(uint16_t seq, float yaw, uint8_t* out, size_t cap) {
+    TelemetryImu rec = {yaw, 1.5f, -2.25f};
+    return telemetryEncodeFrame(makeHeader(TLM_IMU, seq, 1000u * seq), &rec, sizeof(rec), out, cap);
+}
+
+// Decodifica un buffer intero, ritorna il numero di record validi
+static int feedAll(TelemetryDecoder& d, const uint8_t* buf, size_t len) {
+    int records = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (d.feed(buf[i]) == TelemetryDecoder::RECORD) records++;
+    }
+    return records;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void checkCobs(const uint8_t* in, size_t len) {
+    uint8_t enc[600];
+    uint8_t dec[600];
+    size_t n = cobsEncode(in, len, enc);
+    TEST_ASSERT_LESS_OR_EQUAL(len + len / 254 + 1, n);
+    for (size_t i = 0; i < n; i++) TEST_ASSERT_NOT_EQUAL(0, enc[i]);
+    TEST_ASSERT_EQUAL(len, cobsDecode(enc, n, dec, sizeof(dec)));
+    TEST_ASSERT_EQUAL_MEMORY(in, dec, len);
+}
+
+void test_cobs_edge_cases() {
+    uint8_t buf[520];
+
+    const uint8_t zero[] = {0};
+    checkCobs(zero, 1);
+    const uint8_t zeros[] = {0, 0, 0};
+    checkCobs(zeros, 3);
+    const uint8_t mixed[] = {0x11, 0x00, 0x00, 0x22, 0x33, 0x00};
+    checkCobs(mixed, sizeof(mixed));
+
+    // Blocchi da 254 byte non nulli: il caso del codice 0xFF
+    memset(buf, 0xAB, sizeof(buf));
+    checkCobs(buf, 253);
+    checkCobs(buf, 254);
+    checkCobs(buf, 255);
+    checkCobs(buf, 510);
+    buf[254] = 0;
+    checkCobs(buf, 300);
+
+    // Esempio di riferimento (Cheshire & Baker)
+    const uint8_t ref[] = {0x11, 0x22, 0x00, 0x33};
+    const uint8_t expected[] = {0x03, 0x11, 0x22, 0x02, 0x33};
+    uint8_t enc[8];
+    TEST_ASSERT_EQUAL(sizeof(expected), cobsEncode(ref, sizeof(ref), enc));
+    TEST_ASSERT_EQUAL_MEMORY(expected, enc, sizeof(expected));
+}
+
+void test_cobs_rejects_truncated_frame() {
+    const uint8_t bad[] = {0x05, 0x11, 0x22}; // Il codice promette 4 byte, ne arrivano 2
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL(0, cobsDecode(bad, sizeof(bad), out, sizeof(out)));
+}
+
+void test_record_round_trip() {
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    TelemetryDecoder d;
+
+    TelemetryToF tof = {{120, -1, 0, 3000, 85}, 0x1D};
+    size_t n = telemetryEncodeFrame(makeHeader(TLM_TOF, 7, 123456), &tof, sizeof(tof), frame, sizeof(frame));
+    TEST_ASSERT_GREATER_THAN(0, n);
+    TEST_ASSERT_EQUAL(0, frame[n - 1]);
+    TEST_ASSERT_EQUAL(1, feedAll(d, frame, n));
+    TEST_ASSERT_EQUAL(TLM_TOF, d.header().type);
+    TEST_ASSERT_EQUAL(7, d.header().sequence);
+    TEST_ASSERT_EQUAL(123456, d.header().timestampUs);
+    TEST_ASSERT_EQUAL(sizeof(tof), d.payloadLen());
+    TEST_ASSERT_EQUAL_MEMORY(&tof, d.payload(), sizeof(tof));
+
+    TelemetrySpectral spec = {{10, 0, 30.5f, 0, 50, 60}, 150.5f};
+    n = telemetryEncodeFrame(makeHeader(TLM_SPECTRAL, 8, 123999), &spec, sizeof(spec), frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(1, feedAll(d, frame, n));
+    TEST_ASSERT_EQUAL_MEMORY(&spec, d.payload(), sizeof(spec));
+
+    TelemetryColor color = {COLOR_RED, 3, 0.0625f};
+    n = telemetryEncodeFrame(makeHeader(TLM_COLOR, 9, 124000), &color, sizeof(color), frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(1, feedAll(d, frame, n));
+    TEST_ASSERT_EQUAL_MEMORY(&color, d.payload(), sizeof(color));
+
+    TEST_ASSERT_EQUAL(3, d.records());
+    TEST_ASSERT_EQUAL(0, d.lostRecords());
+}
+
+void test_resync_after_text_and_lost_bytes() {
+    uint8_t stream[512];
+    size_t len = 0;
+
+    // Testo di debug prima del flusso, chiuso dal delimitatore iniziale del writer
+    const char* text = "SUM:  120.0 | Detect: BIANCO\r\n";
+    memcpy(stream, text, strlen(text));
+    len += strlen(text);
+    stream[len++] = 0x00;
+
+    len += encodeImu(1, 10.0f, stream + len, sizeof(stream) - len);
+    // Frame troncato a metà (byte persi sulla USB)
+    size_t cut = encodeImu(2, 20.0f, stream + len, sizeof(stream) - len);
+    len += cut / 2;
+    len += encodeImu(3, 30.0f, stream + len, sizeof(stream) - len);
+    len += encodeImu(4, 40.0f, stream + len, sizeof(stream) - len);
+
+    TelemetryDecoder d;
+    TEST_ASSERT_EQUAL(2, feedAll(d, stream, len));
+    TEST_ASSERT_EQUAL(2, d.badFrames()); // Il testo e il frame 2 fuso con il 3
+    // Il record 3 è andato perso con il 2: la sequenza salta da 1 a 4
+    TEST_ASSERT_EQUAL(4, d.header().sequence);
+    TEST_ASSERT_EQUAL(2, d.lostRecords());
+}
+
+void test_corrupted_and_foreign_frames_rejected() {
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    TelemetryDecoder d;
+
+    // Un bit cambiato: CRC errato
+    size_t n = encodeImu(1, 10.0f, frame, sizeof(frame));
+    frame[5] ^= 0x04;
+    if (frame[5] == 0) frame[5] = 0x01;
+    TEST_ASSERT_EQUAL(0, feedAll(d, frame, n));
+    TEST_ASSERT_EQUAL(1, d.badFrames());
+
+    // Schema futuro: scartato senza contarlo come rumore
+    TelemetryImu imu = {1, 2, 3};
+    TelemetryHeader h = makeHeader(TLM_IMU, 2, 0);
+    h.version = TELEMETRY_SCHEMA_VERSION + 1;
+    n = telemetryEncodeFrame(h, &imu, sizeof(imu), frame, sizeof(frame));
+    TelemetryDecoder::Result last = TelemetryDecoder::NONE;
+    for (size_t i = 0; i < n; i++) last = d.feed(frame[i]);
+    TEST_ASSERT_EQUAL(TelemetryDecoder::BAD_VERSION, last);
+
+    // Dimensione incoerente col tipo
+    n = telemetryEncodeFrame(makeHeader(TLM_TOF, 3, 0), &imu, sizeof(imu), frame, sizeof(frame));
+    for (size_t i = 0; i < n; i++) last = d.feed(frame[i]);
+    TEST_ASSERT_EQUAL(TelemetryDecoder::BAD_RECORD, last);
+
+    // Payload oltre il massimo: nessun frame
+    uint8_t big[TELEMETRY_MAX_PAYLOAD + 1] = {0};
+    TEST_ASSERT_EQUAL(0, telemetryEncodeFrame(h, big, sizeof(big), frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL(0, d.records());
+}
+
+void test_benchmark_encode_ns_per_record() {
+    // Record misti come nel flusso reale: IMU a ogni giro, ToF e spettro più radi
+    static volatile bool runtime = true;
+    TelemetryImu imu = {12.5f, -0.75f, 0.5f};
+    TelemetryToF tof = {{150, 80, 0, 1200, 95}, 0x1F};
+    TelemetrySpectral spec = {{40, 90, 220, 150, 60, 40}, 600};
+    if (!runtime) imu.yaw = 0;
+
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    const int rounds = 200000;
+    volatile size_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        imu.yaw += 0.01f;
+        sink += telemetryEncodeFrame(makeHeader(TLM_IMU, (uint16_t)i, i), &imu, sizeof(imu), frame, sizeof(frame));
+        sink += telemetryEncodeFrame(makeHeader(TLM_TOF, (uint16_t)i, i), &tof, sizeof(tof), frame, sizeof(frame));
+        sink += telemetryEncodeFrame(makeHeader(TLM_SPECTRAL, (uint16_t)i, i), &spec, sizeof(spec), frame, sizeof(frame));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (3.0 * rounds);
+    double bytes = (double)sink / (3.0 * rounds);
+    char msg[128];
+    snprintf(msg, sizeof(msg), "codifica: %.1f ns/record, %.1f byte/frame medi", ns, bytes);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cobs_edge_cases);
+    RUN_TEST(test_cobs_rejects_truncated_frame);
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_resync_after_text_and_lost_bytes);
+    RUN_TEST(test_corrupted_and_foreign_frames_rejected);
+    RUN_TEST(test_benchmark_encode_ns_per_record);
+    return UNITY_END();
+}
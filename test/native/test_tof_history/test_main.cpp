@@ -0,0 +1,103 @@
+/*
+ * Test host dello storico ToF: anello con avvolgimento, finestra senza
+ * copie dell'intero array, misure non valide fuori dal filtro, picchi
+ * scartati dal filtro di Hampel e gradini veri accettati.
+ */
+#include <unity.h>
+
+#include "ToFHistory.h"
+
+void setUp() {}
+void tearDown() {}
+
+static RangeSample range(int16_t mm, uint8_t status = 0) {
+    RangeSample s = {mm, status, 1, 1200, 3};
+    return s;
+}
+
+static RangeSample noObject() {
+    RangeSample s = {0, 255, 0, 0, 0};
+    return s;
+}
+
+void test_ring_wraps_and_keeps_newest() {
+    ToFHistory h;
+    TEST_ASSERT_TRUE(h.empty());
+    for (int i = 0; i < TOF_HISTORY_LEN + 5; i++) h.push(range(100), 1000 * i);
+
+    TEST_ASSERT_EQUAL(TOF_HISTORY_LEN, h.size());
+    TEST_ASSERT_EQUAL(1000 * (TOF_HISTORY_LEN + 4), h.latest().timestampUs);
+    TEST_ASSERT_EQUAL(1000 * 5, h.at(TOF_HISTORY_LEN - 1).timestampUs);
+    TEST_ASSERT_EQUAL(1200, h.latest().signalKcps);
+    TEST_ASSERT_EQUAL(3, h.latest().sigmaMm);
+
+    ToFSample last[3];
+    TEST_ASSERT_EQUAL(3, h.window(last, 3));
+    TEST_ASSERT_EQUAL(h.at(2).timestampUs, last[2].timestampUs);
+}
+
+void test_invalid_samples_bypass_filter() {
+    ToFHistory h;
+    TEST_ASSERT_FALSE(h.hasFiltered());
+    TEST_ASSERT_EQUAL(UINT32_MAX, h.ageUs(0));
+
+    h.push(range(150), 1000);
+    h.push(noObject(), 2000);
+    h.push(range(40, 4), 3000);  // Phase fail: oggetto visto, lettura sporca
+
+    TEST_ASSERT_EQUAL(3, h.size());
+    TEST_ASSERT_EQUAL(TOF_NO_OBJECT_MM, h.at(1).distance_mm);
+    TEST_ASSERT_EQUAL(255, h.at(1).rangeStatus);
+    TEST_ASSERT_EQUAL(0, h.latest().flags & TOF_SAMPLE_VALID);
+    TEST_ASSERT_EQUAL(4, h.latest().rangeStatus);
+
+    // L'uscita resta l'ultima misura valida, con la sua età
+    TEST_ASSERT_EQUAL(150, h.filtered());
+    TEST_ASSERT_EQUAL(150, h.latest().filtered_mm);
+    TEST_ASSERT_EQUAL(4000, h.ageUs(5000));
+}
+
+void test_hampel_rejects_spikes() {
+    ToFHistory h;
+    const int16_t wall[] = {200, 203, 198, 201, 199, 202};
+    for (int i = 0; i < 6; i++) h.push(range(wall[i]), 1000 * i);
+    TEST_ASSERT_EQUAL(0, h.outliers());
+
+    // Riflesso spurio: sostituito dalla mediana
+    const ToFSample& spike = h.push(range(60), 7000);
+    TEST_ASSERT_TRUE(spike.flags & TOF_SAMPLE_OUTLIER);
+    TEST_ASSERT_EQUAL(60, spike.distance_mm);
+    TEST_ASSERT_INT_WITHIN(3, 200, spike.filtered_mm);
+    TEST_ASSERT_EQUAL(1, h.outliers());
+
+    // Rumore normale: passa invariato
+    h.push(range(212), 8000);
+    TEST_ASSERT_EQUAL(212, h.filtered());
+}
+
+void test_hampel_follows_real_step() {
+    ToFHistory h;
+    for (int i = 0; i < TOF_HAMPEL_WINDOW; i++) h.push(range(300), 1000 * i);
+
+    // Muro che compare davanti: dopo metà finestra la mediana è il nuovo valore
+    int accepted = -1;
+    for (int i = 0; i < TOF_HAMPEL_WINDOW; i++) {
+        const ToFSample& s = h.push(range(120), 10000 + 1000 * i);
+        if (!(s.flags & TOF_SAMPLE_OUTLIER)) {
+            accepted = i;
+            break;
+        }
+    }
+    TEST_ASSERT_TRUE(accepted >= 0);
+    TEST_ASSERT_TRUE(accepted <= TOF_HAMPEL_WINDOW / 2);
+    TEST_ASSERT_EQUAL(120, h.filtered());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_wraps_and_keeps_newest);
+    RUN_TEST(test_invalid_samples_bypass_filter);
+    RUN_TEST(test_hampel_rejects_spikes);
+    RUN_TEST(test_hampel_follows_real_step);
+    return UNITY_END();
+}
@@ -0,0 +1,151 @@
+/*
+ * Test host della politica di budget/distance mode dei ToF e della sua
+ * applicazione in ToFManager, con un sensore finto su orologio virtuale.
+ */
+#include <unity.h>
+
+#include "HalReplay.h"
+#include "ToFManager.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_mode_hysteresis() {
+    ToFRangingPolicy p;
+    ToFRangingConfig start = {TOF_MODE_LONG, TOF_BUDGET_DEFAULT_US};
+    p.reset(0, start, 0);
+    ToFRangingConfig cfg;
+
+    // Muro a 1 m: nella banda di isteresi si resta in LONG
+    TEST_ASSERT_FALSE(p.evaluate(0, 1000, MOTION_DRIVING, 0, cfg));
+    // Sotto la soglia: SHORT
+    TEST_ASSERT_TRUE(p.evaluate(0, 600, MOTION_DRIVING, 0, cfg));
+    TEST_ASSERT_EQUAL(TOF_MODE_SHORT, cfg.mode);
+    TEST_ASSERT_EQUAL(TOF_BUDGET_DEFAULT_US, cfg.budgetUs);
+    p.onApplied(0, cfg, 0);
+
+    // Tempo minimo: niente cambi, ma l'isteresi segue le misure
+    TEST_ASSERT_FALSE(p.evaluate(0, TOF_NO_OBJECT_MM, MOTION_DRIVING, 1000, cfg));
+    TEST_ASSERT_TRUE(p.evaluate(0, 1000, MOTION_DRIVING, TOF_POLICY_HOLD_US, cfg));
+    TEST_ASSERT_EQUAL(TOF_MODE_LONG, cfg.mode);
+
+    // Lettura sporca: nessuna decisione
+    TEST_ASSERT_FALSE(p.evaluate(0, -1, MOTION_TURNING, TOF_POLICY_HOLD_US, cfg));
+}
+
+void test_budget_follows_distance_and_motion() {
+    ToFRangingPolicy p;
+    ToFRangingConfig start = {TOF_MODE_SHORT, TOF_BUDGET_DEFAULT_US};
+    p.reset(1, start, 0);
+    ToFRangingConfig cfg;
+
+    // Muro nella piastrella: rate
+    TEST_ASSERT_TRUE(p.evaluate(1, 120, MOTION_DRIVING, 0, cfg));
+    TEST_ASSERT_EQUAL(TOF_BUDGET_FAST_US, cfg.budgetUs);
+    // Muro lontano, in rotazione: rate
+    TEST_ASSERT_TRUE(p.evaluate(1, 500, MOTION_TURNING, 0, cfg));
+    TEST_ASSERT_EQUAL(TOF_BUDGET_FAST_US, cfg.budgetUs);
+    // Fermo: precisione
+    TEST_ASSERT_TRUE(p.evaluate(1, 500, MOTION_STATIONARY, 0, cfg));
+    TEST_ASSERT_EQUAL(TOF_BUDGET_SLOW_US, cfg.budgetUs);
+    // In marcia: configurazione attuale, niente da fare
+    TEST_ASSERT_FALSE(p.evaluate(1, 500, MOTION_DRIVING, 0, cfg));
+
+    p.onFailed(1, 0);
+    TEST_ASSERT_FALSE(p.evaluate(1, 120, MOTION_DRIVING, 1000, cfg));
+    TEST_ASSERT_EQUAL(0, p.changes(1));
+}
+
+// Sensore a distanza fissa: dato pronto budget + overhead dopo ogni ripartenza
+class FakeRanging : public RangingDevice {
+public:
+    FakeRanging(int16_t mm) : distance(mm), budgetUs(33000), mode(TOF_MODE_LONG), restartUs(0), reconfigs(0) {}
+
+    const char* name() const override { return "fake"; }
+    uint8_t address() const override { return RobotLayout::TOF[0].address; }
+    void powerDown() override {}
+    void powerUp() override {}
+    bool probeDefault() override { return false; }
+    bool probe() override { return true; }
+    bool initAtDefault() override { return true; }
+    bool attachWarm() override { return true; }
+    void release() override {}
+
+    uint32_t startRanging() override {
+        restartUs = halMicros();
+        return budgetUs;
+    }
+    int checkDataReady(bool& ready) override {
+        ready = halMicros() - restartUs >= budgetUs + TOF_SCHED_OVERHEAD_US;
+        return 0;
+    }
+    int readRange(RangeSample& s) override {
+        s.distance_mm = distance;
+        s.rangeStatus = 0;
+        s.objects = 1;
+        s.signalKcps = 0;
+        s.sigmaMm = 0;
+        restartUs = halMicros();
+        return 0;
+    }
+    uint32_t reconfigure(ToFDistanceMode m, uint32_t b) override {
+        mode = m;
+        budgetUs = b;
+        reconfigs++;
+        restartUs = halMicros();
+        return b;
+    }
+
+    int16_t         distance;
+    uint32_t        budgetUs;
+    ToFDistanceMode mode;
+    uint32_t        restartUs;
+    int             reconfigs;
+};
+
+void test_manager_applies_policy_and_reports_rate() {
+    VirtualClock clock(1000000);
+    halSetClock(&clock);
+
+    FakeRanging near(120), far(2500);
+    RangingDevice* const devices[TOF_COUNT] = {&near, &far, nullptr, nullptr, nullptr};
+    ToFManager tof(devices);
+    TEST_ASSERT_TRUE(tof.begin());
+
+    for (int i = 0; i < 2000; i++) {
+        clock.advance(1000);
+        tof.update();
+    }
+
+    // Muro vicino: SHORT e budget veloce; muro lontano: resta LONG a budget normale
+    TEST_ASSERT_EQUAL(TOF_MODE_SHORT, near.mode);
+    TEST_ASSERT_EQUAL(TOF_BUDGET_FAST_US, near.budgetUs);
+    TEST_ASSERT_EQUAL(1, near.reconfigs);
+    TEST_ASSERT_EQUAL(TOF_MODE_LONG, tof.getRangingConfig(TOF_FRONT_RIGHT).mode);
+    TEST_ASSERT_EQUAL(0, far.reconfigs);
+
+    // Lo scheduler riparte dal nuovo budget: il rate segue
+    float nearHz = tof.getSchedulerStats(TOF_FRONT_LEFT).achievedHz;
+    float farHz = tof.getSchedulerStats(TOF_FRONT_RIGHT).achievedHz;
+    TEST_ASSERT_FLOAT_WITHIN(10.0f, 1e6f / (TOF_BUDGET_FAST_US + TOF_SCHED_OVERHEAD_US), nearHz);
+    TEST_ASSERT_TRUE(nearHz > 2.0f * farHz);
+
+    // Da fermo il sensore lontano passa al budget preciso
+    tof.setMotion(MOTION_STATIONARY);
+    for (int i = 0; i < 500; i++) {
+        clock.advance(1000);
+        tof.update();
+    }
+    TEST_ASSERT_EQUAL(TOF_BUDGET_SLOW_US, far.budgetUs);
+    tof.printSchedulerStats();
+
+    halSetClock(nullptr);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_mode_hysteresis);
+    RUN_TEST(test_budget_follows_distance_and_motion);
+    RUN_TEST(test_manager_applies_policy_and_reports_rate);
+    return UNITY_END();
+}
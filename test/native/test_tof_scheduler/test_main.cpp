@@ -0,0 +1,168 @@
+/*
+ * Test host dello scheduler ToF con clock finto e un VL53L4CX simulato.
+ */
+#include <unity.h>
+#include <cstdio>
+
+#include "ToFScheduler.h"
+
+// VL53L4CX simulato: il dato è pronto 'periodUs' dopo la (ri)partenza
+struct MockVL53L4CX {
+    uint32_t periodUs;
+    uint32_t restartUs;
+    uint32_t readCostUs;
+
+    bool dataReady(uint32_t nowUs) const { return (nowUs - restartUs) >= periodUs; }
+    void clearAndStart(uint32_t nowUs) { restartUs = nowUs; }
+};
+
+// Loop principale simulato: un giro ogni 'loopUs'
+struct SimResult {
+    uint32_t measurements;
+    uint32_t polls;
+    uint32_t wasted;
+};
+
+static const uint32_t BUDGET_US = 33000;
+static const uint32_t LOOP_US = 250;
+static const uint32_t POLL_COST_US = 120;
+
+static SimResult simulate(ToFScheduler& sched, MockVL53L4CX* tofs, uint32_t durationUs, bool irq) {
+    SimResult r = {0, 0, 0};
+    uint32_t now = 0;
+    for (int i = 0; i < TOF_COUNT; i++) {
+        tofs[i].restartUs = now;
+        sched.configure(i, BUDGET_US, now);
+        sched.setInterruptDriven(i, irq);
+    }
+
+    while (now < durationUs) {
+        for (int i = 0; i < TOF_COUNT; i++) {
+            // La ISR di GPIO1 scatta appena il dato è pronto
+            if (irq && tofs[i].dataReady(now)) sched.notifyDataReady(i);
+
+            ToFScheduler::Action a = sched.nextAction(i, now);
+            if (a == ToFScheduler::IDLE) continue;
+
+            bool ready = true;
+            if (a == ToFScheduler::POLL) {
+                now += POLL_COST_US;
+                ready = tofs[i].dataReady(now);
+                sched.onPollResult(i, now, ready);
+                r.polls++;
+                if (!ready) r.wasted++;
+            }
+            if (ready) {
+                uint32_t start = now;
+                now += tofs[i].readCostUs;
+                tofs[i].clearAndStart(now);
+                sched.onReadComplete(i, start, now);
+                r.measurements++;
+            }
+        }
+        now += LOOP_US;
+    }
+    return r;
+}
+
+static void makeSensors(MockVL53L4CX* tofs) {
+    // Periodi reali leggermente diversi dal seme (budget + overhead teorico)
+    const uint32_t periods[TOF_COUNT] = {34100, 35500, 33800, 36900, 34700};
+    for (int i = 0; i < TOF_COUNT; i++) tofs[i] = {periods[i], 0, 450};
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_idle_until_due() {
+    ToFScheduler sched;
+    sched.configure(0, BUDGET_US, 1000);
+    TEST_ASSERT_EQUAL(ToFScheduler::IDLE, sched.nextAction(0, 1000));
+    TEST_ASSERT_EQUAL(ToFScheduler::IDLE, sched.nextAction(0, 1000 + BUDGET_US / 2));
+    TEST_ASSERT_EQUAL(ToFScheduler::POLL, sched.nextAction(0, 1000 + BUDGET_US + TOF_SCHED_OVERHEAD_US));
+    // Sensore non configurato: mai toccato
+    TEST_ASSERT_EQUAL(ToFScheduler::IDLE, sched.nextAction(1, 1000000));
+}
+
+void test_wrap_around_clock() {
+    ToFScheduler sched;
+    uint32_t start = 0xFFFFF000u;
+    sched.configure(0, BUDGET_US, start);
+    TEST_ASSERT_EQUAL(ToFScheduler::IDLE, sched.nextAction(0, start + 100));
+    TEST_ASSERT_EQUAL(ToFScheduler::POLL, sched.nextAction(0, start + BUDGET_US + TOF_SCHED_OVERHEAD_US));
+}
+
+void test_predictive_polling_wastes_little() {
+    static ToFScheduler sched;
+    MockVL53L4CX tofs[TOF_COUNT];
+    makeSensors(tofs);
+
+    SimResult r = simulate(sched, tofs, 10000000, false);
+
+    for (int i = 0; i < TOF_COUNT; i++) {
+        ToFSchedulerStats st = sched.getStats(i);
+        float idealHz = 1000000.0f / (tofs[i].periodUs + tofs[i].readCostUs);
+        char msg[128];
+        snprintf(msg, sizeof(msg), "ToF %d: %.1f Hz (ideale %.1f), poll %u, sprecati %u, periodo appreso %u us",
+                 i, st.achievedHz, idealHz, st.polls, st.wastedPolls, st.periodUs);
+        TEST_MESSAGE(msg);
+
+        // Entro il 5% della frequenza ideale del sensore
+        TEST_ASSERT_FLOAT_WITHIN(idealHz * 0.05f, idealHz, st.achievedHz);
+        // Al massimo ~1.5 poll sprecati per misura (il polling cieco ne spreca >100)
+        TEST_ASSERT_LESS_THAN(st.measurements * 3 / 2, st.wastedPolls);
+        TEST_ASSERT_FLOAT_WITHIN(1500.0f, (float)tofs[i].periodUs, (float)st.periodUs);
+    }
+    TEST_ASSERT_GREATER_THAN(1000, r.measurements);
+}
+
+void test_interrupt_mode_never_polls() {
+    static ToFScheduler sched;
+    MockVL53L4CX tofs[TOF_COUNT];
+    makeSensors(tofs);
+
+    SimResult r = simulate(sched, tofs, 2000000, true);
+
+    TEST_ASSERT_EQUAL_UINT32(0, r.polls);
+    TEST_ASSERT_GREATER_THAN(250, r.measurements);
+    ToFSchedulerStats st = sched.getStats(0);
+    TEST_ASSERT_EQUAL_UINT32(0, st.wastedPolls);
+    TEST_ASSERT_FLOAT_WITHIN(450.0f, 450.0f, st.avgReadLatencyUs);
+}
+
+void test_interrupt_timeout_falls_back_to_poll() {
+    ToFScheduler sched;
+    sched.configure(0, BUDGET_US, 0);
+    sched.setInterruptDriven(0, true);
+    uint32_t period = BUDGET_US + TOF_SCHED_OVERHEAD_US;
+    TEST_ASSERT_EQUAL(ToFScheduler::IDLE, sched.nextAction(0, period * 2));
+    TEST_ASSERT_EQUAL(ToFScheduler::POLL, sched.nextAction(0, period * TOF_SCHED_IRQ_TIMEOUT_PERIODS));
+}
+
+void test_late_poll_does_not_stretch_period() {
+    ToFScheduler sched;
+    MockVL53L4CX tof = {34000, 0, 450};
+    sched.configure(0, BUDGET_US, 0);
+
+    // Primo poll mezzo secondo dopo l'avvio (bias IMU ancora in corso): dato pronto da tempo
+    uint32_t now = 500000;
+    sched.onPollResult(0, now, true);
+    tof.clearAndStart(now + tof.readCostUs);
+    sched.onReadComplete(0, now, now + tof.readCostUs);
+    TEST_ASSERT_FLOAT_WITHIN(1500.0f, (float)(BUDGET_US + TOF_SCHED_OVERHEAD_US), (float)sched.getStats(0).periodUs);
+
+    // Il ciclo successivo viene interrogato di nuovo attorno al periodo reale
+    now += tof.readCostUs + BUDGET_US + TOF_SCHED_OVERHEAD_US;
+    TEST_ASSERT_EQUAL(ToFScheduler::POLL, sched.nextAction(0, now));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_until_due);
+    RUN_TEST(test_wrap_around_clock);
+    RUN_TEST(test_predictive_polling_wastes_little);
+    RUN_TEST(test_interrupt_mode_never_polls);
+    RUN_TEST(test_interrupt_timeout_falls_back_to_poll);
+    RUN_TEST(test_late_poll_does_not_stretch_period);
+    return UNITY_END();
+}
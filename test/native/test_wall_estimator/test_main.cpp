@@ -0,0 +1,164 @@
+/*
+ * Test host dello stimatore dei muri: letture ToF generate da una geometria
+ * sintetica (corridoio di una piastrella, robot spostato e ruotato), isteresi
+ * della presenza, correzione della deriva dello yaw e costo per campione.
+ */
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <math.h>
+
+#include "WallEstimator.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const float DEG = 0.01745329f;
+
+// Robot a offsetMm a destra del centro piastrella, ruotato di headingDeg a sinistra.
+// Muri a ±MAZE_TILE_MM/2 se presenti, muro davanti a frontMm dal centro (-1 = nessuno).
+static ToFData corridor(float offsetMm, float headingDeg, bool left, bool right, float frontMm) {
+    const float half = MAZE_TILE_MM / 2.0f;
+    const float lx = TOF_SIDE_BASELINE_MM / 2.0f;
+    const float s = sinf(headingDeg * DEG), c = cosf(headingDeg * DEG);
+    const float y0 = -offsetMm;  // y verso sinistra
+
+    ToFData tof;
+    // Sensori laterali: posizione (±lx, ±TOF_SIDE_OFFSET_MM) nel robot, raggio perpendicolare
+    const float along[2] = {lx, -lx};
+    const uint8_t leftIds[2] = {TOF_FRONT_LEFT, TOF_BACK_LEFT};
+    const uint8_t rightIds[2] = {TOF_FRONT_RIGHT, TOF_BACK_RIGHT};
+    for (int k = 0; k < 2; k++) {
+        float yl = y0 + along[k] * s + TOF_SIDE_OFFSET_MM * c;
+        float yr = y0 + along[k] * s - TOF_SIDE_OFFSET_MM * c;
+        tof.distance_mm[leftIds[k]] = left ? (int16_t)lroundf((half - yl) / c) : 8888;
+        tof.valid[leftIds[k]] = left;
+        tof.distance_mm[rightIds[k]] = right ? (int16_t)lroundf((yr + half) / c) : 8888;
+        tof.valid[rightIds[k]] = right;
+    }
+    tof.distance_mm[TOF_CENTER] = frontMm > 0 ? (int16_t)lroundf(frontMm / c - TOF_CENTER_OFFSET_MM) : 8888;
+    tof.valid[TOF_CENTER] = frontMm > 0;
+    return tof;
+}
+
+static void feed(WallEstimator& est, const ToFData& tof, int samples) {
+    for (int i = 0; i < samples; i++) est.update(tof);
+}
+
+void test_centered_in_corridor() {
+    WallEstimator est;
+    feed(est, corridor(0, 0, true, true, -1), 10);
+    const WallEstimate& w = est.estimate();
+    TEST_ASSERT_TRUE(w.present[WALL_LEFT]);
+    TEST_ASSERT_TRUE(w.present[WALL_RIGHT]);
+    TEST_ASSERT_FALSE(w.present[WALL_FRONT]);
+    TEST_ASSERT_TRUE(w.headingValid);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, w.headingErrorDeg);
+    TEST_ASSERT_TRUE(w.lateralValid);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, w.lateralOffsetMm);
+    TEST_ASSERT_EQUAL(-1, w.frontDistanceMm);
+}
+
+void test_offset_and_skew_recovered() {
+    WallEstimator est;
+    const float offsets[3] = {-40.0f, 15.0f, 35.0f};
+    const float headings[3] = {-12.0f, 4.0f, 9.0f};
+    for (int i = 0; i < 3; i++) {
+        est.update(corridor(offsets[i], headings[i], true, true, 120.0f));
+        const WallEstimate& w = est.estimate();
+        TEST_ASSERT_FLOAT_WITHIN(0.8f, headings[i], w.headingErrorDeg);
+        TEST_ASSERT_FLOAT_WITHIN(1.5f, offsets[i], w.lateralOffsetMm);
+        TEST_ASSERT_INT_WITHIN(2, 120, w.frontDistanceMm);
+    }
+}
+
+void test_single_wall_uses_tile_width() {
+    WallEstimator est;
+    // Solo muro destro: offset dalla metà piastrella
+    feed(est, corridor(25.0f, 6.0f, false, true, -1), 10);
+    const WallEstimate& w = est.estimate();
+    TEST_ASSERT_FALSE(w.present[WALL_LEFT]);
+    TEST_ASSERT_TRUE(w.present[WALL_RIGHT]);
+    TEST_ASSERT_FLOAT_WITHIN(0.8f, 6.0f, w.headingErrorDeg);
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 25.0f, w.lateralOffsetMm);
+
+    // Un sensore solo (l'altro oltre la fine del muro): presenza sì, angolo no
+    ToFData tof = corridor(0, 0, true, false, -1);
+    tof.distance_mm[TOF_BACK_LEFT] = 600;
+    est.reset();
+    feed(est, tof, 10);
+    TEST_ASSERT_TRUE(est.estimate().lateralValid);
+    TEST_ASSERT_FALSE(est.estimate().headingValid);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, est.estimate().lateralOffsetMm);
+}
+
+void test_presence_hysteresis() {
+    WallEstimator est;
+    ToFData wall = corridor(0, 0, true, true, 100.0f);
+    ToFData open = corridor(0, 0, false, false, -1);
+
+    feed(est, wall, 10);
+    TEST_ASSERT_TRUE(est.estimate().present[WALL_FRONT]);
+    // Un campione spurio non cambia la decisione
+    est.update(open);
+    TEST_ASSERT_TRUE(est.estimate().present[WALL_LEFT]);
+    TEST_ASSERT_TRUE(est.estimate().present[WALL_FRONT]);
+    feed(est, open, 10);
+    TEST_ASSERT_FALSE(est.estimate().present[WALL_LEFT]);
+    TEST_ASSERT_FALSE(est.estimate().lateralValid);
+
+    // Sensori spenti (-1): non votano, la confidenza resta ferma
+    float before = est.estimate().confidence[WALL_RIGHT];
+    ToFData off = open;
+    off.distance_mm[TOF_FRONT_RIGHT] = off.distance_mm[TOF_BACK_RIGHT] = -1;
+    feed(est, off, 5);
+    TEST_ASSERT_EQUAL_FLOAT(before, est.estimate().confidence[WALL_RIGHT]);
+}
+
+void test_yaw_drift_corrected() {
+    WallEstimator est;
+    // Robot a 90° (+3° di errore verso i muri), gyro derivato di +4°
+    ToFData tof = corridor(0, 3.0f, true, true, -1);
+    est.update(tof);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, est.yawCorrection(97.0f));  // Confidenza ancora bassa
+
+    feed(est, tof, 10);
+    float yaw = 97.0f;
+    for (int i = 0; i < 200; i++) yaw += est.yawCorrection(yaw);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 93.0f, yaw);
+
+    // Deriva implausibile (robot a metà curva): nessuna correzione
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, est.yawCorrection(93.0f + 30.0f));
+    // Anche su yaw negativi e oltre un giro
+    TEST_ASSERT_TRUE(est.yawCorrection(-360.0f + 3.0f + 2.0f) < 0.0f);
+}
+
+void test_cost_per_sample() {
+    WallEstimator est;
+    ToFData samples[4] = {corridor(10, 2, true, true, 120), corridor(-20, -5, true, false, -1),
+                          corridor(0, 8, false, true, 60), corridor(5, 0, true, true, -1)};
+    const int n = 200000;
+    float sink = 0.0f;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        est.update(samples[i & 3]);
+        sink += est.yawCorrection(90.0f);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+    TEST_ASSERT_TRUE(sink == sink);  // Tiene vivo il calcolo
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "update + yawCorrection: %.0f ns/campione", ns);
+    TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_centered_in_corridor);
+    RUN_TEST(test_offset_and_skew_recovered);
+    RUN_TEST(test_single_wall_uses_tile_width);
+    RUN_TEST(test_presence_hysteresis);
+    RUN_TEST(test_yaw_drift_corrected);
+    RUN_TEST(test_cost_per_sample);
+    return UNITY_END();
+}